@@ -0,0 +1,129 @@
+// AbsoluteMeter.h - Absolute HID meter encoding (HID_CONTROL_MODE 2)
+//
+// Sends the sensor reading as the value the original Boktai cartridge
+// would return (0xE8 = darkness, 0x00 = extreme), so any level change
+// reaches the emulator in a single report:
+//
+//   Left trigger   cart value, 0x00-0xE8
+//   Right trigger  gauge size (8 or 10) in the high nibble, bars shown on
+//                  the Ojo del Sol in the low nibble
+//   Axis           check byte in the high byte of the HID_SINGLE_ANALOG_AXIS
+//                  axis (sign ignored), low byte fixed at 0x80
+//
+// The check byte is a CRC-8 (poly 0x07) over the tag byte and both trigger
+// bytes. A controller at rest or a player squeezing the triggers fails the
+// check, so no unlock button is needed.
+//
+// This file is also the reference decoder for emulators: it has no Arduino
+// dependencies and can be copied as-is. See "For Emulator Devs.md".
+#ifndef ABSOLUTE_METER_H
+#define ABSOLUTE_METER_H
+
+#include <stdint.h>
+#include <math.h>
+
+static const uint8_t ABS_METER_CART_DARK = 0xE8;    // Cart value in darkness
+static const uint8_t ABS_METER_LEVEL_MAX = 0xE8;    // Sunlight level = 0xE8 - cart value
+static const uint8_t ABS_METER_LEVEL_FULL = 140;    // Lowest level showing a full gauge
+static const uint8_t ABS_METER_CHECK_TAG = 0x0D;
+static const uint8_t ABS_METER_AXIS_LOW = 0x80;     // Keeps the check byte centred in its bucket
+
+// Exclusive upper bound of each bar on the cartridge's 0-140 level scale
+// (Raphi's sensor graph; same curves as GAME_PROFILES in GameProfiles.h)
+static constexpr uint8_t ABS_METER_BOUNDS_8[8] = { 1, 7, 16, 28, 44, 67, 98, 140 };
+static constexpr uint8_t ABS_METER_BOUNDS_10[10] = { 1, 6, 13, 23, 35, 50, 67, 87, 110, 140 };
+
+struct AbsMeterReport {
+  uint8_t triggerLeft;
+  uint8_t triggerRight;
+  int16_t axis;
+};
+
+struct AbsMeterValue {
+  uint8_t cartValue;  // 0x00-0xE8, as read from the cartridge GPIO
+  uint8_t bars;
+  uint8_t numBars;    // 8 (Boktai 1) or 10 (Boktai 2 & 3)
+};
+
+static inline const uint8_t* absMeterBounds(uint8_t numBars) {
+  if (numBars == 8) return ABS_METER_BOUNDS_8;
+  if (numBars == 10) return ABS_METER_BOUNDS_10;
+  return nullptr;
+}
+
+// Bars the game shows for a sunlight level (0 = dark, 0xE8 = extreme)
+static inline uint8_t absMeterBarsFromLevel(uint8_t level, uint8_t numBars) {
+  const uint8_t* bounds = absMeterBounds(numBars);
+  if (bounds == nullptr) return 0;
+  uint8_t bars = 0;
+  while (bars < numBars && level >= bounds[bars]) {
+    bars++;
+  }
+  return bars;
+}
+
+// Keep a level inside the band of the bar count actually shown, so the
+// emulator agrees with the device display when hysteresis holds a bar.
+static inline uint8_t absMeterClampLevelToBars(uint8_t level, uint8_t bars, uint8_t numBars) {
+  const uint8_t* bounds = absMeterBounds(numBars);
+  if (bounds == nullptr) return level;
+  if (bars > numBars) bars = numBars;
+  uint8_t lo = (bars == 0) ? 0 : bounds[bars - 1];
+  uint8_t hi = (bars == numBars) ? ABS_METER_LEVEL_MAX : (uint8_t)(bounds[bars] - 1);
+  if (level < lo) return lo;
+  if (level > hi) return hi;
+  return level;
+}
+
+static inline uint8_t absMeterCheck(uint8_t triggerLeft, uint8_t triggerRight) {
+  const uint8_t data[3] = { ABS_METER_CHECK_TAG, triggerLeft, triggerRight };
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < 3; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+static inline AbsMeterReport absMeterEncode(uint8_t cartValue, uint8_t bars, uint8_t numBars) {
+  AbsMeterReport report;
+  report.triggerLeft = cartValue;
+  report.triggerRight = (uint8_t)((numBars << 4) | (bars & 0x0F));
+  uint8_t check = absMeterCheck(report.triggerLeft, report.triggerRight);
+  report.axis = (int16_t)(uint16_t)(((uint16_t)check << 8) | ABS_METER_AXIS_LOW);
+  return report;
+}
+
+// Validate and unpack a report. Returns false for anything that is not an
+// Ojo del Sol absolute report; the meter should then be left unchanged.
+static inline bool absMeterDecode(const AbsMeterReport& report, AbsMeterValue* out) {
+  uint8_t check = (uint8_t)(((uint16_t)report.axis) >> 8);
+  if (check != absMeterCheck(report.triggerLeft, report.triggerRight)) return false;
+  uint8_t numBars = report.triggerRight >> 4;
+  uint8_t bars = report.triggerRight & 0x0F;
+  if (absMeterBounds(numBars) == nullptr || bars > numBars) return false;
+  if (report.triggerLeft > ABS_METER_CART_DARK) return false;
+  uint8_t level = (uint8_t)(ABS_METER_CART_DARK - report.triggerLeft);
+  if (absMeterBarsFromLevel(level, numBars) != bars) return false;
+  out->cartValue = report.triggerLeft;
+  out->bars = bars;
+  out->numBars = numBars;
+  return true;
+}
+
+// For input APIs that only expose normalized values: triggers 0.0-1.0 and
+// the signed axis -1.0-1.0. Rounding recovers the exact bytes whatever the
+// transport's native trigger resolution (XInput 8-bit, BLE 10-bit).
+static inline bool absMeterDecodeNormalized(float triggerLeft, float triggerRight, float axis,
+                                            AbsMeterValue* out) {
+  AbsMeterReport report;
+  report.triggerLeft = (uint8_t)lroundf(fminf(fmaxf(triggerLeft, 0.0f), 1.0f) * 255.0f);
+  report.triggerRight = (uint8_t)lroundf(fminf(fmaxf(triggerRight, 0.0f), 1.0f) * 255.0f);
+  long raw = lroundf(fminf(fmaxf(axis, -1.0f), 1.0f) * 32767.0f);
+  report.axis = (int16_t)raw;
+  return absMeterDecode(report, out);
+}
+
+#endif // ABSOLUTE_METER_H
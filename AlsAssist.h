@@ -0,0 +1,428 @@
+// AlsAssist.h - Fast sun/shade step detection from the LTR390's ALS channel
+//
+// A UV sample in the shade range integrates for 400 ms, so walking from sun
+// into shade shows up first as one mixed sample and only fully in the one
+// after it; smoothing or hysteresis then add more samples on top. The
+// LTR390 has one ADC, shared by the UVS and ALS channels, so the two cannot
+// run side by side. Instead, with UV_ALS_ASSIST_ENABLED, every UV sample is
+// followed by one 25 ms ALS conversion (gain 1, 16-bit) before the next UV
+// integration starts. Only in the slow UV range, though: a fast-range UV
+// sample (100 ms) already tracks a step nearly as quickly, and the ALS slot
+// would stretch every period by a third, so there the assist is off
+// (alsAssistInRange()).
+//
+// Consecutive ALS readings bracket the UV integration between them. When
+// they agree, the light was steady and the pair teaches the detector the
+// UVI-per-ALS-count ratio for that light level. Sky light in the shade is
+// richer in UV than direct sun, so ratios are kept per power-of-two ALS
+// bucket. When two ALS readings differ by more than stepRatio, the light
+// has stepped: the detector returns a provisional UVI from the new ALS
+// reading and the learned ratio. The caller shows it at once, restarts its
+// filters at that level, and lets the next full UV sample (integrated
+// entirely after the step) confirm or correct it.
+//
+// alsAssistSimulate() replays synthetic sun/shade transitions through a
+// model of the sensor timing and measures how long the bar output takes to
+// settle, with and without the assist (serial command 'a', and
+// host/als_assist_bench for more scenes and seeds).
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef ALS_ASSIST_H
+#define ALS_ASSIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+static const int ALS_ASSIST_BUCKETS = 17;   // floor(log2(counts)) for 16-bit data
+static const uint32_t ALS_ASSIST_SLOT_MS = 30;   // One ALS conversion plus register writes
+
+// Whether the assist runs in a UV range. In the fast range the slot costs
+// more than it saves: host/als_assist_bench measured slower averages and
+// worst cases there (slow walks, instant edges, haze).
+static inline bool alsAssistInRange(bool fastRange) {
+  return !fastRange;
+}
+
+struct AlsAssistConfig {
+  float stepRatio;      // ALS change (either direction) that counts as a step
+  float stableRatio;    // ALS change small enough to learn from the pair
+  float learnWeight;    // Weight of a new pair in its bucket's ratio
+  uint32_t minCounts;   // Too dark below this to judge steps
+};
+
+class AlsTransientDetector {
+public:
+  void configure(const AlsAssistConfig& config) {
+    cfg = config;
+    reset();
+  }
+
+  void reset() {
+    for (int i = 0; i < ALS_ASSIST_BUCKETS; i++) {
+      ratio[i] = 0.0f;
+    }
+    haveAls = false;
+    haveUv = false;
+    stepCount = 0;
+  }
+
+  // The assist was paused (fast range): the last ALS reading is too old to
+  // compare with, but the learned ratios still hold
+  void resume() {
+    haveAls = false;
+    haveUv = false;
+  }
+
+  // The UV sample that just finished (UVI), before its ALS slot
+  void uvSample(float uvi) {
+    lastUvi = uvi;
+    haveUv = true;
+  }
+
+  // ALS counts from the slot after a UV sample. Returns true on a step with
+  // *provisionalUvi from the learned ratio; false if the light is steady,
+  // too dark, or nothing has been learned near this level yet.
+  bool alsSample(uint32_t counts, float* provisionalUvi) {
+    bool step = false;
+    bool stable = false;
+    if (haveAls && (counts >= cfg.minCounts || prevCounts >= cfg.minCounts)) {
+      float change = (float)(counts + 1) / (float)(prevCounts + 1);
+      step = change >= cfg.stepRatio || change * cfg.stepRatio <= 1.0f;
+      stable = change <= cfg.stableRatio && change * cfg.stableRatio >= 1.0f;
+    }
+    if (stable && haveUv && counts >= cfg.minCounts) {
+      // Steady across the UV integration: learn this level's ratio
+      int b = bucket(counts);
+      float r = lastUvi / (float)counts;
+      ratio[b] = (ratio[b] > 0.0f) ? ratio[b] + cfg.learnWeight * (r - ratio[b]) : r;
+    }
+    prevCounts = counts;
+    haveAls = true;
+    haveUv = false;
+    if (!step) {
+      return false;
+    }
+    stepCount++;
+    float r = ratioNear(counts);
+    if (r <= 0.0f) {
+      return false;
+    }
+    *provisionalUvi = r * (float)counts;
+    return true;
+  }
+
+  uint32_t steps() const { return stepCount; }
+  uint32_t lastCounts() const { return prevCounts; }
+  int bucketsLearned() const {
+    int n = 0;
+    for (int i = 0; i < ALS_ASSIST_BUCKETS; i++) {
+      n += (ratio[i] > 0.0f) ? 1 : 0;
+    }
+    return n;
+  }
+
+private:
+  static int bucket(uint32_t counts) {
+    int b = 0;
+    while (counts > 1 && b < ALS_ASSIST_BUCKETS - 1) {
+      counts >>= 1;
+      b++;
+    }
+    return b;
+  }
+
+  // Ratio of the bucket for these counts, or of the nearest learned one
+  float ratioNear(uint32_t counts) const {
+    int b = bucket(counts);
+    for (int d = 0; d < ALS_ASSIST_BUCKETS; d++) {
+      if (b - d >= 0 && ratio[b - d] > 0.0f) {
+        return ratio[b - d];
+      }
+      if (b + d < ALS_ASSIST_BUCKETS && ratio[b + d] > 0.0f) {
+        return ratio[b + d];
+      }
+    }
+    return 0.0f;
+  }
+
+  AlsAssistConfig cfg = { 1.6f, 1.1f, 0.25f, 50 };
+  float ratio[ALS_ASSIST_BUCKETS] = {};
+  float lastUvi = 0.0f;
+  uint32_t prevCounts = 0;
+  bool haveAls = false;
+  bool haveUv = false;
+  uint32_t stepCount = 0;
+};
+
+// ---- Step-response replay ----
+
+struct AlsSimConfig {
+  bool assist;
+  uint32_t uvIntegrationMs;   // 400 (shade range) or 100 (bright range)
+  uint32_t uvPeriodMs;        // UV sample period without the assist
+  uint32_t alsSlotMs;         // ALS conversion plus register writes
+  float sunUvi;
+  float shadeUvi;
+  float sunCountsPerUvi;      // ALS counts per UVI in direct sun
+  float shadeCountsPerUvi;    // ... in the shade (fewer: sky light is UV-rich)
+  uint32_t holdMinMs;         // Time between transitions, uniformly random
+  uint32_t holdMaxMs;
+  uint32_t rampMs;            // Time to walk through the sun/shade edge
+  uint32_t noisePermille;     // Reading noise, +/- uniform
+  float smoothingAlpha;       // UVI_SMOOTHING_ALPHA, or 0 for none
+  float hysteresisUvi;        // BAR_HYSTERESIS, or 0 for none
+  const float* barStarts;     // UVI where bars 1..numBars start, ascending
+  int numBars;
+  uint32_t durationMs;
+  uint32_t seed;
+  AlsAssistConfig detector;
+};
+
+struct AlsSimResult {
+  uint32_t transitions;
+  uint32_t settled;           // Transitions the bars reached before the next
+  uint32_t latencyAvgMs;      // Transition start -> bars first at the new level
+  uint32_t latencyMaxMs;
+  uint32_t shadeAvgMs;        // Same, sun -> shade only
+  uint32_t shadeSettled;      // Sun -> shade transitions settled
+  uint32_t provisionals;      // Provisional bars shown
+  uint32_t provisionalExact;  // ... that were already the settled level
+  uint32_t falseSteps;        // Steps detected with no transition nearby
+};
+
+static inline uint32_t alsSimRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static inline int alsSimBars(const AlsSimConfig& c, float uvi, int lastBars, float margin) {
+  int target = 0;
+  while (target < c.numBars && uvi >= c.barStarts[target]) {
+    target++;
+  }
+  if (margin <= 0.0f || lastBars < 0 || target == lastBars) {
+    return target;
+  }
+  if (target > lastBars) {
+    return (uvi >= c.barStarts[lastBars] + margin) ? target : lastBars;
+  }
+  return (uvi < c.barStarts[lastBars - 1] - margin) ? target : lastBars;
+}
+
+// Light and transition bookkeeping for alsAssistSimulate(). Queries must
+// come in time order.
+struct AlsSimLight {
+  const AlsSimConfig* c;
+  uint32_t* rng;
+  bool sun;
+  uint64_t lastEdgeMs;
+  uint64_t nextEdgeMs;
+  bool pending;               // A transition the bars have not reached yet
+  uint64_t pendingSinceMs;
+  int pendingTarget;
+  bool pendingToShade;
+
+  uint64_t hold() {
+    uint32_t span = (c->holdMaxMs > c->holdMinMs) ? c->holdMaxMs - c->holdMinMs : 0;
+    return c->holdMinMs + (span ? alsSimRandom(rng) % (span + 1) : 0);
+  }
+
+  // Advance to t; returns true if a new transition started on the way
+  bool advance(uint64_t t, AlsSimResult* r) {
+    bool started = false;
+    while (t >= nextEdgeMs) {
+      if (nextEdgeMs < c->durationMs) {
+        r->transitions++;   // Counted as it starts, so runs of any timing agree
+      }
+      sun = !sun;
+      lastEdgeMs = nextEdgeMs;
+      nextEdgeMs += hold();
+      pending = true;
+      pendingSinceMs = lastEdgeMs;
+      pendingTarget = alsSimBars(*c, sun ? c->sunUvi : c->shadeUvi, -1, 0.0f);
+      pendingToShade = !sun;
+      started = true;
+    }
+    return started;
+  }
+
+  // UVI and ALS counts at t (linear across the ramp after an edge)
+  void at(uint64_t t, float* uvi, float* counts) const {
+    float toUvi = sun ? c->sunUvi : c->shadeUvi;
+    float fromUvi = sun ? c->shadeUvi : c->sunUvi;
+    float toCpu = sun ? c->sunCountsPerUvi : c->shadeCountsPerUvi;
+    float fromCpu = sun ? c->shadeCountsPerUvi : c->sunCountsPerUvi;
+    float f = 1.0f;
+    if (c->rampMs > 0 && t < lastEdgeMs + c->rampMs && lastEdgeMs > 0) {
+      f = (float)(t - lastEdgeMs) / (float)c->rampMs;
+    }
+    *uvi = fromUvi + f * (toUvi - fromUvi);
+    *counts = fromUvi * fromCpu + f * (toUvi * toCpu - fromUvi * fromCpu);
+  }
+};
+
+static inline void alsAssistSimulate(const AlsSimConfig& c, AlsSimResult* result) {
+  *result = AlsSimResult{};
+  // Separate streams, so the assist's extra ALS readings draw noise without
+  // changing the light: runs with and without it see the same transitions
+  uint32_t rng = c.seed ? c.seed : 1;
+  uint32_t noiseRng = rng ^ 0x9E3779B9u;
+  AlsSimLight light = { &c, &rng, true, 0, 0, false, 0, 0, false };
+  light.nextEdgeMs = light.hold();
+
+  AlsTransientDetector detector;
+  detector.configure(c.detector);
+  auto noisy = [&](float v) -> float {
+    if (c.noisePermille == 0) {
+      return v;
+    }
+    int32_t n = (int32_t)(alsSimRandom(&noiseRng) % (2 * c.noisePermille + 1)) - (int32_t)c.noisePermille;
+    return v * (1.0f + n / 1000.0f);
+  };
+
+  float smoothed = 0.0f;
+  bool primed = false;
+  bool confirmPending = false;
+  int bars = -1;
+  uint64_t latencySumMs = 0;
+  uint64_t shadeSumMs = 0;
+
+  // Show a bar value at time t and settle any pending transition it reaches
+  auto output = [&](uint64_t t, float uvi, bool snap) {
+    if (snap || !primed || c.smoothingAlpha <= 0.0f) {
+      smoothed = uvi;
+      primed = true;
+    } else {
+      smoothed = c.smoothingAlpha * uvi + (1.0f - c.smoothingAlpha) * smoothed;
+    }
+    bars = alsSimBars(c, smoothed, bars, snap ? 0.0f : c.hysteresisUvi);
+    if (light.pending && bars == light.pendingTarget && light.pendingSinceMs < c.durationMs) {
+      uint64_t latencyMs = t - light.pendingSinceMs;
+      latencySumMs += latencyMs;
+      if (latencyMs > result->latencyMaxMs) {
+        result->latencyMaxMs = (uint32_t)latencyMs;
+      }
+      if (light.pendingToShade) {
+        shadeSumMs += latencyMs;
+        result->shadeSettled++;
+      }
+      result->settled++;
+      light.pending = false;
+    }
+  };
+
+  uint64_t t = 0;
+  while (t < c.durationMs) {
+    // One UV integration, averaged over 1 ms steps
+    uint64_t end = t + c.uvIntegrationMs;
+    float sum = 0.0f;
+    float uvi = 0.0f;
+    float counts = 0.0f;
+    for (uint64_t s = t; s < end; s++) {
+      light.advance(s, result);
+      light.at(s, &uvi, &counts);
+      sum += uvi;
+    }
+    light.advance(end, result);
+    float uvSample = noisy(sum / (float)c.uvIntegrationMs);
+    bool snap = confirmPending;
+    confirmPending = false;
+    output(end, uvSample, snap);
+
+    if (!c.assist) {
+      t += (c.uvPeriodMs > c.uvIntegrationMs) ? c.uvPeriodMs : c.uvIntegrationMs;
+      continue;
+    }
+    // ALS slot: a short conversion right after the UV sample
+    detector.uvSample(uvSample);
+    uint64_t alsEnd = end + c.alsSlotMs;
+    light.advance(alsEnd, result);
+    light.at(end + c.alsSlotMs / 2, &uvi, &counts);
+    float provisional = 0.0f;
+    uint32_t stepsBefore = detector.steps();
+    bool shown = detector.alsSample((uint32_t)noisy(counts), &provisional);
+    if (detector.steps() != stepsBefore) {
+      bool nearEdge = (alsEnd - light.lastEdgeMs) <= (uint64_t)c.uvIntegrationMs + c.alsSlotMs + c.rampMs;
+      if (!nearEdge) {
+        result->falseSteps++;
+      }
+    }
+    if (shown) {
+      int target = light.pendingTarget;
+      output(alsEnd, provisional, true);
+      result->provisionals++;
+      if (bars == target) {
+        result->provisionalExact++;
+      }
+      confirmPending = true;
+    }
+    t = alsEnd;
+  }
+  result->latencyAvgMs = result->settled ? (uint32_t)(latencySumMs / result->settled) : 0;
+  result->shadeAvgMs = result->shadeSettled ? (uint32_t)(shadeSumMs / result->shadeSettled) : 0;
+}
+
+// ---- Scenes shared by the 'a' command and host/als_assist_bench ----
+
+struct AlsSimScene {
+  const char* name;
+  float sunUvi;
+  float shadeUvi;
+  uint32_t rampMs;
+};
+
+// "walk" is the device's scene; the others bracket it: an instant edge, a
+// slow walk through a wide shadow, and a hazy day with a smaller step
+static const AlsSimScene ALS_SIM_SCENES[] = {
+  { "walk", 8.5f, 2.5f, 150 },
+  { "edge", 8.5f, 2.5f, 0 },
+  { "slow_walk", 8.5f, 2.5f, 1000 },
+  { "haze", 4.5f, 1.5f, 150 },
+};
+static const int ALS_SIM_SCENE_COUNT = (int)(sizeof(ALS_SIM_SCENES) / sizeof(ALS_SIM_SCENES[0]));
+static const char* const ALS_SIM_RANGE_NAMES[2] = { "slow", "fast" };
+
+// Sensor timing for the slow (400 ms in a 500 ms period) or fast (100 ms)
+// UV range, and a scene's light: steps every 3-15 s, 2% noise, sun ALS
+// counts per UVI 5/3 of the shade's. The caller fills in the bars, the
+// smoothing and hysteresis, and the detector settings. As on the device,
+// asking for the assist in the fast range runs without it.
+static inline AlsSimConfig alsSimSceneConfig(const AlsSimScene& scene, bool fastRange, bool assist,
+                                             uint32_t durationMs, uint32_t seed) {
+  AlsSimConfig config = {};
+  config.assist = assist && alsAssistInRange(fastRange);
+  config.uvIntegrationMs = fastRange ? 100 : 400;
+  config.uvPeriodMs = fastRange ? 100 : 500;
+  config.alsSlotMs = ALS_ASSIST_SLOT_MS;
+  config.sunUvi = scene.sunUvi;
+  config.shadeUvi = scene.shadeUvi;
+  config.sunCountsPerUvi = 5000.0f;
+  config.shadeCountsPerUvi = 3000.0f;
+  config.holdMinMs = 3000;
+  config.holdMaxMs = 15000;
+  config.rampMs = scene.rampMs;
+  config.noisePermille = 20;
+  config.durationMs = durationMs;
+  config.seed = seed;
+  return config;
+}
+
+static const char* const ALS_SIM_TABLE_HEADER =
+    "# range assist transitions settled lat_avg_ms lat_max_ms shade_avg_ms provisional exact false_steps";
+
+static inline int alsSimFormatRow(char* out, size_t size, const char* range, bool assist,
+                                  const AlsSimResult& result) {
+  return snprintf(out, size, "%s %s %lu %lu %lu %lu %lu %lu %lu %lu", range, assist ? "on" : "off",
+                  (unsigned long)result.transitions, (unsigned long)result.settled,
+                  (unsigned long)result.latencyAvgMs, (unsigned long)result.latencyMaxMs,
+                  (unsigned long)result.shadeAvgMs, (unsigned long)result.provisionals,
+                  (unsigned long)result.provisionalExact, (unsigned long)result.falseSteps);
+}
+
+#endif // ALS_ASSIST_H
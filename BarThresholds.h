@@ -0,0 +1,238 @@
+// BarThresholds.h - Raw UVS count -> UVI -> Boktai bars
+//
+// The float path (measured UVI, enclosure compensation, game UV range,
+// GAME_BAR_RATIOS and the optional BAR_HYSTERESIS margin) and the raw-count
+// tables folded from it. BarRawTables::rebuild() bisects the 20-bit range
+// against the float path once per divisor change, so classifying an
+// unsmoothed sample is a handful of integer compares and gives the same
+// answer as the float path for every count.
+//
+// The firmware fills a BarThresholdConfig from config.h
+// (getBarThresholdConfig() in FirmwareConfig.h); host tests build their own to cover the
+// manual-range, hysteresis and compensation variants.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef BAR_THRESHOLDS_H
+#define BAR_THRESHOLDS_H
+
+#include <stdint.h>
+#include <math.h>
+#include "GameProfiles.h"
+
+static const uint32_t BAR_RAW_MAX = 0xFFFFF;         // LTR390 20-bit data registers
+static const uint32_t BAR_RAW_NEVER = 0xFFFFFFFF;    // Threshold not reachable by any 20-bit count
+
+struct BarThresholdConfig {
+  float uvMin[NUM_GAMES];      // UVI at the start of bar 1
+  float uvSat[NUM_GAMES];      // UVI where the gauge is full
+  bool enclosureComp;          // UV_ENCLOSURE_COMP_ENABLED
+  float transmittance;         // UV_ENCLOSURE_TRANSMITTANCE
+  float offsetUvi;             // UV_ENCLOSURE_UVI_OFFSET
+  bool openAirThresholds;      // UV_THRESHOLDS_CALIBRATED_OPEN_AIR: compare compensated UVI
+  float hysteresis;            // UVI margin for bar changes, 0 = off
+};
+
+static inline int barGameIndex(int game) {
+  if (game < 0) return 0;
+  if (game >= NUM_GAMES) return NUM_GAMES - 1;
+  return game;
+}
+
+static inline float barMeasuredUvi(uint32_t rawUVS, float divisor) {
+  return (float)rawUVS / divisor;
+}
+
+static inline float barCompensateUvi(const BarThresholdConfig& cfg, float measuredUvi) {
+  if (!cfg.enclosureComp || cfg.transmittance <= 0.0f) {
+    return measuredUvi;
+  }
+  float corrected = (measuredUvi - cfg.offsetUvi) / cfg.transmittance;
+  return (corrected < 0.0f) ? 0.0f : corrected;
+}
+
+// UVI the bar thresholds are compared against
+static inline float barCompareUvi(const BarThresholdConfig& cfg, uint32_t rawUVS, float divisor) {
+  float measuredUvi = barMeasuredUvi(rawUVS, divisor);
+  return cfg.openAirThresholds ? barCompensateUvi(cfg, measuredUvi) : measuredUvi;
+}
+
+// UVI at which bar `barIndex` (1-based, clamped to the game's bars) starts
+static inline float barThreshold(const BarThresholdConfig& cfg, int game, int barIndex) {
+  game = barGameIndex(game);
+  int numBars = GAME_BARS[game];
+  if (barIndex < 1) barIndex = 1;
+  if (barIndex > numBars) barIndex = numBars;
+  float uvMin = cfg.uvMin[game];
+  float uvSat = cfg.uvSat[game];
+  if (uvSat <= uvMin) return uvMin;
+  return uvMin + GAME_BAR_RATIOS[game][barIndex - 1] * (uvSat - uvMin);
+}
+
+static inline int barsForUvi(const BarThresholdConfig& cfg, float uvi, int game) {
+  game = barGameIndex(game);
+  int numBars = GAME_BARS[game];
+  float uvMin = cfg.uvMin[game];
+  float uvSat = cfg.uvSat[game];
+
+  if (uvSat <= uvMin) {
+    return (uvi >= uvMin) ? numBars : 0;
+  }
+  if (uvi < uvMin) return 0;
+  if (uvi >= uvSat) return numBars;
+
+  // Scale UVI to [0, 1) within the configured range and look up in Raphi's table.
+  // Bar N+1 starts where bar N's exclusive upper bound falls (ratio = (upper_bound-1)/139).
+  float ratio = (uvi - uvMin) / (uvSat - uvMin);
+  const float* ratios = GAME_BAR_RATIOS[game];
+  for (int i = numBars - 1; i >= 0; i--) {
+    if (ratio >= ratios[i]) {
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+// Bar starts in UVI x1000 for the fixed-point filter (uvFilterBars()),
+// INT32_MAX past the game's last bar
+static inline void barBuildStartsMilli(const BarThresholdConfig& cfg, int32_t starts[NUM_GAMES][GAME_MAX_BARS]) {
+  for (int game = 0; game < NUM_GAMES; game++) {
+    for (int k = 1; k <= GAME_MAX_BARS; k++) {
+      starts[game][k - 1] = (k <= GAME_BARS[game]) ? (int32_t)lroundf(barThreshold(cfg, game, k) * 1000.0f)
+                                                   : INT32_MAX;
+    }
+  }
+}
+
+// Bars with an explicit UVI margin against changing away from lastBars
+static inline int barsForUviWithMargin(const BarThresholdConfig& cfg, float uvi, int game, int lastBars,
+                                       float margin) {
+  game = barGameIndex(game);
+  int numBars = GAME_BARS[game];
+  int target = barsForUvi(cfg, uvi, game);
+
+  if (margin <= 0.0f) {
+    return target;
+  }
+  if (lastBars < 0) lastBars = 0;
+  if (lastBars > numBars) lastBars = numBars;
+
+  if (target > lastBars) {
+    float upThreshold = barThreshold(cfg, game, lastBars + 1);
+    return (uvi >= (upThreshold + margin)) ? target : lastBars;
+  }
+  if (target < lastBars) {
+    // lastBars > 0 guaranteed: clamped to [0, numBars] above and target < lastBars
+    float downThreshold = barThreshold(cfg, game, lastBars);
+    return (uvi < (downThreshold - margin)) ? target : lastBars;
+  }
+  return lastBars;
+}
+
+static inline int barsForUviWithHysteresis(const BarThresholdConfig& cfg, float uvi, int game, int lastBars) {
+  return barsForUviWithMargin(cfg, uvi, game, lastBars, cfg.hysteresis);
+}
+
+// Bar thresholds pre-folded into raw UVS counts (divisor, enclosure
+// compensation, UV range, Raphi ratios and hysteresis margins).
+class BarRawTables {
+public:
+  void rebuild(const BarThresholdConfig& cfg, float divisor) {
+    _hysteresis = cfg.hysteresis > 0.0f;
+    for (int game = 0; game < NUM_GAMES; game++) {
+      int numBars = GAME_BARS[game];
+      _up[game][0] = 0;
+      _down[game][0] = 0;
+      for (int k = 1; k <= GAME_MAX_BARS; k++) {
+        if (k > numBars) {
+          _starts[game][k - 1] = BAR_RAW_NEVER;
+          _up[game][k] = BAR_RAW_NEVER;
+          _down[game][k] = BAR_RAW_NEVER;
+          continue;
+        }
+        _starts[game][k - 1] = rawForBars(cfg, divisor, game, k);
+        // Same float expressions as barsForUviWithMargin()
+        float barStart = barThreshold(cfg, game, k);
+        _up[game][k] = rawForUvi(cfg, divisor, barStart + cfg.hysteresis);
+        _down[game][k] = rawForUvi(cfg, divisor, barStart - cfg.hysteresis);
+      }
+    }
+  }
+
+  // Integer equivalent of barsForUvi(cfg, barCompareUvi(cfg, raw, divisor), game)
+  int bars(uint32_t rawUVS, int game) const {
+    const uint32_t* starts = _starts[barGameIndex(game)];
+    int bars = 0;
+    for (int i = 0; i < GAME_MAX_BARS; i++) {
+      bars += (rawUVS >= starts[i]) ? 1 : 0;
+    }
+    return bars;
+  }
+
+  // Integer equivalent of barsForUviWithHysteresis(cfg, barCompareUvi(...), game, lastBars)
+  int barsWithHysteresis(uint32_t rawUVS, int game, int lastBars) const {
+    game = barGameIndex(game);
+    int numBars = GAME_BARS[game];
+    int target = bars(rawUVS, game);
+
+    if (!_hysteresis) {
+      return target;
+    }
+    if (lastBars < 0) lastBars = 0;
+    if (lastBars > numBars) lastBars = numBars;
+    if (target > lastBars) {
+      return (rawUVS >= _up[game][lastBars + 1]) ? target : lastBars;
+    }
+    if (target < lastBars) {
+      return (rawUVS < _down[game][lastBars]) ? target : lastBars;
+    }
+    return lastBars;
+  }
+
+  // Lowest raw count that shows at least `barIndex` bars (1-based)
+  uint32_t start(int game, int barIndex) const {
+    if (barIndex < 1 || barIndex > GAME_MAX_BARS) return BAR_RAW_NEVER;
+    return _starts[barGameIndex(game)][barIndex - 1];
+  }
+
+private:
+  // The raw -> UVI -> bars chain is monotonic, so a bisection over the
+  // 20-bit range reproduces the float comparisons exactly.
+  static uint32_t rawForBars(const BarThresholdConfig& cfg, float divisor, int game, int bar) {
+    uint32_t lo = 0;
+    uint32_t hi = BAR_RAW_MAX + 1;
+    while (lo < hi) {
+      uint32_t mid = lo + ((hi - lo) / 2);
+      if (barsForUvi(cfg, barCompareUvi(cfg, mid, divisor), game) >= bar) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    return (lo > BAR_RAW_MAX) ? BAR_RAW_NEVER : lo;
+  }
+
+  static uint32_t rawForUvi(const BarThresholdConfig& cfg, float divisor, float threshold) {
+    uint32_t lo = 0;
+    uint32_t hi = BAR_RAW_MAX + 1;
+    while (lo < hi) {
+      uint32_t mid = lo + ((hi - lo) / 2);
+      if (barCompareUvi(cfg, mid, divisor) >= threshold) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    return (lo > BAR_RAW_MAX) ? BAR_RAW_NEVER : lo;
+  }
+
+  bool _hysteresis = false;
+  // [game][k - 1] = lowest raw count that shows at least k bars
+  uint32_t _starts[NUM_GAMES][GAME_MAX_BARS] = {};
+  // [game][k] = lowest raw count that enters bar k from k - 1 (hysteresis up)
+  uint32_t _up[NUM_GAMES][GAME_MAX_BARS + 1] = {};
+  // [game][k] = raw counts below this leave bar k for a lower bar (hysteresis down)
+  uint32_t _down[NUM_GAMES][GAME_MAX_BARS + 1] = {};
+};
+
+#endif // BAR_THRESHOLDS_H
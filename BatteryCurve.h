@@ -0,0 +1,62 @@
+// BatteryCurve.h - LiPo state of charge from voltage
+//
+// A single-cell LiPo spends most of its capacity between ~3.7 V and ~3.9 V,
+// so a straight line from VOLT_MIN to VOLT_MAX reads far too high on a
+// fresh charge drop and then falls off a cliff near the end. This maps the
+// resting (open-circuit) cell voltage through a typical discharge curve
+// instead, interpolating between points.
+//
+// The voltage measured while the device runs sits below the resting
+// voltage by the load current times the cell and wiring resistance;
+// callers add that sag back (BATTERY_SAG_MV) before the lookup.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef BATTERY_CURVE_H
+#define BATTERY_CURVE_H
+
+#include <stdint.h>
+
+struct BatteryCurvePoint {
+  int32_t mv;
+  int32_t pct;
+};
+
+// Resting voltage of a typical 1S LiPo vs. remaining capacity, ~0.2C
+// discharge. Highest voltage first.
+static const BatteryCurvePoint LIPO_CURVE[] = {
+  { 4200, 100 }, { 4150, 95 }, { 4110, 90 }, { 4080, 85 }, { 4020, 80 },
+  { 3980, 75 },  { 3950, 70 }, { 3910, 65 }, { 3870, 60 }, { 3850, 55 },
+  { 3840, 50 },  { 3820, 45 }, { 3800, 40 }, { 3790, 35 }, { 3770, 30 },
+  { 3750, 25 },  { 3730, 20 }, { 3710, 15 }, { 3690, 10 }, { 3610, 5 },
+  { 3300, 0 }
+};
+static const int LIPO_CURVE_POINTS = sizeof(LIPO_CURVE) / sizeof(LIPO_CURVE[0]);
+
+// Percent (0-100) for a resting voltage in mV
+static inline int batteryCurvePercent(int32_t restMv) {
+  if (restMv >= LIPO_CURVE[0].mv) {
+    return 100;
+  }
+  for (int i = 1; i < LIPO_CURVE_POINTS; i++) {
+    const BatteryCurvePoint& hi = LIPO_CURVE[i - 1];
+    const BatteryCurvePoint& lo = LIPO_CURVE[i];
+    if (restMv >= lo.mv) {
+      // Round to nearest
+      int32_t span = hi.mv - lo.mv;
+      return (int)(lo.pct + ((restMv - lo.mv) * (hi.pct - lo.pct) + span / 2) / span);
+    }
+  }
+  return 0;
+}
+
+// The previous linear mapping (BATTERY_LIPO_CURVE_ENABLED = false)
+static inline int batteryLinearPercent(int32_t mv, int32_t minMv, int32_t maxMv) {
+  if (maxMv <= minMv) {
+    return 0;  // Guard: VOLT_MAX must be greater than VOLT_MIN
+  }
+  int32_t pct = ((mv - minMv) * 100) / (maxMv - minMv);
+  return (pct < 0) ? 0 : (pct > 100) ? 100 : (int)pct;
+}
+
+#endif // BATTERY_CURVE_H
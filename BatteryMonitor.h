@@ -0,0 +1,224 @@
+// BatteryMonitor.h - Battery voltage sampling off the main loop
+//
+// loop() used to spend ten back-to-back analogRead() calls per battery
+// update, converting with a nominal 3.3 V full scale. Here a low-priority
+// task runs the ADC in continuous (DMA) mode once per period: one burst of
+// BATTERY_ADC_OVERSAMPLE conversions is averaged by the driver and
+// converted to millivolts with the chip's eFuse calibration. Bursts are
+// median-of-3 filtered (a BLE or flash current spike lands in one burst)
+// and then low-passed, so callers see a steady voltage. loop() only picks
+// up the latest result, and can ask to be notified when one is ready.
+//
+// If continuous mode cannot start, the task falls back to calibrated
+// one-shot reads (analogReadMilliVolts), still off the main loop.
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <Arduino.h>
+#include <atomic>
+
+const uint32_t BATTERY_ADC_OVERSAMPLE = 64;        // Conversions per burst
+const uint32_t BATTERY_ADC_SAMPLE_HZ = 20000;      // Burst takes ~3 ms
+const uint32_t BATTERY_FILTER_SHIFT = 2;           // Low-pass weight 1/4 per burst
+const uint32_t BATTERY_STOP_TIMEOUT_MS = 200;      // Longest burst end() waits out
+
+struct BatteryReading {
+  uint32_t pinMv;        // Filtered, calibrated voltage at the ADC pin
+  uint32_t batteryMv;    // pinMv times the divider ratio
+  uint32_t adcRaw;       // Last burst's average raw count (diagnostics)
+};
+
+static TaskHandle_t _batteryTask = nullptr;
+
+class BatteryMonitor {
+public:
+  bool begin(int adcPin, float dividerMult, uint32_t periodMs, int core) {
+    pin = adcPin;
+    divider = dividerMult;
+    period = (periodMs == 0) ? 1 : periodMs;
+    uint8_t pins[1] = { (uint8_t)pin };
+    analogContinuousSetAtten(ADC_11db);
+    analogContinuousSetWidth(12);
+    dma = analogContinuous(pins, 1, BATTERY_ADC_OVERSAMPLE, BATTERY_ADC_SAMPLE_HZ, &onBurstDone);
+    if (!dma) {
+      analogSetPinAttenuation(pin, ADC_11db);
+    }
+    stopping = false;
+    parked = false;
+    BaseType_t created = xTaskCreatePinnedToCore(taskMain, "battery", 3072, this, 1, &_batteryTask, core);
+    if (created != pdPASS) {
+      _batteryTask = nullptr;
+      return false;
+    }
+    return true;
+  }
+
+  // Stop sampling and release the ADC (before deep sleep). The task is
+  // only deleted once it has parked, which it does after its current burst
+  // has stopped the ADC: deleted inside burstDma(), it would leave
+  // continuous mode running with the ISR notifying a deleted task. If it
+  // does not park in time it is left running with the stop request set and
+  // end() returns false; a later call finishes the job.
+  bool end() {
+    if (_batteryTask == nullptr) {
+      return true;
+    }
+    stopping = true;
+    xTaskNotifyGive(_batteryTask);  // Cut its wait for the next period short
+    unsigned long startMs = millis();
+    while (!parked && (millis() - startMs) < BATTERY_STOP_TIMEOUT_MS) {
+      delay(1);
+    }
+    if (!parked) {
+      return false;
+    }
+    vTaskDelete(_batteryTask);
+    _batteryTask = nullptr;
+    if (dma) {
+      analogContinuousDeinit();
+      dma = false;
+    }
+    return true;
+  }
+
+  // Latest reading; returns false if there is nothing new since the last call
+  bool read(BatteryReading* out) {
+    uint32_t seq = published.load(std::memory_order_acquire);
+    if (seq == consumed) {
+      return false;
+    }
+    // Retry if the task published again while we copied
+    do {
+      seq = published.load(std::memory_order_acquire);
+      out->pinMv = filteredQ >> BATTERY_FILTER_SHIFT;
+      out->adcRaw = lastRaw;
+    } while (published.load(std::memory_order_acquire) != seq);
+    consumed = seq;
+    out->batteryMv = (uint32_t)lroundf(out->pinMv * divider);
+    return true;
+  }
+
+  // Task to notify after each new reading (nullptr for none)
+  void setWakeTask(TaskHandle_t task) { wakeTask = task; }
+
+  bool usingDma() const { return dma; }
+  uint32_t failedBursts() const { return failures; }
+
+private:
+  static void ARDUINO_ISR_ATTR onBurstDone() {
+    BaseType_t woken = pdFALSE;
+    if (_batteryTask != nullptr) {
+      vTaskNotifyGiveFromISR(_batteryTask, &woken);
+    }
+    if (woken == pdTRUE) {
+      portYIELD_FROM_ISR();
+    }
+  }
+
+  static void taskMain(void* arg) {
+    BatteryMonitor* self = static_cast<BatteryMonitor*>(arg);
+    TickType_t wake = xTaskGetTickCount();
+    while (!self->stopping) {
+      uint32_t raw = 0;
+      uint32_t mv = 0;
+      bool ok = self->dma ? self->burstDma(&raw, &mv) : self->burstOneShot(&raw, &mv);
+      if (ok) {
+        self->publish(raw, mv);
+      } else if (!self->stopping) {
+        self->failures++;  // Not the stop notification cutting a burst short
+      }
+      self->waitForPeriod(&wake);
+    }
+    // No burst is running and the ADC is stopped; end() deletes the task
+    self->parked = true;
+    for (;;) {
+      vTaskSuspend(nullptr);
+    }
+  }
+
+  // vTaskDelayUntil() that end() can cut short with a notification. Stray
+  // burst-done notifications just resume the wait.
+  void waitForPeriod(TickType_t* wake) {
+    const TickType_t periodTicks = pdMS_TO_TICKS(period);
+    *wake += periodTicks;
+    while (!stopping) {
+      TickType_t now = xTaskGetTickCount();
+      TickType_t left = *wake - now;
+      if (left == 0 || left > periodTicks) {
+        if (left > periodTicks) {
+          *wake = now;  // Overran the period: restart the schedule from now
+        }
+        return;
+      }
+      ulTaskNotifyTake(pdTRUE, left);
+    }
+  }
+
+  bool burstDma(uint32_t* raw, uint32_t* mv) {
+    ulTaskNotifyTake(pdTRUE, 0);
+    if (!analogContinuousStart()) {
+      return false;
+    }
+    adc_continuous_data_t* data = nullptr;
+    bool ok = ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(50)) > 0 && analogContinuousRead(&data, 0) &&
+              data != nullptr;
+    if (ok) {
+      *raw = (uint32_t)data[0].avg_read_raw;
+      *mv = (uint32_t)data[0].avg_read_mvolts;
+    }
+    analogContinuousStop();
+    return ok;
+  }
+
+  bool burstOneShot(uint32_t* raw, uint32_t* mv) {
+    const uint32_t reads = 16;
+    uint32_t rawSum = 0;
+    uint32_t mvSum = 0;
+    for (uint32_t i = 0; i < reads; i++) {
+      rawSum += analogRead(pin);
+      mvSum += analogReadMilliVolts(pin);
+    }
+    *raw = rawSum / reads;
+    *mv = mvSum / reads;
+    return true;
+  }
+
+  void publish(uint32_t raw, uint32_t mv) {
+    history[historyCount % 3] = mv;
+    historyCount++;
+    uint32_t median = mv;
+    if (historyCount >= 3) {
+      uint32_t a = history[0], b = history[1], c = history[2];
+      median = (a > b) ? ((b > c) ? b : (a > c) ? c : a) : ((a > c) ? a : (b > c) ? c : b);
+    }
+    if (historyCount == 1) {
+      filteredQ = median << BATTERY_FILTER_SHIFT;
+    } else {
+      // filtered += (median - filtered) / 2^shift, kept in Q(shift)
+      filteredQ = filteredQ - (filteredQ >> BATTERY_FILTER_SHIFT) + median;
+    }
+    lastRaw = raw;
+    published.fetch_add(1, std::memory_order_release);
+    if (wakeTask != nullptr) {
+      xTaskNotifyGive(wakeTask);
+    }
+  }
+
+  int pin = -1;
+  float divider = 1.0f;
+  uint32_t period = 1000;
+  volatile bool dma = false;
+  volatile bool stopping = false;
+  volatile bool parked = false;   // Set by the task once it has seen stopping
+
+  uint32_t history[3] = {};
+  uint32_t historyCount = 0;
+  volatile uint32_t filteredQ = 0;
+  volatile uint32_t lastRaw = 0;
+  std::atomic<uint32_t> published{0};
+  uint32_t consumed = 0;
+  volatile uint32_t failures = 0;
+  TaskHandle_t wakeTask = nullptr;
+};
+
+#endif // BATTERY_MONITOR_H
@@ -14,6 +14,33 @@
 #include <XboxGamepadConfiguration.h>
 #include <NimBLEDevice.h>
 #include <NimBLEServer.h>
+#include "LoopProfiler.h"
+#include "GbaLink.h"
+#include "I2cBus.h"
+#include "TaskHandoff.h"
+#include "MeterPlanner.h"
+#include "AbsoluteMeter.h"
+#include "GameProfiles.h"
+#include "BarThresholds.h"
+#include "FirmwareConfig.h"
+#include "WarmResume.h"
+#include "TraceBuffer.h"
+#include "SessionLogger.h"
+#include "SessionLogReplay.h"
+#include "UvFilterBench.h"
+#include "Telemetry.h"
+#include "UvFilter.h"
+#include "UvBarPipeline.h"
+#include "AlsAssist.h"
+#include "UvFusion.h"
+#include "UvAutoRange.h"
+#include "UvSensorArray.h"
+#include "ButtonInput.h"
+#include "BatteryMonitor.h"
+#include "BatteryCurve.h"
+#include "UiWidgets.h"
+#include "DeadlineScheduler.h"
+#include "PowerManager.h"
 
 // USB XInput gamepad (requires USB Mode: USB-OTG/TinyUSB in board settings)
 #if defined(ARDUINO_USB_MODE) && !ARDUINO_USB_MODE
@@ -34,10 +61,17 @@
 TQTDisplay display(SCREEN_WIDTH, SCREEN_HEIGHT);
 #define DISPLAY_WHITE 1
 #else
-Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1);
+// Same clock during and after transfers, so the library doesn't drop the
+// shared bus back to 100kHz for the sensor
+Adafruit_SSD1306 display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, -1, I2C_CLOCK_HZ, I2C_CLOCK_HZ);
 #define DISPLAY_WHITE SSD1306_WHITE
 #endif
 bool displayInitialized = false;
+// Shared I2C bus statistics (and, on the XIAO build, chunked OLED flushes)
+I2cBusMonitor i2cBusMonitor;
+#if !defined(BOARD_LILYGO_T_QT_PRO)
+OledChunkFlush oledFlush;
+#endif
 // Icon dimensions (shared by status bar and screensaver)
 const int16_t STATUS_BATT_ICON_W = 20;
 const int16_t STATUS_BATT_ICON_H = 9;
@@ -58,28 +92,86 @@ const uint8_t SSD1306_SETDISPLAYOFFSET_CMD = 0xD3;
 const uint8_t SSD1306_SETSTARTLINE0_CMD = 0x40;
 #endif
 
-// Sensor settings
-Adafruit_LTR390 ltr = Adafruit_LTR390();
-
-// UV Index calculation per LTR-390UV datasheet (DS86-2015-0004)
-// Reference: 2300 counts/UVI at 18x gain, 400ms (20-bit) integration
-// Formula: UVI = raw * (18/gain) * (400/int_time) / 2300
-//
-// For 18x gain, 20-bit (400ms):
-//   UVI = raw / 2300
-const float UV_SENSITIVITY_COUNTS_PER_UVI = 2300.0f;
-const float UV_REFERENCE_GAIN = 18.0f;
-const float UV_REFERENCE_INT_MS = 400.0f;
+// Retained main screen (UI_RETAINED_WIDGETS, see UiWidgets.h). Widgets draw
+// straight into the display's frame buffer; `valid` is cleared whenever
+// something else (debug page, screensaver) has drawn over them.
+struct MainScreenWidgets {
+  UiLabel gameName;
+  UiNumber bars;
+  UiLabel uviLabel;
+  UiNumber uvi;
+  UiGauge gauge;
+  UiLabel batteryText;
+  UiIcon battery;
+  UiIcon bluetooth;
+  int batteryPct;     // Status strip inputs as last drawn
+  bool bluetoothOn;
+  bool valid;
+};
+MainScreenWidgets mainWidgets;
+UiSurface uiSurface;
+UiGlyphCache uiGlyphs;
+UiFrameStats uiFrameStats;
+GFXcanvas1 bluetoothSprite(STATUS_BT_ICON_W, STATUS_BT_ICON_H);
+GFXcanvas1 batterySprite(STATUS_BATT_ICON_W, STATUS_BATT_ICON_H);
+
+// Sensor settings. uvSensors[0] is the reference sensor; the others are
+// optional (UV_SENSOR_COUNT, see UvSensorArray.h and UvFusion.h).
+UvSensor uvSensors[UV_SENSOR_MAX];
+int uvSensorCount = 1;
+int uvSelectedSensor = 0;  // Target of writeLtr390Register(), readLtr390Burst() and activeLtr()
+I2cMux uvSensorMux;
+UvFusion uvFusion;
+const uint8_t LTR390_ARRAY_MEAS_RATE = 0x06;  // 2 s: array sensors are restarted for every sample
+unsigned long uvArrayCycleMs = 500;          // Per-sensor sample period with several sensors
+int uvArrayNextPoll = 0;
+
+// Counts per UVI at the active sensor's gain and resolution (the range
+// table and datasheet reference are in FirmwareConfig.h)
 float uvDivisor = UV_SENSITIVITY_COUNTS_PER_UVI;
-const uint8_t MEAS_RATE_500MS = 0x04;
-
-// Power button state tracking
-unsigned long buttonPressStart = 0;
-bool buttonWasPressed = false;
-
-// Secondary button state (unused when BUTTON2_ENABLED is false)
-unsigned long button2PressStart = 0;
-bool button2WasPressed = false;
+static_assert(LTR390_GAIN_18 == LTR390_GAIN_CODE_18 && LTR390_GAIN_1 == LTR390_GAIN_CODE_1 &&
+              LTR390_RESOLUTION_20BIT == LTR390_RES_CODE_20BIT &&
+              LTR390_RESOLUTION_18BIT == LTR390_RES_CODE_18BIT &&
+              LTR390_RESOLUTION_13BIT == LTR390_RES_CODE_13BIT,
+              "FirmwareConfig.h register codes must match Adafruit_LTR390");
+UvAutoRange uvAutoRange;  // Active range mode (UV_RANGE_*) and when it was set
+bool ltrDiscardNextSample = false;  // First conversion after a switch may mix settings
+const uint32_t LTR390_RAW_MAX = BAR_RAW_MAX;  // 20-bit data registers
+// Status + data are fetched in one burst from MAIN_STATUS through UVS_DATA
+const uint8_t LTR390_BURST_LEN = (LTR390_UVSDATA + 3) - LTR390_MAIN_STATUS;
+const uint8_t LTR390_STATUS_DATA_READY = 0x08;  // MAIN_STATUS bit 3
+unsigned long ltrSamplePeriodMs = 500;
+unsigned long ltrIntegrationMs = 400;
+unsigned long ltrLastSampleMs = 0;
+bool ltrHasSample = false;
+// Set by the LTR390 INT pin ISR (only when LTR390_INT_PIN is configured)
+volatile bool ltrDataReadyIrq = false;
+volatile bool ltrIntArmedHigh = false;  // Level-interrupt mode: waiting for INT release
+bool ltrIntModeActive = false;
+
+// ALS slot after each UV sample (UV_ALS_ASSIST_ENABLED, see AlsAssist.h)
+const uint8_t LTR390_MAIN_CTRL_ALS = 0x02;       // Enabled, ALS mode
+const uint8_t LTR390_MAIN_CTRL_UVS = 0x0A;       // Enabled, UVS mode
+const uint8_t LTR390_ALS_GAIN = 0x00;            // 1x: direct sun stays below 16-bit full scale
+const uint8_t LTR390_ALS_MEAS_RATE = 0x40;       // 16-bit (25ms), 25ms rate
+const unsigned long LTR390_ALS_SLOT_MS = ALS_ASSIST_SLOT_MS;  // One ALS conversion plus margin
+const unsigned long LTR390_ALS_SLOT_MAX_MS = 100;  // Give up and return to UVS after this
+bool ltrAlsSlotActive = false;
+unsigned long ltrAlsSlotStartMs = 0;
+AlsTransientDetector alsDetector;
+bool alsConfirmPending = false;  // Last bars were provisional; the next UV sample replaces them
+
+// Bar thresholds (see BarThresholds.h) and the sample-to-bars pipeline
+// (UvBarPipeline.h). Its raw-count tables are rebuilt by
+// updateUvDivisorFromSensor() whenever gain/resolution changes, so
+// classifying an unsmoothed sample needs no float math.
+BarThresholdConfig barConfig;  // From config.h, set at the start of setup()
+UvBarPipeline uvBars;
+
+// Buttons (edge interrupts + debounce, see ButtonInput.h). The second
+// button is unused when BUTTON2_ENABLED is false.
+ButtonInput powerButton;
+ButtonInput secondButton;
 bool button2SuppressShortPress = false;
 
 // Game selection (0 = Boktai 1, 1 = Boktai 2, 2 = Boktai 3)
@@ -90,10 +182,93 @@ const int NUM_UI_SCREENS = NUM_GAMES + 1;
 // UI screen selection:
 // 0..NUM_GAMES-1 = game screens, DEBUG_SCREEN_INDEX = XInput/CDC debug screen
 int currentScreen = 0;
-bool uiScreenChanged = false;
-
-// Battery state
-unsigned long lastBatterySampleTime = 0;
+bool uiScreenChanged = false;  // UI side: set when UI_EVENT_SCREEN_CHANGED is consumed
+
+// Debug screen pages (cycled every DEBUG_STATS_PAGE_MS when stats are enabled)
+enum DebugPage {
+  DEBUG_PAGE_READINGS = 0,
+  DEBUG_PAGE_LOOP,
+  DEBUG_PAGE_GBA_LINK,
+  DEBUG_PAGE_I2C,
+  DEBUG_PAGE_SENSORS,
+  DEBUG_PAGE_TFT,
+  DEBUG_PAGE_UI,
+  DEBUG_PAGE_TASKS,
+  DEBUG_PAGE_POWER,
+  DEBUG_PAGE_USB,
+  DEBUG_PAGE_METER,
+  DEBUG_PAGE_BOOT,
+  DEBUG_PAGE_LOG,
+  DEBUG_PAGE_COUNT
+};
+int debugPage = DEBUG_PAGE_READINGS;
+unsigned long debugPageLastMs = 0;
+
+// Loop timing
+LoopProfiler loopProfiler;
+
+// Sleep between events (see PowerManager.h)
+PowerManager powerManager;
+DeadlineScheduler loopScheduler;
+DeadlineScheduler uiScheduler;
+PowerLock uiCpuLock;
+
+// Boot timing and warm resume (see WarmResume.h)
+BootProfiler bootProfiler;
+SessionLogger sessionLog;
+TelemetryTx<TELEMETRY_TX_BYTES> telemetryTx;
+uint16_t telemetrySeq = 0;
+unsigned long sessionLogBatteryMs = 0;  // Last time battery voltage went into the log
+bool setupComplete = false;  // enterDeepSleep() only snapshots a session that ran
+
+// UI handoff. loop() (sensor, bars, HID, GBA link) publishes a UiSnapshot
+// and posts UiEvents; rendering (UI task on UI_TASK_CORE, or inline from
+// loop() when the task is disabled) works only from its own copy in `ui`.
+struct UiSnapshot {
+  int currentScreen;
+  int currentGame;
+  int filledBars;
+  int numBars;
+  float uvi;
+  float uviRaw;
+  uint32_t rawUVS;
+  int uvRangeMode;
+  int batteryPct;
+  float batteryVoltage;
+  float batteryAdcAvg;
+  bool hasBatteryReading;
+  bool bleConnected;
+  bool blePairingActive;
+  bool bleIconFlashOn;
+};
+enum UiEvent : uint8_t {
+  UI_EVENT_REDRAW = 0,      // New sample or state worth redrawing
+  UI_EVENT_SCREEN_CHANGED,  // Screen cycled (also restarts debug page rotation)
+  UI_EVENT_ACTIVITY,        // Button activity (wakes from screensaver)
+  UI_EVENT_COUNT
+};
+Seqlock<UiSnapshot> uiSnapshot;
+SpscQueue<uint8_t, 8> uiEvents;
+std::atomic<uint8_t> uiEventsQueued(0);  // Bit per event type waiting in uiEvents
+uint8_t uiEventsThisPass = 0;            // loop() side: raised, not yet queued
+UiSnapshot ui;                           // UI side: state being rendered
+TaskHandle_t uiTaskHandle = nullptr;
+std::atomic<bool> uiTaskStopRequested(false);
+std::atomic<bool> uiTaskParked(false);
+const unsigned long UI_TASK_STOP_TIMEOUT_MS = 500;  // Longest frame stopUiTask() waits out
+std::atomic<uint32_t> uiTaskBusyUs(0);   // UI frame time accumulated this window
+unsigned long uiStatsWindowStartMs = 0;
+
+// Per-task CPU share and stack headroom, published once per stats window
+unsigned long taskStatsWindowStartUs = 0;
+uint32_t loopTaskCpuPermille = 0;
+uint32_t uiTaskCpuPermille = 0;
+uint32_t loopTaskStackFree = 0;
+uint32_t uiTaskStackFree = 0;
+int loopTaskCore = -1;
+
+// Battery state (sampled by the battery task, see BatteryMonitor.h)
+BatteryMonitor batteryMonitor;
 const int BATTERY_PCT_UNKNOWN = -1;
 int cachedBatteryPct = BATTERY_PCT_UNKNOWN;
 float cachedBatteryVoltage = -1.0f;
@@ -122,7 +297,8 @@ const uint8_t OJO_DEL_SOL_BITMAP[] PROGMEM = {
 };
 unsigned long lastScreenActivityMs = 0;
 unsigned long lastScreensaverMoveMs = 0;
-bool screensaverActive = false;
+// Owned by the UI side; loop() reads it to swallow the tap that wakes the screen
+std::atomic<bool> screensaverActive(false);
 bool screensaverJustExited = false;
 bool suppressShortPress = false;
 int16_t screensaverX = 0;
@@ -140,54 +316,30 @@ float cachedUviRaw = 0.0f;
 float cachedUvi = 0.0f;
 int cachedFilledBars = 0;
 int cachedNumBars = 0;
-float smoothedUvi = 0.0f;
-bool hasSmoothedUvi = false;
 bool gameChanged = false;
 bool hidGameChanged = false;
 bool gbaFramePhaseHigh = false;
 unsigned long gbaFrameLastToggleUs = 0;
+uint8_t gbaTracedValue = 0xFF;   // First frame of each new value is traced, as in GbaLink.h
+uint8_t gbaTracePhasesLeft = 0;
+GbaLinkTimer gbaLinkTimer;
 
 // BLE state
 XboxGamepadDevice* xboxGamepad = nullptr;
 XboxSeriesXControllerDeviceConfiguration* xboxConfig = nullptr;
 BleCompositeHID compositeHID(BLE_DEVICE_NAME, BLE_MANUFACTURER, 100);  // Initial battery level; updated once battery is read
-unsigned long blePressIntervalMs = 0;  // Set by initHidPressTiming()
-unsigned long blePressHoldMs = 0;      // Set by initHidPressTiming()
 bool bleConnected = false;
 bool blePairingActive = false;
 unsigned long blePairingStartMs = 0;
 bool bleIconFlashOn = true;
 unsigned long bleIconLastToggleMs = 0;
 bool bleSyncPending = false;
-unsigned long bleLastResyncMs = 0;
 int bleDeviceBars = 0;
 int bleDeviceNumBars = 0;
-bool bleEstimateValid = false;
-int bleEstimatedSteps = 0;
-bool blePressHolding = false;
-unsigned long blePressStartMs = 0;
-unsigned long bleLastPressMs = 0;
-int blePressDirection = 0;
-uint16_t bleActiveButton = 0;
-int bleSyncTargetSteps = 0;
-int bleSyncStepsMax = 0;
-int bleSyncRemaining = 0;
-int bleSyncDirection = 0;
-int bleRefillRemaining = 0;
-int bleRefillDirection = 0;
+MeterPlanner bleMeter;         // Incremental press plan (timing set by initHidPressTiming())
+uint16_t bleActiveButton = 0;  // Button bleMeter is holding down
+MeterConvergenceStats meterStats;
 const unsigned long BLE_ICON_FLASH_MS = 500;
-const int BLE_DIR_DEC = -1;
-const int BLE_DIR_INC = 1;
-const int BOKTAI1_STEP_COUNT = 10;
-const int BOKTAI1_STEP_TO_BAR[BOKTAI1_STEP_COUNT + 1] = { 0, 1, 2, 3, 3, 4, 5, 6, 7, 7, 8 };
-const int BOKTAI1_BAR_TO_STEP_FROM_EMPTY[9] = { 0, 1, 2, 3, 5, 6, 7, 8, 10 };
-const int BOKTAI1_BAR_TO_STEP_FROM_FULL[9] = { 0, 1, 2, 4, 5, 6, 7, 9, 10 };
-enum BleSyncPhase {
-  BLE_SYNC_NONE = 0,
-  BLE_SYNC_CLAMP,
-  BLE_SYNC_REFILL
-};
-BleSyncPhase bleSyncPhase = BLE_SYNC_NONE;
 // Single Analog mode state
 int bleSingleAnalogBars = -1;
 int16_t bleSingleAnalogValue = 0;
@@ -195,10 +347,13 @@ bool bleSingleAnalogActive = false;
 bool bleSingleAnalogButtonHeld = false;
 unsigned long bleSingleAnalogLastRefreshMs = 0;
 
+// Absolute mode state (-1 = nothing sent yet)
+int bleAbsoluteCartValue = -1;
+int bleAbsoluteBars = -1;
+
 // USB XInput state
 #if HAS_USB_HID
 XboxHIDGamepad usbGamepad;
-bool cdcRequireButtonRelease = false;
 #endif
 bool inCdcMode = false;
 bool usbHidActive = false;
@@ -206,8 +361,10 @@ bool serialEnabled = false;
 uint16_t usbButtonState = 0;
 int16_t usbStickLX = 0, usbStickLY = 0;
 int16_t usbStickRX = 0, usbStickRY = 0;
+uint8_t usbTriggerL = 0, usbTriggerR = 0;
 int usbMeterBars = -1;
 int usbMeterNumBars = -1;
+int usbMeterCartValue = -1;
 
 char screensaverBatteryText[6] = "";
 int16_t screensaverBatteryTextW = 0;
@@ -261,6 +418,7 @@ void wakeDisplayHardware() {
   display.ssd1306_command(SSD1306_SETDISPLAYOFFSET_CMD);
   display.ssd1306_command(0x00);
   display.ssd1306_command(SSD1306_SETSTARTLINE0_CMD);
+  oledFlush.invalidate();
   delay(2);  // SSD1306 charge pump stabilization
 }
 
@@ -299,18 +457,41 @@ void usbGamepadSetRightStick(int16_t x, int16_t y) {
   usbStickRY = y;
 }
 
+void usbGamepadSetTriggers(uint8_t left, uint8_t right) {
+  usbTriggerL = left;
+  usbTriggerR = right;
+}
+
 void usbSendReport() {
   #if HAS_USB_HID
   if (!usbHidActive) return;
-  usbGamepad.sendReport(usbButtonState, 0, 0,
+  usbGamepad.sendReport(usbButtonState, usbTriggerL, usbTriggerR,
                         usbStickLX, usbStickLY, usbStickRX, usbStickRY);
   #endif
 }
 
+// Press/release edges of incremental-mode taps: queued in order so a tap
+// issued while the previous report is still in flight is not merged away.
+void usbSendEdgeReport() {
+  #if HAS_USB_HID
+  if (!usbHidActive) return;
+  usbGamepad.sendEdgeReport(usbButtonState, usbTriggerL, usbTriggerR,
+                            usbStickLX, usbStickLY, usbStickRX, usbStickRY);
+  #endif
+}
+
+void usbServiceReports() {
+  #if HAS_USB_HID
+  if (!usbHidActive) return;
+  usbGamepad.service();
+  #endif
+}
+
 void usbReleaseAll() {
   usbButtonState = 0;
   usbStickLX = 0; usbStickLY = 0;
   usbStickRX = 0; usbStickRY = 0;
+  usbTriggerL = 0; usbTriggerR = 0;
   usbSendReport();
 }
 
@@ -321,6 +502,7 @@ void initUsbHid() {
     return;
   }
   usbHidActive = true;
+  usbGamepad.begin();
   // XInput descriptors are provided via TinyUSB callback overrides in
   // XboxHIDGamepad.h. USB.begin() ensures TinyUSB is started if CDC On
   // Boot did not already auto-start it.
@@ -334,6 +516,7 @@ void initUsbHid() {
 
 #if HAS_USB_HID
 void exitCdcModeAndSleep() {
+  stopUiTask();
   if (USB_HID_ENABLED) {
     clearCdcModeFlag();  // Only return to XInput when it's actually enabled
   }
@@ -355,8 +538,9 @@ void exitCdcModeAndSleep() {
   pinMode(I2C_SDA_PIN, INPUT);
   pinMode(I2C_SCL_PIN, INPUT);
 
-  while (digitalRead(BUTTON_PIN) == LOW) delay(10);
-  delay(50);
+  powerButton.waitForRelease();
+  powerButton.end();
+  secondButton.end();
 
   esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_PIN, 0);
   if (serialEnabled) {
@@ -367,6 +551,7 @@ void exitCdcModeAndSleep() {
 }
 
 void enterCdcMode() {
+  stopUiTask();
   display.clearDisplay();
   display.setTextSize(1);
   const char* msg = "Restarting to CDC...";
@@ -384,6 +569,8 @@ void enterCdcMode() {
   pinMode(I2C_SCL_PIN, INPUT_PULLUP);
   delay(2);
 
+  traceFreeze();  // Keep this session's trace for a dump in CDC mode
+  sessionLog.flush(500);
   setCdcModeFlag();
   esp_restart();
 }
@@ -412,19 +599,15 @@ void logDeviceButtonPress(const char* context) {
   Serial.println();
 }
 
+// The power-on hold is still in progress: it must not count as a tap, but
+// holding on for another LONG_PRESS_MS still sleeps.
 void syncRuntimeButtonStateAfterStartup() {
-  bool buttonPressed = (digitalRead(BUTTON_PIN) == LOW);
-  buttonWasPressed = buttonPressed;
-  if (buttonPressed) {
-    buttonPressStart = millis();
-    suppressShortPress = true;
-  } else {
-    buttonPressStart = 0;
-    suppressShortPress = false;
-  }
+  powerButton.resync(millis(), false);
+  suppressShortPress = false;
 }
 
 void setup() {
+  barConfig = getBarThresholdConfig();
   #if HAS_USB_HID
   inCdcMode = isXInputCdcMode();
   if (!inCdcMode && !USB_HID_ENABLED) {
@@ -434,6 +617,13 @@ void setup() {
     esp_restart();
   }
   #endif
+  WarmResumeState warmState;
+  bool warmResume = loadWarmResumeState(&warmState) && WARM_RESUME_ENABLED && !inCdcMode;
+  bootProfiler.begin(warmResume);
+  if (POWER_SCHEDULER_ENABLED) {
+    powerManager.begin(POWER_CPU_MAX_MHZ, POWER_CPU_MIN_MHZ, POWER_LIGHT_SLEEP_ENABLED);
+  }
+  bool traceHeld = traceBegin(TRACE_ENABLED, inCdcMode, powerManager.scaling());
   if (!inCdcMode) {
     initUsbHid();
   }
@@ -452,13 +642,30 @@ void setup() {
     #else
     Serial.println("Ojo del Sol boot - board: Seeed XIAO ESP32S3");
     #endif
+    if (warmResume) {
+      Serial.println("Warm resume from deep sleep");
+    }
+    if (traceHeld) {
+      Serial.println("Event trace from the XInput session held; send 't' to dump it");
+    }
   }
   initHidPressTiming();
+  initUvFilter();
+  bootProfiler.mark(BOOT_PHASE_USB);
 
-  // Configure power button with internal pull-up (active LOW)
-  pinMode(BUTTON_PIN, INPUT_PULLUP);
+  // Buttons: internal pull-up (active LOW), edge interrupts
+  powerButton.begin(BUTTON_PIN, DEBOUNCE_MS, LONG_PRESS_MS, BUTTON_DOUBLE_TAP_MS);
   if (BUTTON2_ENABLED && BUTTON2_PIN >= 0) {
-    pinMode(BUTTON2_PIN, INPUT_PULLUP);
+    secondButton.begin(BUTTON2_PIN, DEBOUNCE_MS, LONG_PRESS_MS, BUTTON_DOUBLE_TAP_MS);
+  }
+  if (POWER_SCHEDULER_ENABLED) {
+    // Edges end loop()'s wait; in light sleep they must also wake the chip
+    powerButton.setWakeTask(_powerWakeTask);
+    secondButton.setWakeTask(_powerWakeTask);
+    if (powerManager.mode() == POWER_MODE_LIGHT_SLEEP) {
+      powerButton.enableSleepWake();
+      secondButton.enableSleepWake();
+    }
   }
 
   if (GBA_LINK_ENABLED) {
@@ -468,13 +675,24 @@ void setup() {
     digitalWrite(GBA_PIN_SC, LOW);
     digitalWrite(GBA_PIN_SD, LOW);
     digitalWrite(GBA_PIN_SO, LOW);
+    if (GBA_LINK_HW_TIMER_ENABLED) {
+      if (!gbaLinkTimer.begin(GBA_PIN_SC, GBA_PIN_SD, GBA_PIN_SO, getGbaPhaseIntervalUs(),
+                            GBA_LINK_PROTOCOL_V2)) {
+        if (serialEnabled) {
+          Serial.println("GBA link timer unavailable, using polled output");
+        }
+      }
+    }
   }
 
   if (BATTERY_SENSE_ENABLED) {
-    analogSetPinAttenuation(BAT_PIN, ADC_11db);
+    batteryMonitor.setWakeTask(_powerWakeTask);
+    batteryMonitor.begin(BAT_PIN, VOLT_DIVIDER_MULT, BATTERY_SAMPLE_MS, UI_TASK_CORE);
   }
   // Initialize I2C for the LTR390 (and, on the XIAO build, the OLED)
-  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
+  Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN, I2C_CLOCK_HZ);
+  i2cBusMonitor.begin();
+  setupUvSensorBuses();
 
   #if defined(BOARD_LILYGO_T_QT_PRO)
   if (serialEnabled) Serial.println("Initializing display (Arduino_GFX / GC9107)...");
@@ -495,16 +713,21 @@ void setup() {
     enterDeepSleep();
   }
   displayInitialized = true;
+  #if !defined(BOARD_LILYGO_T_QT_PRO)
+  oledFlush.begin(&Wire, DISPLAY_I2C_ADDR, &i2cBusMonitor);
+  #endif
   if (serialEnabled) Serial.println("Display initialized");
+  bootProfiler.mark(BOOT_PHASE_DISPLAY);
 
   display.clearDisplay();
   display.setTextColor(DISPLAY_WHITE);
+  initMainWidgets();
 
   #if HAS_USB_HID
   // If the button is still held from the "enter CDC mode" long press,
   // require a release before allowing another long-press action.
   if (inCdcMode) {
-    cdcRequireButtonRelease = (digitalRead(BUTTON_PIN) == LOW);
+    powerButton.resync(millis(), true);
   }
   #endif
 
@@ -516,9 +739,13 @@ void setup() {
   screensaverTextH = (int16_t)ssH;
   screensaverTextX1 = ssX1;
   screensaverTextY1 = ssY1;
-  calculateScreensaverLayout();
-  screensaverLastLayoutPct = cachedBatteryPct;
-  screensaverLastLayoutBleStatus = BLUETOOTH_ENABLED && (bleConnected || blePairingActive);
+  if (warmResume) {
+    // Restore the last session and start the sensor now, so its first
+    // integration overlaps the power-on hold
+    restoreWarmResumeState(warmState);
+    initUvSensor(warmState.uvRangeMode);
+    bootProfiler.mark(BOOT_PHASE_SENSOR);
+  }
   if (!inCdcMode) {
     // Wait for power-on: show prompt for 10s, reset on button activity.
     // This always shows immediately so a short wake tap reliably shows the prompt.
@@ -527,6 +754,7 @@ void setup() {
       enterDeepSleep();
     }
   }
+  bootProfiler.mark(BOOT_PHASE_POWER_ON);
   // Re-assert charge pump and canonical panel state after any restart or power-on.
   // In CDC mode this recovers the display from drift caused by the software restart.
   // A double flush with a 10ms gap stabilizes the panel against occasional blank boots.
@@ -541,42 +769,12 @@ void setup() {
   }
   #endif
 
-  if (!initLTR390()) {
-    if (serialEnabled) Serial.println("LTR390 not found - check wiring; sleeping");
-    display.clearDisplay();
-    display.setTextSize(1);
-    display.setCursor(10, 28);
-    display.print("LTR390 failed");
-    display.display();
-    delay(2000);
-    enterDeepSleep();
+  if (!warmResume) {
+    initUvSensor(UV_RANGE_SLOW);
+    bootProfiler.mark(BOOT_PHASE_SENSOR);
   }
 
-  // Configure LTR390 for UV sensing mode
-  // Gain 18x: Datasheet reference setting for UVI sensitivity
-  // Resolution 20-bit: Datasheet accuracy setting (~400ms integration)
-  // Measurement rate 500ms: Matches datasheet example timing
-  ltr.setMode(LTR390_MODE_UVS);
-  ltr.setGain(LTR390_GAIN_18);
-  ltr.setResolution(LTR390_RESOLUTION_20BIT);
-  setMeasurementRate(MEAS_RATE_500MS);
-  updateUvDivisorFromSensor();
-  
-  if (serialEnabled) {
-    Serial.println("LTR390 configured: UV mode, 18x gain, 20-bit (~400ms)");
-    Serial.println("Expected: ~2300 counts per UVI");
-    if (UV_ENCLOSURE_COMP_ENABLED) {
-      Serial.print("UV enclosure compensation: ON (T=");
-      Serial.print(UV_ENCLOSURE_TRANSMITTANCE, 4);
-      Serial.print(", offset=");
-      Serial.print(UV_ENCLOSURE_UVI_OFFSET, 4);
-      Serial.println(")");
-    } else {
-      Serial.println("UV enclosure compensation: OFF");
-    }
-  }
-  
-  if (!inCdcMode) {
+  if (!inCdcMode && !warmResume) {
     // Show wake-up confirmation
     display.clearDisplay();
     display.setTextSize(1);
@@ -598,16 +796,23 @@ void setup() {
     display.print(wakeText);
     display.display();
     delay(2000);
+    bootProfiler.mark(BOOT_PHASE_SPLASH);
   }
 
+  #if !defined(BOARD_LILYGO_T_QT_PRO)
+  // Setup screens were pushed with blocking full-frame writes
+  oledFlush.invalidate();
+  #endif
   refreshGameState(false);
   lastScreenActivityMs = millis();
+  loopProfiler.begin(DEBUG_STATS_WINDOW_MS);
   #if HAS_USB_HID
   if (inCdcMode) {
-    uiScreenChanged = true;  // Force initial display draw on first loop iteration
+    postUiEvent(UI_EVENT_SCREEN_CHANGED);  // Force initial display draw on first loop iteration
   }
   #endif
   initBluetooth();
+  bootProfiler.mark(BOOT_PHASE_BLE);
   #if HAS_USB_HID
   if (!inCdcMode) {
     syncRuntimeButtonStateAfterStartup();
@@ -615,276 +820,1798 @@ void setup() {
   #else
   syncRuntimeButtonStateAfterStartup();
   #endif
+
+  // First frame, then hand rendering to the UI task
+  postUiEvent(UI_EVENT_REDRAW);
+  publishUiSnapshot();
+  flushUiEvents();
+  startUiTask();
+  bootProfiler.mark(BOOT_PHASE_UI);
+  if (SESSION_LOG_ENABLED &&
+      !sessionLog.begin(SESSION_LOG_FILE_KB * 1024UL, SESSION_LOG_MAX_KB * 1024UL, UI_TASK_CORE)) {
+    if (serialEnabled) Serial.println("Session log task create failed");
+  }
+  setupComplete = true;
+}
+
+// Bring up the LTR390 in UV mode with the given ranging mode (slow on a
+// cold boot: 18x gain, 20-bit / ~400ms integration, 500ms rate, the
+// datasheet reference setting). Sleeps if the sensor is missing.
+void initUvSensor(int rangeMode) {
+  if (!initUvSensors()) {
+    if (serialEnabled) Serial.println("LTR390 not found - check wiring; sleeping");
+    display.clearDisplay();
+    display.setTextSize(1);
+    display.setCursor(10, 28);
+    display.print("LTR390 failed");
+    display.display();
+    delay(2000);
+    enterDeepSleep();
+  }
+
+  if (rangeMode != UV_RANGE_SLOW && rangeMode != UV_RANGE_FAST) {
+    rangeMode = UV_RANGE_SLOW;
+  }
+  for (int i = 0; i < uvSensorCount; i++) {
+    if (uvSensors[i].online) {
+      selectUvSensor(i);
+      activeLtr().setMode(LTR390_MODE_UVS);
+    }
+  }
+  ltrAlsSlotActive = false;
+  alsConfirmPending = false;
+  alsDetector.configure(getAlsAssistConfig());
+  uvAutoRange.configure(getUvAutoRangeConfig());
+  applyUvRangeMode(rangeMode);
+  verifyBarRawThresholds();
+  initLtr390Interrupt();
+
+  if (serialEnabled) {
+    Serial.print("LTR390 configured: UV mode, ");
+    Serial.println(UV_RANGE_MODES[rangeMode].label);
+    if (uvSensorCount > 1) {
+      Serial.print("UV sensors online: ");
+      Serial.print(uvFusion.onlineCount());
+      Serial.print("/");
+      Serial.print(uvSensorCount);
+      Serial.print(", a sample every ");
+      Serial.print(uvArrayCycleMs / (unsigned long)max(1, uvFusion.onlineCount()));
+      Serial.println("ms");
+    }
+    Serial.println("Expected: ~2300 counts per UVI (18x gain, 20-bit)");
+    if (UV_AUTORANGE_ENABLED) {
+      Serial.println("UV auto-ranging: ON (18-bit/100ms in bright light)");
+    }
+    if (UV_ENCLOSURE_COMP_ENABLED) {
+      Serial.print("UV enclosure compensation: ON (T=");
+      Serial.print(UV_ENCLOSURE_TRANSMITTANCE, 4);
+      Serial.print(", offset=");
+      Serial.print(UV_ENCLOSURE_UVI_OFFSET, 4);
+      Serial.println(")");
+    } else {
+      Serial.println("UV enclosure compensation: OFF");
+    }
+  }
+}
+
+// Last session's game, screen and reading. The reading gives a provisional
+// bar (computed by refreshGameState() against the restored range mode's
+// tables) until the first real sample replaces it.
+void restoreWarmResumeState(const WarmResumeState& state) {
+  currentScreen = constrain((int)state.currentScreen, 0, NUM_UI_SCREENS - 1);
+  currentGame = (currentScreen < NUM_GAMES) ? currentScreen : clampGameIndex(state.currentGame);
+  if (state.debugPage >= 0 && state.debugPage < DEBUG_PAGE_COUNT) {
+    debugPage = state.debugPage;
+  }
+  cachedRawUVS = state.rawUVS & LTR390_RAW_MAX;
+  cachedUviRaw = state.uviRaw;
+  cachedUvi = state.uvi;
+  uvBars.resumeSmoothing(state.uvi);
+}
+
+void saveWarmResumeSnapshot() {
+  if (!WARM_RESUME_ENABLED || !setupComplete) {
+    return;
+  }
+  WarmResumeState state;
+  memset(&state, 0, sizeof(state));
+  state.currentGame = (int8_t)currentGame;
+  state.currentScreen = (int8_t)currentScreen;
+  state.debugPage = (int8_t)debugPage;
+  state.uvRangeMode = (int8_t)uvAutoRange.mode();
+  state.rawUVS = cachedRawUVS;
+  state.uviRaw = cachedUviRaw;
+  state.uvi = cachedUvi;
+  saveWarmResumeState(state);
 }
 
 void loop() {
+  unsigned long loopStartUs = micros();
+  unsigned long stageUs = loopStartUs;
+
   // Check power button for tap (change game) or long-press (sleep)
   handlePowerButton();
   handleSecondButton();
-  updateScreensaverState();
+  stageUs = loopProfiler.mark(PROFILE_BUTTONS, stageUs);
   updateBluetoothState();
+  stageUs = loopProfiler.mark(PROFILE_BLE_STATE, stageUs);
   updateBatteryStatus();
   handleLowBatteryCutoff();
+  stageUs = loopProfiler.mark(PROFILE_BATTERY, stageUs);
 
   // Wait for new sensor data
   bool newData = false;
-  if (ltr.newDataAvailable()) {
-    float uvi = calculateUVI();
-    float uviForBars = UV_THRESHOLDS_CALIBRATED_OPEN_AIR ? uvi : cachedUviRaw;
-    if (UVI_SMOOTHING_ENABLED) {
-      if (!hasSmoothedUvi) {
-        smoothedUvi = uviForBars;
-        hasSmoothedUvi = true;
-      } else {
-        smoothedUvi = (UVI_SMOOTHING_ALPHA * uviForBars) + ((1.0f - UVI_SMOOTHING_ALPHA) * smoothedUvi);
-      }
-      uviForBars = smoothedUvi;
-    }
-    cachedNumBars = GAME_BARS[currentGame];
-    if (gameChanged) {
-      cachedFilledBars = getBoktaiBars(uviForBars, currentGame);
-      gameChanged = false;
-    } else {
-      cachedFilledBars = getBoktaiBarsWithHysteresis(uviForBars, currentGame, cachedFilledBars);
-    }
-    cachedUvi = uviForBars;
-    updateBluetoothMeter(cachedFilledBars, cachedNumBars);
-    updateUsbMeter(cachedFilledBars, cachedNumBars);
+  uint32_t rawUVS = 0;
+  bool provisional = false;
+  if (pollLtr390Sample(&rawUVS, &provisional)) {
+    handleUvSample(rawUVS, provisional);
     newData = true;
   }
+  stageUs = loopProfiler.mark(PROFILE_SENSOR, stageUs);
 
   updateGbaLinkOutput(cachedFilledBars);
+  stageUs = loopProfiler.mark(PROFILE_GBA_LINK, stageUs);
 
-  if (screensaverActive) {
-    drawScreensaver();
-  } else if (newData || screensaverJustExited || uiScreenChanged) {
-    drawMainDisplay();
-    uiScreenChanged = false;
+  // Hand the new state to the UI side
+  if (newData) {
+    postUiEvent(UI_EVENT_REDRAW);
+  }
+  publishUiSnapshot();
+  flushUiEvents();
+  stageUs = loopProfiler.mark(PROFILE_UI_STATE, stageUs);
+  if (uiTaskHandle == nullptr) {
+    runUiFrame();
   }
+  stageUs = loopProfiler.mark(PROFILE_DISPLAY, stageUs);
 
-  screensaverJustExited = false;
   handleBlePresses();
   refreshSingleAnalogButton();
-  delay(1); // Keep loop responsive while allowing accurate GBA phase timing
+  usbServiceReports();
+  loopProfiler.mark(PROFILE_HID, stageUs);
+
+  serviceSerialCommands();
+  drainTelemetry();
+
+  if (loopProfiler.endIteration(loopStartUs)) {
+    i2cBusMonitor.publish();
+    powerManager.publish();
+    updateTaskStats();
+    logLoopProfile();
+  }
+  if (POWER_SCHEDULER_ENABLED) {
+    sleepUntilNextDeadline();
+  } else {
+    delay(1); // Keep loop responsive (GBA phases are timer-driven when enabled)
+  }
 }
 
-void noteScreenActivity() {
-  lastScreenActivityMs = millis();
-  if (screensaverActive) {
-    screensaverActive = false;
-    screensaverJustExited = true;
+// Classify one sensor sample and hand it to the meters. A provisional sample
+// (ALS step, see AlsAssist.h) restarts smoothing at the new level and skips
+// hysteresis; so does the full UV sample that confirms it. Only full UV
+// samples are logged, streamed and used for auto-ranging.
+void handleUvSample(uint32_t rawUVS, bool provisional) {
+  traceEvent(TRACE_SENSOR_SAMPLE, (uint8_t)(uvAutoRange.mode() | (provisional ? 0x80 : 0x00)),
+             traceSaturate16(rawUVS));
+  bool restart = provisional || alsConfirmPending;
+  alsConfirmPending = provisional;
+  if (restart) {
+    uvBars.restart();
+  }
+  float uvi = calculateUVI(rawUVS);
+  float uviForBars = UV_THRESHOLDS_CALIBRATED_OPEN_AIR ? uvi : cachedUviRaw;
+  cachedNumBars = GAME_BARS[currentGame];
+  cachedUvi = uvBars.smooth(uviForBars, millis());
+  int previousBars = cachedFilledBars;
+  cachedFilledBars = getCurrentSampleBars(!gameChanged && !restart);
+  if (cachedFilledBars != previousBars) {
+    traceEvent(TRACE_BAR_CHANGE, (uint8_t)cachedFilledBars, (uint16_t)previousBars);
+  }
+  gameChanged = false;
+  if (!provisional) {
+    logSessionSample();
+    queueTelemetrySample();
+  }
+  updateBluetoothMeter(cachedFilledBars, cachedNumBars);
+  updateUsbMeter(cachedFilledBars, cachedNumBars);
+  if (provisional) {
+    return;
+  }
+  updateUvAutoRange(cachedUviRaw);
+  if (alsAssistActive()) {
+    alsDetector.uvSample(cachedUviRaw);
+    startLtr390AlsSlot();
+  }
+  if (!bootProfiler.done(BOOT_PHASE_FIRST_BAR)) {
+    bootProfiler.mark(BOOT_PHASE_FIRST_BAR);
+    logBootProfile();
   }
 }
 
-bool shouldShowScreensaverBluetoothStatus() {
-  return BLUETOOTH_ENABLED && (bleConnected || blePairingActive);
+// ---- Sleep between events (loop() side) ----
+
+// Block until the earliest subsystem deadline or an interrupt. Each
+// subsystem still checks its own timing when loop() runs; this only
+// decides when that is (see DeadlineScheduler.h).
+void sleepUntilNextDeadline() {
+  uint32_t now = millis();
+  loopScheduler.clear();
+  planLoopDeadlines(now);
+  powerManager.keepAwake(getPowerAwakeReasons());
+  WakeSource source;
+  uint32_t waitMs = loopScheduler.waitMs(now, POWER_MAX_SLEEP_MS, &source);
+  powerManager.wait(waitMs, source);
 }
 
-void calculateScreensaverLayout() {
-  bool bluetoothStatusVisible = shouldShowScreensaverBluetoothStatus();
-  screensaverBatteryVisible = (cachedBatteryPct >= 0) || bluetoothStatusVisible;
-  screensaverBatteryText[0] = '\0';
-  screensaverBatteryTextW = 0;
-  screensaverBatteryTextH = 0;
-  screensaverBatteryW = 0;
-  screensaverBatteryH = 0;
+// When each loop() subsystem next needs to run. Interrupt-driven work
+// (button edges, sensor INT, battery results) notifies loop() instead;
+// BLE connection changes are picked up within POWER_MAX_SLEEP_MS.
+void planLoopDeadlines(uint32_t now) {
+  uint32_t dueMs;
+  if (powerButton.nextDeadline(&dueMs)) {
+    loopScheduler.at(WAKE_BUTTONS, dueMs);
+  }
+  if (BUTTON2_ENABLED && BUTTON2_PIN >= 0 && secondButton.nextDeadline(&dueMs)) {
+    loopScheduler.at(WAKE_BUTTONS, dueMs);
+  }
+
+  if (uvSensorCount > 1) {
+    planUvArrayDeadlines();
+  } else if (ltrAlsSlotActive) {
+    loopScheduler.at(WAKE_SENSOR, ltrAlsSlotStartMs + LTR390_ALS_SLOT_MS);
+  } else if (ltrIntModeActive) {
+    loopScheduler.at(WAKE_SENSOR, ltrLastSampleMs + LTR390_INT_SAFETY_POLL_MS);
+  } else if (ltrHasSample) {
+    // Polled once per ms from the poll start until the sample is ready
+    loopScheduler.at(WAKE_SENSOR, ltrLastSampleMs + getLtr390PollStartMs());
+  } else {
+    loopScheduler.after(WAKE_SENSOR, now, 1);
+  }
 
-  display.setTextSize(1);
-  if (screensaverBatteryVisible) {
-    bool hasBattery = (cachedBatteryPct >= 0);
-    if (hasBattery) {
-      snprintf(screensaverBatteryText, sizeof(screensaverBatteryText), "%d%%", cachedBatteryPct);
-      int16_t x1, y1;
-      uint16_t w, h;
-      display.getTextBounds(screensaverBatteryText, 0, 0, &x1, &y1, &w, &h);
-      screensaverBatteryTextW = (int16_t)w;
-      screensaverBatteryTextH = (int16_t)h;
+  if (BLUETOOTH_ENABLED && blePairingActive && !bleConnected) {
+    loopScheduler.at(WAKE_BLE, bleIconLastToggleMs + BLE_ICON_FLASH_MS);
+    if (BLE_PAIRING_TIMEOUT_MS > 0) {
+      loopScheduler.at(WAKE_BLE, blePairingStartMs + BLE_PAIRING_TIMEOUT_MS);
     }
+  }
 
-    int16_t bluetoothW = 0;
-    if (bluetoothStatusVisible) {
-      bluetoothW = STATUS_BT_ICON_W;
+  if (HID_CONTROL_MODE == 0) {
+    unsigned long hidWakeMs = 0;
+    if ((bleMeter.pressHolding() || hasBlePressWork()) &&
+        bleMeter.wakeAt(getBleStepModel(currentGame), bleDeviceBars, &hidWakeMs)) {
+      loopScheduler.at(WAKE_HID, hidWakeMs);
     }
+  } else if (HID_CONTROL_MODE == 1 && BLUETOOTH_ENABLED && bleSingleAnalogButtonHeld &&
+             HID_METER_UNLOCK_BUTTON_ENABLED && HID_METER_UNLOCK_REFRESH_MS > 0) {
+    loopScheduler.at(WAKE_HID, bleSingleAnalogLastRefreshMs + HID_METER_UNLOCK_REFRESH_MS);
+  }
+  #if HAS_USB_HID
+  if (usbHidActive && usbGamepad.hasPending()) {
+    loopScheduler.after(WAKE_HID, now, 1);
+  }
+  #endif
 
-    if (hasBattery) {
-      screensaverBatteryW = screensaverBatteryTextW + SCREENSAVER_BATT_GAP + STATUS_BATT_ICON_W;
-      if (bluetoothStatusVisible) {
-        screensaverBatteryW += bluetoothW + STATUS_BT_GAP;
-      }
-      screensaverBatteryH = max(screensaverBatteryTextH, STATUS_BATT_ICON_H);
-    } else {
-      screensaverBatteryW = bluetoothW;
-      screensaverBatteryH = bluetoothW > 0 ? STATUS_BT_ICON_H : 0;
-    }
+  if (lowBatteryStart != 0) {
+    loopScheduler.at(WAKE_BATTERY, lowBatteryStart + BATTERY_CUTOFF_HOLD_MS);
+  }
 
-    if (bluetoothStatusVisible) {
-      screensaverBatteryH = max(screensaverBatteryH, STATUS_BT_ICON_H);
-    }
+  if (GBA_LINK_ENABLED && !gbaLinkTimer.running()) {
+    unsigned long intervalUs = getGbaPhaseIntervalUs();
+    unsigned long elapsedUs = micros() - gbaFrameLastToggleUs;
+    uint32_t leftMs = (elapsedUs < intervalUs) ? (uint32_t)((intervalUs - elapsedUs) / 1000UL) : 0;
+    loopScheduler.after(WAKE_GBA_LINK, now, leftMs);
   }
 
-  screensaverBlockW = screensaverTextW;
-  if (SCREENSAVER_IMAGE_W > screensaverBlockW) {
-    screensaverBlockW = SCREENSAVER_IMAGE_W;
+  if (uiTaskHandle == nullptr) {
+    planUiDeadlines(loopScheduler, WAKE_DISPLAY, now);
   }
-  if (screensaverBatteryW > screensaverBlockW) {
-    screensaverBlockW = screensaverBatteryW;
+
+  if (serialEnabled) {
+    bool telemetryQueued = DEBUG_SERIAL_TELEMETRY && telemetryTx.pendingBytes() > 0;
+    loopScheduler.after(WAKE_SERIAL, now, telemetryQueued ? 1 : POWER_SERIAL_POLL_MS);
   }
 
-  screensaverBlockH = SCREENSAVER_IMAGE_H + SCREENSAVER_IMAGE_TEXT_GAP + screensaverTextH;
-  if (screensaverBatteryVisible) {
-    screensaverBlockH += SCREENSAVER_TEXT_BATT_GAP + screensaverBatteryH;
+  loopScheduler.at(WAKE_STATS, loopProfiler.windowDueMs());
+}
+
+// Next conversion start or poll start per sensor, and offline retries
+void planUvArrayDeadlines() {
+  unsigned long pollStartMs = (ltrIntegrationMs * LTR390_POLL_START_PCT) / 100UL;
+  for (int i = 0; i < uvSensorCount; i++) {
+    const UvSensor& sensor = uvSensors[i];
+    if (!sensor.online) {
+      loopScheduler.at(WAKE_SENSOR, sensor.retryAtMs);
+    } else if (sensor.converting) {
+      loopScheduler.at(WAKE_SENSOR, sensor.startedMs + pollStartMs);
+    } else {
+      loopScheduler.at(WAKE_SENSOR, sensor.startAtMs);
+    }
   }
 }
 
-void drawScreensaverBattery(int16_t x, int16_t y) {
-  if (!screensaverBatteryVisible) {
-    return;
+// Light sleep would drop the USB connection (and the host cannot wake us
+// by plugging in) and freeze the polled GBA link output
+uint8_t getPowerAwakeReasons() {
+  uint8_t reasons = 0;
+  if (usbHidActive || serialEnabled) {
+    reasons |= POWER_AWAKE_USB;
   }
+  if (GBA_LINK_ENABLED) {
+    reasons |= POWER_AWAKE_GBA_LINK;
+  }
+  return reasons;
+}
 
-  bool hasBattery = (cachedBatteryPct >= 0);
-  bool bluetoothStatusVisible = shouldShowScreensaverBluetoothStatus();
-  int16_t cursorX = x;
+// ---- UI handoff (loop() side) ----
 
-  display.setTextSize(1);
-  if (bluetoothStatusVisible) {
-    int16_t btY = y + ((screensaverBatteryH - STATUS_BT_ICON_H) / 2);
-    drawBluetoothIcon(cursorX, btY, isBluetoothIconOn());
-    cursorX += STATUS_BT_ICON_W;
-    if (hasBattery) {
-      cursorX += STATUS_BT_GAP;
+void postUiEvent(uint8_t event) {
+  uiEventsThisPass |= (uint8_t)(1U << event);
+}
+
+void publishUiSnapshot() {
+  UiSnapshot snap;
+  snap.currentScreen = currentScreen;
+  snap.currentGame = currentGame;
+  snap.filledBars = cachedFilledBars;
+  snap.numBars = cachedNumBars;
+  snap.uvi = cachedUvi;
+  snap.uviRaw = cachedUviRaw;
+  snap.rawUVS = cachedRawUVS;
+  snap.uvRangeMode = uvAutoRange.mode();
+  snap.batteryPct = cachedBatteryPct;
+  snap.batteryVoltage = cachedBatteryVoltage;
+  snap.batteryAdcAvg = cachedBatteryAdcAvg;
+  snap.hasBatteryReading = hasBatteryReading;
+  snap.bleConnected = bleConnected;
+  snap.blePairingActive = blePairingActive;
+  snap.bleIconFlashOn = bleIconFlashOn;
+  uiSnapshot.write(snap);
+}
+
+// Queue this pass's events only after the snapshot they refer to has been
+// published. Each event type sits in the queue at most once; a repeat
+// raised before the UI consumes it is covered by the one already queued,
+// since the UI reads the snapshot after draining events.
+void flushUiEvents() {
+  if (uiEventsThisPass == 0) {
+    return;
+  }
+  for (uint8_t event = 0; event < UI_EVENT_COUNT; event++) {
+    uint8_t bit = (uint8_t)(1U << event);
+    if ((uiEventsThisPass & bit) == 0) {
+      continue;
+    }
+    if ((uiEventsQueued.fetch_or(bit) & bit) != 0) {
+      continue;
     }
+    uiEvents.push(event);
   }
-  if (hasBattery) {
-    int16_t textY = y + ((screensaverBatteryH - screensaverBatteryTextH) / 2);
-    display.setCursor(cursorX, textY);
-    display.print(screensaverBatteryText);
-    cursorX += screensaverBatteryTextW + SCREENSAVER_BATT_GAP;
-
-    int16_t iconY = y + ((screensaverBatteryH - STATUS_BATT_ICON_H) / 2);
-    drawBatteryGauge(cursorX, iconY, cachedBatteryPct);
+  uiEventsThisPass = 0;
+  if (uiTaskHandle != nullptr) {
+    xTaskNotifyGive(uiTaskHandle);
   }
 }
 
-void updateScreensaverState() {
-  if (!SCREENSAVER_ENABLED) {
-    return;
+// ---- UI side ----
+
+// One UI pass: consume events, take the latest snapshot, then update the
+// screensaver / debug page state and redraw what changed.
+void runUiFrame() {
+  unsigned long startUs = micros();
+  bool redraw = false;
+  uint8_t event;
+  while (uiEvents.pop(event)) {
+    uiEventsQueued.fetch_and((uint8_t)~(1U << event));
+    if (event == UI_EVENT_REDRAW) {
+      redraw = true;
+    } else if (event == UI_EVENT_SCREEN_CHANGED) {
+      uiScreenChanged = true;
+    } else if (event == UI_EVENT_ACTIVITY) {
+      applyScreenActivity();
+    }
   }
+  uiSnapshot.read(ui);
+
+  updateScreensaverState();
+  bool debugPageChanged = updateDebugPage();
   if (screensaverActive) {
-    return;
+    drawScreensaver();
+  } else if (redraw || screensaverJustExited || uiScreenChanged || debugPageChanged) {
+    drawMainDisplay();
+    uiScreenChanged = false;
   }
+  screensaverJustExited = false;
+  serviceDisplayFlush();
 
-  unsigned long now = millis();
-  if ((now - lastScreenActivityMs) >= SCREENSAVER_TIMEOUT_MS) {
-    screensaverActive = true;
-    screensaverDx = 1;
-    screensaverDy = 1;
-    calculateScreensaverLayout();
-    screensaverLastLayoutPct = cachedBatteryPct;
-    screensaverLastLayoutBleStatus = shouldShowScreensaverBluetoothStatus();
-    screensaverX = (SCREEN_WIDTH - screensaverBlockW) / 2;
-    screensaverY = (SCREEN_HEIGHT - screensaverBlockH) / 2;
-    lastScreensaverMoveMs = 0;
+  unsigned long nowMs = millis();
+  if ((nowMs - uiStatsWindowStartMs) >= DEBUG_STATS_WINDOW_MS) {
+    #if !defined(BOARD_LILYGO_T_QT_PRO)
+    oledFlush.publish();
+    #endif
+    uiFrameStats.publish();
+    uiStatsWindowStartMs = nowMs;
   }
+  uiTaskBusyUs.fetch_add((uint32_t)(micros() - startUs));
 }
 
-void drawScreensaver() {
-  unsigned long now = millis();
-  if ((now - lastScreensaverMoveMs) < SCREENSAVER_MOVE_MS) {
-    return;
+void uiTaskMain(void* arg) {
+  (void)arg;
+  for (;;) {
+    // Woken by flushUiEvents(); the timeout drives the screensaver, debug
+    // page rotation and any chunked flush still in progress.
+    TickType_t waitTicks = pdMS_TO_TICKS(getUiWaitMs());
+    uiCpuLock.release();
+    ulTaskNotifyTake(pdTRUE, (waitTicks > 0) ? waitTicks : 1);
+    uiCpuLock.acquire();
+    if (uiTaskStopRequested) {
+      uiCpuLock.release();
+      uiTaskParked = true;
+      vTaskSuspend(nullptr);
+    }
+    runUiFrame();
   }
-  lastScreensaverMoveMs = now;
+}
 
-  bool bluetoothStatusVisible = shouldShowScreensaverBluetoothStatus();
-  if (screensaverLastLayoutPct != cachedBatteryPct ||
-      screensaverLastLayoutBleStatus != bluetoothStatusVisible) {
-    calculateScreensaverLayout();
-    screensaverLastLayoutPct = cachedBatteryPct;
-    screensaverLastLayoutBleStatus = bluetoothStatusVisible;
+// How long the UI task may wait for an event before it has timed work
+uint32_t getUiWaitMs() {
+  if (displayFlushPending()) {
+    return 1;
   }
+  if (!POWER_SCHEDULER_ENABLED) {
+    return UI_TASK_PERIOD_MS;
+  }
+  uint32_t now = millis();
+  uiScheduler.clear();
+  planUiDeadlines(uiScheduler, WAKE_DISPLAY, now);
+  WakeSource source;
+  return uiScheduler.waitMs(now, POWER_MAX_SLEEP_MS, &source);
+}
 
-  int16_t maxX = SCREEN_WIDTH - screensaverBlockW;
-  int16_t maxY = SCREEN_HEIGHT - screensaverBlockH;
-  if (maxX < 0) {
-    maxX = 0;
+// UI timing: chunked flush, screensaver timeout and movement, debug page
+// rotation and the stats window
+void planUiDeadlines(DeadlineScheduler& scheduler, WakeSource source, uint32_t now) {
+  if (displayFlushPending()) {
+    scheduler.after(source, now, 1);
   }
-  if (maxY < 0) {
-    maxY = 0;
+  if (SCREENSAVER_ENABLED) {
+    if (screensaverActive) {
+      scheduler.at(source, lastScreensaverMoveMs + SCREENSAVER_MOVE_MS);
+    } else {
+      scheduler.at(source, lastScreenActivityMs + SCREENSAVER_TIMEOUT_MS);
+    }
   }
+  if (DEBUG_STATS_ENABLED && ui.currentScreen == DEBUG_SCREEN_INDEX) {
+    scheduler.at(source, debugPageLastMs + DEBUG_STATS_PAGE_MS);
+  }
+  scheduler.at(source, uiStatsWindowStartMs + DEBUG_STATS_WINDOW_MS);
+}
 
-  screensaverX += screensaverDx;
-  screensaverY += screensaverDy;
-
-  if (screensaverX <= 0) {
-    screensaverX = 0;
+void startUiTask() {
+  if (!UI_TASK_ENABLED || uiTaskHandle != nullptr) {
+    return;
+  }
+  uiTaskStopRequested = false;
+  uiTaskParked = false;
+  uiCpuLock.create(ESP_PM_CPU_FREQ_MAX, "ui");
+  BaseType_t created = xTaskCreatePinnedToCore(uiTaskMain, "ui", UI_TASK_STACK_BYTES, nullptr, 1,
+                                               &uiTaskHandle, UI_TASK_CORE);
+  if (created != pdPASS) {
+    uiTaskHandle = nullptr;
+    if (serialEnabled) Serial.println("UI task create failed, rendering from loop()");
+  }
+}
+
+// Park and delete the UI task so the caller can drive the display directly
+// (sleep, CDC restart, low-battery screens). Waits for the current frame to
+// finish so no display transfer is cut off mid-way. The task is only
+// deleted once it has parked: deleted mid-frame, it would keep the Wire
+// lock and its CPU lock forever and the next display or sensor access would
+// hang. If it does not park in time it is left running with the stop
+// request set (it parks after its frame, and a later call deletes it).
+bool stopUiTask() {
+  if (uiTaskHandle == nullptr) {
+    return true;
+  }
+  uiTaskStopRequested = true;
+  xTaskNotifyGive(uiTaskHandle);
+  unsigned long startMs = millis();
+  while (!uiTaskParked && (millis() - startMs) < UI_TASK_STOP_TIMEOUT_MS) {
+    delay(1);
+  }
+  if (!uiTaskParked) {
+    if (serialEnabled) {
+      Serial.print("UI task did not park within ");
+      Serial.print(UI_TASK_STOP_TIMEOUT_MS);
+      Serial.println("ms, left running");
+    }
+    return false;
+  }
+  vTaskDelete(uiTaskHandle);
+  uiTaskHandle = nullptr;
+  return true;
+}
+
+// CPU share per task over the last stats window, and stack headroom
+void updateTaskStats() {
+  unsigned long nowUs = micros();
+  uint32_t windowUs = (uint32_t)(nowUs - taskStatsWindowStartUs);
+  taskStatsWindowStartUs = nowUs;
+  uint32_t uiBusyUs = uiTaskBusyUs.exchange(0);
+  if (windowUs > 0) {
+    loopTaskCpuPermille = (uint32_t)(((uint64_t)loopProfiler.loopTotalUs() * 1000ULL) / windowUs);
+    uiTaskCpuPermille = (uint32_t)(((uint64_t)uiBusyUs * 1000ULL) / windowUs);
+  }
+  loopTaskStackFree = uxTaskGetStackHighWaterMark(nullptr);
+  uiTaskStackFree = (uiTaskHandle != nullptr) ? uxTaskGetStackHighWaterMark(uiTaskHandle) : 0;
+  loopTaskCore = xPortGetCoreID();
+}
+
+// Advance the debug screen to its next page once DEBUG_STATS_PAGE_MS has
+// elapsed. Returns true when the page changed and the screen needs a redraw.
+bool updateDebugPage() {
+  if (!DEBUG_STATS_ENABLED || ui.currentScreen != DEBUG_SCREEN_INDEX) {
+    debugPage = DEBUG_PAGE_READINGS;
+    return false;
+  }
+  unsigned long now = millis();
+  if (uiScreenChanged) {
+    debugPageLastMs = now;
+    return false;
+  }
+  if ((now - debugPageLastMs) < DEBUG_STATS_PAGE_MS) {
+    return false;
+  }
+  debugPageLastMs = now;
+  do {
+    debugPage = (debugPage + 1) % DEBUG_PAGE_COUNT;
+  } while (!isDebugPageAvailable(debugPage));
+  return true;
+}
+
+bool isDebugPageAvailable(int page) {
+  if (page == DEBUG_PAGE_GBA_LINK) {
+    return GBA_LINK_ENABLED;
+  }
+  if (page == DEBUG_PAGE_METER) {
+    return HID_CONTROL_MODE == 0;
+  }
+  if (page == DEBUG_PAGE_LOG) {
+    return SESSION_LOG_ENABLED;
+  }
+  if (page == DEBUG_PAGE_USB) {
+    #if HAS_USB_HID
+    return usbHidActive && !inCdcMode;
+    #else
+    return false;
+    #endif
+  }
+  if (page == DEBUG_PAGE_UI) {
+    return UI_RETAINED_WIDGETS;
+  }
+  if (page == DEBUG_PAGE_POWER) {
+    return POWER_SCHEDULER_ENABLED;
+  }
+  if (page == DEBUG_PAGE_SENSORS) {
+    return uvSensorCount > 1;
+  }
+  if (page == DEBUG_PAGE_TFT) {
+    #if defined(BOARD_LILYGO_T_QT_PRO)
+    return true;
+    #else
+    return false;
+    #endif
+  }
+  return true;
+}
+
+void logBootProfile() {
+  if (!serialEnabled) {
+    return;
+  }
+  Serial.print(bootProfiler.warm() ? "Boot (warm) ms:" : "Boot (cold) ms:");
+  for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+    Serial.print(" ");
+    Serial.print(BOOT_PHASE_NAMES[i]);
+    Serial.print("=");
+    Serial.print(bootProfiler.phaseMs((BootPhase)i));
+  }
+  Serial.print(" to first bar: ");
+  Serial.println(bootProfiler.totalMs());
+}
+
+// ---- Event trace dump ----
+
+// Serial commands:
+//   't'  dump the event trace (the frozen XInput-session trace first, if
+//        one is held) and start a fresh one
+//   'T'  the same, as a raw hex dump for host/trace_decode
+//   'l'  dump the session log as CSV, replayed through the bar pipeline
+//   'L'  dump the session log blocks as hex for host/session_log_decode
+//   'b'  score filter settings against the session log
+//   'g'  simulate GBA link protocols v1 and v2
+//   'a'  simulate ALS-assisted step detection
+//   'm'  simulate multi-sensor fusion
+//   'p'  print the GBA link patch dataarea blocks
+//   'E'  erase the session log
+void serviceSerialCommands() {
+  if (!serialEnabled) {
+    return;
+  }
+  while (Serial.available() > 0) {
+    int command = Serial.read();
+    if (command == 't' && TRACE_ENABLED) {
+      traceFreeze();
+      dumpTrace();
+      traceResume(TRACE_ENABLED);
+    } else if (command == 'T' && TRACE_ENABLED) {
+      traceFreeze();
+      dumpTraceRaw();
+      traceResume(TRACE_ENABLED);
+    } else if ((command == 'l' || command == 'L' || command == 'b') && sessionLog.isMounted()) {
+      // Reading needs the writer idle; a block it still holds would be
+      // overwritten by the read-back
+      if (!sessionLog.pause()) {
+        Serial.println("# session log busy writing, try again");
+        continue;
+      }
+      if (command == 'l') {
+        dumpSessionLog();
+      } else if (command == 'L') {
+        dumpSessionLogRaw();
+      } else {
+        runFilterBenchmark();
+      }
+      sessionLog.resume();
+    } else if (command == 'g') {
+      runGbaLinkSimulation();
+    } else if (command == 'a') {
+      runAlsAssistSimulation();
+    } else if (command == 'm') {
+      runUvFusionSimulation();
+    } else if (command == 'p') {
+      printLinkPatchDataAreas();
+    } else if (command == 'E' && sessionLog.isMounted()) {
+      Serial.println(sessionLog.eraseAll() ? "# session log erased" : "# session log busy writing, nothing erased");
+    }
+  }
+}
+
+// ---- Binary telemetry ----
+
+// One frame per sensor sample; never blocks (see Telemetry.h)
+void queueTelemetrySample() {
+  if (!serialEnabled || !DEBUG_SERIAL_TELEMETRY) {
+    return;
+  }
+  TelemetrySample t;
+  t.seq = telemetrySeq++;
+  t.timeUs = (uint32_t)micros();
+  t.rawUVS = cachedRawUVS;
+  t.uviMilli = (int32_t)lroundf(cachedUvi * 1000.0f);
+  t.bars = (uint8_t)cachedFilledBars;
+  t.numBars = (uint8_t)cachedNumBars;
+  t.game = (uint8_t)currentGame;
+  t.rangeMode = (uint8_t)uvAutoRange.mode();
+  t.batteryAdc = hasBatteryReading ? (uint16_t)lroundf(cachedBatteryAdcAvg) : 0;
+  t.batteryMv = hasBatteryReading ? (uint16_t)lroundf(cachedBatteryVoltage * 1000.0f) : 0;
+  t.hidFlags = (usbHidActive ? TELEMETRY_HID_USB : 0) |
+               (bleConnected ? TELEMETRY_HID_BLE : 0) |
+               (bleMeter.pressHolding() ? TELEMETRY_HID_HOLDING : 0) |
+               ((bleMeter.syncPhase() != METER_SYNC_NONE) ? TELEMETRY_HID_SYNCING : 0);
+  t.hidMode = (uint8_t)HID_CONTROL_MODE;
+  t.hidButtons = usbButtonState;
+  t.dropped = telemetryTx.dropped();
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  size_t len = telemetryEncodeSample(t, frame);
+  telemetryTx.push(frame, len);
+}
+
+void drainTelemetry() {
+  if (!serialEnabled || !DEBUG_SERIAL_TELEMETRY) {
+    return;
+  }
+  telemetryTx.drain(Serial, TELEMETRY_MAX_FRAME);
+}
+
+// ---- Session log ----
+
+// Queue the sample loop() just processed. Battery voltage is added every
+// SESSION_LOG_BATTERY_MS, since it moves far slower than UV.
+void logSessionSample() {
+  if (!sessionLog.isRunning()) {
+    return;
+  }
+  unsigned long now = millis();
+  SessionLogSample sample;
+  sample.timeMs = now;
+  sample.rawUVS = cachedRawUVS & LTR390_RAW_MAX;
+  sample.uviMilli = (int32_t)lroundf(cachedUvi * 1000.0f);
+  sample.bars = (uint8_t)cachedFilledBars;
+  sample.game = (uint8_t)currentGame;
+  sample.rangeMode = (uint8_t)uvAutoRange.mode();
+  sample.hasBattery = hasBatteryReading &&
+                      (sessionLogBatteryMs == 0 || (now - sessionLogBatteryMs) >= SESSION_LOG_BATTERY_MS);
+  sample.batteryMv = sample.hasBattery ? (uint16_t)lroundf(cachedBatteryVoltage * 1000.0f) : 0;
+  if (sample.hasBattery) {
+    sessionLogBatteryMs = now;
+  }
+  sessionLog.append(sample);
+}
+
+// Every logged sample as CSV. replay_uvi/replay_bars run the logged raw
+// count through this build's conversion, filtering and hysteresis, so a
+// threshold or calibration change can be checked against a real session.
+void dumpSessionLog() {
+  Serial.println(SESSION_LOG_CSV_HEADER);
+  char line[112];
+  uint32_t samples = 0;
+  SessionLogReplay replay;
+  replay.begin(getSessionLogReplayConfig());
+  uint32_t badBlocks = sessionLog.forEachSample([&](const SessionLogBlockHeader& header, const SessionLogSample& sample) {
+    int replayBars = replay.update(header, sample);
+    sessionLogFormatCsv(line, sizeof(line), header, sample, replay.uvi(), replayBars);
+    Serial.println(line);
+    samples++;
+  });
+  Serial.print("# ");
+  Serial.print(samples);
+  Serial.print(" samples, ");
+  Serial.print(badBlocks);
+  Serial.print(" unreadable blocks, ");
+  Serial.print(sessionLog.recordsDropped());
+  Serial.println(" dropped this session");
+}
+
+// Every stored block as hex, for host/session_log_decode
+void dumpSessionLogRaw() {
+  char line[2 * SESSION_LOG_RAW_LINE_BYTES + 1];
+  sessionLogFormatRawBegin(line, sizeof(line), SESSION_LOG_BLOCK_BYTES);
+  Serial.println(line);
+  sessionLog.forEachBlock([&](const uint8_t* block, size_t blockBytes) {
+    for (size_t offset = 0; offset < blockBytes; offset += SESSION_LOG_RAW_LINE_BYTES) {
+      sessionLogFormatRawLine(line, block + offset, SESSION_LOG_RAW_LINE_BYTES);
+      Serial.println(line);
+    }
+  });
+  Serial.println(SESSION_LOG_RAW_END);
+}
+
+// Replays the session log through the filter presets in UvFilterBench.h
+// (none, legacy smoothing + hysteresis, median, median + One-Euro, the
+// configured pipeline) and prints each one's flips and lag behind the
+// reference bar count.
+void runFilterBenchmark() {
+  static UvFilterBench bench;
+  bench.begin(getSessionLogReplayConfig(), BAR_HYSTERESIS);
+  sessionLog.forEachSample([&](const SessionLogBlockHeader& header, const SessionLogSample& sample) {
+    bench.add(header, sample);
+  });
+  bench.finish();
+
+  char line[96];
+  uvFilterBenchFormatSummary(line, sizeof(line), bench);
+  Serial.println(line);
+  Serial.println(UV_FILTER_BENCH_TABLE_HEADER);
+  for (int p = 0; p < UV_FILTER_BENCH_PRESETS; p++) {
+    uvFilterBenchFormatRow(line, sizeof(line), bench, p);
+    Serial.println(line);
+  }
+}
+
+// Runs the GBA link model (GbaLinkCodec.h) for both protocols at the
+// configured phase time, 10 minutes per scenario (GBA_LINK_SIM_SCENARIOS).
+// False commits are values the game would show that the ESP did not send
+// during the last two game frames.
+void runGbaLinkSimulation() {
+  char line[112];
+  Serial.print("# GBA link simulation: phase ");
+  Serial.print(getGbaPhaseIntervalUs());
+  Serial.println("us, 10 min per run");
+  Serial.println(GBA_LINK_SIM_TABLE_HEADER);
+  for (const GbaLinkSimScenario& scenario : GBA_LINK_SIM_SCENARIOS) {
+    for (int v2 = 0; v2 < 2; v2++) {
+      GbaLinkSimConfig config =
+          gbaLinkSimScenarioConfig(scenario, v2 != 0, getGbaPhaseIntervalUs(), 600000UL, 12345);
+      GbaLinkSimResult result;
+      gbaLinkSimulate(config, &result);
+      gbaLinkSimFormatRow(line, sizeof(line), scenario.name, v2 != 0, result);
+      Serial.println(line);
+    }
+  }
+}
+
+// Replays sun/shade transitions through the sensor timing model in
+// AlsAssist.h, with the current game's bar thresholds and the configured
+// smoothing: one hour of the "walk" scene (steps every 3-15 s between UVI
+// 8.5 and 2.5, 150 ms walk-through, 2% noise), per UV range, without and
+// with the ALS assist. Latency runs from the start of a transition to the
+// first bar value at the new level; the assist is off in the fast range, so
+// its rows match. host/als_assist_bench runs more scenes.
+void runAlsAssistSimulation() {
+  float barStarts[GAME_MAX_BARS];
+  int numBars = GAME_BARS[currentGame];
+  for (int bar = 1; bar <= numBars; bar++) {
+    barStarts[bar - 1] = getBarThreshold(currentGame, bar);
+  }
+  Serial.print("# ALS assist simulation: ");
+  Serial.print(GAME_NAMES[currentGame]);
+  Serial.print(", ");
+  Serial.print(ALS_SIM_SCENES[0].name);
+  Serial.println(", 60 min per run");
+  Serial.println(ALS_SIM_TABLE_HEADER);
+  char line[112];
+  for (int range = 0; range < 2; range++) {
+    for (int assist = 0; assist < 2; assist++) {
+      AlsSimConfig config = alsSimSceneConfig(ALS_SIM_SCENES[0], range == UV_RANGE_FAST, assist != 0,
+                                              3600000UL, 12345);
+      config.smoothingAlpha = (UVI_SMOOTHING_ENABLED && !UV_FILTER_PIPELINE_ENABLED) ? UVI_SMOOTHING_ALPHA : 0.0f;
+      config.hysteresisUvi = (BAR_HYSTERESIS_ENABLED && !UV_FILTER_PIPELINE_ENABLED) ? BAR_HYSTERESIS : 0.0f;
+      config.barStarts = barStarts;
+      config.numBars = numBars;
+      config.detector = getAlsAssistConfig();
+      AlsSimResult result;
+      alsAssistSimulate(config, &result);
+      alsSimFormatRow(line, sizeof(line), ALS_SIM_RANGE_NAMES[range], assist != 0, result);
+      Serial.println(line);
+    }
+  }
+}
+
+// Runs UvFusion (UvFusion.h) on mocked sensors with the configured fusion
+// settings: one hour of steps between shade and sun every 3-15 s, 3% noise
+// and a +/-8% sensitivity spread (calibrated away), for 1 to 4 sensors, then
+// 4 sensors with one window losing half its light after 10 min and with one
+// sensor off the bus from 10 to 30 min.
+void runUvFusionSimulation() {
+  float divisor = getUvDivisorForRange(UV_RANGE_SLOW);
+  UvFusionConfig fusion = getUvFusionConfig(divisor, 500);
+  Serial.println("# UV fusion simulation: 500ms cycle, 400ms integration, 60 min per run");
+  Serial.println(UV_FUSION_SIM_TABLE_HEADER);
+  char line[96];
+  for (const UvFusionSimScenario& scenario : UV_FUSION_SIM_SCENARIOS) {
+    UvFusionSimResult result;
+    uvFusionSimulate(uvFusionSimScenarioConfig(scenario, divisor, fusion, 3600000UL, 12345), &result);
+    uvFusionSimFormatRow(line, sizeof(line), scenario.name, result);
+    Serial.println(line);
+  }
+}
+
+// The dataarea block of each GBA link patch, generated from GameProfiles.h;
+// paste over the block in GBA Link Patches/Source/<prefix>*.asm and
+// reassemble when a profile's link levels change.
+void printLinkPatchDataAreas() {
+  Serial.println("# GBA link patch dataarea blocks");
+  char line[96];
+  for (int game = 0; game < NUM_GAMES; game++) {
+    if (!gameProfileFormatDataArea(game, line, sizeof(line))) {
+      continue;
+    }
+    Serial.print("# ");
+    Serial.print(GAME_NAMES[game]);
+    Serial.print(": ");
+    Serial.print(GAME_PROFILES[game].patchPrefix);
+    Serial.println("*.asm");
+    Serial.println("dataarea:");
+    Serial.println(GAME_LINK_DATAAREA_COMMENT);
+    Serial.println(line);
+  }
+}
+
+void printTraceLatency(const char* label, const TraceLatency& latency) {
+  char line[80];
+  traceFormatLatency(line, sizeof(line), label, latency);
+  Serial.println(line);
+}
+
+// Timeline, one event per line (ms since the oldest event), then the
+// latency from the sample that changed the bar count to the first HID
+// output after it, and to the first GBA phase carrying the new value.
+void dumpTrace() {
+  char line[80];
+  TraceReader reader;
+  reader.begin(_traceStore);
+  traceFormatSummary(line, sizeof(line), reader);
+  Serial.println(line);
+  Serial.println(TRACE_TIMELINE_HEADER);
+
+  TraceLatencyPairing latency(GBA_LINK_ENABLED);
+  int64_t firstUs = 0;
+  bool first = true;
+  TraceEntry entry;
+  while (reader.read(&entry)) {
+    if (first) {
+      firstUs = entry.timeUs;
+      first = false;
+    }
+    traceFormatEntry(line, sizeof(line), entry, firstUs);
+    Serial.println(line);
+    latency.add(entry);
+  }
+  printTraceLatency("sensor->HID", latency.hid);
+  printTraceLatency("sensor->GBA", latency.gba);
+}
+
+// The frozen ring as hex, for host/trace_decode (see TraceFormat.h)
+void dumpTraceRaw() {
+  char line[80];
+  traceFormatRawBegin(line, sizeof(line));
+  Serial.println(line);
+  traceFormatRawHeader(line, sizeof(line), _traceStore);
+  Serial.println(line);
+  for (uint32_t i = 0; i < TRACE_BUFFER_EVENTS; i++) {
+    traceFormatRawRecord(line, sizeof(line), _traceStore.records[i]);
+    Serial.println(line);
+  }
+  Serial.println(TRACE_RAW_END);
+}
+
+void logLoopProfile() {
+  if (!serialEnabled || !DEBUG_SERIAL_PERF) {
+    return;
+  }
+  Serial.print("Loop us avg/max/peak: ");
+  Serial.print(loopProfiler.loopAvgUs());
+  Serial.print("/");
+  Serial.print(loopProfiler.loopMaxUs());
+  Serial.print("/");
+  Serial.print(loopProfiler.loopPeakSinceBootUs());
+  Serial.print(" loops: ");
+  Serial.print(loopProfiler.loopsPerWindow());
+  for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    Serial.print(" ");
+    Serial.print(PROFILE_STAGE_NAMES[i]);
+    Serial.print("=");
+    Serial.print(loopProfiler.stageAvgUs((ProfileStage)i));
+    Serial.print("/");
+    Serial.print(loopProfiler.stageMaxUs((ProfileStage)i));
+  }
+  Serial.println();
+
+  if (GBA_LINK_ENABLED && gbaLinkTimer.running()) {
+    GbaJitterStats stats;
+    gbaLinkTimer.getStats(&stats);
+    Serial.print("GBA phase us min/max/p99: ");
+    Serial.print(stats.minUs);
+    Serial.print("/");
+    Serial.print(stats.maxUs);
+    Serial.print("/");
+    Serial.print(stats.p99Us);
+    Serial.print(" nominal: ");
+    Serial.print(gbaLinkTimer.nominalPeriodUs());
+    Serial.print(" phases: ");
+    Serial.println(stats.phases);
+  }
+
+  Serial.print("I2C busy: ");
+  Serial.print(i2cBusMonitor.busyPermille() / 10);
+  Serial.print(".");
+  Serial.print(i2cBusMonitor.busyPermille() % 10);
+  Serial.print("% hold max/peak us: ");
+  Serial.print(i2cBusMonitor.maxHoldUsInWindow());
+  Serial.print("/");
+  Serial.print(i2cBusMonitor.peakHoldSinceBootUs());
+  Serial.print(" txn/s: ");
+  Serial.print(i2cBusMonitor.transactionsPerSec());
+  Serial.print(" sensor txn/s: ");
+  Serial.print(i2cBusMonitor.transactionsPerSec(I2C_CLIENT_SENSOR));
+  Serial.print(ltrIntModeActive ? " (INT)" : " (polled)");
+  #if defined(BOARD_LILYGO_T_QT_PRO)
+  Serial.print(" TFT push us last/max/full: ");
+  Serial.print(display.lastPushMicros());
+  Serial.print("/");
+  Serial.print(display.maxPushMicros());
+  Serial.print("/");
+  Serial.print(display.lastFullPushMicros());
+  Serial.print(" rows sent/skipped: ");
+  Serial.print(display.lastPushRowsSent());
+  Serial.print("/");
+  Serial.print(display.lastPushRowsSkipped());
+  #else
+  Serial.print(" OLED bytes/frame last/avg: ");
+  Serial.print(oledFlush.lastFrameBytesSent());
+  Serial.print("/");
+  Serial.print(oledFlush.avgFrameBytes());
+  Serial.print(" frames: ");
+  Serial.print(oledFlush.framesPerWindow());
+  #endif
+  Serial.println();
+
+  if (UI_RETAINED_WIDGETS) {
+    Serial.print("UI compose us avg/max: ");
+    Serial.print(uiFrameStats.avgComposeUs());
+    Serial.print("/");
+    Serial.print(uiFrameStats.maxComposeUs());
+    Serial.print(" damaged px/frame: ");
+    Serial.print(uiFrameStats.avgDamagedPixels());
+    Serial.print(" frames/idle: ");
+    Serial.print(uiFrameStats.framesPerWindow());
+    Serial.print("/");
+    Serial.println(uiFrameStats.idleFramesPerWindow());
+  }
+
+  Serial.print("Tasks loop core/cpu/stack: ");
+  Serial.print(loopTaskCore);
+  Serial.print("/");
+  Serial.print(loopTaskCpuPermille / 10);
+  Serial.print("%/");
+  Serial.print(loopTaskStackFree);
+  if (uiTaskHandle != nullptr) {
+    Serial.print(" ui core/cpu/stack: ");
+    Serial.print(UI_TASK_CORE);
+    Serial.print("/");
+    Serial.print(uiTaskCpuPermille / 10);
+    Serial.print("%/");
+    Serial.println(uiTaskStackFree);
+  } else {
+    Serial.println(" ui: in loop");
+  }
+
+  if (POWER_SCHEDULER_ENABLED) {
+    Serial.print("Power ");
+    Serial.print(POWER_MODE_NAMES[powerManager.mode()]);
+    Serial.print(" wait/sleepable: ");
+    Serial.print(powerManager.blockedPermille() / 10);
+    Serial.print("%/");
+    Serial.print(powerManager.sleepablePermille() / 10);
+    Serial.print("% wakes: ");
+    Serial.print(powerManager.wakesPerWindow());
+    for (uint8_t i = 0; i <= WAKE_TIMEOUT; i++) {
+      if (powerManager.wakesFor((WakeSource)i) > 0) {
+        Serial.print(" ");
+        Serial.print(WAKE_SOURCE_NAMES[i]);
+        Serial.print(":");
+        Serial.print(powerManager.wakesFor((WakeSource)i));
+      }
+    }
+    Serial.print(" est mA: ");
+    Serial.println(estimatePowerMa(), 1);
+    Serial.print("Active us/window:");
+    for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+      Serial.print(" ");
+      Serial.print(PROFILE_STAGE_NAMES[i]);
+      Serial.print(" ");
+      Serial.print(loopProfiler.stageTotalUs((ProfileStage)i));
+    }
+    Serial.println();
+  }
+}
+
+// loop() side: button activity keeps the screen awake
+void noteScreenActivity() {
+  postUiEvent(UI_EVENT_ACTIVITY);
+}
+
+// UI side
+void applyScreenActivity() {
+  lastScreenActivityMs = millis();
+  if (screensaverActive) {
+    screensaverActive = false;
+    screensaverJustExited = true;
+  }
+}
+
+bool shouldShowScreensaverBluetoothStatus() {
+  return BLUETOOTH_ENABLED && (ui.bleConnected || ui.blePairingActive);
+}
+
+void calculateScreensaverLayout() {
+  bool bluetoothStatusVisible = shouldShowScreensaverBluetoothStatus();
+  screensaverBatteryVisible = (ui.batteryPct >= 0) || bluetoothStatusVisible;
+  screensaverBatteryText[0] = '\0';
+  screensaverBatteryTextW = 0;
+  screensaverBatteryTextH = 0;
+  screensaverBatteryW = 0;
+  screensaverBatteryH = 0;
+
+  display.setTextSize(1);
+  if (screensaverBatteryVisible) {
+    bool hasBattery = (ui.batteryPct >= 0);
+    if (hasBattery) {
+      snprintf(screensaverBatteryText, sizeof(screensaverBatteryText), "%d%%", ui.batteryPct);
+      int16_t x1, y1;
+      uint16_t w, h;
+      display.getTextBounds(screensaverBatteryText, 0, 0, &x1, &y1, &w, &h);
+      screensaverBatteryTextW = (int16_t)w;
+      screensaverBatteryTextH = (int16_t)h;
+    }
+
+    int16_t bluetoothW = 0;
+    if (bluetoothStatusVisible) {
+      bluetoothW = STATUS_BT_ICON_W;
+    }
+
+    if (hasBattery) {
+      screensaverBatteryW = screensaverBatteryTextW + SCREENSAVER_BATT_GAP + STATUS_BATT_ICON_W;
+      if (bluetoothStatusVisible) {
+        screensaverBatteryW += bluetoothW + STATUS_BT_GAP;
+      }
+      screensaverBatteryH = max(screensaverBatteryTextH, STATUS_BATT_ICON_H);
+    } else {
+      screensaverBatteryW = bluetoothW;
+      screensaverBatteryH = bluetoothW > 0 ? STATUS_BT_ICON_H : 0;
+    }
+
+    if (bluetoothStatusVisible) {
+      screensaverBatteryH = max(screensaverBatteryH, STATUS_BT_ICON_H);
+    }
+  }
+
+  screensaverBlockW = screensaverTextW;
+  if (SCREENSAVER_IMAGE_W > screensaverBlockW) {
+    screensaverBlockW = SCREENSAVER_IMAGE_W;
+  }
+  if (screensaverBatteryW > screensaverBlockW) {
+    screensaverBlockW = screensaverBatteryW;
+  }
+
+  screensaverBlockH = SCREENSAVER_IMAGE_H + SCREENSAVER_IMAGE_TEXT_GAP + screensaverTextH;
+  if (screensaverBatteryVisible) {
+    screensaverBlockH += SCREENSAVER_TEXT_BATT_GAP + screensaverBatteryH;
+  }
+}
+
+void drawScreensaverBattery(int16_t x, int16_t y) {
+  if (!screensaverBatteryVisible) {
+    return;
+  }
+
+  bool hasBattery = (ui.batteryPct >= 0);
+  bool bluetoothStatusVisible = shouldShowScreensaverBluetoothStatus();
+  int16_t cursorX = x;
+
+  display.setTextSize(1);
+  if (bluetoothStatusVisible) {
+    int16_t btY = y + ((screensaverBatteryH - STATUS_BT_ICON_H) / 2);
+    drawBluetoothIcon(display, cursorX, btY, isBluetoothIconOn());
+    cursorX += STATUS_BT_ICON_W;
+    if (hasBattery) {
+      cursorX += STATUS_BT_GAP;
+    }
+  }
+  if (hasBattery) {
+    int16_t textY = y + ((screensaverBatteryH - screensaverBatteryTextH) / 2);
+    display.setCursor(cursorX, textY);
+    display.print(screensaverBatteryText);
+    cursorX += screensaverBatteryTextW + SCREENSAVER_BATT_GAP;
+
+    int16_t iconY = y + ((screensaverBatteryH - STATUS_BATT_ICON_H) / 2);
+    drawBatteryGauge(display, cursorX, iconY, ui.batteryPct);
+  }
+}
+
+void updateScreensaverState() {
+  if (!SCREENSAVER_ENABLED) {
+    return;
+  }
+  if (screensaverActive) {
+    return;
+  }
+
+  unsigned long now = millis();
+  if ((now - lastScreenActivityMs) >= SCREENSAVER_TIMEOUT_MS) {
+    screensaverActive = true;
+    screensaverDx = 1;
+    screensaverDy = 1;
+    calculateScreensaverLayout();
+    screensaverLastLayoutPct = ui.batteryPct;
+    screensaverLastLayoutBleStatus = shouldShowScreensaverBluetoothStatus();
+    screensaverX = (SCREEN_WIDTH - screensaverBlockW) / 2;
+    screensaverY = (SCREEN_HEIGHT - screensaverBlockH) / 2;
+    lastScreensaverMoveMs = 0;
+  }
+}
+
+void drawScreensaver() {
+  unsigned long now = millis();
+  if ((now - lastScreensaverMoveMs) < SCREENSAVER_MOVE_MS) {
+    return;
+  }
+  lastScreensaverMoveMs = now;
+
+  bool bluetoothStatusVisible = shouldShowScreensaverBluetoothStatus();
+  if (screensaverLastLayoutPct != ui.batteryPct ||
+      screensaverLastLayoutBleStatus != bluetoothStatusVisible) {
+    calculateScreensaverLayout();
+    screensaverLastLayoutPct = ui.batteryPct;
+    screensaverLastLayoutBleStatus = bluetoothStatusVisible;
+  }
+
+  int16_t maxX = SCREEN_WIDTH - screensaverBlockW;
+  int16_t maxY = SCREEN_HEIGHT - screensaverBlockH;
+  if (maxX < 0) {
+    maxX = 0;
+  }
+  if (maxY < 0) {
+    maxY = 0;
+  }
+
+  screensaverX += screensaverDx;
+  screensaverY += screensaverDy;
+
+  if (screensaverX <= 0) {
+    screensaverX = 0;
     screensaverDx = 1;
   } else if (screensaverX >= maxX) {
     screensaverX = maxX;
     screensaverDx = -1;
   }
 
-  if (screensaverY <= 0) {
-    screensaverY = 0;
-    screensaverDy = 1;
-  } else if (screensaverY >= maxY) {
-    screensaverY = maxY;
-    screensaverDy = -1;
+  if (screensaverY <= 0) {
+    screensaverY = 0;
+    screensaverDy = 1;
+  } else if (screensaverY >= maxY) {
+    screensaverY = maxY;
+    screensaverDy = -1;
+  }
+
+  display.clearDisplay();
+
+  int16_t imageX = screensaverX + ((screensaverBlockW - SCREENSAVER_IMAGE_W) / 2);
+  int16_t imageY = screensaverY;
+  display.drawBitmap(imageX, imageY, OJO_DEL_SOL_BITMAP, SCREENSAVER_IMAGE_W, SCREENSAVER_IMAGE_H, DISPLAY_WHITE);
+
+  int16_t textX = screensaverX + ((screensaverBlockW - screensaverTextW) / 2);
+  int16_t textY = imageY + SCREENSAVER_IMAGE_H + SCREENSAVER_IMAGE_TEXT_GAP;
+  display.setTextSize(1);
+  display.setCursor(textX - screensaverTextX1, textY - screensaverTextY1);
+  display.print(SCREENSAVER_TEXT);
+
+  if (screensaverBatteryVisible) {
+    int16_t batteryX = screensaverX + ((screensaverBlockW - screensaverBatteryW) / 2);
+    int16_t batteryY = textY + screensaverTextH + SCREENSAVER_TEXT_BATT_GAP;
+    drawScreensaverBattery(batteryX, batteryY);
+  }
+
+  queueDisplayFlush();
+}
+
+void drawDebugHeader() {
+  display.clearDisplay();
+
+  // Draw Status Icons (Top Right)
+  drawStatusIcons();
+
+  display.setTextSize(1);
+  display.setCursor(0, 0);
+  #if HAS_USB_HID
+  display.print(inCdcMode ? "CDC" : "XInput");
+  #else
+  display.print("DEBUG");
+  #endif
+}
+
+// Loop timing page: whole-pass cost plus worst case per subsystem (us)
+void drawDebugLoopPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("Loop avg:");
+  display.print(loopProfiler.loopAvgUs());
+  display.print("us");
+
+  display.setCursor(0, 20);
+  display.print("max:");
+  display.print(loopProfiler.loopMaxUs());
+  display.print(" pk:");
+  display.print(loopProfiler.loopPeakSinceBootUs());
+
+  for (uint8_t i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    display.setCursor((i % 2) * 64, 30 + ((i / 2) * 8));
+    display.print(PROFILE_STAGE_NAMES[i]);
+    display.print(" ");
+    display.print(loopProfiler.stageMaxUs((ProfileStage)i));
+  }
+
+  queueDisplayFlush();
+}
+
+// GBA link page: phase period jitter since the link timer started (us)
+void drawDebugGbaLinkPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("GBA link:");
+  display.print(gbaLinkTimer.running() ? "timer" : "polled");
+  display.print(GBA_LINK_PROTOCOL_V2 ? " v2" : " v1");
+
+  display.setCursor(0, 20);
+  display.print("nominal:");
+  display.print(getGbaPhaseIntervalUs());
+  display.print("us");
+
+  if (!gbaLinkTimer.running()) {
+    queueDisplayFlush();
+    return;
+  }
+
+  GbaJitterStats stats;
+  gbaLinkTimer.getStats(&stats);
+
+  display.setCursor(0, 30);
+  display.print("min:");
+  display.print(stats.minUs);
+  display.print(" max:");
+  display.print(stats.maxUs);
+
+  display.setCursor(0, 40);
+  display.print("p99:");
+  display.print(stats.p99Us);
+  display.print("us");
+
+  display.setCursor(0, 50);
+  display.print("phases:");
+  display.print(stats.phases);
+
+  queueDisplayFlush();
+}
+
+// I2C page: bus utilization and the longest single bus hold, i.e. the
+// worst case the sensor read can wait behind display traffic
+// Loop and UI task placement, CPU share and stack headroom (bytes free)
+void drawDebugTasksPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("loop core:");
+  display.print(loopTaskCore);
+  display.print(" ");
+  display.print(loopTaskCpuPermille / 10);
+  display.print("%");
+
+  display.setCursor(0, 20);
+  display.print("loop stk:");
+  display.print(loopTaskStackFree);
+
+  display.setCursor(0, 30);
+  if (uiTaskHandle != nullptr) {
+    display.print("ui core:");
+    display.print(UI_TASK_CORE);
+    display.print(" ");
+    display.print(uiTaskCpuPermille / 10);
+    display.print("%");
+
+    display.setCursor(0, 40);
+    display.print("ui stk:");
+    display.print(uiTaskStackFree);
+  } else {
+    display.print("ui: in loop");
+  }
+
+  queueDisplayFlush();
+}
+
+// Power page: where loop() spent the last stats window. "wait" is time
+// blocked until the next deadline, "sleep" the part of it light sleep was
+// allowed; "top" is the loop() stage with the most active time.
+void drawDebugPowerPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("pwr:");
+  display.print(POWER_MODE_NAMES[powerManager.mode()]);
+  display.print(" ");
+  display.print(powerManager.maxMhz());
+  display.print("/");
+  display.print(powerManager.minMhz());
+  display.print("MHz");
+
+  display.setCursor(0, 20);
+  display.print("wait:");
+  display.print(powerManager.blockedPermille() / 10);
+  display.print("% sleep:");
+  display.print(powerManager.sleepablePermille() / 10);
+  display.print("%");
+
+  display.setCursor(0, 30);
+  WakeSource topWake = powerManager.topWakeSource();
+  display.print("wakes:");
+  display.print(powerManager.wakesPerWindow());
+  display.print(" ");
+  display.print(WAKE_SOURCE_NAMES[topWake]);
+  display.print(":");
+  display.print(powerManager.wakesFor(topWake));
+
+  display.setCursor(0, 40);
+  uint8_t topStage = 0;
+  for (uint8_t i = 1; i < PROFILE_STAGE_COUNT; i++) {
+    if (loopProfiler.stageTotalUs((ProfileStage)i) > loopProfiler.stageTotalUs((ProfileStage)topStage)) {
+      topStage = i;
+    }
+  }
+  display.print("top:");
+  display.print(PROFILE_STAGE_NAMES[topStage]);
+  display.print(" ");
+  display.print(loopProfiler.stageTotalUs((ProfileStage)topStage));
+  display.print("us");
+
+  display.setCursor(0, 50);
+  display.print("est:");
+  display.print(estimatePowerMa(), 1);
+  display.print("mA");
+  uint8_t awake = powerManager.awakeMask();
+  if (awake & POWER_AWAKE_USB) {
+    display.print(" usb");
+  }
+  if (awake & POWER_AWAKE_GBA_LINK) {
+    display.print(" gba");
+  }
+
+  queueDisplayFlush();
+}
+
+// Rough average current from where the last window's time went, using the
+// POWER_EST_* figures in config.h. The light sleep share is an upper bound:
+// the BLE controller or a driver lock can still keep the chip awake.
+float estimatePowerMa() {
+  float busy = (loopTaskCpuPermille + uiTaskCpuPermille) / 1000.0f;
+  if (busy > 1.0f) {
+    busy = 1.0f;
+  }
+  bool radioOn = BLUETOOTH_ENABLED && (bleConnected || blePairingActive);
+  float sleep = radioOn ? 0.0f : powerManager.sleepablePermille() / 1000.0f;
+  if (sleep > 1.0f - busy) {
+    sleep = 1.0f - busy;
+  }
+  float idle = 1.0f - busy - sleep;
+  float idleMa = powerManager.scaling() ? POWER_EST_IDLE_MIN_MA : POWER_EST_IDLE_MAX_MA;
+  float ma = busy * POWER_EST_BUSY_MA + idle * idleMa + sleep * POWER_EST_LIGHT_SLEEP_MA + POWER_EST_DISPLAY_MA;
+  if (radioOn) {
+    ma += POWER_EST_BLE_MA;
+  }
+  return ma;
+}
+
+void drawDebugI2cPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("I2C ");
+  display.print(I2C_CLOCK_HZ / 1000);
+  display.print("kHz");
+
+  display.setCursor(0, 20);
+  display.print("busy:");
+  display.print(i2cBusMonitor.busyPermille() / 10);
+  display.print(".");
+  display.print(i2cBusMonitor.busyPermille() % 10);
+  display.print("%");
+
+  display.setCursor(0, 30);
+  display.print("hold max:");
+  display.print(i2cBusMonitor.maxHoldUsInWindow());
+  display.print("us");
+
+  display.setCursor(0, 40);
+  #if defined(BOARD_LILYGO_T_QT_PRO)
+  display.print("hold pk:");
+  display.print(i2cBusMonitor.peakHoldSinceBootUs());
+  display.print("us");
+  #else
+  // OLED bytes sent per frame (a full frame is ~1.1 KB)
+  display.print("frame B:");
+  display.print(oledFlush.lastFrameBytesSent());
+  display.print("/");
+  display.print(oledFlush.avgFrameBytes());
+  #endif
+
+  // Total and LTR390 transactions/s (polled vs INT-pin mode)
+  display.setCursor(0, 50);
+  display.print("txn/s:");
+  display.print(i2cBusMonitor.transactionsPerSec());
+  display.print(ltrIntModeActive ? " int:" : " uv:");
+  display.print(i2cBusMonitor.transactionsPerSec(I2C_CLIENT_SENSOR));
+
+  queueDisplayFlush();
+}
+
+// Sensors page: one line per LTR390 with its last count (mapped onto
+// sensor 0), samples and samples left out as outliers; "off" is dropped
+// from the bus, "out" currently left out of the fused stream
+void drawDebugSensorsPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("UV x");
+  display.print(uvFusion.onlineCount());
+  display.print("/");
+  display.print(uvSensorCount);
+  display.print(" every ");
+  display.print(uvArrayCycleMs / (unsigned long)max(1, uvFusion.onlineCount()));
+  display.print("ms");
+
+  for (int i = 0; i < uvSensorCount; i++) {
+    display.setCursor(0, 20 + i * 10);
+    display.print(i);
+    if (!uvSensors[i].online) {
+      display.print(" off");
+      continue;
+    }
+    display.print(uvFusion.isExcluded(i) ? " out " : " ok ");
+    display.print((uint32_t)uvFusion.lastCounts(i));
+    display.print(" ");
+    display.print(uvFusion.samples(i));
+    display.print("/");
+    display.print(uvFusion.rejected(i));
+  }
+
+  queueDisplayFlush();
+}
+
+#if defined(BOARD_LILYGO_T_QT_PRO)
+// TFT page: cost of the last canvas push and how many rows the dirty-row
+// check skipped. Figures describe the push before this page was drawn.
+void drawDebugTftPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("TFT push:");
+  display.print(display.lastPushMicros());
+  display.print("us");
+
+  display.setCursor(0, 20);
+  display.print("max:");
+  display.print(display.maxPushMicros());
+  display.print(" full:");
+  display.print(display.lastFullPushMicros());
+
+  display.setCursor(0, 30);
+  display.print("rows sent:");
+  display.print(display.lastPushRowsSent());
+  display.print(" skip:");
+  display.print(display.lastPushRowsSkipped());
+
+  display.setCursor(0, 40);
+  display.print("skipped:");
+  display.print(display.rowsSkippedTotal());
+
+  queueDisplayFlush();
+}
+#endif
+
+// UI page: retained main-screen compose cost (see UiWidgets.h). Figures
+// are from the last main-screen frame, since this page is not one.
+void drawDebugUiPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("UI compose:");
+  display.print(uiFrameStats.lastComposeUs());
+  display.print("us");
+
+  display.setCursor(0, 20);
+  display.print("max:");
+  display.print(uiFrameStats.maxComposeUs());
+  display.print("us");
+
+  display.setCursor(0, 30);
+  display.print("damaged:");
+  display.print(uiFrameStats.lastDamagedPixels());
+  display.print("px");
+
+  display.setCursor(0, 40);
+  display.print("frames:");
+  display.print(uiFrameStats.framesTotal());
+  display.print(" idle:");
+  display.print(uiFrameStats.idleFramesTotal());
+
+  display.setCursor(0, 50);
+  display.print("glyph cells:");
+  display.print(uiGlyphs.cellsRasterized());
+
+  queueDisplayFlush();
+}
+
+#if HAS_USB_HID
+// USB page: XInput report pipeline counters since boot. "merged" counts
+// states replaced before they went out; "retry" counts submissions
+// deferred because EP1 IN was busy or the host was not ready.
+void drawDebugUsbPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("USB sent:");
+  display.print(usbGamepad.reportsSubmitted());
+
+  display.setCursor(0, 20);
+  display.print("merged:");
+  display.print(usbGamepad.reportsCoalesced());
+
+  display.setCursor(0, 30);
+  display.print("retry:");
+  display.print(usbGamepad.reportsRetried());
+
+  display.setCursor(0, 40);
+  display.print("edges q:");
+  display.print(usbGamepad.edgesQueued());
+
+  queueDisplayFlush();
+}
+#endif
+
+// Incremental meter page: sync phase, how long the emulator meter took to
+// show each sensor bar change, and accumulated bar-error seconds
+void drawDebugMeterPage() {
+  drawDebugHeader();
+
+  display.setCursor(0, 10);
+  display.print("Meter:");
+  if (bleMeter.syncPhase() == METER_SYNC_CLAMP) {
+    display.print("clamp");
+  } else if (bleMeter.syncPhase() == METER_SYNC_ANCHOR) {
+    display.print("anchor");
+  } else {
+    display.print(bleMeter.isResyncDue() ? "delta*" : "delta");
+  }
+
+  display.setCursor(0, 20);
+  display.print("step:");
+  if (bleMeter.estimateValid()) {
+    display.print(bleMeter.estimatedSteps());
+  } else {
+    display.print("?");
   }
+  display.print(" bar:");
+  display.print(bleDeviceBars);
 
-  display.clearDisplay();
+  display.setCursor(0, 30);
+  display.print("conv ms:");
+  display.print(meterStats.lastConvergeTimeMs());
+  display.print("/");
+  display.print(meterStats.maxConvergeTimeMs());
+
+  display.setCursor(0, 40);
+  display.print("bar-err s:");
+  display.print(meterStats.barErrorDeciSeconds() / 10);
+  display.print(".");
+  display.print(meterStats.barErrorDeciSeconds() % 10);
+
+  display.setCursor(0, 50);
+  display.print("clamp:");
+  display.print(bleMeter.clampCount());
+  display.print(" anch:");
+  display.print(bleMeter.anchorCount());
+
+  queueDisplayFlush();
+}
 
-  int16_t imageX = screensaverX + ((screensaverBlockW - SCREENSAVER_IMAGE_W) / 2);
-  int16_t imageY = screensaverY;
-  display.drawBitmap(imageX, imageY, OJO_DEL_SOL_BITMAP, SCREENSAVER_IMAGE_W, SCREENSAVER_IMAGE_H, DISPLAY_WHITE);
+// Boot page: time spent in each setup() phase on this boot, and total
+// time from app start to the first bar from a real sample (ms)
+void drawDebugBootPage() {
+  drawDebugHeader();
 
-  int16_t textX = screensaverX + ((screensaverBlockW - screensaverTextW) / 2);
-  int16_t textY = imageY + SCREENSAVER_IMAGE_H + SCREENSAVER_IMAGE_TEXT_GAP;
-  display.setTextSize(1);
-  display.setCursor(textX - screensaverTextX1, textY - screensaverTextY1);
-  display.print(SCREENSAVER_TEXT);
+  display.setCursor(0, 10);
+  display.print(bootProfiler.warm() ? "Boot warm:" : "Boot cold:");
+  if (bootProfiler.done(BOOT_PHASE_FIRST_BAR)) {
+    display.print(bootProfiler.totalMs());
+    display.print("ms");
+  } else {
+    display.print("...");
+  }
 
-  if (screensaverBatteryVisible) {
-    int16_t batteryX = screensaverX + ((screensaverBlockW - screensaverBatteryW) / 2);
-    int16_t batteryY = textY + screensaverTextH + SCREENSAVER_TEXT_BATT_GAP;
-    drawScreensaverBattery(batteryX, batteryY);
+  for (uint8_t i = 0; i < BOOT_PHASE_COUNT; i++) {
+    display.setCursor((i % 2) * 64, 22 + ((i / 2) * 10));
+    display.print(BOOT_PHASE_NAMES[i]);
+    display.print(" ");
+    display.print(bootProfiler.phaseMs((BootPhase)i));
   }
 
-  display.display();
+  queueDisplayFlush();
 }
 
-void drawDebugDisplay() {
-  display.clearDisplay();
+void drawDebugLogPage() {
+  drawDebugHeader();
 
-  // Draw Status Icons (Top Right)
-  drawStatusIcons();
+  display.setCursor(0, 10);
+  display.print("Log:");
+  if (!sessionLog.isRunning()) {
+    display.print(" off (no fs)");
+  } else if (!sessionLog.isMounted()) {
+    display.print(" mounting");
+  } else {
+    display.print(sessionLog.storedBytes() / 1024);
+    display.print("KB ");
+    display.print(sessionLog.filesKept());
+    display.print(" files");
+  }
 
-  display.setTextSize(1);
-  display.setCursor(0, 0);
+  display.setCursor(0, 22);
+  display.print("Samples:");
+  display.print(sessionLog.recordsLogged());
+
+  display.setCursor(0, 32);
+  display.print("Drop:");
+  display.print(sessionLog.recordsDropped());
+  display.print(" Err:");
+  display.print(sessionLog.writeErrors());
+
+  display.setCursor(0, 42);
+  display.print("Blocks:");
+  display.print(sessionLog.blocksWritten());
+  display.print(" max ");
+  display.print(sessionLog.maxWriteMs());
+  display.print("ms");
+
+  queueDisplayFlush();
+}
+
+void drawDebugDisplay() {
+  if (debugPage == DEBUG_PAGE_LOG) {
+    drawDebugLogPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_BOOT) {
+    drawDebugBootPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_METER) {
+    drawDebugMeterPage();
+    return;
+  }
   #if HAS_USB_HID
-  display.print(inCdcMode ? "CDC" : "XInput");
-  #else
-  display.print("DEBUG");
+  if (debugPage == DEBUG_PAGE_USB) {
+    drawDebugUsbPage();
+    return;
+  }
+  #endif
+  #if defined(BOARD_LILYGO_T_QT_PRO)
+  if (debugPage == DEBUG_PAGE_TFT) {
+    drawDebugTftPage();
+    return;
+  }
   #endif
+  if (debugPage == DEBUG_PAGE_UI) {
+    drawDebugUiPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_POWER) {
+    drawDebugPowerPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_I2C) {
+    drawDebugI2cPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_SENSORS) {
+    drawDebugSensorsPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_LOOP) {
+    drawDebugLoopPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_GBA_LINK) {
+    drawDebugGbaLinkPage();
+    return;
+  }
+  if (debugPage == DEBUG_PAGE_TASKS) {
+    drawDebugTasksPage();
+    return;
+  }
+
+  drawDebugHeader();
 
   // UV readings
   display.setCursor(0, 10);
   display.print("UV raw:");
-  display.print(cachedRawUVS);
+  display.print(ui.rawUVS);
+  if (ui.uvRangeMode == UV_RANGE_FAST) {
+    display.print(" fast");
+  }
 
   display.setCursor(0, 20);
   display.print("UVI:");
-  display.print(cachedUviRaw, 3);
+  display.print(ui.uviRaw, 3);
 
   display.setCursor(0, 30);
   display.print("UVI comp'ed:");
-  display.print(cachedUvi, 3);
+  display.print(ui.uvi, 3);
 
   // Battery readings
-  bool haveBatteryReading = BATTERY_SENSE_ENABLED && hasBatteryReading;
+  bool haveBatteryReading = BATTERY_SENSE_ENABLED && ui.hasBatteryReading;
 
   display.setCursor(0, 42);
   display.print("ADC avg:");
   if (haveBatteryReading) {
-    display.print(cachedBatteryAdcAvg, 0);
+    display.print(ui.batteryAdcAvg, 0);
   } else {
     display.print("N/A");
   }
@@ -892,19 +2619,70 @@ void drawDebugDisplay() {
   display.setCursor(0, 52);
   display.print("Batt V:");
   if (haveBatteryReading) {
-    display.print(cachedBatteryVoltage, 2);
+    display.print(ui.batteryVoltage, 2);
   } else {
     display.print("N/A");
   }
 
+  queueDisplayFlush();
+}
+
+// Hot-path redraws hand the finished frame to the chunked flusher so the
+// shared I2C bus is never held for a whole frame. The T-QT's TFT is on its
+// own SPI bus and is pushed directly.
+void queueDisplayFlush() {
+  mainWidgets.valid = false;  // The whole frame was redrawn by hand
+  traceEvent(TRACE_FLUSH_START);
+  #if defined(BOARD_LILYGO_T_QT_PRO)
   display.display();
+  traceEvent(TRACE_FLUSH_END);
+  #else
+  oledFlush.queue(display.getBuffer());
+  #endif
+}
+
+// Same, for a frame the retained widgets changed only in `damage`
+void queueDisplayDamage(const UiDamage& damage) {
+  if (damage.empty()) {
+    return;
+  }
+  traceEvent(TRACE_FLUSH_START);
+  #if defined(BOARD_LILYGO_T_QT_PRO)
+  UiRect bounds = damage.bounds();
+  display.displayRows(bounds.y, bounds.y + bounds.h - 1);
+  traceEvent(TRACE_FLUSH_END);
+  #else
+  oledFlush.queuePages(display.getBuffer(), damage.pageMask());
+  #endif
+}
+
+void serviceDisplayFlush() {
+  #if !defined(BOARD_LILYGO_T_QT_PRO)
+  bool wasPending = oledFlush.pending();
+  oledFlush.service(I2C_DISPLAY_FLUSH_BUDGET_US);
+  if (wasPending && !oledFlush.pending()) {
+    traceEvent(TRACE_FLUSH_END, 0, traceSaturate16(oledFlush.lastFrameBytesSent()));
+  }
+  #endif
+}
+
+bool displayFlushPending() {
+  #if defined(BOARD_LILYGO_T_QT_PRO)
+  return false;
+  #else
+  return oledFlush.pending();
+  #endif
 }
 
 void drawMainDisplay() {
-  if (currentScreen == DEBUG_SCREEN_INDEX) {
+  if (ui.currentScreen == DEBUG_SCREEN_INDEX) {
     drawDebugDisplay();
     return;
   }
+  if (UI_RETAINED_WIDGETS) {
+    composeMainWidgets();
+    return;
+  }
 
   display.clearDisplay();
 
@@ -914,23 +2692,121 @@ void drawMainDisplay() {
   // 2. Game Name
   display.setTextSize(1);
   display.setCursor(0, 0);
-  display.print(GAME_NAMES[currentGame]);
+  display.print(GAME_NAMES[ui.currentGame]);
 
   // 3. Bar Count (Large, Prominent)
   display.setTextSize(3);
   display.setCursor(0, 10);
-  display.print(cachedFilledBars);
+  display.print(ui.filledBars);
 
   // 4. UV Index (Small, Secondary)
   display.setTextSize(1);
   display.setCursor(64, 18);
   display.print(UV_ENCLOSURE_COMP_ENABLED ? "cUVI:" : "UVI:");
-  display.print(cachedUvi, 3);
+  display.print(ui.uvi, 3);
 
   // 5. Draw Sun Gauge (8 or 10 segments depending on game)
-  drawBoktaiGauge(38, 20, cachedFilledBars, cachedNumBars);
+  drawBoktaiGauge(38, 20, ui.filledBars, ui.numBars);
 
-  display.display();
+  queueDisplayFlush();
+}
+
+// Same layout as the immediate-mode path above
+void initMainWidgets() {
+  #if defined(BOARD_LILYGO_T_QT_PRO)
+  uiSurface.begin(display.getBuffer(), SCREEN_WIDTH, SCREEN_HEIGHT, UI_LAYOUT_ROWS);
+  #else
+  uiSurface.begin(display.getBuffer(), SCREEN_WIDTH, SCREEN_HEIGHT, UI_LAYOUT_PAGES);
+  #endif
+  int16_t batteryX = SCREEN_WIDTH - STATUS_BATT_ICON_W - STATUS_RIGHT_MARGIN;
+  mainWidgets.gameName.place(0, 0, 1, UI_ALIGN_LEFT);
+  mainWidgets.bars.place(0, 10, 3, UI_ALIGN_LEFT);
+  const char* uviLabel = UV_ENCLOSURE_COMP_ENABLED ? "cUVI:" : "UVI:";
+  mainWidgets.uviLabel.place(64, 18, 1, UI_ALIGN_LEFT);
+  mainWidgets.uviLabel.set(uviLabel);
+  mainWidgets.uvi.place(64 + (int16_t)(strlen(uviLabel) * 6), 18, 1, UI_ALIGN_LEFT);
+  mainWidgets.gauge.place(38, 20, SCREEN_WIDTH, 2);
+  mainWidgets.batteryText.place(batteryX - STATUS_TEXT_GAP, 2, 1, UI_ALIGN_RIGHT);
+
+  // Icon sprites are the immediate-mode icons drawn once into canvases
+  bluetoothSprite.fillScreen(0);
+  drawBluetoothIcon(bluetoothSprite, 0, 0, true);
+  mainWidgets.bluetooth.setSprite(bluetoothSprite.getBuffer(), STATUS_BT_ICON_W, STATUS_BT_ICON_H);
+  batterySprite.fillScreen(0);
+  drawBatteryGauge(batterySprite, 0, 0, 0);
+  mainWidgets.battery.setSprite(batterySprite.getBuffer(), STATUS_BATT_ICON_W, STATUS_BATT_ICON_H);
+  mainWidgets.battery.setLevelArea({ 2, 2, (int16_t)(STATUS_BATT_ICON_W - 6), (int16_t)(STATUS_BATT_ICON_H - 4) });
+  mainWidgets.valid = false;
+}
+
+// Retained main screen: each widget redraws only if its value changed, and
+// the backend gets just the damaged area. A frame where nothing changed
+// sends nothing.
+void composeMainWidgets() {
+  unsigned long startUs = micros();
+  MainScreenWidgets& w = mainWidgets;
+  if (!w.valid) {
+    // Something else drew over the widgets: start from a blank frame
+    display.clearDisplay();
+    w.gameName.invalidate();
+    w.bars.invalidate();
+    w.uviLabel.invalidate();
+    w.uvi.invalidate();
+    w.gauge.invalidate();
+    w.batteryText.invalidate();
+    w.battery.invalidate();
+    w.bluetooth.invalidate();
+    w.batteryPct = -2;  // Forces the status strip
+    uiSurface.damage.clear();
+    uiSurface.damage.add({ 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT });
+    w.valid = true;
+  }
+
+  w.gameName.set(GAME_NAMES[ui.currentGame]);
+  w.bars.setValue(ui.filledBars, 0);
+  w.uvi.setValue((int32_t)lroundf(ui.uvi * 1000.0f), 3);
+  w.gauge.set(ui.filledBars, ui.numBars);
+
+  // Status strip: the percentage text moves the Bluetooth icon, so any
+  // change there redraws the strip as a whole rather than letting one
+  // widget's erase clip another
+  bool batteryVisible = (ui.batteryPct >= 0);
+  bool bluetoothOn = isBluetoothIconOn();
+  if (ui.batteryPct != w.batteryPct || bluetoothOn != w.bluetoothOn) {
+    UiRect strip = { SCREEN_WIDTH / 2, 0, SCREEN_WIDTH / 2, STATUS_BT_ICON_H + 1 };
+    uiSurface.fill(strip, false);
+    uiSurface.damage.add(strip);
+    w.batteryText.invalidate();
+    w.battery.invalidate();
+    w.bluetooth.invalidate();
+
+    char pctText[6] = "";
+    if (batteryVisible) {
+      snprintf(pctText, sizeof(pctText), "%d%%", ui.batteryPct);
+    }
+    w.batteryText.set(pctText);
+    int16_t batteryX = SCREEN_WIDTH - STATUS_BATT_ICON_W - STATUS_RIGHT_MARGIN;
+    w.battery.set(batteryX, 2, batteryVisible, batteryVisible ? getBatteryGaugeFillW(ui.batteryPct) : 0);
+    int16_t btX = batteryVisible ? (int16_t)(w.batteryText.left() - STATUS_BT_GAP - STATUS_BT_ICON_W)
+                                 : (int16_t)(SCREEN_WIDTH - STATUS_BT_ICON_W - STATUS_RIGHT_MARGIN);
+    w.bluetooth.set(btX, 1, bluetoothOn, 0);
+    w.batteryPct = ui.batteryPct;
+    w.bluetoothOn = bluetoothOn;
+  }
+
+  w.bluetooth.draw(uiSurface);
+  w.battery.draw(uiSurface);
+  w.batteryText.draw(uiSurface, uiGlyphs);
+  w.gameName.draw(uiSurface, uiGlyphs);
+  w.bars.draw(uiSurface, uiGlyphs);
+  w.uviLabel.draw(uiSurface, uiGlyphs);
+  w.uvi.draw(uiSurface, uiGlyphs);
+  w.gauge.draw(uiSurface);
+
+  int32_t damagedPixels = uiSurface.damage.area();
+  queueDisplayDamage(uiSurface.damage);
+  uiSurface.damage.clear();
+  uiFrameStats.record((uint32_t)(micros() - startUs), damagedPixels);
 }
 
 void updateGbaLinkOutput(int bars) {
@@ -938,17 +2814,22 @@ void updateGbaLinkOutput(int bars) {
     return;
   }
 
-  uint8_t value = (uint8_t)constrain(bars, 0, 15);  // 4-bit bar value encoded over two phases
+  uint8_t value = gbaLinkValueForBars(bars);  // 4-bit bar value encoded over two phases
+
+  // Timer ISR owns the pins; just hand it the latest value
+  if (gbaLinkTimer.running()) {
+    gbaLinkTimer.publish(value);
+    return;
+  }
 
   // Framed 3-wire mode:
   // - SC carries frame phase (0 = low pair, 1 = high pair)
   // - SD/SO carry two data bits for that phase
   // - SI is unused (wired to ground externally)
-  unsigned long phaseIntervalUs = GBA_LINK_FRAME_TOGGLE_MS * 1000UL;
-  if (phaseIntervalUs == 0) {
-    phaseIntervalUs = 1000UL;  // Guard against invalid config value
-  }
+  // - v2 sends the Gray code of the value (GbaLinkCodec.h)
+  unsigned long phaseIntervalUs = getGbaPhaseIntervalUs();
 
+  bool phaseWasHigh = gbaFramePhaseHigh;
   unsigned long nowUs = micros();
   if (gbaFrameLastToggleUs == 0) {
     gbaFramePhaseHigh = !gbaFramePhaseHigh;
@@ -964,7 +2845,8 @@ void updateGbaLinkOutput(int bars) {
     }
   }
 
-  uint8_t pair = gbaFramePhaseHigh ? ((value >> 2) & 0x03) : (value & 0x03);
+  uint8_t code = gbaLinkEncode(value, GBA_LINK_PROTOCOL_V2);
+  uint8_t pair = gbaFramePhaseHigh ? ((code >> 2) & 0x03) : (code & 0x03);
   bool soBit = (pair & 0x01) != 0;
   bool sdBit = (pair & 0x02) != 0;
 
@@ -972,208 +2854,629 @@ void updateGbaLinkOutput(int bars) {
   digitalWrite(GBA_PIN_SD, sdBit ? HIGH : LOW);
   digitalWrite(GBA_PIN_SO, soBit ? HIGH : LOW);
   digitalWrite(GBA_PIN_SC, gbaFramePhaseHigh ? HIGH : LOW);
+
+  if (gbaFramePhaseHigh != phaseWasHigh) {
+    if (value != gbaTracedValue) {
+      gbaTracedValue = value;
+      gbaTracePhasesLeft = 2;
+    }
+    if (gbaTracePhasesLeft > 0) {
+      gbaTracePhasesLeft--;
+      traceEvent(TRACE_GBA_PHASE, gbaFramePhaseHigh ? 1 : 0, value);
+    }
+  }
+}
+
+// Register access goes to the sensor picked by selectUvSensor()
+bool writeLtr390Register(uint8_t reg, uint8_t value) {
+  TwoWire* wire = uvSensors[uvSelectedSensor].wire;
+  unsigned long startUs = micros();
+  wire->beginTransmission(LTR390_I2CADDR_DEFAULT);
+  wire->write(reg);
+  wire->write(value);
+  bool ok = wire->endTransmission() == 0;
+  i2cBusMonitor.record((uint32_t)(micros() - startUs), I2C_CLIENT_SENSOR);
+  return ok;
+}
+
+Adafruit_LTR390& activeLtr() {
+  return uvSensors[uvSelectedSensor].ltr;
 }
 
-void writeLtr390Register(uint8_t reg, uint8_t value) {
-  Wire.beginTransmission(LTR390_I2CADDR_DEFAULT);
-  Wire.write(reg);
-  Wire.write(value);
-  Wire.endTransmission();
+// Point register access at sensor i (and the mux at its channel)
+void selectUvSensor(int i) {
+  uvSelectedSensor = i;
+  const UvSensor& sensor = uvSensors[i];
+  if (sensor.wire == &Wire && uvSensorCount > 1) {
+    uvSensorMux.select(sensor.muxChannel);
+  }
 }
 
 void setMeasurementRate(uint8_t rate) {
-  uint8_t resBits = (uint8_t)ltr.getResolution();
+  uint8_t resBits = (uint8_t)activeLtr().getResolution();
   uint8_t regValue = (uint8_t)((resBits << 4) | (rate & 0x07));
   writeLtr390Register(LTR390_MEAS_RATE, regValue);
+
+  // A new sample arrives every measurement period, or every integration
+  // time if that is longer
+  unsigned long periodMs = measRateToMs(rate);
+  unsigned long intMs = (unsigned long)resolutionToIntegrationMs(activeLtr().getResolution());
+  ltrSamplePeriodMs = (intMs > periodMs) ? intMs : periodMs;
+  ltrIntegrationMs = intMs;
+  ltrHasSample = false;
+}
+
+// Time after the last sample to start polling. After an ALS slot the UV
+// conversion restarts, so the next sample is one integration time away
+// rather than one measurement period.
+unsigned long getLtr390PollStartMs() {
+  unsigned long periodMs = alsAssistActive() ? ltrIntegrationMs : ltrSamplePeriodMs;
+  return (periodMs * LTR390_POLL_START_PCT) / 100UL;
+}
+
+void IRAM_ATTR onLtr390Interrupt() {
+  ltrDataReadyIrq = true;
+  powerWakeFromIsr();
 }
 
-float gainToFactor(ltr390_gain_t gain) {
-  switch (gain) {
-    case LTR390_GAIN_1: return 1.0f;
-    case LTR390_GAIN_3: return 3.0f;
-    case LTR390_GAIN_6: return 6.0f;
-    case LTR390_GAIN_9: return 9.0f;
-    case LTR390_GAIN_18: return 18.0f;
-    default: return 1.0f;
+// Light sleep variant: edge interrupts cannot wake the chip, so wait for the
+// low level and then for INT to be released (high) before re-arming
+void IRAM_ATTR onLtr390LevelInterrupt() {
+  if (ltrIntArmedHigh) {
+    ltrIntArmedHigh = false;
+    powerArmLevelWake(LTR390_INT_PIN, false);
+    return;
   }
+  ltrIntArmedHigh = true;
+  powerArmLevelWake(LTR390_INT_PIN, true);
+  onLtr390Interrupt();
 }
 
-float resolutionToIntegrationMs(ltr390_resolution_t res) {
-  switch (res) {
-    case LTR390_RESOLUTION_20BIT: return 400.0f;
-    case LTR390_RESOLUTION_19BIT: return 200.0f;
-    case LTR390_RESOLUTION_18BIT: return 100.0f;
-    case LTR390_RESOLUTION_17BIT: return 50.0f;
-    case LTR390_RESOLUTION_16BIT: return 25.0f;
-    case LTR390_RESOLUTION_13BIT: return 12.5f;
-    default: return 100.0f;
+// Route the LTR390 INT output to a GPIO so samples are fetched only when
+// the sensor signals one. Thresholds are set so every UVS conversion is
+// "out of window" (lower = max count, upper = 0), i.e. INT asserts once per
+// sample and is released when MAIN_STATUS is read.
+void initLtr390Interrupt() {
+  ltrIntModeActive = false;
+  if (LTR390_INT_PIN < 0 || uvSensorCount > 1) {
+    return;
+  }
+  selectUvSensor(0);
+  activeLtr().setThresholds(LTR390_RAW_MAX, 0);
+  activeLtr().configInterrupt(true, LTR390_MODE_UVS, 0);
+  pinMode(LTR390_INT_PIN, INPUT_PULLUP);
+  ltrDataReadyIrq = false;
+  if (powerManager.mode() == POWER_MODE_LIGHT_SLEEP) {
+    ltrIntArmedHigh = false;
+    attachInterrupt(digitalPinToInterrupt(LTR390_INT_PIN), onLtr390LevelInterrupt, ONLOW_WE);
+  } else {
+    attachInterrupt(digitalPinToInterrupt(LTR390_INT_PIN), onLtr390Interrupt, FALLING);
+  }
+  ltrIntModeActive = true;
+  if (serialEnabled) {
+    Serial.print("LTR390 INT on GPIO");
+    Serial.println(LTR390_INT_PIN);
   }
 }
 
-void updateUvDivisorFromSensor() {
-  float gainFactor = gainToFactor(ltr.getGain());
-  float intMs = resolutionToIntegrationMs(ltr.getResolution());
+void stopLtr390Interrupt() {
+  if (!ltrIntModeActive) {
+    return;
+  }
+  detachInterrupt(digitalPinToInterrupt(LTR390_INT_PIN));
+  if (powerManager.mode() == POWER_MODE_LIGHT_SLEEP) {
+    gpio_wakeup_disable((gpio_num_t)LTR390_INT_PIN);
+  }
+  pinMode(LTR390_INT_PIN, INPUT);
+  ltrIntModeActive = false;
+}
 
-  if (gainFactor <= 0.0f || intMs <= 0.0f) {
-    uvDivisor = UV_SENSITIVITY_COUNTS_PER_UVI;
-  } else {
-    uvDivisor = (UV_SENSITIVITY_COUNTS_PER_UVI * gainFactor * intMs) /
-                (UV_REFERENCE_GAIN * UV_REFERENCE_INT_MS);
+// Fetch a new UVS sample if one is ready. In INT-pin mode the sensor is
+// only read after its interrupt fires (or after a safety timeout, which
+// also releases INT if an edge was missed). Otherwise polling only starts
+// once most of the measurement period has elapsed since the last sample.
+// Each read is a single burst of MAIN_STATUS through UVS_DATA instead of
+// separate status and data transactions. During an ALS slot the same burst
+// returns the ALS result; a step there yields a provisional UVS value
+// (*provisional = true) from AlsTransientDetector.
+bool pollLtr390Sample(uint32_t* rawUVS, bool* provisional) {
+  unsigned long now = millis();
+  *provisional = false;
+  if (uvSensorCount > 1) {
+    return pollUvSensorArray(now, rawUVS);
+  }
+  if (ltrAlsSlotActive) {
+    return pollLtr390AlsSlot(now, rawUVS, provisional);
+  }
+  if (ltrIntModeActive) {
+    if (!ltrDataReadyIrq && (now - ltrLastSampleMs) < LTR390_INT_SAFETY_POLL_MS) {
+      return false;
+    }
+    ltrDataReadyIrq = false;
+  } else if (ltrHasSample && (now - ltrLastSampleMs) < getLtr390PollStartMs()) {
+    return false;
   }
 
-  if (serialEnabled) {
-    Serial.print("UV divisor: ");
-    Serial.println(uvDivisor, 4);
+  uint8_t buf[LTR390_BURST_LEN];
+  bool busOk;
+  if (!readLtr390Burst(buf, &busOk)) {
+    if (ltrIntModeActive) {
+      ltrLastSampleMs = now;  // Re-arm the safety timeout
+    }
+    return false;
+  }
+
+  const uint8_t* uvs = &buf[LTR390_UVSDATA - LTR390_MAIN_STATUS];
+  *rawUVS = ((uint32_t)uvs[0] | ((uint32_t)uvs[1] << 8) | ((uint32_t)uvs[2] << 16)) & LTR390_RAW_MAX;
+  ltrLastSampleMs = now;
+  ltrHasSample = true;
+  if (ltrDiscardNextSample) {
+    ltrDiscardNextSample = false;
+    return false;
   }
+  return true;
 }
 
-float applyEnclosureCompensation(float measuredUvi) {
-  if (!UV_ENCLOSURE_COMP_ENABLED) {
-    return measuredUvi;
+// MAIN_STATUS through UVS_DATA in one transaction from the selected sensor.
+// False if the read failed (*busOk = false) or no new data is ready.
+bool readLtr390Burst(uint8_t* buf, bool* busOk) {
+  TwoWire* wire = uvSensors[uvSelectedSensor].wire;
+  unsigned long startUs = micros();
+  wire->beginTransmission(LTR390_I2CADDR_DEFAULT);
+  wire->write(LTR390_MAIN_STATUS);
+  bool ok = (wire->endTransmission(false) == 0) &&
+            (wire->requestFrom((uint8_t)LTR390_I2CADDR_DEFAULT, LTR390_BURST_LEN) == LTR390_BURST_LEN);
+  if (ok) {
+    for (uint8_t i = 0; i < LTR390_BURST_LEN; i++) {
+      buf[i] = (uint8_t)wire->read();
+    }
+  }
+  i2cBusMonitor.record((uint32_t)(micros() - startUs), I2C_CLIENT_SENSOR);
+  *busOk = ok;
+  return ok && (buf[0] & LTR390_STATUS_DATA_READY) != 0;
+}
+
+// ALS slots run with a single sensor, and only in the slow UV range
+// (alsAssistInRange() in AlsAssist.h)
+bool alsAssistActive() {
+  return UV_ALS_ASSIST_ENABLED && uvSensorCount == 1 && alsAssistInRange(uvAutoRange.mode() == UV_RANGE_FAST);
+}
+
+// Switch to one short ALS conversion right after a UV sample. The INT pin
+// stays quiet meanwhile (it is set to the UVS channel), so the slot end is
+// polled on its own deadline.
+void startLtr390AlsSlot() {
+  writeLtr390Register(LTR390_GAIN, LTR390_ALS_GAIN);
+  writeLtr390Register(LTR390_MEAS_RATE, LTR390_ALS_MEAS_RATE);
+  writeLtr390Register(LTR390_MAIN_CTRL, LTR390_MAIN_CTRL_ALS);
+  ltrAlsSlotStartMs = millis();
+  ltrAlsSlotActive = true;
+}
+
+// Back to the current UV range. The UV conversion starts over from here.
+void endLtr390AlsSlot(unsigned long now) {
+  const UvRangeMode& m = UV_RANGE_MODES[uvAutoRange.mode()];
+  writeLtr390Register(LTR390_GAIN, (uint8_t)m.gain);
+  writeLtr390Register(LTR390_MEAS_RATE, (uint8_t)(((uint8_t)m.resolution << 4) | (m.measRate & 0x07)));
+  writeLtr390Register(LTR390_MAIN_CTRL, LTR390_MAIN_CTRL_UVS);
+  ltrAlsSlotActive = false;
+  ltrLastSampleMs = now;
+  ltrDataReadyIrq = false;
+}
+
+bool pollLtr390AlsSlot(unsigned long now, uint32_t* rawUVS, bool* provisional) {
+  if ((now - ltrAlsSlotStartMs) < LTR390_ALS_SLOT_MS) {
+    return false;
+  }
+  uint8_t buf[LTR390_BURST_LEN];
+  bool busOk;
+  if (!readLtr390Burst(buf, &busOk)) {
+    if ((now - ltrAlsSlotStartMs) >= LTR390_ALS_SLOT_MAX_MS) {
+      endLtr390AlsSlot(now);
+    }
+    return false;
+  }
+  endLtr390AlsSlot(now);
+
+  const uint8_t* als = &buf[LTR390_ALSDATA - LTR390_MAIN_STATUS];
+  uint32_t counts = (uint32_t)als[0] | ((uint32_t)als[1] << 8) | ((uint32_t)als[2] << 16);
+  uint32_t previousCounts = alsDetector.lastCounts();
+  float provisionalUvi = 0.0f;
+  uint32_t stepsBefore = alsDetector.steps();
+  bool shown = alsDetector.alsSample(counts, &provisionalUvi);
+  if (alsDetector.steps() == stepsBefore) {
+    return false;
+  }
+  traceEvent(TRACE_ALS_STEP, (counts > previousCounts) ? 1 : 0, traceSaturate16(counts));
+  if (serialEnabled && DEBUG_SERIAL_UV && !DEBUG_SERIAL_TELEMETRY) {
+    Serial.print("ALS step ");
+    Serial.print(previousCounts);
+    Serial.print(" -> ");
+    Serial.print(counts);
+    if (shown) {
+      Serial.print(", provisional UVI ");
+      Serial.println(provisionalUvi, 3);
+    } else {
+      Serial.println(", no ratio learned yet");
+    }
+  }
+  if (!shown) {
+    return false;
+  }
+  float raw = provisionalUvi * uvDivisor;
+  *rawUVS = (raw >= (float)LTR390_RAW_MAX) ? LTR390_RAW_MAX : (uint32_t)lroundf(raw);
+  *provisional = true;
+  return true;
+}
+
+// ---- Several sensors (UV_SENSOR_COUNT > 1) ----
+
+// Bus and mux for each configured sensor (from setup(), after Wire.begin)
+void setupUvSensorBuses() {
+  uvSensorCount = constrain(UV_SENSOR_COUNT, 1, UV_SENSOR_MAX);
+  bool needBus1 = false;
+  for (int i = 0; i < uvSensorCount; i++) {
+    bool bus1 = (i > 0) && UV_SENSOR_BUS[i] == 1 && UV_SENSOR_BUS1_SDA_PIN >= 0 && UV_SENSOR_BUS1_SCL_PIN >= 0;
+    uvSensors[i].wire = bus1 ? &Wire1 : &Wire;
+    uvSensors[i].muxChannel = bus1 ? -1 : UV_SENSOR_MUX_CHANNEL[i];
+    needBus1 = needBus1 || bus1;
+  }
+  if (needBus1) {
+    Wire1.begin(UV_SENSOR_BUS1_SDA_PIN, UV_SENSOR_BUS1_SCL_PIN, I2C_CLOCK_HZ);
+  }
+  if (uvSensorCount > 1) {
+    uvSensorMux.begin(&Wire, UV_SENSOR_MUX_ADDR, &i2cBusMonitor);
+  }
+}
+
+// Bring up every configured sensor. True if at least one answered; the
+// others are retried from the sample loop.
+bool initUvSensors() {
+  uvFusion.configure(getUvFusionConfig(uvDivisor, uvArrayCycleMs), uvSensorCount);
+  int online = 0;
+  unsigned long now = millis();
+  for (int i = 0; i < uvSensorCount; i++) {
+    UvSensor& sensor = uvSensors[i];
+    sensor.online = initLTR390(i);
+    sensor.converting = false;
+    sensor.failures = 0;
+    sensor.retryAtMs = now + UV_SENSOR_RETRY_MS;
+    uvFusion.setOnline(i, sensor.online);
+    online += sensor.online ? 1 : 0;
+  }
+  if (online > 0) {
+    for (int i = 0; i < uvSensorCount; i++) {
+      if (uvSensors[i].online) {
+        selectUvSensor(i);
+        break;
+      }
+    }
+  }
+  return online > 0;
+}
+
+// Map each sensor's counts onto sensor 0's: its sensitivity, and its own
+// window transmittance against the enclosure one (the enclosure offset is
+// applied later, to the fused value)
+void updateUvFusionCalibration() {
+  for (int i = 0; i < uvSensorCount; i++) {
+    float scale = 1.0f;
+    float offset = 0.0f;
+    uvFusionCalibration(UV_SENSOR_SENSITIVITY[i], UV_SENSOR_TRANSMITTANCE[i], UV_ENCLOSURE_COMP_ENABLED,
+                        UV_ENCLOSURE_TRANSMITTANCE, UV_ENCLOSURE_UVI_OFFSET, uvDivisor, &scale, &offset);
+    uvFusion.setCalibration(i, scale, offset);
+  }
+  uvFusion.setOutlierMinCounts(UV_SENSOR_OUTLIER_MIN_UVI * uvDivisor);
+  uvFusion.setFreshMs(uvArrayCycleMs);
+}
+
+// Spread the online sensors' conversion starts evenly over one cycle. Any
+// conversion in progress is abandoned and restarted at its new slot.
+void staggerUvSensors(unsigned long now) {
+  int online = 0;
+  for (int i = 0; i < uvSensorCount; i++) {
+    online += uvSensors[i].online ? 1 : 0;
+  }
+  int slot = 0;
+  for (int i = 0; i < uvSensorCount; i++) {
+    UvSensor& sensor = uvSensors[i];
+    if (!sensor.online) {
+      continue;
+    }
+    sensor.converting = false;
+    sensor.startAtMs = now + (uvArrayCycleMs * (unsigned long)slot) / (unsigned long)online;
+    slot++;
+  }
+}
+
+// Restart sensor i's conversion now (standby, then UVS mode again)
+void startUvArrayConversion(int i, unsigned long now) {
+  UvSensor& sensor = uvSensors[i];
+  selectUvSensor(i);
+  bool ok = writeLtr390Register(LTR390_MAIN_CTRL, 0x00) &&
+            writeLtr390Register(LTR390_MAIN_CTRL, LTR390_MAIN_CTRL_UVS);
+  if (!ok) {
+    noteUvSensorFailure(i, now);
+    return;
+  }
+  sensor.converting = true;
+  sensor.startedMs = now;
+}
+
+void noteUvSensorFailure(int i, unsigned long now) {
+  UvSensor& sensor = uvSensors[i];
+  sensor.converting = false;
+  sensor.startAtMs = now;
+  if (++sensor.failures < UV_SENSOR_MAX_FAILURES) {
+    return;
+  }
+  sensor.online = false;
+  sensor.retryAtMs = now + UV_SENSOR_RETRY_MS;
+  uvFusion.setOnline(i, false);
+  staggerUvSensors(now);
+  if (serialEnabled && !DEBUG_SERIAL_TELEMETRY) {
+    Serial.print("UV sensor ");
+    Serial.print(i);
+    Serial.println(" dropped");
+  }
+}
+
+// Try to bring back sensors that dropped off the bus
+void retryOfflineUvSensors(unsigned long now) {
+  for (int i = 0; i < uvSensorCount; i++) {
+    UvSensor& sensor = uvSensors[i];
+    if (sensor.online || (long)(now - sensor.retryAtMs) < 0) {
+      continue;
+    }
+    selectUvSensor(i);
+    if (!sensor.ltr.begin(sensor.wire)) {
+      sensor.retryAtMs = now + UV_SENSOR_RETRY_MS;
+      continue;
+    }
+    sensor.ltr.setMode(LTR390_MODE_UVS);
+    configureUvSensorRange(i, UV_RANGE_MODES[uvAutoRange.mode()]);
+    sensor.online = true;
+    sensor.failures = 0;
+    uvFusion.setOnline(i, true);
+    staggerUvSensors(millis());
+    if (serialEnabled && !DEBUG_SERIAL_TELEMETRY) {
+      Serial.print("UV sensor ");
+      Serial.print(i);
+      Serial.println(" back online");
+    }
   }
-  if (UV_ENCLOSURE_TRANSMITTANCE <= 0.0f) {
-    return measuredUvi;
+}
+
+// Each online sensor runs one conversion per cycle, started by the firmware
+// at its staggered slot, so the sensors' own clocks cannot drift into each
+// other. A finished sample goes through UvFusion; at most one fused sample
+// is returned per call (others are picked up on the next pass).
+bool pollUvSensorArray(unsigned long now, uint32_t* rawUVS) {
+  retryOfflineUvSensors(now);
+  unsigned long pollStartMs = (ltrIntegrationMs * LTR390_POLL_START_PCT) / 100UL;
+  for (int k = 0; k < uvSensorCount; k++) {
+    int i = (uvArrayNextPoll + k) % uvSensorCount;
+    UvSensor& sensor = uvSensors[i];
+    if (!sensor.online) {
+      continue;
+    }
+    if (!sensor.converting) {
+      if ((long)(now - sensor.startAtMs) >= 0) {
+        startUvArrayConversion(i, now);
+      }
+      continue;
+    }
+    if ((now - sensor.startedMs) < pollStartMs) {
+      continue;
+    }
+
+    selectUvSensor(i);
+    uint8_t buf[LTR390_BURST_LEN];
+    bool busOk;
+    if (!readLtr390Burst(buf, &busOk)) {
+      if (!busOk || (now - sensor.startedMs) >= 2 * uvArrayCycleMs) {
+        noteUvSensorFailure(i, now);
+      }
+      continue;
+    }
+    sensor.failures = 0;
+    sensor.converting = false;
+    // Next slot on this sensor's grid (skipping any already missed)
+    do {
+      sensor.startAtMs += uvArrayCycleMs;
+    } while ((long)(now - sensor.startAtMs) >= 0);
+    uvArrayNextPoll = (i + 1) % uvSensorCount;
+
+    const uint8_t* uvs = &buf[LTR390_UVSDATA - LTR390_MAIN_STATUS];
+    uint32_t raw = ((uint32_t)uvs[0] | ((uint32_t)uvs[1] << 8) | ((uint32_t)uvs[2] << 16)) & LTR390_RAW_MAX;
+    float fused = 0.0f;
+    if (!uvFusion.add(i, raw, now, &fused)) {
+      continue;
+    }
+    *rawUVS = (fused >= (float)LTR390_RAW_MAX) ? LTR390_RAW_MAX : (uint32_t)lroundf(fused);
+    return true;
+  }
+  return false;
+}
+
+// Program gain, resolution and measurement rate for a ranging mode, then
+// rebuild the divisor and raw bar tables for it.
+void applyUvRangeMode(int mode) {
+  const UvRangeMode& m = UV_RANGE_MODES[mode];
+  for (int i = 0; i < uvSensorCount; i++) {
+    if (uvSensors[i].online) {
+      configureUvSensorRange(i, m);
+    }
+  }
+  updateUvDivisorFromSensor();
+  uvAutoRange.setMode(mode, millis());
+  if (uvSensorCount > 1) {
+    // One conversion per start, and time to read it before the next
+    unsigned long intMs = (unsigned long)resolutionToIntegrationMs(m.resolution);
+    unsigned long rateMs = measRateToMs(m.measRate);
+    uvArrayCycleMs = max(rateMs, intMs + intMs / 8);
+    updateUvFusionCalibration();
+    staggerUvSensors(millis());
+  }
+}
+
+void configureUvSensorRange(int i, const UvRangeMode& m) {
+  selectUvSensor(i);
+  activeLtr().setGain((ltr390_gain_t)m.gain);
+  activeLtr().setResolution((ltr390_resolution_t)m.resolution);
+  // Array sensors are restarted for every sample (pollUvSensorArray), so
+  // their own rate is set long enough never to start one by itself
+  setMeasurementRate((uvSensorCount > 1) ? LTR390_ARRAY_MEAS_RATE : m.measRate);
+}
+
+// Switch between the shade and bright-light modes on measured UVI
+// (UvAutoRange.h). The first sample after a switch is discarded since that
+// conversion may straddle both settings, unless an ALS slot follows, which
+// restarts the conversion anyway.
+void updateUvAutoRange(float measuredUvi) {
+  if (!uvAutoRange.update(measuredUvi, millis())) {
+    return;
+  }
+  int target = uvAutoRange.mode();
+  applyUvRangeMode(target);
+  ltrDiscardNextSample = !alsAssistActive();   // An ALS slot restarts the conversion itself
+  if (alsAssistActive()) {
+    alsDetector.resume();
+  }
+  if (serialEnabled && DEBUG_SERIAL_UV && !DEBUG_SERIAL_TELEMETRY) {
+    Serial.print("UV range -> ");
+    Serial.print(UV_RANGE_MODES[target].label);
+    Serial.print(" at UVI ");
+    Serial.println(measuredUvi, 3);
+  }
+}
+
+void updateUvDivisorFromSensor() {
+  uvDivisor = getUvDivisor((uint8_t)activeLtr().getGain(), (uint8_t)activeLtr().getResolution());
+
+  if (serialEnabled) {
+    Serial.print("UV divisor: ");
+    Serial.println(uvDivisor, 4);
   }
 
-  float corrected = (measuredUvi - UV_ENCLOSURE_UVI_OFFSET) / UV_ENCLOSURE_TRANSMITTANCE;
-  if (corrected < 0.0f) {
-    corrected = 0.0f;
-  }
-  return corrected;
+  rebuildBarRawThresholds();
 }
 
-// Raphi's original Boktai cartridge bar thresholds (raphi.xyz/~raphi/boktai/sensor_graph/).
-// Ratios of the UV range [UV_MIN, UV_SATURATION] at which each bar level starts.
-// Derived from exclusive upper bounds on the 0-140 cartridge scale: ratio = (upper_bound - 1) / 139.
-// Boktai 1 (8 bars): exclusive upper bounds 1, 7, 16, 28, 44, 67, 98, 140
-static const float RAPHI_B1[8] = {
-  0.0f,          // Bar 1: starts at UV_MIN
-  6.0f/139.0f,   // Bar 2
-  15.0f/139.0f,  // Bar 3
-  27.0f/139.0f,  // Bar 4
-  43.0f/139.0f,  // Bar 5
-  66.0f/139.0f,  // Bar 6
-  97.0f/139.0f,  // Bar 7
-  1.0f           // Bar 8: starts at UV_SATURATION
-};
-// Boktai 2 & 3 (10 bars): exclusive upper bounds 1, 6, 13, 23, 35, 50, 67, 87, 110, 140
-static const float RAPHI_B23[10] = {
-  0.0f,           // Bar 1: starts at UV_MIN
-  5.0f/139.0f,    // Bar 2
-  12.0f/139.0f,   // Bar 3
-  22.0f/139.0f,   // Bar 4
-  34.0f/139.0f,   // Bar 5
-  49.0f/139.0f,   // Bar 6
-  66.0f/139.0f,   // Bar 7
-  86.0f/139.0f,   // Bar 8
-  109.0f/139.0f,  // Bar 9
-  1.0f            // Bar 10: starts at UV_SATURATION
-};
-
-const float* getRaphiRatios(int numBars) {
-  return (numBars == 8) ? RAPHI_B1 : RAPHI_B23;
+float applyEnclosureCompensation(float measuredUvi) {
+  return barCompensateUvi(barConfig, measuredUvi);
 }
 
 void getGameUvRange(int game, float* uvMin, float* uvSat) {
-  if (AUTO_MODE) {
-    *uvMin = AUTO_UV_MIN;
-    *uvSat = AUTO_UV_SATURATION;
-    return;
-  }
-  switch (game) {
-    case 0: *uvMin = BOKTAI_1_UV_MIN; *uvSat = BOKTAI_1_UV_SATURATION; break;
-    case 1: *uvMin = BOKTAI_2_UV_MIN; *uvSat = BOKTAI_2_UV_SATURATION; break;
-    case 2: *uvMin = BOKTAI_3_UV_MIN; *uvSat = BOKTAI_3_UV_SATURATION; break;
-    default: *uvMin = AUTO_UV_MIN;    *uvSat = AUTO_UV_SATURATION;      break;
-  }
+  game = clampGameIndex(game);
+  *uvMin = barConfig.uvMin[game];
+  *uvSat = barConfig.uvSat[game];
 }
 
 int clampGameIndex(int game) {
-  if (game < 0) {
-    return 0;
-  }
-  if (game >= NUM_GAMES) {
-    return NUM_GAMES - 1;
-  }
-  return game;
+  return barGameIndex(game);
 }
 
 float getBarThreshold(int game, int barIndex) {
-  game = clampGameIndex(game);
-  int numBars = GAME_BARS[game];
-  if (barIndex < 1) barIndex = 1;
-  if (barIndex > numBars) barIndex = numBars;
-  float uvMin, uvSat;
-  getGameUvRange(game, &uvMin, &uvSat);
-  if (uvSat <= uvMin) return uvMin;
-  return uvMin + getRaphiRatios(numBars)[barIndex - 1] * (uvSat - uvMin);
+  return barThreshold(barConfig, game, barIndex);
 }
 
-int getBoktaiBarsWithHysteresis(float uvi, int game, int lastBars) {
-  game = clampGameIndex(game);
-  int numBars = GAME_BARS[game];
-  int target = getBoktaiBars(uvi, game);
-
-  if (!BAR_HYSTERESIS_ENABLED || BAR_HYSTERESIS <= 0.0f || (AUTO_MODE && AUTO_UV_SATURATION <= AUTO_UV_MIN)) {
-    return target;
-  }
+// Smoothing and bar starts; they depend only on config.h, so this runs
+// once at boot, before the sensor sets the divisor.
+void initUvFilter() {
+  uvBars.configure(getUvBarPipelineConfig());
+}
 
-  if (lastBars < 0) {
-    lastBars = 0;
-  }
-  if (lastBars > numBars) {
-    lastBars = numBars;
-  }
+int getBoktaiBarsWithHysteresis(float uvi, int game, int lastBars) {
+  return barsForUviWithHysteresis(barConfig, uvi, game, lastBars);
+}
 
-  if (target > lastBars) {
-    float upThreshold = getBarThreshold(game, lastBars + 1);
-    if (uvi >= (upThreshold + BAR_HYSTERESIS)) {
-      return target;
-    }
-    return lastBars;
-  }
+// Convert UV Index to Boktai bar count based on selected game
+int getBoktaiBars(float uvi, int game) {
+  return barsForUvi(barConfig, uvi, game);
+}
 
-  if (target < lastBars) {
-    // lastBars > 0 guaranteed: clamped to [0, numBars] above and target < lastBars
-    float downThreshold = getBarThreshold(game, lastBars);
-    if (uvi < (downThreshold - BAR_HYSTERESIS)) {
-      return target;
-    }
-    return lastBars;
-  }
+void rebuildBarRawThresholds() {
+  uvBars.setDivisor(getUvDivisor());
+}
 
-  return lastBars;
+// Integer equivalent of getBoktaiBars(rawToBarUvi(rawUVS), game).
+int getBoktaiBarsFromRaw(uint32_t rawUVS, int game) {
+  return uvBars.rawTables().bars(rawUVS, game);
 }
 
-// Convert UV Index to Boktai bar count based on selected game
-int getBoktaiBars(float uvi, int game) {
-  game = clampGameIndex(game);
-  int numBars = GAME_BARS[game];
-  float uvMin, uvSat;
-  getGameUvRange(game, &uvMin, &uvSat);
+// Integer equivalent of getBoktaiBarsWithHysteresis(rawToBarUvi(rawUVS), ...).
+int getBoktaiBarsFromRawWithHysteresis(uint32_t rawUVS, int game, int lastBars) {
+  return uvBars.rawTables().barsWithHysteresis(rawUVS, game, lastBars);
+}
 
-  if (uvSat <= uvMin) {
-    return (uvi >= uvMin) ? numBars : 0;
+// Debug aid: sweep every 20-bit count and confirm the raw tables agree with
+// the float path as this compiler and FPU evaluate it (host/test_bar_thresholds
+// covers the same on the host). Takes several seconds; only runs with
+// DEBUG_VERIFY_BAR_TABLES.
+void verifyBarRawThresholds() {
+  if (!serialEnabled || !DEBUG_VERIFY_BAR_TABLES) {
+    return;
   }
-  if (uvi < uvMin) return 0;
-  if (uvi >= uvSat) return numBars;
-
-  // Scale UVI to [0, 1) within the configured range and look up in Raphi's table.
-  // Bar N+1 starts where bar N's exclusive upper bound falls (ratio = (upper_bound-1)/139).
-  float ratio = (uvi - uvMin) / (uvSat - uvMin);
-  const float* ratios = getRaphiRatios(numBars);
-  for (int i = numBars - 1; i >= 0; i--) {
-    if (ratio >= ratios[i]) {
-      return i + 1;
+  unsigned long startMs = millis();
+  uint32_t mismatches = 0;
+  for (int game = 0; game < NUM_GAMES; game++) {
+    int numBars = GAME_BARS[game];
+    for (uint32_t raw = 0; raw <= LTR390_RAW_MAX; raw++) {
+      float uvi = rawToBarUvi(raw);
+      if (getBoktaiBarsFromRaw(raw, game) != getBoktaiBars(uvi, game)) {
+        mismatches++;
+      }
+      for (int lastBars = 0; lastBars <= numBars; lastBars++) {
+        if (getBoktaiBarsFromRawWithHysteresis(raw, game, lastBars) !=
+            getBoktaiBarsWithHysteresis(uvi, game, lastBars)) {
+          mismatches++;
+        }
+      }
+    }
+  }
+  Serial.print("Bar table check: ");
+  Serial.print(mismatches);
+  Serial.print(" mismatches in ");
+  Serial.print(millis() - startMs);
+  Serial.println("ms");
+
+  // Absolute HID mode: every level must survive encode -> decode on both
+  // transports (8-bit XInput triggers, 10-bit BLE triggers).
+  uint32_t absMismatches = 0;
+  for (int game = 0; game < NUM_GAMES; game++) {
+    uint8_t numBars = (uint8_t)GAME_BARS[game];
+    for (int level = 0; level <= ABS_METER_LEVEL_MAX; level++) {
+      uint8_t bars = absMeterBarsFromLevel((uint8_t)level, numBars);
+      AbsMeterReport report = absMeterEncode((uint8_t)(ABS_METER_CART_DARK - level), bars, numBars);
+      AbsMeterValue value;
+      if (!absMeterDecode(report, &value) || value.bars != bars ||
+          value.cartValue != report.triggerLeft) {
+        absMismatches++;
+      }
+      float bleLeft = (float)absoluteTriggerToBle(report.triggerLeft) / XBOX_TRIGGER_MAX;
+      float bleRight = (float)absoluteTriggerToBle(report.triggerRight) / XBOX_TRIGGER_MAX;
+      if (!absMeterDecodeNormalized(bleLeft, bleRight, report.axis / 32768.0f, &value) ||
+          value.cartValue != report.triggerLeft) {
+        absMismatches++;
+      }
     }
   }
-  return 0;
+  Serial.print("Absolute HID check: ");
+  Serial.print(absMismatches);
+  Serial.println(" mismatches");
+}
+
+// Bars for the current sample (UvBarPipeline.h): the raw-count tables when
+// samples are used as read, the float path when smoothing has produced an
+// in-between UVI.
+int getCurrentSampleBars(bool applyHysteresis) {
+  return uvBars.bars(cachedRawUVS, cachedUvi, currentGame, applyHysteresis ? cachedFilledBars : -1);
 }
 
 void refreshGameState(bool refreshOutputs) {
   currentGame = clampGameIndex(currentGame);
   cachedNumBars = GAME_BARS[currentGame];
-  cachedFilledBars = getBoktaiBars(cachedUvi, currentGame);
+  cachedFilledBars = getCurrentSampleBars(false);
 
   if (refreshOutputs) {
     updateBluetoothMeter(cachedFilledBars, cachedNumBars);
@@ -1185,7 +3488,7 @@ void refreshGameState(bool refreshOutputs) {
 // state when a game screen is selected.
 void cycleUiScreen(int step) {
   currentScreen = (currentScreen + NUM_UI_SCREENS + step) % NUM_UI_SCREENS;
-  uiScreenChanged = true;
+  postUiEvent(UI_EVENT_SCREEN_CHANGED);
 
   if (currentScreen < NUM_GAMES) {
     currentGame = clampGameIndex(currentScreen);
@@ -1197,56 +3500,48 @@ void cycleUiScreen(int step) {
 
 // Handle power button: tap to cycle screens, long-press (2s) to sleep
 void handlePowerButton() {
-  #if HAS_USB_HID
-  if (cdcRequireButtonRelease) {
-    if (digitalRead(BUTTON_PIN) != LOW) {
-      cdcRequireButtonRelease = false;
-      buttonWasPressed = false;
-    }
-    return;
-  }
-  #endif
-
-  bool buttonPressed = (digitalRead(BUTTON_PIN) == LOW);
-
-  if (buttonPressed && !buttonWasPressed) {
-    logDeviceButtonPress("runtime");
-    buttonPressStart = millis();
-    buttonWasPressed = true;
-    if (screensaverActive) {
-      suppressShortPress = true;
-    }
-    noteScreenActivity();
-  }
-  else if (buttonPressed && buttonWasPressed) {
-    noteScreenActivity();
-    if ((millis() - buttonPressStart) >= LONG_PRESS_MS) {
-      #if HAS_USB_HID
-      if (inCdcMode) {
-        if (USB_HID_ENABLED) {
-          exitCdcModeAndSleep();  // Return to XInput mode
+  powerButton.poll(millis());
+  ButtonEvent event;
+  while (powerButton.nextEvent(&event)) {
+    switch (event.type) {
+      case BUTTON_EVENT_PRESS:
+        traceEvent(TRACE_BUTTON, 1, 1);
+        logDeviceButtonPress("runtime");
+        // The tap that wakes the screen from the screensaver does nothing else
+        suppressShortPress = screensaverActive;
+        noteScreenActivity();
+        break;
+      case BUTTON_EVENT_RELEASE:
+        traceEvent(TRACE_BUTTON, 1, 0);
+        break;
+      case BUTTON_EVENT_TAP:
+        if (!suppressShortPress) {
+          cycleUiScreen(1);
+        }
+        break;
+      case BUTTON_EVENT_LONG_PRESS:
+        #if HAS_USB_HID
+        if (inCdcMode) {
+          if (USB_HID_ENABLED) {
+            exitCdcModeAndSleep();  // Return to XInput mode
+          } else {
+            enterDeepSleep();       // USB disabled — just sleep normally
+          }
+        } else if (currentScreen == DEBUG_SCREEN_INDEX) {
+          enterCdcMode();
         } else {
-          enterDeepSleep();       // USB disabled — just sleep normally
+          enterDeepSleep();
         }
-      } else if (currentScreen == DEBUG_SCREEN_INDEX) {
-        enterCdcMode();
-      } else {
+        #else
         enterDeepSleep();
-      }
-      #else
-      enterDeepSleep();
-      #endif
+        #endif
+        break;
+      default:
+        break;
     }
   }
-  else if (!buttonPressed && buttonWasPressed) {
-    unsigned long pressDuration = millis() - buttonPressStart;
-    if (pressDuration >= DEBOUNCE_MS && pressDuration < LONG_PRESS_MS) {
-      if (!suppressShortPress) {
-        cycleUiScreen(1);
-      }
-    }
-    suppressShortPress = false;
-    buttonWasPressed = false;
+  if (powerButton.isPressed()) {
+    noteScreenActivity();
   }
 }
 
@@ -1257,94 +3552,94 @@ void handleSecondButton() {
     return;
   }
 
-  bool buttonPressed = (digitalRead(BUTTON2_PIN) == LOW);
-
-  if (buttonPressed && !button2WasPressed) {
-    logDeviceButtonPress("runtime, button 2");
-    button2PressStart = millis();
-    button2WasPressed = true;
-    if (screensaverActive) {
-      button2SuppressShortPress = true;
+  secondButton.poll(millis());
+  ButtonEvent event;
+  while (secondButton.nextEvent(&event)) {
+    if (event.type == BUTTON_EVENT_PRESS) {
+      traceEvent(TRACE_BUTTON, 2, 1);
+      logDeviceButtonPress("runtime, button 2");
+      button2SuppressShortPress = screensaverActive;
+      noteScreenActivity();
+    } else if (event.type == BUTTON_EVENT_RELEASE) {
+      traceEvent(TRACE_BUTTON, 2, 0);
+    } else if (event.type == BUTTON_EVENT_TAP && !button2SuppressShortPress) {
+      cycleUiScreen(-1);
     }
-    noteScreenActivity();
   }
-  else if (buttonPressed && button2WasPressed) {
+  if (secondButton.isPressed()) {
     noteScreenActivity();
   }
-  else if (!buttonPressed && button2WasPressed) {
-    unsigned long pressDuration = millis() - button2PressStart;
-    if (pressDuration >= DEBOUNCE_MS && !button2SuppressShortPress) {
-      cycleUiScreen(-1);
-    }
-    button2SuppressShortPress = false;
-    button2WasPressed = false;
-  }
 }
 
 // Wait for power-on with 10-second timeout.
 // Always shows "Hold 2s to power on" immediately so wake taps are visible.
 // Button activity resets the 10-second timer.
 // Returns true if hold completed, false if timed out.
+// Sleeps between button edges instead of polling the pin.
 bool waitForPowerOn() {
   const unsigned long DISPLAY_TIMEOUT_MS = 10000;  // 10 seconds
+  const unsigned long PROMPT_REFRESH_MS = 750;
   unsigned long lastActivity = millis();
   unsigned long lastPromptRefresh = lastActivity;
-  unsigned long pressStart = 0;
-  bool wasPressed = false;
-  bool pressedAtStart = (digitalRead(BUTTON_PIN) == LOW);
-  
+
   showHoldPowerOnPrompt();
-  if (pressedAtStart) {
+  if (powerButton.isPressed()) {
     logDeviceButtonPress("wake");
-    pressStart = lastActivity;
-    wasPressed = true;
   }
-  
+
   while (true) {
-    bool pressed = (digitalRead(BUTTON_PIN) == LOW);
     unsigned long now = millis();
-    
-    // Check for timeout (10 seconds of no button activity)
-    if ((now - lastActivity) >= DISPLAY_TIMEOUT_MS) {
-      displayPanelOff();
-      return false;  // Timed out - caller should go to sleep
-    }
-    
-    // Button just pressed
-    if (pressed && !wasPressed) {
-      logDeviceButtonPress("wake");
+    powerButton.poll(now);
+    ButtonEvent event;
+    while (powerButton.nextEvent(&event)) {
       lastActivity = now;  // Reset timeout
-      pressStart = now;
-      wasPressed = true;
-      
-      // Refresh prompt on each press.
-      showHoldPowerOnPrompt();
-      lastPromptRefresh = now;
-    }
-    // Button held
-    else if (pressed && wasPressed) {
+      if (event.type == BUTTON_EVENT_PRESS) {
+        logDeviceButtonPress("wake");
+        // Refresh prompt on each press.
+        showHoldPowerOnPrompt();
+        lastPromptRefresh = now;
+      } else if (event.type == BUTTON_EVENT_LONG_PRESS) {
+        return true;  // Successfully powered on
+      }
+    }
+
+    unsigned long waitMs;
+    if (powerButton.isPressed()) {
       lastActivity = now;  // Reset timeout while holding
       // Retry prompt draw periodically while held in case the first draw was missed.
-      if ((now - lastPromptRefresh) >= 750UL) {
+      if ((now - lastPromptRefresh) >= PROMPT_REFRESH_MS) {
         showHoldPowerOnPrompt();
         lastPromptRefresh = now;
       }
-      
-      if ((now - pressStart) >= LONG_PRESS_MS) {
-        return true;  // Successfully powered on
+      waitMs = PROMPT_REFRESH_MS - (now - lastPromptRefresh);
+    } else {
+      // Check for timeout (10 seconds of no button activity)
+      if ((now - lastActivity) >= DISPLAY_TIMEOUT_MS) {
+        displayPanelOff();
+        return false;  // Timed out - caller should go to sleep
       }
+      waitMs = DISPLAY_TIMEOUT_MS - (now - lastActivity);
     }
-    // Button released
-    else if (!pressed && wasPressed) {
-      wasPressed = false;
+    // Wake for the next edge, or when the debouncer has a long press or
+    // lock-out end due
+    uint32_t deadline;
+    if (powerButton.nextDeadline(&deadline)) {
+      int32_t untilMs = (int32_t)(deadline - (uint32_t)now);
+      unsigned long dueMs = (untilMs > 0) ? (unsigned long)untilMs : 1;
+      if (dueMs < waitMs) {
+        waitMs = dueMs;
+      }
     }
-    
-    delay(10);
+    powerButton.waitForEdge(waitMs);
   }
 }
 
 // Enter deep sleep mode with button wake-up
 void enterDeepSleep() {
+  stopUiTask();
+  saveWarmResumeSnapshot();
+  sessionLog.flush(500);
+
   // Release USB HID state before sleep
   usbReleaseAll();
 
@@ -1362,7 +3657,7 @@ void enterDeepSleep() {
       xboxGamepad->release(XBOX_BUTTON_RS);
       xboxGamepad->setLeftThumb(0, 0);
       xboxGamepad->setRightThumb(0, 0);
-      xboxGamepad->sendGamepadReport();
+      bleSendReport();
     }
     // Only touch NimBLE if BLE stack was initialized.
     if (xboxGamepad != nullptr) {
@@ -1395,23 +3690,30 @@ void enterDeepSleep() {
   pinMode(I2C_SDA_PIN, INPUT);
   pinMode(I2C_SCL_PIN, INPUT);
 
+  stopLtr390Interrupt();
+
   // Set GBA link pins to high-impedance
   if (GBA_LINK_ENABLED) {
+    gbaLinkTimer.end();
     pinMode(GBA_PIN_SC, INPUT);
     pinMode(GBA_PIN_SD, INPUT);
     pinMode(GBA_PIN_SO, INPUT);
   }
 
-  // Set battery sense pin to INPUT (disable ADC pull)
+  // Release the ADC and set battery sense pin to INPUT (disable ADC pull)
   if (BATTERY_SENSE_ENABLED) {
+    if (!batteryMonitor.end() && serialEnabled) {
+      Serial.print("Battery task did not stop within ");
+      Serial.print(BATTERY_STOP_TIMEOUT_MS);
+      Serial.println("ms, left running");
+    }
     pinMode(BAT_PIN, INPUT);
   }
   
   // Wait for button release before sleeping
-  while (digitalRead(BUTTON_PIN) == LOW) {
-    delay(10);
-  }
-  delay(50);  // Debounce
+  powerButton.waitForRelease();
+  powerButton.end();
+  secondButton.end();
   
   // Configure wake-up source: BUTTON_PIN going LOW (pressed)
   esp_sleep_enable_ext0_wakeup((gpio_num_t)BUTTON_PIN, 0);
@@ -1454,40 +3756,45 @@ bool isBluetoothIconOn() {
   if (!BLUETOOTH_ENABLED) {
     return false;
   }
-  if (bleConnected) {
+  if (ui.bleConnected) {
     return true;
   }
-  if (blePairingActive) {
-    return bleIconFlashOn;
+  if (ui.blePairingActive) {
+    return ui.bleIconFlashOn;
   }
   return false;
 }
 
-void drawBluetoothIcon(int x, int y, bool on) {
+// Icons take the target so the retained UI can rasterize them into sprites
+void drawBluetoothIcon(Adafruit_GFX& gfx, int x, int y, bool on) {
   if (!on) {
     return;
   }
 
-  display.drawLine(x + 3, y, x + 3, y + (STATUS_BT_ICON_H - 1), DISPLAY_WHITE);
-  display.drawLine(x + 3, y, x + 7, y + 2, DISPLAY_WHITE);
-  display.drawLine(x + 3, y + 4, x + 7, y + 2, DISPLAY_WHITE);
-  display.drawLine(x + 3, y + 4, x + 7, y + 6, DISPLAY_WHITE);
-  display.drawLine(x + 3, y + (STATUS_BT_ICON_H - 1), x + 7, y + 6, DISPLAY_WHITE);
-  display.drawLine(x + 3, y + 4, x, y + 2, DISPLAY_WHITE);
-  display.drawLine(x + 3, y + 4, x, y + 6, DISPLAY_WHITE);
+  gfx.drawLine(x + 3, y, x + 3, y + (STATUS_BT_ICON_H - 1), DISPLAY_WHITE);
+  gfx.drawLine(x + 3, y, x + 7, y + 2, DISPLAY_WHITE);
+  gfx.drawLine(x + 3, y + 4, x + 7, y + 2, DISPLAY_WHITE);
+  gfx.drawLine(x + 3, y + 4, x + 7, y + 6, DISPLAY_WHITE);
+  gfx.drawLine(x + 3, y + (STATUS_BT_ICON_H - 1), x + 7, y + 6, DISPLAY_WHITE);
+  gfx.drawLine(x + 3, y + 4, x, y + 2, DISPLAY_WHITE);
+  gfx.drawLine(x + 3, y + 4, x, y + 6, DISPLAY_WHITE);
 }
 
-void drawBatteryGauge(int x, int y, int pct) {
+void drawBatteryGauge(Adafruit_GFX& gfx, int x, int y, int pct) {
   int16_t bodyW = STATUS_BATT_ICON_W - 2;
-  display.drawRect(x, y, bodyW, STATUS_BATT_ICON_H, DISPLAY_WHITE); // Main body
-  display.fillRect(x + bodyW, y + 2, 2, STATUS_BATT_ICON_H - 4, DISPLAY_WHITE); // Tip
+  gfx.drawRect(x, y, bodyW, STATUS_BATT_ICON_H, DISPLAY_WHITE); // Main body
+  gfx.fillRect(x + bodyW, y + 2, 2, STATUS_BATT_ICON_H - 4, DISPLAY_WHITE); // Tip
+
+  gfx.fillRect(x + 2, y + 2, getBatteryGaugeFillW(pct), STATUS_BATT_ICON_H - 4, DISPLAY_WHITE);
+}
 
-  int fillW = (pct * (bodyW - 4)) / 100;
-  display.fillRect(x + 2, y + 2, fillW, STATUS_BATT_ICON_H - 4, DISPLAY_WHITE);
+int getBatteryGaugeFillW(int pct) {
+  int16_t bodyW = STATUS_BATT_ICON_W - 2;
+  return (pct * (bodyW - 4)) / 100;
 }
 
 void drawStatusIcons() {
-  bool batteryVisible = (cachedBatteryPct >= 0);
+  bool batteryVisible = (ui.batteryPct >= 0);
   bool btReserved = BLUETOOTH_ENABLED;
   bool btOn = isBluetoothIconOn();
 
@@ -1498,7 +3805,7 @@ void drawStatusIcons() {
 
   if (batteryVisible) {
     char pctText[6];
-    snprintf(pctText, sizeof(pctText), "%d%%", cachedBatteryPct);
+    snprintf(pctText, sizeof(pctText), "%d%%", ui.batteryPct);
     int16_t x1, y1;
     uint16_t w, h;
     display.setTextSize(1);
@@ -1507,7 +3814,7 @@ void drawStatusIcons() {
     int16_t textY = batteryY + ((STATUS_BATT_ICON_H - (int16_t)h) / 2);
     display.setCursor(textX, textY);
     display.print(pctText);
-    drawBatteryGauge(batteryX, batteryY, cachedBatteryPct);
+    drawBatteryGauge(display, batteryX, batteryY, ui.batteryPct);
   }
 
   if (btReserved) {
@@ -1517,7 +3824,7 @@ void drawStatusIcons() {
     } else {
       drawX = SCREEN_WIDTH - STATUS_BT_ICON_W - STATUS_RIGHT_MARGIN;
     }
-    drawBluetoothIcon(drawX, btY, btOn);
+    drawBluetoothIcon(display, drawX, btY, btOn);
   }
 }
 
@@ -1586,96 +3893,52 @@ void startBlePairing() {
   startBleAdvertising();
 }
 
+// BLE has no completion status; trace how long the stack took to take the report
+void bleSendReport() {
+  uint32_t startUs = micros();
+  xboxGamepad->sendGamepadReport();
+  traceEvent(TRACE_BLE_REPORT, 0, traceSaturate16(micros() - startUs));
+}
+
 void resetBlePressState() {
   if (!BLUETOOTH_ENABLED) {
     return;
   }
-  if (xboxGamepad != nullptr && blePressHolding && bleActiveButton != 0) {
+  bool holding = bleMeter.pressHolding();
+  if (xboxGamepad != nullptr && holding && bleActiveButton != 0) {
     xboxGamepad->release(bleActiveButton);
-    xboxGamepad->sendGamepadReport();
+    bleSendReport();
   }
-  if (blePressHolding && bleActiveButton != 0) {
+  if (holding && bleActiveButton != 0) {
     usbGamepadRelease(bleActiveButton);
-    usbSendReport();
+    usbSendEdgeReport();
+    traceEvent(TRACE_HID_RELEASE, getHidTraceTransports(), bleActiveButton);
   }
-  blePressHolding = false;
   bleActiveButton = 0;
-  blePressDirection = 0;
-  blePressStartMs = 0;
-  bleLastPressMs = 0;
-}
-
-void clearBleSyncPhase() {
-  bleSyncPhase = BLE_SYNC_NONE;
-  bleSyncRemaining = 0;
-  bleRefillRemaining = 0;
-  bleSyncDirection = 0;
-  bleRefillDirection = 0;
+  bleMeter.cancelPress();
 }
 
 void resetBleSyncState() {
   if (!BLUETOOTH_ENABLED) {
     return;
   }
-  clearBleSyncPhase();
-  bleSyncTargetSteps = 0;
-  bleSyncStepsMax = 0;
-  bleEstimateValid = false;
-}
-
-int getBleMeterStepsForGame(int game) {
-  game = clampGameIndex(game);
-  if (game == 0) {
-    if (!HID_BOKTAI1_MGBA_10_STEP_WORKAROUND) {
-      return GAME_BARS[game];
-    }
-    return BOKTAI1_STEP_COUNT;
-  }
-  return GAME_BARS[game];
+  bleMeter.reset();
 }
 
-int getBleBarFromStep(int game, int step) {
-  game = clampGameIndex(game);
-  int stepsMax = getBleMeterStepsForGame(game);
-  if (step < 0) {
-    step = 0;
-  }
-  if (step > stepsMax) {
-    step = stepsMax;
-  }
-  if (game == 0 && HID_BOKTAI1_MGBA_10_STEP_WORKAROUND) {
-    return BOKTAI1_STEP_TO_BAR[step];
-  }
-  return step;
+// Emulator step model for a game (see MeterPlanner.h)
+MeterStepModel getBleStepModel(int game) {
+  return meterStepModelForGame(clampGameIndex(game), HID_BOKTAI1_MGBA_10_STEP_WORKAROUND);
 }
 
 int getBleStepFromBar(int game, int bar, bool fromEmpty) {
-  game = clampGameIndex(game);
-  int barsMax = GAME_BARS[game];
-  if (bar < 0) {
-    bar = 0;
-  }
-  if (bar > barsMax) {
-    bar = barsMax;
-  }
-  if (game == 0 && HID_BOKTAI1_MGBA_10_STEP_WORKAROUND) {
-    return fromEmpty ? BOKTAI1_BAR_TO_STEP_FROM_EMPTY[bar] : BOKTAI1_BAR_TO_STEP_FROM_FULL[bar];
-  }
-  return bar;
-}
-
-int getBleActiveNumSteps() {
-  if (bleSyncPhase != BLE_SYNC_NONE && bleSyncStepsMax > 0) {
-    return bleSyncStepsMax;
-  }
-  return getBleMeterStepsForGame(currentGame);
+  return getBleStepModel(game).stepFromBar(bar, fromEmpty);
 }
 
 // ---------------------------------------------------------------------------
 // Single Analog mode (HID_CONTROL_MODE == 1)
 // Maps the current bar count to a proportional deflection on one analog axis.
 // The 0.0-1.0 range is divided into (numBars + 1) equal bands; we send the
-// midpoint of the band for the current bar count.
+// midpoint of the band for the current bar count (GAME_ANALOG_FRACTIONS).
 // ---------------------------------------------------------------------------
 
 void resetSingleAnalogState() {
@@ -1688,15 +3951,9 @@ void resetSingleAnalogState() {
 
 // Return the midpoint fraction for a given bar count.
 // Boktai 1 (8 bars) → 9 bands, Boktai 2 & 3 (10 bars) → 11 bands.
-float getSingleAnalogFraction(int bars, int numBars) {
-  if (numBars <= 0) {
-    return 0.0f;
-  }
-  int levels = numBars + 1;            // 0-bar band counts as a level
-  float bandWidth = 1.0f / levels;
-  float midpoint = (bars * bandWidth) + (bandWidth * 0.5f);
-  if (midpoint > 1.0f) midpoint = 1.0f;
-  return midpoint;
+float getSingleAnalogFraction(int game, int bars) {
+  game = clampGameIndex(game);
+  return GAME_ANALOG_FRACTIONS[game][constrain(bars, 0, GAME_BARS[game])];
 }
 
 // Convert a 0.0–1.0 fraction to a signed stick deflection for the chosen axis.
@@ -1745,7 +4002,7 @@ void applySingleAnalog(int bars, int numBars) {
     return;
   }
 
-  float frac = getSingleAnalogFraction(bars, numBars);
+  float frac = getSingleAnalogFraction(currentGame, bars);
   int16_t lx = 0, ly = 0, rx = 0, ry = 0;
   int16_t value = computeSingleAnalogSticks(frac, lx, ly, rx, ry);
   bool isLeft = (HID_SINGLE_ANALOG_AXIS < 4);
@@ -1758,7 +4015,7 @@ void applySingleAnalog(int bars, int numBars) {
       if (bleSingleAnalogButtonHeld) {
         // Release first, send report, then re-press with the new stick value
         xboxGamepad->release(HID_METER_UNLOCK_BUTTON);
-        xboxGamepad->sendGamepadReport();
+        bleSendReport();
       }
       xboxGamepad->press(HID_METER_UNLOCK_BUTTON);
       bleSingleAnalogButtonHeld = true;
@@ -1775,13 +4032,106 @@ void applySingleAnalog(int bars, int numBars) {
   } else {
     xboxGamepad->setRightThumb(rx, ry);
   }
-  xboxGamepad->sendGamepadReport();
+  bleSendReport();
 
   bleSingleAnalogBars = bars;
   bleSingleAnalogValue = value;
   bleSingleAnalogActive = true;
 }
 
+// ---------------------------------------------------------------------------
+// Absolute mode (HID_CONTROL_MODE == 2)
+// Sends the cartridge sensor value in the triggers plus a check byte on one
+// stick axis (see AbsoluteMeter.h), so any level change is one report.
+// ---------------------------------------------------------------------------
+
+// Sensor reading as the original cartridge would report it. The level runs
+// on Raphi's 0-140 scale across the configured UV range (AUTO_UV_MIN = 1,
+// AUTO_UV_SATURATION = 140), continues at the same slope up to 0xE8, and is
+// kept inside the band of the bar count being shown.
+uint8_t getAbsoluteCartValue(float uvi, int game, int bars) {
+  game = clampGameIndex(game);
+  int numBars = GAME_BARS[game];
+  float uvMin, uvSat;
+  getGameUvRange(game, &uvMin, &uvSat);
+  float level;
+  if (uvSat <= uvMin) {
+    level = (uvi >= uvMin) ? ABS_METER_LEVEL_FULL : 0.0f;
+  } else if (uvi < uvMin) {
+    level = 0.0f;
+  } else {
+    level = 1.0f + ((uvi - uvMin) / (uvSat - uvMin)) * (ABS_METER_LEVEL_FULL - 1);
+  }
+  if (level > ABS_METER_LEVEL_MAX) {
+    level = ABS_METER_LEVEL_MAX;
+  }
+  uint8_t clamped = absMeterClampLevelToBars((uint8_t)level, (uint8_t)constrain(bars, 0, numBars),
+                                             (uint8_t)numBars);
+  return (uint8_t)(ABS_METER_CART_DARK - clamped);
+}
+
+// BLE triggers are 10-bit; scale so round(value / 1023 * 255) is the byte
+uint16_t absoluteTriggerToBle(uint8_t value) {
+  return (uint16_t)(((uint32_t)value * XBOX_TRIGGER_MAX + 127) / 255);
+}
+
+// Check byte goes on the HID_SINGLE_ANALOG_AXIS stick axis; the sign half
+// of the axis setting is ignored since the raw 16-bit value is what counts.
+void getAbsoluteSticks(int16_t axisValue, int16_t& lx, int16_t& ly, int16_t& rx, int16_t& ry) {
+  uint8_t axis = HID_SINGLE_ANALOG_AXIS;
+  bool isLeft = (axis < 4);
+  bool isX    = (axis % 4) < 2;
+  lx = 0; ly = 0; rx = 0; ry = 0;
+  if (isLeft) {
+    if (isX) lx = axisValue; else ly = axisValue;
+  } else {
+    if (isX) rx = axisValue; else ry = axisValue;
+  }
+}
+
+void resetAbsoluteState() {
+  bleAbsoluteCartValue = -1;
+  bleAbsoluteBars = -1;
+}
+
+void applyAbsoluteMeter(uint8_t cartValue, int bars, int numBars) {
+  if (!BLUETOOTH_ENABLED || xboxGamepad == nullptr || numBars <= 0) {
+    return;
+  }
+  bars = constrain(bars, 0, numBars);
+  if (cartValue == bleAbsoluteCartValue && bars == bleAbsoluteBars) {
+    return;
+  }
+
+  AbsMeterReport report = absMeterEncode(cartValue, (uint8_t)bars, (uint8_t)numBars);
+  int16_t lx = 0, ly = 0, rx = 0, ry = 0;
+  getAbsoluteSticks(report.axis, lx, ly, rx, ry);
+  xboxGamepad->setTriggers(absoluteTriggerToBle(report.triggerLeft),
+                           absoluteTriggerToBle(report.triggerRight));
+  if (HID_SINGLE_ANALOG_AXIS < 4) {
+    xboxGamepad->setLeftThumb(lx, ly);
+  } else {
+    xboxGamepad->setRightThumb(rx, ry);
+  }
+  bleSendReport();
+
+  bleAbsoluteCartValue = cartValue;
+  bleAbsoluteBars = bars;
+}
+
+void releaseAbsoluteMeter() {
+  if (BLUETOOTH_ENABLED && xboxGamepad != nullptr && bleAbsoluteCartValue >= 0) {
+    xboxGamepad->setTriggers(0, 0);
+    if (HID_SINGLE_ANALOG_AXIS < 4) {
+      xboxGamepad->setLeftThumb(0, 0);
+    } else {
+      xboxGamepad->setRightThumb(0, 0);
+    }
+    bleSendReport();
+  }
+  resetAbsoluteState();
+}
+
 void releaseSingleAnalog() {
   if (!BLUETOOTH_ENABLED || xboxGamepad == nullptr) {
     resetSingleAnalogState();
@@ -1807,7 +4157,7 @@ void releaseSingleAnalog() {
   }
 
   if (changed) {
-    xboxGamepad->sendGamepadReport();
+    bleSendReport();
   }
 
   resetSingleAnalogState();
@@ -1832,36 +4182,14 @@ void refreshSingleAnalogButton() {
   }
 
   xboxGamepad->release(HID_METER_UNLOCK_BUTTON);
-  xboxGamepad->sendGamepadReport();
+  bleSendReport();
   xboxGamepad->press(HID_METER_UNLOCK_BUTTON);
-  xboxGamepad->sendGamepadReport();
+  bleSendReport();
   bleSingleAnalogLastRefreshMs = now;
 }
 
-void applyBlePressEffect(int direction) {
-  if (!bleEstimateValid) {
-    return;
-  }
-  int stepsMax = getBleActiveNumSteps();
-  if (stepsMax <= 0) {
-    return;
-  }
-  if (direction > 0) {
-    bleEstimatedSteps = min(bleEstimatedSteps + 1, stepsMax);
-  } else if (direction < 0) {
-    bleEstimatedSteps = max(bleEstimatedSteps - 1, 0);
-  }
-}
-
-void finishBleSync() {
-  if (!BLUETOOTH_ENABLED) {
-    return;
-  }
-  clearBleSyncPhase();
-  bleEstimatedSteps = bleSyncTargetSteps;
-  bleEstimateValid = true;
-}
-
+// Clamp from an unknown position toward whichever end reaches the sensor
+// bar in fewer presses (full clamp plus refill).
 void startBleResync(int deviceBars, int numBars) {
   if (!BLUETOOTH_ENABLED) {
     return;
@@ -1870,23 +4198,11 @@ void startBleResync(int deviceBars, int numBars) {
     return;
   }
   resetBlePressState();
-  bleSyncPhase = BLE_SYNC_CLAMP;
-  bleSyncStepsMax = getBleMeterStepsForGame(currentGame);
-  int targetBars = constrain(deviceBars, 0, numBars);
-  int middle = numBars / 2;
-  int direction = (targetBars <= middle) ? BLE_DIR_DEC : BLE_DIR_INC;
-  bleSyncTargetSteps = getBleStepFromBar(currentGame, targetBars, direction == BLE_DIR_DEC);
-  bleSyncDirection = direction;
-  bleSyncRemaining = bleSyncStepsMax;
-  if (direction == BLE_DIR_DEC) {
-    bleRefillDirection = BLE_DIR_INC;
-    bleRefillRemaining = bleSyncTargetSteps;
-  } else {
-    bleRefillDirection = BLE_DIR_DEC;
-    bleRefillRemaining = bleSyncStepsMax - bleSyncTargetSteps;
-  }
-  bleEstimateValid = false;
-  bleLastResyncMs = millis();
+  bleMeter.startClamp(getBleStepModel(currentGame), constrain(deviceBars, 0, numBars), millis());
+}
+
+void updateMeterConvergenceStats(unsigned long now) {
+  bleMeter.updateStats(meterStats, getBleStepModel(currentGame), bleDeviceBars, now);
 }
 
 void updateBluetoothState() {
@@ -1904,15 +4220,22 @@ void updateBluetoothState() {
         resetBlePressState();
         resetBleSyncState();
         resetSingleAnalogState();
+      } else if (HID_CONTROL_MODE == 2) {
+        bleSyncPending = false;
+        resetBlePressState();
+        resetBleSyncState();
+        resetAbsoluteState();
       } else {
         bleSyncPending = true;
-        bleEstimateValid = false;
+        bleMeter.invalidate();
       }
     } else {
       resetBlePressState();
       resetBleSyncState();
       if (HID_CONTROL_MODE == 1) {
         releaseSingleAnalog();
+      } else if (HID_CONTROL_MODE == 2) {
+        releaseAbsoluteMeter();
       }
       // If a connection drops, re-enter pairing/advertising for the usual timeout.
       startBlePairing();
@@ -1938,12 +4261,26 @@ void updateUsbMeter(int bars, int numBars) {
   bool usbIncrementalNeedsRefresh = (HID_CONTROL_MODE == 0) &&
                                     (!BLUETOOTH_ENABLED || !bleConnected) &&
                                     hidGameChanged;
-  if (bars == usbMeterBars && numBars == usbMeterNumBars && !usbIncrementalNeedsRefresh) return;
+  int cartValue = (HID_CONTROL_MODE == 2) ? getAbsoluteCartValue(cachedUvi, currentGame, bars) : -1;
+  if (bars == usbMeterBars && numBars == usbMeterNumBars && cartValue == usbMeterCartValue &&
+      !usbIncrementalNeedsRefresh) return;
   usbMeterBars = bars;
   usbMeterNumBars = numBars;
+  usbMeterCartValue = cartValue;
 
-  if (HID_CONTROL_MODE == 1) {
-    float frac = getSingleAnalogFraction(bars, numBars);
+  if (HID_CONTROL_MODE == 2) {
+    AbsMeterReport report = absMeterEncode((uint8_t)cartValue, (uint8_t)bars, (uint8_t)numBars);
+    int16_t lx = 0, ly = 0, rx = 0, ry = 0;
+    getAbsoluteSticks(report.axis, lx, ly, rx, ry);
+    usbGamepadSetTriggers(report.triggerLeft, report.triggerRight);
+    if (HID_SINGLE_ANALOG_AXIS < 4) {
+      usbGamepadSetLeftStick(lx, ly);
+    } else {
+      usbGamepadSetRightStick(rx, ry);
+    }
+    usbSendReport();
+  } else if (HID_CONTROL_MODE == 1) {
+    float frac = getSingleAnalogFraction(currentGame, bars);
     int16_t lx = 0, ly = 0, rx = 0, ry = 0;
     int16_t value = computeSingleAnalogSticks(frac, lx, ly, rx, ry);
     bool isLeft = (HID_SINGLE_ANALOG_AXIS < 4);
@@ -1967,14 +4304,13 @@ void updateUsbMeter(int bars, int numBars) {
     // or currently disconnected.
     if (!BLUETOOTH_ENABLED || !bleConnected) {
       if (hidGameChanged || bleDeviceNumBars != numBars) {
-        bleEstimateValid = false;
+        bleMeter.invalidate();
         hidGameChanged = false;
       }
       bleDeviceBars = bars;
       bleDeviceNumBars = numBars;
-      if (!bleEstimateValid) {
-        bleEstimatedSteps = getBleStepFromBar(currentGame, bleDeviceBars, true);
-        bleEstimateValid = true;
+      if (!bleMeter.estimateValid()) {
+        bleMeter.setEstimate(getBleStepFromBar(currentGame, bleDeviceBars, true));
       }
     }
   }
@@ -2000,6 +4336,13 @@ void updateBluetoothMeter(int deviceBars, int numBars) {
     return;
   }
 
+  if (HID_CONTROL_MODE == 2) {
+    hidGameChanged = false;
+    applyAbsoluteMeter(getAbsoluteCartValue(cachedUvi, currentGame, bleDeviceBars),
+                       bleDeviceBars, bleDeviceNumBars);
+    return;
+  }
+
   if (bleSyncPending || hidGameChanged) {
     startBleResync(bleDeviceBars, bleDeviceNumBars);
     bleSyncPending = false;
@@ -2007,16 +4350,21 @@ void updateBluetoothMeter(int deviceBars, int numBars) {
     return;
   }
 
-  if (BLE_RESYNC_ENABLED && BLE_RESYNC_INTERVAL_MS > 0 && bleSyncPhase == BLE_SYNC_NONE) {
-    unsigned long now = millis();
-    if ((now - bleLastResyncMs) >= BLE_RESYNC_INTERVAL_MS) {
-      startBleResync(bleDeviceBars, bleDeviceNumBars);
-    }
+  // A due resync waits for the sensor bar to reach an end (anchor) and
+  // only falls back to a visible clamp+refill after BLE_RESYNC_MAX_DEFER_MS.
+  bleMeter.updateResync(getBleStepModel(currentGame), bleDeviceBars, millis());
+}
+
+// Whether handleBlePresses() will press as soon as the interval allows
+bool hasBlePressWork() {
+  if (!(BLUETOOTH_ENABLED && bleConnected) && !usbHidActive) {
+    return false;
   }
+  return bleMeter.hasWork(getBleStepModel(currentGame), bleDeviceBars);
 }
 
 void handleBlePresses() {
-  if (HID_CONTROL_MODE == 1) {
+  if (HID_CONTROL_MODE != 0) {
     return;
   }
   bool blePathActive = BLUETOOTH_ENABLED && bleConnected;
@@ -2026,109 +4374,67 @@ void handleBlePresses() {
   }
 
   unsigned long now = millis();
-
-  if (blePressHolding) {
-    if ((now - blePressStartMs) >= blePressHoldMs) {
-      if (xboxGamepad != nullptr) {
-        xboxGamepad->release(bleActiveButton);
-        xboxGamepad->sendGamepadReport();
-      }
-      usbGamepadRelease(bleActiveButton);
-      usbSendReport();
-      blePressHolding = false;
-      applyBlePressEffect(blePressDirection);
-      if (bleSyncPhase != BLE_SYNC_NONE) {
-        bleSyncRemaining--;
-        if (bleSyncRemaining <= 0) {
-          if (bleSyncPhase == BLE_SYNC_CLAMP) {
-            if (bleSyncDirection == BLE_DIR_DEC) {
-              bleEstimatedSteps = 0;
-            } else {
-              bleEstimatedSteps = bleSyncStepsMax;
-            }
-            bleEstimateValid = true;
-            bleSyncPhase = BLE_SYNC_REFILL;
-            bleSyncRemaining = bleRefillRemaining;
-            bleSyncDirection = bleRefillDirection;
-            if (bleSyncRemaining <= 0) {
-              finishBleSync();
-            }
-          } else {
-            finishBleSync();
-          }
-        }
-      }
-    }
-    return;
-  }
-
-  if (blePressIntervalMs == 0) {
-    return;
-  }
-  if ((now - bleLastPressMs) < blePressIntervalMs) {
-    return;
-  }
+  updateMeterConvergenceStats(now);
 
   int direction = 0;
-  if (bleSyncPhase != BLE_SYNC_NONE) {
-    if (bleSyncRemaining > 0) {
-      direction = bleSyncDirection;
+  MeterPressAction action = bleMeter.poll(getBleStepModel(currentGame), bleDeviceBars, now, &direction);
+  if (action == METER_PRESS_UP) {
+    if (xboxGamepad != nullptr) {
+      xboxGamepad->release(bleActiveButton);
+      bleSendReport();
     }
-  } else if (bleEstimateValid) {
-    int estimatedBars = getBleBarFromStep(currentGame, bleEstimatedSteps);
-    if (bleDeviceBars > estimatedBars) {
-      direction = BLE_DIR_INC;
-    } else if (bleDeviceBars < estimatedBars) {
-      direction = BLE_DIR_DEC;
+    usbGamepadRelease(bleActiveButton);
+    usbSendEdgeReport();
+    traceEvent(TRACE_HID_RELEASE, getHidTraceTransports(), bleActiveButton);
+  } else if (action == METER_PRESS_DOWN) {
+    bleActiveButton = (direction > 0) ? HID_BUTTON_INC : HID_BUTTON_DEC;
+    if (xboxGamepad != nullptr) {
+      xboxGamepad->press(bleActiveButton);
+      bleSendReport();
     }
+    usbGamepadPress(bleActiveButton);
+    usbSendEdgeReport();
+    traceEvent(TRACE_HID_PRESS, getHidTraceTransports(), bleActiveButton);
   }
+}
 
-  if (direction == 0) {
-    return;
+uint8_t getHidTraceTransports() {
+  uint8_t transports = 0;
+  if (xboxGamepad != nullptr && bleConnected) {
+    transports |= TRACE_HID_BLE;
   }
-
-  blePressDirection = direction;
-  bleActiveButton = (direction > 0) ? HID_BUTTON_INC : HID_BUTTON_DEC;
-  blePressHolding = true;
-  blePressStartMs = now;
-  bleLastPressMs = now;
-  if (xboxGamepad != nullptr) {
-    xboxGamepad->press(bleActiveButton);
-    xboxGamepad->sendGamepadReport();
+  if (usbHidActive) {
+    transports |= TRACE_HID_USB;
   }
-  usbGamepadPress(bleActiveButton);
-  usbSendReport();
+  return transports;
 }
 
 void initHidPressTiming() {
-  if (HID_BUTTONS_PER_SECOND == 0) {
-    blePressIntervalMs = 0;
-    blePressHoldMs = 0;
-  } else {
-    blePressIntervalMs = 1000UL / HID_BUTTONS_PER_SECOND;
-    if (blePressIntervalMs == 0) {
-      blePressIntervalMs = 1;
-    }
-    blePressHoldMs = blePressIntervalMs / 2;
-    if (blePressHoldMs == 0) {
-      blePressHoldMs = 1;
-    }
-  }
+  bleMeter.setPressRate(HID_BUTTONS_PER_SECOND);
+  bleMeter.setResyncTiming(BLE_RESYNC_ENABLED ? BLE_RESYNC_INTERVAL_MS : 0, BLE_RESYNC_MAX_DEFER_MS);
 }
 
-// Calculate battery % based on analog reading
+// Pick up the battery task's latest reading; never touches the ADC
 void updateBatteryStatus() {
   if (!BATTERY_SENSE_ENABLED) {
     return;
   }
 
-  unsigned long now = millis();
-  if ((now - lastBatterySampleTime) < BATTERY_SAMPLE_MS) {
+  BatteryReading reading;
+  if (!batteryMonitor.read(&reading)) {
     return;
   }
-  lastBatterySampleTime = now;
+  cachedBatteryAdcAvg = (float)reading.adcRaw;
+  cachedBatteryVoltage = reading.batteryMv / 1000.0f;
+  hasBatteryReading = true;
+  cachedBatteryPct = getBatteryPercent(reading.batteryMv);
 
-  cachedBatteryPct = readBatteryPercentage();
+  if (serialEnabled && DEBUG_SERIAL_BATTERY && !DEBUG_SERIAL_TELEMETRY) {
+    Serial.print("Battery ADC raw: "); Serial.print(reading.adcRaw);
+    Serial.print(" Pin mV: "); Serial.print(reading.pinMv);
+    Serial.print(" Voltage: "); Serial.print(cachedBatteryVoltage);
+    Serial.print(" Pct: "); Serial.println(cachedBatteryPct);
+  }
 
   if (BLUETOOTH_ENABLED && cachedBatteryPct >= 0) {
     compositeHID.setBatteryLevel((uint8_t)cachedBatteryPct);
@@ -2149,6 +4455,7 @@ void handleLowBatteryCutoff() {
       lowBatteryStart = now;
     }
     if ((now - lowBatteryStart) >= BATTERY_CUTOFF_HOLD_MS) {
+      stopUiTask();
       display.clearDisplay();
       display.setTextSize(1);
       display.setCursor(31, 28);
@@ -2162,45 +4469,28 @@ void handleLowBatteryCutoff() {
   }
 }
 
-int readBatteryPercentage() {
-  // Read multiple samples and average for stability
-  uint32_t sum = 0;
-  for (int i = 0; i < 10; i++) {
-    sum += analogRead(BAT_PIN);
-  }
-  float raw = sum / 10.0f;
-  cachedBatteryAdcAvg = raw;
-  hasBatteryReading = true;
-  
-  // ESP32-S3 ADC: 12-bit (0-4095), default ~0-3.3V range
-  // VOLT_DIVIDER_MULT compensates for voltage divider ratio + ADC variance
-  // Calibrate in config.h if battery % is wrong at full charge
-  float voltage = (raw / 4095.0f) * 3.3f * VOLT_DIVIDER_MULT;
-  cachedBatteryVoltage = voltage;
-  
-  if (serialEnabled && DEBUG_SERIAL_BATTERY) {
-    Serial.print("Battery ADC raw: "); Serial.print(raw);
-    Serial.print(" Voltage: "); Serial.println(voltage);
-  }
-
-  float range = VOLT_MAX - VOLT_MIN;
-  if (range <= 0.0f) {
-    return 0;  // Guard: VOLT_MAX must be greater than VOLT_MIN
+// Battery % from the filtered voltage under load
+int getBatteryPercent(uint32_t batteryMv) {
+  if (BATTERY_LIPO_CURVE_ENABLED) {
+    return batteryCurvePercent((int32_t)batteryMv + BATTERY_SAG_MV);
   }
-  int pct = ((voltage - VOLT_MIN) / range) * 100;
-  return constrain(pct, 0, 100);
+  return batteryLinearPercent((int32_t)batteryMv, (int32_t)lroundf(VOLT_MIN * 1000.0f),
+                              (int32_t)lroundf(VOLT_MAX * 1000.0f));
 }
 
-bool initLTR390() {
+bool initLTR390(int sensor) {
   const int maxAttempts = 3;
 
   for (int attempt = 0; attempt < maxAttempts; attempt++) {
-    if (ltr.begin()) {
+    selectUvSensor(sensor);
+    if (uvSensors[sensor].ltr.begin(uvSensors[sensor].wire)) {
       return true;
     }
 
     if (serialEnabled) {
-      Serial.print("LTR390 init failed (");
+      Serial.print("LTR390 ");
+      Serial.print(sensor);
+      Serial.print(" init failed (");
       Serial.print(attempt + 1);
       Serial.println(")");
     }
@@ -2211,18 +4501,29 @@ bool initLTR390() {
   return false;
 }
 
+float getUvDivisor() {
+  return (uvDivisor > 0.0f) ? uvDivisor : UV_SENSITIVITY_COUNTS_PER_UVI;
+}
+
+float rawToMeasuredUvi(uint32_t rawUVS) {
+  return barMeasuredUvi(rawUVS, getUvDivisor());
+}
+
+// UVI used for bar comparison (see UV_THRESHOLDS_CALIBRATED_OPEN_AIR)
+float rawToBarUvi(uint32_t rawUVS) {
+  return barCompareUvi(barConfig, rawUVS, getUvDivisor());
+}
+
 // Calculate UV Index from raw sensor data
-float calculateUVI() {
-  uint32_t rawUVS = ltr.readUVS();
-  float divisor = (uvDivisor > 0.0f) ? uvDivisor : UV_SENSITIVITY_COUNTS_PER_UVI;
-  float measuredUvi = (float)rawUVS / divisor;
+float calculateUVI(uint32_t rawUVS) {
+  float measuredUvi = rawToMeasuredUvi(rawUVS);
   float correctedUvi = applyEnclosureCompensation(measuredUvi);
 
   cachedRawUVS = rawUVS;
   cachedUviRaw = measuredUvi;
   
   // Debug output
-  if (serialEnabled && DEBUG_SERIAL_UV) {
+  if (serialEnabled && DEBUG_SERIAL_UV && !DEBUG_SERIAL_TELEMETRY) {
     Serial.print("UV raw: "); Serial.print(rawUVS);
     Serial.print(" UVI measured: "); Serial.print(measuredUvi, 3);
     Serial.print(" UVI corrected: "); Serial.println(correctedUvi, 3);
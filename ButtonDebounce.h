@@ -0,0 +1,214 @@
+// ButtonDebounce.h - Debounce and gesture state machine for one button
+//
+// Input is the button's raw edges, each with the time it happened (taken
+// in the GPIO interrupt, see ButtonInput.h); output is a queue of button
+// events. All durations are measured between edge timestamps, so
+// DEBOUNCE_MS and LONG_PRESS_MS mean the same thing however late loop()
+// gets around to reading the queue.
+//
+// Debounce is lock-out style: the first edge of a burst is accepted at
+// once, then the pin is ignored for debounceMs. If the pin ends up at the
+// other level when the lock-out ends, that level is accepted with the time
+// of the edge that produced it. Presses and releases are therefore seen
+// with no added delay, and contact bounce cannot produce extra presses.
+//
+// Events, in order, for one press:
+//
+//   PRESS       the button went down
+//   LONG_PRESS  held for longPressMs (time = press + longPressMs); at most
+//               once per press
+//   RELEASE     the button went up; heldMs = how long it was down
+//   TAP         after RELEASE, if held for at least debounceMs and no
+//               LONG_PRESS fired
+//   DOUBLE_TAP  after a TAP that started within doubleTapMs of the end of
+//               the previous TAP. The TAP is still sent first, so single
+//               taps are never held back waiting for a second one.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef BUTTON_DEBOUNCE_H
+#define BUTTON_DEBOUNCE_H
+
+#include <stdint.h>
+
+enum ButtonEventType : uint8_t {
+  BUTTON_EVENT_PRESS = 0,
+  BUTTON_EVENT_RELEASE,
+  BUTTON_EVENT_LONG_PRESS,
+  BUTTON_EVENT_TAP,
+  BUTTON_EVENT_DOUBLE_TAP
+};
+
+struct ButtonEvent {
+  ButtonEventType type;
+  uint32_t timeMs;   // When it happened (edge time, not when it was read)
+  uint32_t heldMs;   // RELEASE/TAP/DOUBLE_TAP: how long the button was down
+};
+
+const uint8_t BUTTON_EVENT_QUEUE = 8;  // Power of two
+
+class ButtonDebouncer {
+public:
+  void configure(uint32_t debounce, uint32_t longPress, uint32_t doubleTap) {
+    debounceMs = debounce;
+    longPressMs = longPress;
+    doubleTapMs = doubleTap;
+  }
+
+  // Start from the pin's current level without generating events. A press
+  // already in progress never counts as a tap; with ignoreHeld it cannot
+  // long-press either (it must be released first).
+  void reset(bool pressed, uint32_t nowMs, bool ignoreHeld) {
+    stable = pressed;
+    raw = pressed;
+    rawMs = nowMs;
+    locked = false;
+    pressMs = nowMs;
+    longFired = pressed && ignoreHeld;
+    tapSuppressed = pressed;
+    hasLastTap = false;
+    eventHead = 0;
+    eventTail = 0;
+    eventsLost = 0;
+  }
+
+  // One raw edge: the level the pin changed to, and when. Edges must be fed
+  // in time order; a repeated level (a bounce too short for the GPIO
+  // interrupt to see both edges) is ignored.
+  void edge(bool pressed, uint32_t timeMs) {
+    advance(timeMs);
+    if (pressed == raw) {
+      return;
+    }
+    raw = pressed;
+    rawMs = timeMs;
+    if (!locked && pressed != stable) {
+      accept(pressed, timeMs, timeMs);
+    }
+  }
+
+  // Let time pass with no edges: ends lock-outs and fires LONG_PRESS
+  void poll(uint32_t nowMs) { advance(nowMs); }
+
+  bool nextEvent(ButtonEvent* out) {
+    if (eventTail == eventHead) {
+      return false;
+    }
+    *out = events[eventTail & (BUTTON_EVENT_QUEUE - 1)];
+    eventTail++;
+    return true;
+  }
+
+  bool isPressed() const { return stable; }
+  // True while a lock-out is running or the raw level differs from the
+  // debounced one, i.e. the state may still change without a new edge
+  bool isSettling() const { return locked || raw != stable; }
+  uint32_t pressedAtMs() const { return pressMs; }
+  uint32_t eventsDropped() const { return eventsLost; }
+
+  // Earliest time poll() could produce an event, so callers can sleep until
+  // then. Returns false if only a new edge can change anything.
+  bool nextDeadline(uint32_t* outMs) const {
+    bool any = false;
+    uint32_t best = 0;
+    auto consider = [&](uint32_t t) {
+      if (!any || (int32_t)(t - best) < 0) {
+        best = t;
+        any = true;
+      }
+    };
+    if (locked) {
+      consider(lockMs + debounceMs);
+    }
+    if (stable && !longFired) {
+      consider(pressMs + longPressMs);
+    }
+    *outMs = best;
+    return any;
+  }
+
+private:
+  void advance(uint32_t nowMs) {
+    // Lock-outs that ended before now, and any long press due before them.
+    // Accepting a pending level starts a new lock-out at the end of the
+    // old one, which may itself have ended by now.
+    while (locked && (uint32_t)(nowMs - lockMs) >= debounceMs) {
+      uint32_t unlockMs = lockMs + debounceMs;
+      checkLongPress(unlockMs);
+      locked = false;
+      if (raw != stable) {
+        accept(raw, rawMs, unlockMs);
+      }
+    }
+    checkLongPress(nowMs);
+  }
+
+  void checkLongPress(uint32_t nowMs) {
+    if (stable && !longFired && (uint32_t)(nowMs - pressMs) >= longPressMs) {
+      longFired = true;
+      push(BUTTON_EVENT_LONG_PRESS, pressMs + longPressMs, longPressMs);
+    }
+  }
+
+  // eventMs: when the level was reached; lockStartMs: when the lock-out starts
+  void accept(bool pressed, uint32_t eventMs, uint32_t lockStartMs) {
+    stable = pressed;
+    locked = true;
+    lockMs = lockStartMs;
+    if (pressed) {
+      pressMs = eventMs;
+      longFired = false;
+      tapSuppressed = false;
+      push(BUTTON_EVENT_PRESS, eventMs, 0);
+      return;
+    }
+    uint32_t held = eventMs - pressMs;
+    push(BUTTON_EVENT_RELEASE, eventMs, held);
+    if (longFired || tapSuppressed || held < debounceMs) {
+      hasLastTap = false;
+      return;
+    }
+    push(BUTTON_EVENT_TAP, eventMs, held);
+    if (hasLastTap && (uint32_t)(pressMs - lastTapMs) <= doubleTapMs) {
+      push(BUTTON_EVENT_DOUBLE_TAP, eventMs, held);
+      hasLastTap = false;
+    } else {
+      hasLastTap = true;
+      lastTapMs = eventMs;
+    }
+  }
+
+  void push(ButtonEventType type, uint32_t timeMs, uint32_t heldMs) {
+    if ((uint8_t)(eventHead - eventTail) >= BUTTON_EVENT_QUEUE) {
+      eventsLost++;
+      return;
+    }
+    ButtonEvent& event = events[eventHead & (BUTTON_EVENT_QUEUE - 1)];
+    event.type = type;
+    event.timeMs = timeMs;
+    event.heldMs = heldMs;
+    eventHead++;
+  }
+
+  uint32_t debounceMs = 50;
+  uint32_t longPressMs = 2000;
+  uint32_t doubleTapMs = 300;
+
+  bool stable = false;       // Debounced level (true = pressed)
+  bool raw = false;          // Level after the latest edge
+  uint32_t rawMs = 0;        // Time of the latest edge
+  bool locked = false;
+  uint32_t lockMs = 0;
+  uint32_t pressMs = 0;
+  bool longFired = false;
+  bool tapSuppressed = false;
+  bool hasLastTap = false;
+  uint32_t lastTapMs = 0;
+
+  ButtonEvent events[BUTTON_EVENT_QUEUE];
+  uint8_t eventHead = 0;
+  uint8_t eventTail = 0;
+  uint32_t eventsLost = 0;
+};
+
+#endif // BUTTON_DEBOUNCE_H
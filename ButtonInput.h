@@ -0,0 +1,198 @@
+// ButtonInput.h - Interrupt-driven button edges feeding ButtonDebounce.h
+//
+// Polling digitalRead() from loop() misses or delays short taps whenever a
+// pass runs long (display flush, BLE call), and measures press length in
+// loop() time. Here a GPIO interrupt on both edges reads the pin and stamps
+// the edge with the time, and pushes it into a small lock-free ring. loop()
+// drains the ring into the debouncer, which produces PRESS / RELEASE /
+// LONG_PRESS / TAP / DOUBLE_TAP events from the edge times.
+//
+// The interrupt also wakes anything blocked in waitForEdge(), so the
+// power-on prompt and the pre-sleep release wait sleep instead of spinning,
+// and notifies the wake task (loop(), see PowerManager.h) if one is set.
+// Edge interrupts cannot end light sleep, so enableSleepWake() switches the
+// pin to a level interrupt on the level it is not at, flipped after every
+// edge; the ring sees the same edges either way.
+// If the edge ring ever overflows (a very long stall during heavy bounce),
+// the debouncer is resynced to the pin's level.
+#ifndef BUTTON_INPUT_H
+#define BUTTON_INPUT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "freertos/semphr.h"
+#include "driver/gpio.h"
+#include "esp_timer.h"
+#include "soc/gpio_reg.h"
+#include "ButtonDebounce.h"
+
+const uint8_t BUTTON_EDGE_QUEUE = 16;  // Power of two
+
+class ButtonInput {
+public:
+  bool begin(int buttonPin, uint32_t debounceMs, uint32_t longPressMs, uint32_t doubleTapMs) {
+    pin = buttonPin;
+    if (pin < 0) {
+      return false;
+    }
+    if (edgeSignal == nullptr) {
+      edgeSignal = xSemaphoreCreateBinary();
+    }
+    pinMode(pin, INPUT_PULLUP);
+    debouncer.configure(debounceMs, longPressMs, doubleTapMs);
+    resync(millis(), false);
+    attachInterruptArg(digitalPinToInterrupt(pin), onEdge, this, CHANGE);
+    attached = true;
+    return true;
+  }
+
+  // Before deep sleep: the pin is handed to the RTC wake logic
+  void end() {
+    if (attached) {
+      detachInterrupt(digitalPinToInterrupt(pin));
+      if (levelMode) {
+        gpio_wakeup_disable((gpio_num_t)pin);
+        levelMode = false;
+      }
+      attached = false;
+    }
+  }
+
+  // Task to notify on every edge (nullptr for none)
+  void setWakeTask(TaskHandle_t task) { wakeTask = task; }
+
+  // Re-attach as a wakeup-enabled level interrupt (automatic light sleep)
+  void enableSleepWake() {
+    if (!attached || levelMode) {
+      return;
+    }
+    detachInterrupt(digitalPinToInterrupt(pin));
+    levelMode = true;
+    attachInterruptArg(digitalPinToInterrupt(pin), onEdge, this, readPin() ? ONHIGH_WE : ONLOW_WE);
+  }
+
+  // Drop queued edges and events and take the pin's current level as the
+  // starting state. A press in progress never counts as a tap; with
+  // ignoreHeld it cannot long-press either.
+  void resync(uint32_t nowMs, bool ignoreHeld) {
+    edgeTail.store(edgeHead.load(std::memory_order_acquire), std::memory_order_relaxed);
+    overflowed = false;
+    debouncer.reset(readPin(), nowMs, ignoreHeld);
+  }
+
+  // Feed queued edges to the debouncer and advance it to nowMs
+  void poll(uint32_t nowMs) {
+    if (pin < 0) {
+      return;
+    }
+    uint32_t tail = edgeTail.load(std::memory_order_relaxed);
+    uint32_t head = edgeHead.load(std::memory_order_acquire);
+    while (tail != head) {
+      const Edge& e = edges[tail & (BUTTON_EDGE_QUEUE - 1)];
+      debouncer.edge(e.pressed, e.timeMs);
+      tail++;
+    }
+    edgeTail.store(tail, std::memory_order_release);
+    if (overflowed) {
+      overflowed = false;
+      debouncer.edge(readPin(), nowMs);
+    }
+    debouncer.poll(nowMs);
+  }
+
+  bool nextEvent(ButtonEvent* out) { return debouncer.nextEvent(out); }
+
+  bool isPressed() const { return debouncer.isPressed(); }
+  bool isSettling() const { return debouncer.isSettling(); }
+  bool nextDeadline(uint32_t* outMs) const { return debouncer.nextDeadline(outMs); }
+  bool pinPressed() const { return readPin(); }
+
+  // Block until the next edge interrupt or timeoutMs, whichever is first
+  void waitForEdge(uint32_t timeoutMs) {
+    if (edgeSignal == nullptr) {
+      delay(timeoutMs);
+      return;
+    }
+    if (edgeTail.load(std::memory_order_relaxed) != edgeHead.load(std::memory_order_acquire)) {
+      return;
+    }
+    xSemaphoreTake(edgeSignal, pdMS_TO_TICKS(timeoutMs) + 1);
+  }
+
+  // Block until the button is released and settled (before sleeping, so the
+  // release does not immediately wake the device again)
+  void waitForRelease() {
+    for (;;) {
+      uint32_t now = millis();
+      poll(now);
+      ButtonEvent ignored;
+      while (nextEvent(&ignored)) {
+      }
+      if (!isPressed() && !isSettling() && !readPin()) {
+        return;
+      }
+      uint32_t deadline;
+      uint32_t waitMs = 100;
+      if (nextDeadline(&deadline) && (int32_t)(deadline - now) < (int32_t)waitMs) {
+        waitMs = ((int32_t)(deadline - now) > 0) ? (deadline - now) : 1;
+      }
+      waitForEdge(waitMs);
+    }
+  }
+
+  uint32_t edgesDropped() const { return edgesLost; }
+
+private:
+  struct Edge {
+    uint32_t timeMs;
+    bool pressed;
+  };
+
+  bool IRAM_ATTR readPin() const {
+    uint32_t bits = (pin < 32) ? REG_READ(GPIO_IN_REG) : REG_READ(GPIO_IN1_REG);
+    return ((bits >> (pin & 31)) & 1) == 0;  // Active LOW
+  }
+
+  static void IRAM_ATTR onEdge(void* arg) {
+    ButtonInput* self = static_cast<ButtonInput*>(arg);
+    uint32_t timeMs = (uint32_t)(esp_timer_get_time() / 1000);  // Same clock as millis()
+    bool pressed = self->readPin();
+    uint32_t head = self->edgeHead.load(std::memory_order_relaxed);
+    if (head - self->edgeTail.load(std::memory_order_acquire) >= BUTTON_EDGE_QUEUE) {
+      self->overflowed = true;
+      self->edgesLost++;
+    } else {
+      Edge& e = self->edges[head & (BUTTON_EDGE_QUEUE - 1)];
+      e.timeMs = timeMs;
+      e.pressed = pressed;
+      self->edgeHead.store(head + 1, std::memory_order_release);
+    }
+    if (self->levelMode) {
+      // Wait for the other level (type 5 = high, 4 = low); if the pin has
+      // already moved, this fires again at once and queues that edge too
+      REG_SET_FIELD(GPIO_PIN0_REG + (self->pin * 4), GPIO_PIN0_INT_TYPE, pressed ? 5 : 4);
+    }
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(self->edgeSignal, &woken);
+    if (self->wakeTask != nullptr) {
+      vTaskNotifyGiveFromISR(self->wakeTask, &woken);
+    }
+    if (woken == pdTRUE) {
+      portYIELD_FROM_ISR();
+    }
+  }
+
+  int pin = -1;
+  bool attached = false;
+  volatile bool levelMode = false;
+  ButtonDebouncer debouncer;
+  Edge edges[BUTTON_EDGE_QUEUE];
+  std::atomic<uint32_t> edgeHead{0};
+  std::atomic<uint32_t> edgeTail{0};
+  volatile bool overflowed = false;
+  volatile uint32_t edgesLost = 0;
+  SemaphoreHandle_t edgeSignal = nullptr;
+  TaskHandle_t wakeTask = nullptr;
+};
+
+#endif // BUTTON_INPUT_H
@@ -0,0 +1,107 @@
+// DeadlineScheduler.h - Next due time across loop() subsystems
+//
+// Each subsystem keeps its own millis() comparison (battery period, BLE
+// icon flash, HID press timing, sensor poll, GBA phase...), so loop() used
+// to spin with delay(1) to give all of them a chance. Instead, after each
+// pass every subsystem posts the time it next needs loop() to run, and the
+// scheduler picks the earliest one. loop() then blocks until that time or
+// until an interrupt (button edge, sensor INT, battery result) wakes it,
+// which lets the CPU drop its clock or enter light sleep in between.
+//
+// Deadlines are millis() values compared relative to the current time, so
+// they are wrap-safe as long as nothing is scheduled more than ~24 days
+// ahead. Ties go to the lower source index. A deadline already in the past
+// means "run again now".
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef DEADLINE_SCHEDULER_H
+#define DEADLINE_SCHEDULER_H
+
+#include <stdint.h>
+
+enum WakeSource : uint8_t {
+  WAKE_BUTTONS = 0,   // Debounce lock-out / long-press timing
+  WAKE_SENSOR,        // LTR390 poll window or INT safety timeout
+  WAKE_BLE,           // Pairing icon flash and pairing timeout
+  WAKE_HID,           // Press/release timing, unlock refresh, queued reports
+  WAKE_BATTERY,       // Low-battery cutoff hold
+  WAKE_GBA_LINK,      // Next phase edge (polled output only)
+  WAKE_DISPLAY,       // UI frame when rendering runs in loop()
+  WAKE_SERIAL,        // Serial commands and telemetry in CDC mode
+  WAKE_STATS,         // End of the stats window
+  WAKE_SOURCE_COUNT,
+  WAKE_INTERRUPT = WAKE_SOURCE_COUNT,   // Woken before the deadline
+  WAKE_TIMEOUT                          // Nothing due before the wait cap
+};
+
+// Short labels (4 chars max), as in LoopProfiler.h
+static const char* const WAKE_SOURCE_NAMES[WAKE_TIMEOUT + 1] = {
+  "btn", "uv", "ble", "hid", "bat", "gba", "disp", "ser", "stat", "irq", "cap"
+};
+
+class DeadlineScheduler {
+public:
+  // Forget all deadlines (at the start of each planning pass)
+  void clear() { pending = 0; }
+
+  // Run `source` at dueMs; an earlier deadline for the same source wins
+  void at(WakeSource source, uint32_t dueMs) {
+    uint32_t bit = 1UL << source;
+    if ((pending & bit) == 0 || (int32_t)(dueMs - due[source]) < 0) {
+      due[source] = dueMs;
+      pending |= bit;
+    }
+  }
+
+  void after(WakeSource source, uint32_t nowMs, uint32_t delayMs) { at(source, nowMs + delayMs); }
+
+  bool has(WakeSource source) const { return (pending & (1UL << source)) != 0; }
+
+  // Earliest deadline. Returns false when nothing is scheduled.
+  bool next(uint32_t nowMs, uint32_t* dueMs, WakeSource* source) const {
+    bool found = false;
+    int32_t best = 0;
+    for (uint8_t i = 0; i < WAKE_SOURCE_COUNT; i++) {
+      if ((pending & (1UL << i)) == 0) {
+        continue;
+      }
+      int32_t ahead = (int32_t)(due[i] - nowMs);
+      if (!found || ahead < best) {
+        best = ahead;
+        found = true;
+        *dueMs = due[i];
+        *source = (WakeSource)i;
+      }
+    }
+    return found;
+  }
+
+  // How long the caller may block: 0 if something is due, at most maxMs.
+  // *source is the deadline that ends the wait (WAKE_TIMEOUT for the cap).
+  uint32_t waitMs(uint32_t nowMs, uint32_t maxMs, WakeSource* source) const {
+    uint32_t dueMs = 0;
+    WakeSource first = WAKE_TIMEOUT;
+    if (!next(nowMs, &dueMs, &first)) {
+      *source = WAKE_TIMEOUT;
+      return maxMs;
+    }
+    int32_t ahead = (int32_t)(dueMs - nowMs);
+    if (ahead <= 0) {
+      *source = first;
+      return 0;
+    }
+    if ((uint32_t)ahead > maxMs) {
+      *source = WAKE_TIMEOUT;
+      return maxMs;
+    }
+    *source = first;
+    return (uint32_t)ahead;
+  }
+
+private:
+  uint32_t due[WAKE_SOURCE_COUNT] = {};
+  uint32_t pending = 0;
+};
+
+#endif // DEADLINE_SCHEDULER_H
@@ -0,0 +1,211 @@
+// FirmwareConfig.h - config.h as the header config structs
+//
+// The sensor range table and the builders that turn config.h into the
+// config structs of BarThresholds.h, UvFilter.h, UvBarPipeline.h,
+// SessionLogReplay.h, AlsAssist.h, UvFusion.h and UvAutoRange.h. The
+// sketch configures itself from these, and the host tests and tools
+// include the same header, so both always see the same settings.
+//
+// UV_RANGE_MODES holds LTR390 register codes (gain and resolution fields of
+// GAIN and MEAS_RATE), which are also the values of the Adafruit library's
+// ltr390_gain_t / ltr390_resolution_t; the sketch checks that they agree.
+// The counts-per-UVI divisor of each range is derived from its entry.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef FIRMWARE_CONFIG_H
+#define FIRMWARE_CONFIG_H
+
+#include <stdint.h>
+#include <math.h>
+#include "config.h"
+#include "BarThresholds.h"
+#include "UvFilter.h"
+#include "UvBarPipeline.h"
+#include "SessionLogReplay.h"
+#include "AlsAssist.h"
+#include "UvFusion.h"
+#include "UvAutoRange.h"
+
+// LTR390 GAIN register codes
+static const uint8_t LTR390_GAIN_CODE_1 = 0;
+static const uint8_t LTR390_GAIN_CODE_3 = 1;
+static const uint8_t LTR390_GAIN_CODE_6 = 2;
+static const uint8_t LTR390_GAIN_CODE_9 = 3;
+static const uint8_t LTR390_GAIN_CODE_18 = 4;
+
+// LTR390 MEAS_RATE resolution codes (bits 6:4)
+static const uint8_t LTR390_RES_CODE_20BIT = 0;
+static const uint8_t LTR390_RES_CODE_19BIT = 1;
+static const uint8_t LTR390_RES_CODE_18BIT = 2;
+static const uint8_t LTR390_RES_CODE_17BIT = 3;
+static const uint8_t LTR390_RES_CODE_16BIT = 4;
+static const uint8_t LTR390_RES_CODE_13BIT = 5;
+
+// LTR390 MEAS_RATE rate codes (bits 2:0)
+static const uint8_t MEAS_RATE_100MS = 0x02;
+static const uint8_t MEAS_RATE_500MS = 0x04;
+
+// Skip polling until this share of the measurement period has elapsed
+static const unsigned long LTR390_POLL_START_PCT = 90;
+
+// UV Index calculation per LTR-390UV datasheet (DS86-2015-0004)
+// Reference: 2300 counts/UVI at 18x gain, 400ms (20-bit) integration
+// Formula: UVI = raw * (18/gain) * (400/int_time) / 2300
+//
+// For 18x gain, 20-bit (400ms):
+//   UVI = raw / 2300
+static const float UV_SENSITIVITY_COUNTS_PER_UVI = 2300.0f;
+static const float UV_REFERENCE_GAIN = 18.0f;
+static const float UV_REFERENCE_INT_MS = 400.0f;
+
+// Sensor ranging modes (see UV_AUTORANGE_ENABLED). Mode 0 is the datasheet
+// reference setting used at boot and whenever auto-ranging is off.
+struct UvRangeMode {
+  uint8_t gain;         // LTR390_GAIN_CODE_*
+  uint8_t resolution;   // LTR390_RES_CODE_*
+  uint8_t measRate;     // MEAS_RATE_*
+  const char* label;
+};
+static const UvRangeMode UV_RANGE_MODES[] = {
+  { LTR390_GAIN_CODE_18, LTR390_RES_CODE_20BIT, MEAS_RATE_500MS, "20b/500ms" },  // Shade
+  { LTR390_GAIN_CODE_18, LTR390_RES_CODE_18BIT, MEAS_RATE_100MS, "18b/100ms" },  // Bright
+};
+static const int UV_RANGE_SLOW = 0;
+static const int UV_RANGE_FAST = 1;
+static_assert((int)(sizeof(UV_RANGE_MODES) / sizeof(UV_RANGE_MODES[0])) == UV_RANGE_FAST + 1,
+              "UV_RANGE_MODES needs one entry per range");
+static_assert(UvAutoRange::SLOW == UV_RANGE_SLOW && UvAutoRange::FAST == UV_RANGE_FAST,
+              "UvAutoRange.h range indexes must match UV_RANGE_MODES");
+
+inline float gainToFactor(uint8_t gain) {
+  switch (gain) {
+    case LTR390_GAIN_CODE_1: return 1.0f;
+    case LTR390_GAIN_CODE_3: return 3.0f;
+    case LTR390_GAIN_CODE_6: return 6.0f;
+    case LTR390_GAIN_CODE_9: return 9.0f;
+    case LTR390_GAIN_CODE_18: return 18.0f;
+    default: return 1.0f;
+  }
+}
+
+inline float resolutionToIntegrationMs(uint8_t res) {
+  switch (res) {
+    case LTR390_RES_CODE_20BIT: return 400.0f;
+    case LTR390_RES_CODE_19BIT: return 200.0f;
+    case LTR390_RES_CODE_18BIT: return 100.0f;
+    case LTR390_RES_CODE_17BIT: return 50.0f;
+    case LTR390_RES_CODE_16BIT: return 25.0f;
+    case LTR390_RES_CODE_13BIT: return 12.5f;
+    default: return 100.0f;
+  }
+}
+
+inline unsigned long measRateToMs(uint8_t rate) {
+  static const unsigned long RATE_MS[8] = { 25, 50, 100, 200, 500, 1000, 2000, 2000 };
+  return RATE_MS[rate & 0x07];
+}
+
+// Counts per UVI at a gain and resolution
+inline float getUvDivisor(uint8_t gain, uint8_t res) {
+  float gainFactor = gainToFactor(gain);
+  float intMs = resolutionToIntegrationMs(res);
+  if (gainFactor <= 0.0f || intMs <= 0.0f) {
+    return UV_SENSITIVITY_COUNTS_PER_UVI;
+  }
+  return (UV_SENSITIVITY_COUNTS_PER_UVI * gainFactor * intMs) / (UV_REFERENCE_GAIN * UV_REFERENCE_INT_MS);
+}
+
+// Counts per UVI for a UV_RANGE_MODES entry (for replaying logged samples
+// taken in a mode other than the current one)
+inline float getUvDivisorForRange(int mode) {
+  mode = (mode < UV_RANGE_SLOW) ? UV_RANGE_SLOW : (mode > UV_RANGE_FAST) ? UV_RANGE_FAST : mode;
+  return getUvDivisor(UV_RANGE_MODES[mode].gain, UV_RANGE_MODES[mode].resolution);
+}
+
+inline bool isBarHysteresisActive() {
+  return BAR_HYSTERESIS_ENABLED && BAR_HYSTERESIS > 0.0f &&
+         !(AUTO_MODE && AUTO_UV_SATURATION <= AUTO_UV_MIN);
+}
+
+// Manual UV range per game, indexed like GAME_PROFILES (see GameProfiles.h)
+static const float MANUAL_UV_MIN[] = { BOKTAI_1_UV_MIN, BOKTAI_2_UV_MIN, BOKTAI_3_UV_MIN };
+static const float MANUAL_UV_SATURATION[] = { BOKTAI_1_UV_SATURATION, BOKTAI_2_UV_SATURATION, BOKTAI_3_UV_SATURATION };
+static_assert((int)(sizeof(MANUAL_UV_MIN) / sizeof(MANUAL_UV_MIN[0])) == NUM_GAMES &&
+              (int)(sizeof(MANUAL_UV_SATURATION) / sizeof(MANUAL_UV_SATURATION[0])) == NUM_GAMES,
+              "Every game in GameProfiles.h needs a manual UV range in config.h");
+
+inline BarThresholdConfig getBarThresholdConfig() {
+  BarThresholdConfig config;
+  for (int game = 0; game < NUM_GAMES; game++) {
+    config.uvMin[game] = AUTO_MODE ? AUTO_UV_MIN : MANUAL_UV_MIN[game];
+    config.uvSat[game] = AUTO_MODE ? AUTO_UV_SATURATION : MANUAL_UV_SATURATION[game];
+  }
+  config.enclosureComp = UV_ENCLOSURE_COMP_ENABLED;
+  config.transmittance = UV_ENCLOSURE_TRANSMITTANCE;
+  config.offsetUvi = UV_ENCLOSURE_UVI_OFFSET;
+  config.openAirThresholds = UV_THRESHOLDS_CALIBRATED_OPEN_AIR;
+  config.hysteresis = isBarHysteresisActive() ? BAR_HYSTERESIS : 0.0f;
+  return config;
+}
+
+inline UvFilterConfig getUvFilterConfig() {
+  UvFilterConfig config;
+  config.medianN = (uint8_t)UV_FILTER_MEDIAN_N;
+  config.adaptive = UV_FILTER_ADAPTIVE_ENABLED;
+  config.minCutoffMilliHz = (uint32_t)lroundf(UV_FILTER_MIN_CUTOFF_HZ * 1000.0f);
+  config.betaMilliHz = (uint32_t)lroundf(UV_FILTER_BETA * 1000.0f);
+  config.slopeCutoffMilliHz = (uint32_t)lroundf(UV_FILTER_SLOPE_CUTOFF_HZ * 1000.0f);
+  config.hystPermille = (uint16_t)lroundf(UV_FILTER_HYSTERESIS * 1000.0f);
+  config.slewPermille = (uint16_t)lroundf(UV_FILTER_SLEW_KEEP * 1000.0f);
+  config.slewMilliUviPerS = (int32_t)lroundf(UV_FILTER_SLEW_UVI_PER_S * 1000.0f);
+  return config;
+}
+
+// This build's smoothing and bar lookup for live samples (UvBarPipeline.h)
+inline UvBarPipelineConfig getUvBarPipelineConfig() {
+  return { getBarThresholdConfig(), UV_FILTER_PIPELINE_ENABLED, getUvFilterConfig(), UVI_SMOOTHING_ENABLED,
+           UVI_SMOOTHING_ALPHA };
+}
+
+// This build's calibration, filter and hysteresis settings for replaying
+// logged samples (SessionLogReplay.h)
+inline SessionLogReplayConfig getSessionLogReplayConfig() {
+  SessionLogReplayConfig config;
+  config.bars = getBarThresholdConfig();
+  config.rangeDivisor[UV_RANGE_SLOW] = getUvDivisorForRange(UV_RANGE_SLOW);
+  config.rangeDivisor[UV_RANGE_FAST] = getUvDivisorForRange(UV_RANGE_FAST);
+  config.filterPipeline = UV_FILTER_PIPELINE_ENABLED;
+  config.filter = getUvFilterConfig();
+  config.smoothing = UVI_SMOOTHING_ENABLED;
+  config.smoothingAlpha = UVI_SMOOTHING_ALPHA;
+  return config;
+}
+
+inline uint32_t getGbaPhaseIntervalUs() {
+  uint32_t phaseIntervalUs = (uint32_t)(GBA_LINK_FRAME_TOGGLE_MS * 1000UL);
+  if (phaseIntervalUs == 0) {
+    phaseIntervalUs = 1000;  // Guard against invalid config value
+  }
+  return phaseIntervalUs;
+}
+
+// ALS step detector settings (AlsAssist.h)
+inline AlsAssistConfig getAlsAssistConfig() {
+  return { UV_ALS_STEP_RATIO, UV_ALS_STABLE_RATIO, UV_ALS_LEARN_WEIGHT, UV_ALS_MIN_COUNTS };
+}
+
+// Sensor fusion settings (UvFusion.h) for `divisor` counts per UVI and a
+// per-sensor sample period of cycleMs
+inline UvFusionConfig getUvFusionConfig(float divisor, uint32_t cycleMs) {
+  return { UV_SENSOR_FUSE_AVERAGE, UV_SENSOR_OUTLIER_FRACTION, UV_SENSOR_OUTLIER_MIN_UVI * divisor,
+           UV_SENSOR_OUTLIER_STRIKES, cycleMs };
+}
+
+// Range switching thresholds (UvAutoRange.h)
+inline UvAutoRangeConfig getUvAutoRangeConfig() {
+  return { UV_AUTORANGE_ENABLED, UV_AUTORANGE_FAST_ABOVE_UVI, UV_AUTORANGE_SLOW_BELOW_UVI,
+           (uint32_t)UV_AUTORANGE_MIN_DWELL_MS };
+}
+
+#endif // FIRMWARE_CONFIG_H
@@ -1,6 +1,12 @@
 .gba
 .open "Clean\Boktai 2 (E).gba","Boktai 2 (E)(Hack).gba",0x08000000
 
+// protocol v2 (Gray-coded halves, one-bar steps commit on a single read after a read of the other phase):
+// armips -definelabel LINK_V2 1 <file>.asm
+.ifndef LINK_V2
+.definelabel LINK_V2,0
+.endif
+
 .org 0x080000D4 // sunlight changer
 .area 0xCC
 
@@ -16,6 +22,57 @@ beq	@@readio
 strh	r3,[r0]
 b	@@end		// skip GPIO read this cycle
 
+.if LINK_V2
+@@readio:
+lsl	r1,r1,1Ch
+lsr	r0,r1,1Ch	// keep data bits only
+ldr	r1,=0203FFF0h
+
+cmp	r0,0Fh		// no link activity: all lines pulled high
+bne	@@link
+strb	r1,[r1,3h]	// forget last committed index (F0h matches none): stored halves are stale after a gap
+b	@@sunwrite
+
+@@link:
+mov	r2,1h
+and	r2,r0		// frame phase from SC
+
+mov	r3,2h
+and	r3,r0		// SD -> bit1
+lsl	r0,r0,1Dh
+lsr	r0,r0,1Fh	// SI -> bit0 (SO arrives on SI via cable crossover)
+orr	r3,r0		// 2-bit payload pair
+
+strb	r3,[r1,r2]	// low pair at +0 (phase 0), high pair at +1 (phase 1)
+ldrb	r0,[r1]
+ldrb	r3,[r1,1h]
+lsl	r3,r3,2h
+orr	r0,r3		// 4-bit Gray code
+
+lsr	r3,r0,1h
+eor	r0,r3
+lsr	r3,r0,2h
+eor	r0,r3		// Gray code -> index
+
+lsl	r2,r2,4h
+orr	r2,r0		// this read: index, phase in bit 4
+ldrb	r3,[r1,2h]	// load last read
+strb	r2,[r1,2h]	// store this read
+eor	r3,r2		// what changed since last frame
+ldrb	r2,[r1,3h]	// load last committed index
+cmp	r3,10h		// same index, other phase?
+beq	@@commit	// yes: read twice, both halves from the last two frames
+lsr	r3,r3,4h	// 1 if the other half was read last frame, else 0
+sub	r2,r0,r2
+add	r2,r3
+add	r3,r3
+cmp	r2,r3		// other half fresh: within one bar of the committed index (a torn read of a
+bhi	@@end		// one-bar step decodes to either value); else the committed index only
+
+@@commit:
+strb	r0,[r1,3h]	// store committed index
+
+.else
 @@readio:
 lsl	r1,r1,1Ch
 lsr	r0,r1,1Ch	// keep data bits only
@@ -62,6 +119,8 @@ strb	r0,[r1,2h]	// store current index
 cmp	r0,r2		// same as last frame?
 bne	@@end		// different: skip (glitch or pending change)
 
+.endif
+
 @@sunwrite:
 add	r3,=dataarea
 ldrb	r0,[r3,r0]
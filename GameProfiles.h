@@ -0,0 +1,266 @@
+// GameProfiles.h - Per-game registry and the lookup tables generated from it
+//
+// Each supported game is described once in GAME_PROFILES below:
+//
+//   name          shown on the display
+//   numBars       bars on the game's sun gauge
+//   bounds        exclusive upper bound of each bar on the cartridge's
+//                 0-140 level scale (Raphi's sensor graph,
+//                 raphi.xyz/~raphi/boktai/sensor_graph/)
+//   patchPrefix   GBA Link Patches/Source/<prefix>*.asm, nullptr if the game
+//                 has no link patch
+//   linkLevels    level the link patch writes for each bar count received
+//   emuSteps      emulator meter steps when they differ from numBars
+//                 (mGBA gives Boktai 1 ten), 0 = one step per bar
+//   emuStepToBar  bars shown at each of those steps
+//
+// Everything else is generated at compile time into flat tables indexed by
+// game: bar start ratios of the UV range, emulator step<->bar maps, Single
+// Analog band midpoints and the link patch `dataarea` bytes. Adding a game
+// is a new GAME_PROFILES entry (plus its manual UV range in config.h); the
+// static_asserts reject a profile whose tables do not agree with each other,
+// and pin the generated tables of the original three games to the values
+// the firmware used before the registry existed. The session log tag holds
+// at most four games of up to 14 bars (SessionLogFormat.h asserts it).
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is: gameProfileFormatDataArea() prints the
+// `dcb` line each link patch carries, host/test_game_profiles checks the
+// patch sources against it, and `test_game_profiles --emit` prints the
+// dataarea block to paste into a new game's patch.
+#ifndef GAME_PROFILES_H
+#define GAME_PROFILES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include "AbsoluteMeter.h"
+
+static const int GAME_MAX_BARS = 10;         // Raise if a profile needs more
+static const int GAME_MAX_EMU_STEPS = 10;
+static const uint8_t GAME_LEVEL_FULL = ABS_METER_LEVEL_FULL;
+static const int GAME_LINK_TABLE_SIZE = 16;  // One entry per 4-bit link index
+static const int GAME_LINK_INDEX_NONE = 15;  // Link lines pulled high: no device attached
+
+struct GameProfile {
+  const char* name;
+  int numBars;
+  uint8_t bounds[GAME_MAX_BARS];
+  const char* patchPrefix;
+  uint8_t linkLevels[GAME_MAX_BARS + 1];
+  int emuSteps;
+  int emuStepToBar[GAME_MAX_EMU_STEPS + 1];
+};
+
+static constexpr GameProfile GAME_PROFILES[] = {
+  { "BOKTAI 1", 8,
+    { 1, 7, 16, 28, 44, 67, 98, 140 },
+    "b1", { 0x00, 0x04, 0x0B, 0x14, 0x1F, 0x2F, 0x4D, 0x77, 0x8C },
+    10, { 0, 1, 2, 3, 3, 4, 5, 6, 7, 7, 8 } },
+  { "BOKTAI 2", 10,
+    { 1, 6, 13, 23, 35, 50, 67, 87, 110, 140 },
+    "b2", { 0x00, 0x03, 0x09, 0x12, 0x1D, 0x2A, 0x3D, 0x4D, 0x62, 0x7D, 0x8C },
+    0, {} },
+  { "BOKTAI 3", 10,
+    { 1, 6, 13, 23, 35, 50, 67, 87, 110, 140 },
+    "b3", { 0x00, 0x03, 0x09, 0x12, 0x1D, 0x2A, 0x3D, 0x4D, 0x62, 0x7D, 0x8C },
+    0, {} },
+};
+
+static const int NUM_GAMES = (int)(sizeof(GAME_PROFILES) / sizeof(GAME_PROFILES[0]));
+
+// ---- Generated tables ----
+
+struct GameTables {
+  const char* names[NUM_GAMES];
+  int bars[NUM_GAMES];
+  float barRatios[NUM_GAMES][GAME_MAX_BARS];        // Start of each bar, 0 = UV_MIN, 1 = UV_SATURATION
+  float analogFractions[NUM_GAMES][GAME_MAX_BARS + 1];
+  int emuSteps[NUM_GAMES];
+  int emuStepToBar[NUM_GAMES][GAME_MAX_EMU_STEPS + 1];
+  int emuStepFromEmpty[NUM_GAMES][GAME_MAX_BARS + 1];  // First step showing a bar when rising
+  int emuStepFromFull[NUM_GAMES][GAME_MAX_BARS + 1];   // First step showing a bar when falling
+  uint8_t linkTables[NUM_GAMES][GAME_LINK_TABLE_SIZE];
+};
+
+static constexpr GameTables buildGameTables() {
+  GameTables t{};
+  for (int g = 0; g < NUM_GAMES; g++) {
+    const GameProfile& p = GAME_PROFILES[g];
+    t.names[g] = p.name;
+    t.bars[g] = p.numBars;
+
+    // A bar starts one level below its lower neighbour's exclusive bound
+    for (int b = 0; b < p.numBars; b++) {
+      t.barRatios[g][b] = (float)(p.bounds[b] - 1) / (float)(GAME_LEVEL_FULL - 1);
+    }
+
+    // Single Analog: (numBars + 1) equal bands, the 0-bar band included;
+    // each bar count sends the midpoint of its band
+    float bandWidth = 1.0f / (float)(p.numBars + 1);
+    for (int b = 0; b <= p.numBars; b++) {
+      float midpoint = (b * bandWidth) + (bandWidth * 0.5f);
+      t.analogFractions[g][b] = (midpoint > 1.0f) ? 1.0f : midpoint;
+    }
+
+    int steps = (p.emuSteps > 0) ? p.emuSteps : p.numBars;
+    t.emuSteps[g] = steps;
+    for (int s = 0; s <= steps; s++) {
+      t.emuStepToBar[g][s] = (p.emuSteps > 0) ? p.emuStepToBar[s] : s;
+    }
+    for (int s = steps; s >= 0; s--) {
+      t.emuStepFromEmpty[g][t.emuStepToBar[g][s]] = s;
+    }
+    for (int s = 0; s <= steps; s++) {
+      t.emuStepFromFull[g][t.emuStepToBar[g][s]] = s;
+    }
+
+    // Bar counts past the gauge read as full; no link reads as no sunlight
+    for (int i = 0; i < GAME_LINK_TABLE_SIZE; i++) {
+      t.linkTables[g][i] = (i <= p.numBars) ? p.linkLevels[i] : GAME_LEVEL_FULL;
+    }
+    t.linkTables[g][GAME_LINK_INDEX_NONE] = 0;
+  }
+  return t;
+}
+
+static constexpr GameTables GAME_TABLES = buildGameTables();
+
+static constexpr const char* const (&GAME_NAMES)[NUM_GAMES] = GAME_TABLES.names;
+static constexpr const int (&GAME_BARS)[NUM_GAMES] = GAME_TABLES.bars;
+static constexpr const float (&GAME_BAR_RATIOS)[NUM_GAMES][GAME_MAX_BARS] = GAME_TABLES.barRatios;
+static constexpr const float (&GAME_ANALOG_FRACTIONS)[NUM_GAMES][GAME_MAX_BARS + 1] = GAME_TABLES.analogFractions;
+static constexpr const int (&GAME_EMU_STEPS)[NUM_GAMES] = GAME_TABLES.emuSteps;
+static constexpr const int (&GAME_EMU_STEP_TO_BAR)[NUM_GAMES][GAME_MAX_EMU_STEPS + 1] = GAME_TABLES.emuStepToBar;
+static constexpr const int (&GAME_EMU_STEP_FROM_EMPTY)[NUM_GAMES][GAME_MAX_BARS + 1] = GAME_TABLES.emuStepFromEmpty;
+static constexpr const int (&GAME_EMU_STEP_FROM_FULL)[NUM_GAMES][GAME_MAX_BARS + 1] = GAME_TABLES.emuStepFromFull;
+static constexpr const uint8_t (&GAME_LINK_TABLES)[NUM_GAMES][GAME_LINK_TABLE_SIZE] = GAME_TABLES.linkTables;
+
+// ---- Profile checks ----
+
+static constexpr bool gameProfileValid(const GameProfile& p) {
+  if (p.numBars < 1 || p.numBars > GAME_MAX_BARS || p.numBars >= GAME_LINK_INDEX_NONE) return false;
+  if (p.bounds[p.numBars - 1] != GAME_LEVEL_FULL) return false;
+  for (int b = 1; b < p.numBars; b++) {
+    if (p.bounds[b] <= p.bounds[b - 1]) return false;
+  }
+  // Each link level must show exactly the bar count it stands for
+  if (p.patchPrefix != nullptr) {
+    for (int b = 0; b <= p.numBars; b++) {
+      uint8_t level = p.linkLevels[b];
+      int shown = 0;
+      while (shown < p.numBars && level >= p.bounds[shown]) shown++;
+      if (shown != b) return false;
+    }
+  }
+  // Emulator steps must start empty, end full and never skip a bar
+  if (p.emuSteps > 0) {
+    if (p.emuSteps > GAME_MAX_EMU_STEPS || p.emuSteps < p.numBars) return false;
+    if (p.emuStepToBar[0] != 0 || p.emuStepToBar[p.emuSteps] != p.numBars) return false;
+    for (int s = 1; s <= p.emuSteps; s++) {
+      int rise = p.emuStepToBar[s] - p.emuStepToBar[s - 1];
+      if (rise < 0 || rise > 1) return false;
+    }
+  }
+  return true;
+}
+
+// HID_CONTROL_MODE 2 sends the gauge size, not the game, so a game must
+// share the curve AbsoluteMeter.h decodes for its bar count
+static constexpr bool gameProfileMatchesAbsoluteMeter(const GameProfile& p) {
+  const uint8_t* bounds = (p.numBars == 8) ? ABS_METER_BOUNDS_8
+                        : (p.numBars == 10) ? ABS_METER_BOUNDS_10 : nullptr;
+  if (bounds == nullptr) return true;
+  for (int b = 0; b < p.numBars; b++) {
+    if (p.bounds[b] != bounds[b]) return false;
+  }
+  return true;
+}
+
+static constexpr bool gameProfilesValid() {
+  for (int g = 0; g < NUM_GAMES; g++) {
+    if (!gameProfileValid(GAME_PROFILES[g])) return false;
+    if (!gameProfileMatchesAbsoluteMeter(GAME_PROFILES[g])) return false;
+  }
+  return true;
+}
+
+static_assert(gameProfilesValid(), "GAME_PROFILES entry is inconsistent");
+
+// Pinned tables of the original games (the arrays the registry replaced)
+static constexpr bool gameTablesMatch(int game, const float* ratios, int numBars,
+                                      const int* stepToBar, const int* fromEmpty,
+                                      const int* fromFull, int steps, const uint8_t* link) {
+  if (GAME_BARS[game] != numBars || GAME_EMU_STEPS[game] != steps) return false;
+  for (int b = 0; b < numBars; b++) {
+    if (GAME_BAR_RATIOS[game][b] != ratios[b]) return false;
+  }
+  for (int s = 0; s <= steps; s++) {
+    if (GAME_EMU_STEP_TO_BAR[game][s] != stepToBar[s]) return false;
+  }
+  for (int b = 0; b <= numBars; b++) {
+    if (GAME_EMU_STEP_FROM_EMPTY[game][b] != fromEmpty[b]) return false;
+    if (GAME_EMU_STEP_FROM_FULL[game][b] != fromFull[b]) return false;
+    float midpoint = (float)b / (numBars + 1) + 0.5f / (numBars + 1);
+    float delta = GAME_ANALOG_FRACTIONS[game][b] - midpoint;
+    if (delta > 1e-6f || delta < -1e-6f) return false;
+  }
+  for (int i = 0; i < GAME_LINK_TABLE_SIZE; i++) {
+    if (GAME_LINK_TABLES[game][i] != link[i]) return false;
+  }
+  return true;
+}
+
+namespace game_profiles_pinned {
+constexpr float RATIOS_B1[8] = {
+  0.0f, 6.0f/139.0f, 15.0f/139.0f, 27.0f/139.0f, 43.0f/139.0f, 66.0f/139.0f, 97.0f/139.0f, 1.0f
+};
+constexpr float RATIOS_B23[10] = {
+  0.0f, 5.0f/139.0f, 12.0f/139.0f, 22.0f/139.0f, 34.0f/139.0f, 49.0f/139.0f,
+  66.0f/139.0f, 86.0f/139.0f, 109.0f/139.0f, 1.0f
+};
+constexpr int STEP_TO_BAR_B1[11] = { 0, 1, 2, 3, 3, 4, 5, 6, 7, 7, 8 };
+constexpr int FROM_EMPTY_B1[9] = { 0, 1, 2, 3, 5, 6, 7, 8, 10 };
+constexpr int FROM_FULL_B1[9] = { 0, 1, 2, 4, 5, 6, 7, 9, 10 };
+constexpr int IDENTITY_B23[11] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+constexpr uint8_t LINK_B1[16] = {
+  0x00, 0x04, 0x0B, 0x14, 0x1F, 0x2F, 0x4D, 0x77, 0x8C, 0x8C, 0x8C, 0x8C, 0x8C, 0x8C, 0x8C, 0x00
+};
+constexpr uint8_t LINK_B23[16] = {
+  0x00, 0x03, 0x09, 0x12, 0x1D, 0x2A, 0x3D, 0x4D, 0x62, 0x7D, 0x8C, 0x8C, 0x8C, 0x8C, 0x8C, 0x00
+};
+}  // namespace game_profiles_pinned
+
+static_assert(gameTablesMatch(0, game_profiles_pinned::RATIOS_B1, 8, game_profiles_pinned::STEP_TO_BAR_B1,
+                              game_profiles_pinned::FROM_EMPTY_B1, game_profiles_pinned::FROM_FULL_B1, 10,
+                              game_profiles_pinned::LINK_B1),
+              "Boktai 1 tables changed");
+static_assert(gameTablesMatch(1, game_profiles_pinned::RATIOS_B23, 10, game_profiles_pinned::IDENTITY_B23,
+                              game_profiles_pinned::IDENTITY_B23, game_profiles_pinned::IDENTITY_B23, 10,
+                              game_profiles_pinned::LINK_B23),
+              "Boktai 2 tables changed");
+static_assert(gameTablesMatch(2, game_profiles_pinned::RATIOS_B23, 10, game_profiles_pinned::IDENTITY_B23,
+                              game_profiles_pinned::IDENTITY_B23, game_profiles_pinned::IDENTITY_B23, 10,
+                              game_profiles_pinned::LINK_B23),
+              "Boktai 3 tables changed");
+
+// ---- Link patch data ----
+
+// The comment each patch carries between `dataarea:` and its dcb line
+static const char GAME_LINK_DATAAREA_COMMENT[] =
+    "// GBA GPIO pins are pulled up, so no connection reads as 0xF; treat as no sunlight";
+
+// The `dcb` line of a link patch's dataarea block, e.g.
+// "dcb\t0x00,0x04,...,0x00". Returns false if the game has no link patch
+// or the buffer is too small (5 characters per entry plus 4).
+static inline bool gameProfileFormatDataArea(int game, char* out, size_t size) {
+  if (game < 0 || game >= NUM_GAMES || GAME_PROFILES[game].patchPrefix == nullptr) return false;
+  if (size < (size_t)(4 + 5 * GAME_LINK_TABLE_SIZE)) return false;
+  int len = snprintf(out, size, "dcb\t");
+  for (int i = 0; i < GAME_LINK_TABLE_SIZE; i++) {
+    len += snprintf(out + len, size - len, (i == 0) ? "0x%02X" : ",0x%02X", GAME_LINK_TABLES[game][i]);
+  }
+  return true;
+}
+
+#endif // GAME_PROFILES_H
@@ -0,0 +1,208 @@
+// GbaLink.h - Hardware-timer driven GBA link phase output
+//
+// The GBA-side patches only commit a value after two identical consecutive
+// reads, so a phase that is stretched by a slow loop() pass (display flush,
+// BLE call, delay) makes the game reject frames. This moves SC/SD/SO phase
+// generation into a hardware timer ISR so phase timing no longer depends on
+// loop() latency.
+//
+// The ISR writes the GPIO set/clear registers directly: data lines (SD/SO)
+// first, then SC, so the GBA always samples stable data on a phase edge.
+// loop() publishes the bar value through a single atomic word.
+//
+// Every phase period is also recorded in a 1us-bin histogram centred on the
+// nominal period, so jitter (min/max/p99) can be shown on the DEBUG screen.
+// The two phases of the first frame carrying each new value go to the event
+// trace (every phase would flood it).
+//
+// With grayCode set (GBA_LINK_PROTOCOL_V2), the ISR sends the Gray code of
+// the published value instead of the value itself; see GbaLinkCodec.h.
+#ifndef GBA_LINK_H
+#define GBA_LINK_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "esp_timer.h"
+#include "soc/gpio_reg.h"
+#include "TraceBuffer.h"
+#include "GbaLinkCodec.h"
+
+// 1us bins; periods beyond +/- half the range land in the edge bins
+const int GBA_JITTER_BINS = 128;
+
+struct GbaJitterStats {
+  uint32_t phases;
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint32_t p99Us;
+};
+
+class GbaLinkTimer {
+public:
+  // Returns false if no hardware timer could be allocated; callers then
+  // fall back to polled output from loop().
+  bool begin(int scPin, int sdPin, int soPin, uint32_t phaseUs, bool grayCode) {
+    end();
+    nominalUs = (phaseUs > 0) ? phaseUs : 1000UL;
+    protocolV2 = grayCode;
+    setPinMask(scPin, scBank, scMask);
+    setPinMask(sdPin, sdBank, sdMask);
+    setPinMask(soPin, soBank, soMask);
+    resetStats();
+    phaseHigh = false;
+    lastPhaseUs = 0;
+
+    timer = timerBegin(1000000);  // 1 MHz: alarm values are in microseconds
+    if (timer == nullptr) {
+      return false;
+    }
+    timerAttachInterruptArg(timer, &GbaLinkTimer::onTimer, this);
+    timerAlarm(timer, nominalUs, true, 0);
+    return true;
+  }
+
+  void end() {
+    if (timer != nullptr) {
+      timerEnd(timer);
+      timer = nullptr;
+    }
+  }
+
+  bool running() const {
+    return timer != nullptr;
+  }
+
+  // Publish the 4-bit value the ISR should transmit.
+  void publish(uint8_t value) {
+    linkValue.store((uint32_t)(value & 0x0F), std::memory_order_relaxed);
+  }
+
+  uint32_t nominalPeriodUs() const {
+    return nominalUs;
+  }
+
+  void getStats(GbaJitterStats* out) {
+    uint32_t bins[GBA_JITTER_BINS];
+    portENTER_CRITICAL(&statsMux);
+    memcpy(bins, histogram, sizeof(bins));
+    out->phases = phaseCount;
+    out->minUs = (phaseCount > 0) ? minPeriodUs : 0;
+    out->maxUs = maxPeriodUs;
+    portEXIT_CRITICAL(&statsMux);
+
+    out->p99Us = 0;
+    if (out->phases == 0) {
+      return;
+    }
+    uint32_t total = 0;
+    for (int i = 0; i < GBA_JITTER_BINS; i++) {
+      total += bins[i];
+    }
+    uint32_t target = total - (total / 100);
+    uint32_t seen = 0;
+    for (int i = 0; i < GBA_JITTER_BINS; i++) {
+      seen += bins[i];
+      if (seen >= target) {
+        // The top bin also holds every longer period; report the true max
+        out->p99Us = (i == GBA_JITTER_BINS - 1) ? out->maxUs : binToPeriodUs(i);
+        break;
+      }
+    }
+  }
+
+  void resetStats() {
+    portENTER_CRITICAL(&statsMux);
+    memset(histogram, 0, sizeof(histogram));
+    phaseCount = 0;
+    minPeriodUs = 0xFFFFFFFF;
+    maxPeriodUs = 0;
+    portEXIT_CRITICAL(&statsMux);
+  }
+
+private:
+  static void IRAM_ATTR onTimer(void* arg) {
+    static_cast<GbaLinkTimer*>(arg)->handlePhase();
+  }
+
+  void IRAM_ATTR handlePhase() {
+    uint32_t nowUs = (uint32_t)esp_timer_get_time();
+    uint8_t value = (uint8_t)linkValue.load(std::memory_order_relaxed);
+    phaseHigh = !phaseHigh;
+
+    // SC carries frame phase (0 = low pair, 1 = high pair);
+    // SD/SO carry two data bits for that phase
+    uint8_t code = gbaLinkEncode(value, protocolV2);
+    uint8_t pair = phaseHigh ? ((code >> 2) & 0x03) : (code & 0x03);
+    uint32_t setMask[2] = { 0, 0 };
+    uint32_t clearMask[2] = { 0, 0 };
+    if (pair & 0x02) setMask[sdBank] |= sdMask; else clearMask[sdBank] |= sdMask;
+    if (pair & 0x01) setMask[soBank] |= soMask; else clearMask[soBank] |= soMask;
+
+    // Data pins first so they're stable before SC signals the new phase
+    REG_WRITE(GPIO_OUT_W1TS_REG, setMask[0]);
+    REG_WRITE(GPIO_OUT_W1TC_REG, clearMask[0]);
+    REG_WRITE(GPIO_OUT1_W1TS_REG, setMask[1]);
+    REG_WRITE(GPIO_OUT1_W1TC_REG, clearMask[1]);
+    if (scBank == 0) {
+      REG_WRITE(phaseHigh ? GPIO_OUT_W1TS_REG : GPIO_OUT_W1TC_REG, scMask);
+    } else {
+      REG_WRITE(phaseHigh ? GPIO_OUT1_W1TS_REG : GPIO_OUT1_W1TC_REG, scMask);
+    }
+
+    if (value != tracedValue) {
+      tracedValue = value;
+      tracePhasesLeft = 2;
+    }
+    if (tracePhasesLeft > 0) {
+      tracePhasesLeft--;
+      traceEvent(TRACE_GBA_PHASE, phaseHigh ? 1 : 0, value);
+    }
+
+    if (lastPhaseUs != 0) {
+      recordPeriod(nowUs - lastPhaseUs);
+    }
+    lastPhaseUs = nowUs;
+  }
+
+  void IRAM_ATTR recordPeriod(uint32_t periodUs) {
+    int bin = (int)periodUs - (int)nominalUs + (GBA_JITTER_BINS / 2);
+    if (bin < 0) bin = 0;
+    if (bin >= GBA_JITTER_BINS) bin = GBA_JITTER_BINS - 1;
+    portENTER_CRITICAL_ISR(&statsMux);
+    histogram[bin]++;
+    phaseCount++;
+    if (periodUs < minPeriodUs) minPeriodUs = periodUs;
+    if (periodUs > maxPeriodUs) maxPeriodUs = periodUs;
+    portEXIT_CRITICAL_ISR(&statsMux);
+  }
+
+  uint32_t binToPeriodUs(int bin) const {
+    int periodUs = (int)nominalUs - (GBA_JITTER_BINS / 2) + bin;
+    return (periodUs > 0) ? (uint32_t)periodUs : 0;
+  }
+
+  // GPIO0-31 use the OUT registers, GPIO32-48 the OUT1 registers
+  static void setPinMask(int pin, uint8_t& bank, uint32_t& mask) {
+    bank = (pin >= 32) ? 1 : 0;
+    mask = 1UL << (pin & 31);
+  }
+
+  hw_timer_t* timer = nullptr;
+  std::atomic<uint32_t> linkValue{0};
+  uint32_t nominalUs = 5000;
+  bool protocolV2 = false;
+  uint8_t scBank = 0, sdBank = 0, soBank = 0;
+  uint32_t scMask = 0, sdMask = 0, soMask = 0;
+  volatile bool phaseHigh = false;
+  uint32_t lastPhaseUs = 0;
+  uint8_t tracedValue = 0xFF;
+  uint8_t tracePhasesLeft = 0;
+
+  portMUX_TYPE statsMux = portMUX_INITIALIZER_UNLOCKED;
+  uint32_t histogram[GBA_JITTER_BINS];
+  uint32_t phaseCount = 0;
+  uint32_t minPeriodUs = 0xFFFFFFFF;
+  uint32_t maxPeriodUs = 0;
+};
+
+#endif
@@ -0,0 +1,330 @@
+// GbaLinkCodec.h - GBA link value encoding and a model of the GBA patches
+//
+// The link carries a 4-bit value as two 2-bit halves on SD/SO, one per SC
+// phase (low pair while SC is low, high pair while SC is high). The GBA
+// patch reads the port once per game frame, so it only ever sees one half
+// per read and assembles the value from the half it just read plus the
+// other half remembered from an earlier read.
+//
+// Protocol v1 sends the bar count as-is. When the value changes, the half
+// remembered from before the change is stale, so an assembled value can be
+// neither the old nor the new count (3 -> 4 can assemble as 0 or 7). The
+// v1 patches therefore only commit when two consecutive reads assemble the
+// same value, which costs at least one extra game frame per change.
+//
+// Protocol v2 sends the 4-bit reflected Gray code of the bar count. A one
+// bar step flips exactly one bit, so it changes only one half, and any mix
+// of old and new halves decodes to the old or the new count. A multi-bar
+// jump changes both halves, though, and a new half read next to a stale
+// one can decode to anything, including a value next to the old one. So
+// the v2 patches only commit a new value whose halves were both read on
+// the last two frames, one in each phase: either two such reads assemble
+// the same value, or the value is within one bar of the last committed one
+// and the other half was read on the frame before. Normal sunlight changes
+// are one-bar steps and land on the first read that sees the changed half
+// when the frame before read the other phase (about two reads in three),
+// one frame later otherwise.
+//
+// What is left: a jump that reaches the lines between those two reads and
+// tears into a value next to the old one still commits it for a frame or
+// two. gbaLinkSimulate() counts these as false commits: about 3% of
+// changes on the timer and 8% with polled phases when a fifth of the
+// changes are jumps. v1 has more, because its two matching reads may both
+// be of one phase next to the same stale half. Polled output can also
+// drift in step with the game frame, so the GBA reads one phase for several
+// frames running; a change in the other half then waits that long under
+// either protocol. A true single-read commit of any value is not possible
+// on this link: the GBA sees 3 data bits per read (SC + SD + SI), 8
+// symbols, which cannot carry 11 bar values plus a phase.
+//
+// GbaLinkDecoder mirrors the patch code in "GBA Link Patches/Source" step
+// for step, and gbaLinkSimulate() runs it against a modelled ESP output so
+// both protocols can be compared (serial command 'g', host/gba_link_sim).
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef GBA_LINK_CODEC_H
+#define GBA_LINK_CODEC_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+static const uint8_t GBA_LINK_NO_LINK = 0x0F;   // All port lines pulled high
+
+// Link value for a bar count: whatever fits the 4 bits, clamped
+static inline uint8_t gbaLinkValueForBars(int bars) {
+  return (uint8_t)((bars < 0) ? 0 : (bars > 15) ? 15 : bars);
+}
+
+// Code to transmit for a bar value (0-15)
+static inline uint8_t gbaLinkEncode(uint8_t value, bool v2) {
+  value &= 0x0F;
+  return v2 ? (uint8_t)(value ^ (value >> 1)) : value;
+}
+
+// Bar value from a 4-bit Gray code, as the v2 patch computes it
+static inline uint8_t gbaLinkGrayDecode(uint8_t code) {
+  uint8_t value = code ^ (code >> 1);
+  return value ^ (value >> 2);
+}
+
+// Port bits the GBA reads (RCNT bits 0-3) for one phase of a code: SC on
+// bit 0, SD on bit 1, the ESP's SO on SI (bit 2), GBA SO grounded (bit 3)
+static inline uint8_t gbaLinkPortBits(uint8_t code, bool phaseHigh) {
+  uint8_t pair = phaseHigh ? ((code >> 2) & 0x03) : (code & 0x03);
+  return (uint8_t)((phaseHigh ? 0x01 : 0x00) | (pair & 0x02) | ((pair & 0x01) << 2));
+}
+
+// The patch's per-frame read, including its 4 scratch bytes at 0203FFF0h
+struct GbaLinkDecoder {
+  bool v2;
+  // Low pair, high pair, last assembled (v2: plus its phase in bit 4), last
+  // committed (v2)
+  uint8_t scratch[4];
+
+  void reset(bool protocolV2) {
+    v2 = protocolV2;
+    scratch[0] = scratch[1] = scratch[2] = scratch[3] = 0;
+  }
+
+  // Returns true if the patch writes a sun value this frame; *index is the
+  // sunlight table index it writes (GBA_LINK_NO_LINK = no link, no sun)
+  bool read(uint8_t portBits, uint8_t* index) {
+    portBits &= 0x0F;
+    if (portBits == GBA_LINK_NO_LINK) {
+      if (v2) {
+        scratch[3] = 0xF0;  // Remembered halves are stale after a gap (the asm stores its pointer's low byte)
+      }
+      *index = GBA_LINK_NO_LINK;
+      return true;
+    }
+    uint8_t phase = portBits & 0x01;
+    uint8_t pair = (uint8_t)((portBits & 0x02) | ((portBits >> 2) & 0x01));
+    scratch[phase] = pair;
+    uint8_t assembled = (uint8_t)(scratch[0] | (scratch[1] << 2));
+    if (!v2) {
+      uint8_t last = scratch[2];
+      scratch[2] = assembled;
+      if (assembled != last) {
+        return false;
+      }
+      *index = assembled;
+      return true;
+    }
+    assembled = gbaLinkGrayDecode(assembled);
+    uint8_t thisRead = (uint8_t)(assembled | (phase << 4));
+    uint8_t changed = scratch[2] ^ thisRead;
+    scratch[2] = thisRead;
+    if (changed != 0x10) {   // 0x10: same value from both phases on consecutive frames, read twice
+      // With the other half read on the last frame (fresh = 1), a one-bar
+      // step from the committed value; otherwise that half may be stale and
+      // only the committed value stands (32-bit unsigned, like the asm)
+      uint32_t fresh = changed >> 4;
+      if ((uint32_t)assembled - scratch[3] + fresh > 2 * fresh) {
+        return false;
+      }
+    }
+    scratch[3] = assembled;
+    *index = assembled;
+    return true;
+  }
+};
+
+// ---- Simulator ----
+
+struct GbaLinkSimConfig {
+  bool v2;
+  uint32_t phaseUs;         // ESP phase hold (GBA_LINK_FRAME_TOGGLE_MS)
+  uint32_t phaseJitterUs;   // Random extra hold per phase (0 for the timer ISR)
+  uint32_t skewUs;          // Data lines lead SC by this much at each edge
+  uint32_t frameUs;         // GBA read period (one game frame)
+  uint32_t holdMinMs;       // Time between bar changes, uniformly random
+  uint32_t holdMaxMs;
+  uint32_t jumpPercent;     // Share of changes that jump more than one bar
+  uint32_t durationMs;
+  uint32_t seed;
+};
+
+struct GbaLinkSimResult {
+  uint32_t reads;
+  uint32_t changes;         // Bar changes sent
+  uint32_t committed;       // Changes the game committed before the next one
+  uint32_t superseded;      // Changes replaced before the game committed them
+  uint32_t falseCommits;    // Commits of a value not sent in the last two frames
+  uint32_t latencyAvgUs;    // Change sent -> game commits it
+  uint32_t latencyMaxUs;
+};
+
+static const uint32_t GBA_LINK_GBA_FRAME_US = 16743;   // 59.73 Hz
+static const int GBA_LINK_SIM_HISTORY = 32;
+
+static inline uint32_t gbaLinkSimRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// Sends a random walk of bar values (0-10) over a modelled ESP output and
+// reads it with GbaLinkDecoder once per game frame, starting at a random
+// offset. A changed value goes out at the next phase edge, like the ISR.
+static inline void gbaLinkSimulate(const GbaLinkSimConfig& config, GbaLinkSimResult* result) {
+  *result = GbaLinkSimResult{};
+  uint32_t rng = config.seed ? config.seed : 1;
+  uint32_t phaseUs = config.phaseUs ? config.phaseUs : 1000;
+  uint32_t frameUs = config.frameUs ? config.frameUs : GBA_LINK_GBA_FRAME_US;
+  uint32_t holdSpanMs = (config.holdMaxMs > config.holdMinMs) ? config.holdMaxMs - config.holdMinMs : 0;
+  auto nextHoldUs = [&]() -> uint64_t {
+    return 1000ULL * (config.holdMinMs + (holdSpanMs ? gbaLinkSimRandom(&rng) % (holdSpanMs + 1) : 0));
+  };
+
+  GbaLinkDecoder decoder;
+  decoder.reset(config.v2);
+
+  // Values put on the lines, and when, to judge false commits
+  uint8_t sentValue[GBA_LINK_SIM_HISTORY];
+  uint64_t sentUs[GBA_LINK_SIM_HISTORY];
+  uint32_t sentCount = 0;
+
+  uint8_t value = 0;        // Latest bar value published by loop()
+  uint8_t lineCode = gbaLinkEncode(0, config.v2);
+  bool phaseHigh = false;
+  uint64_t lastEdgeUs = 0;
+  uint64_t edgeUs = phaseUs;
+  uint64_t changeUs = nextHoldUs();
+  uint64_t pendingSinceUs = 0;
+  bool pending = false;
+  uint64_t latencySumUs = 0;
+  uint64_t endUs = 1000ULL * config.durationMs;
+  uint64_t readUs = gbaLinkSimRandom(&rng) % frameUs;
+
+  sentValue[0] = 0;
+  sentUs[0] = 0;
+  sentCount = 1;
+
+  for (; readUs < endUs; readUs += frameUs) {
+    // Phase edges and value changes up to this read, in time order
+    for (;;) {
+      uint64_t nextEventUs = (changeUs < edgeUs) ? changeUs : edgeUs;
+      if (nextEventUs > readUs) {
+        break;
+      }
+      if (changeUs <= edgeUs) {
+        uint8_t next = value;
+        if ((gbaLinkSimRandom(&rng) % 100) < config.jumpPercent) {
+          next = (uint8_t)(gbaLinkSimRandom(&rng) % 11);
+        } else if (value == 0 || (value < 10 && (gbaLinkSimRandom(&rng) & 1))) {
+          next = value + 1;
+        } else {
+          next = value - 1;
+        }
+        if (next != value) {
+          if (pending) {
+            result->superseded++;
+          }
+          value = next;
+          pending = true;
+          pendingSinceUs = changeUs;
+          result->changes++;
+        }
+        changeUs += nextHoldUs();
+        continue;
+      }
+      phaseHigh = !phaseHigh;
+      uint8_t code = gbaLinkEncode(value, config.v2);
+      if (code != lineCode) {
+        lineCode = code;
+        sentValue[sentCount % GBA_LINK_SIM_HISTORY] = value;
+        sentUs[sentCount % GBA_LINK_SIM_HISTORY] = edgeUs;
+        sentCount++;
+      }
+      lastEdgeUs = edgeUs;
+      edgeUs += phaseUs + (config.phaseJitterUs ? gbaLinkSimRandom(&rng) % (config.phaseJitterUs + 1) : 0);
+    }
+
+    // Inside the skew window the data lines are new but SC is not yet
+    bool scHigh = (readUs < lastEdgeUs + config.skewUs) ? !phaseHigh : phaseHigh;
+    uint8_t portBits = gbaLinkPortBits(lineCode, phaseHigh);
+    portBits = (uint8_t)((portBits & 0x0E) | (scHigh ? 0x01 : 0x00));
+    result->reads++;
+
+    uint8_t index;
+    if (!decoder.read(portBits, &index)) {
+      continue;
+    }
+    // Legitimate: on the lines now, or at any time during the last two frames
+    bool legit = false;
+    uint64_t windowUs = (readUs > 2ULL * frameUs) ? readUs - 2ULL * frameUs : 0;
+    for (uint32_t i = 0; i < sentCount && i < (uint32_t)GBA_LINK_SIM_HISTORY; i++) {
+      uint32_t slot = (sentCount - 1 - i) % GBA_LINK_SIM_HISTORY;
+      if (sentValue[slot] == index) {
+        legit = true;
+        break;
+      }
+      if (sentUs[slot] <= windowUs) {
+        break;  // This one was already on the lines when the window opened
+      }
+    }
+    if (!legit) {
+      result->falseCommits++;
+    }
+    if (pending && index == value) {
+      uint64_t latencyUs = readUs - pendingSinceUs;
+      latencySumUs += latencyUs;
+      if (latencyUs > result->latencyMaxUs) {
+        result->latencyMaxUs = (uint32_t)latencyUs;
+      }
+      result->committed++;
+      pending = false;
+    }
+  }
+  result->latencyAvgUs = result->committed ? (uint32_t)(latencySumUs / result->committed) : 0;
+}
+
+// The runs the 'g' command and host/gba_link_sim print: random one-bar
+// steps every 40-400 ms, then the same with 20% multi-bar jumps, each for
+// the hardware timer (exact phases) and polled output from loop() (phases
+// up to 3 ms late)
+struct GbaLinkSimScenario {
+  const char* name;
+  uint32_t jitterUs;
+  uint32_t jumpPercent;
+};
+
+static const GbaLinkSimScenario GBA_LINK_SIM_SCENARIOS[] = {
+  { "timer", 0, 0 }, { "timer+jumps", 0, 20 }, { "polled", 3000, 0 }, { "polled+jumps", 3000, 20 }
+};
+static const int GBA_LINK_SIM_SCENARIO_COUNT = sizeof(GBA_LINK_SIM_SCENARIOS) / sizeof(GBA_LINK_SIM_SCENARIOS[0]);
+
+static inline GbaLinkSimConfig gbaLinkSimScenarioConfig(const GbaLinkSimScenario& scenario, bool v2,
+                                                        uint32_t phaseUs, uint32_t durationMs, uint32_t seed) {
+  GbaLinkSimConfig config;
+  config.v2 = v2;
+  config.phaseUs = phaseUs;
+  config.phaseJitterUs = scenario.jitterUs;
+  config.skewUs = 2;
+  config.frameUs = GBA_LINK_GBA_FRAME_US;
+  config.holdMinMs = 40;
+  config.holdMaxMs = 400;
+  config.jumpPercent = scenario.jumpPercent;
+  config.durationMs = durationMs;
+  config.seed = seed;
+  return config;
+}
+
+static const char* const GBA_LINK_SIM_TABLE_HEADER =
+    "# scenario protocol changes committed false_commits false_pct lat_avg_ms lat_max_ms";
+
+// One table row; false_pct is false commits per 100 changes sent
+static inline int gbaLinkSimFormatRow(char* out, size_t size, const char* scenario, bool v2,
+                                      const GbaLinkSimResult& result) {
+  return snprintf(out, size, "%s %s %lu %lu %lu %.2f %.1f %.1f", scenario, v2 ? "v2" : "v1",
+                  (unsigned long)result.changes, (unsigned long)result.committed,
+                  (unsigned long)result.falseCommits,
+                  result.changes ? result.falseCommits * 100.0f / result.changes : 0.0f,
+                  result.latencyAvgUs / 1000.0f, result.latencyMaxUs / 1000.0f);
+}
+
+#endif // GBA_LINK_CODEC_H
@@ -0,0 +1,285 @@
+// I2cBus.h - Shared I2C bus accounting and chunked SSD1306 flushes
+//
+// On the XIAO build the SSD1306 and the LTR390 share one Wire bus. A full
+// display.display() holds the bus (and loop()) for the whole 1 KB frame, so
+// the sensor read, button handling and HID timing all wait behind it.
+// OledChunkFlush snapshots the framebuffer, diffs it per page against a
+// shadow copy of what the panel shows, and writes only the changed column
+// window of each page as short transactions, a budgeted slice per loop()
+// pass. Most frames (a few changed digits) shrink from 1 KB to a few dozen
+// bytes, and any other bus client waits at most one slice.
+//
+// I2cBusMonitor accumulates time spent in bus transactions and publishes,
+// per reporting window, bus utilization and the longest single bus hold
+// (the worst case a priority transaction can wait behind). The sensor
+// (loop()) and the display (UI task) record from different cores, so the
+// counters sit behind a spinlock.
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+// Bus clients tracked separately so per-device traffic is visible
+enum I2cClient : uint8_t {
+  I2C_CLIENT_SENSOR = 0,
+  I2C_CLIENT_DISPLAY,
+  I2C_CLIENT_COUNT
+};
+
+class I2cBusMonitor {
+public:
+  void begin() {
+    windowStartUs = micros();
+    busyUs = 0;
+    maxHoldUs = 0;
+    transactions = 0;
+    publishedBusyPermille = 0;
+    publishedMaxHoldUs = 0;
+    publishedTransactions = 0;
+    peakHoldUs = 0;
+    memset(clientTransactions, 0, sizeof(clientTransactions));
+    memset(publishedClientTransactions, 0, sizeof(publishedClientTransactions));
+  }
+
+  // Record one completed bus transaction.
+  void record(uint32_t holdUs, I2cClient client) {
+    portENTER_CRITICAL(&mux);
+    busyUs += holdUs;
+    transactions++;
+    clientTransactions[client]++;
+    if (holdUs > maxHoldUs) {
+      maxHoldUs = holdUs;
+    }
+    if (holdUs > peakHoldUs) {
+      peakHoldUs = holdUs;
+    }
+    portEXIT_CRITICAL(&mux);
+  }
+
+  // Close the current window (call once per stats window).
+  void publish() {
+    unsigned long nowUs = micros();
+    portENTER_CRITICAL(&mux);
+    uint32_t windowUs = (uint32_t)(nowUs - windowStartUs);
+    publishedBusyPermille = (windowUs > 0) ? (uint32_t)(((uint64_t)busyUs * 1000ULL) / windowUs) : 0;
+    publishedMaxHoldUs = maxHoldUs;
+    publishedTransactions = perSecond(transactions, windowUs);
+    for (uint8_t i = 0; i < I2C_CLIENT_COUNT; i++) {
+      publishedClientTransactions[i] = perSecond(clientTransactions[i], windowUs);
+      clientTransactions[i] = 0;
+    }
+    busyUs = 0;
+    maxHoldUs = 0;
+    transactions = 0;
+    windowStartUs = nowUs;
+    portEXIT_CRITICAL(&mux);
+  }
+
+  uint32_t busyPermille() const { return publishedBusyPermille; }
+  uint32_t maxHoldUsInWindow() const { return publishedMaxHoldUs; }
+  uint32_t peakHoldSinceBootUs() const { return peakHoldUs; }
+  uint32_t transactionsPerSec() const { return publishedTransactions; }
+  uint32_t transactionsPerSec(I2cClient client) const { return publishedClientTransactions[client]; }
+
+private:
+  static uint32_t perSecond(uint32_t count, uint32_t windowUs) {
+    return (windowUs > 0) ? (uint32_t)(((uint64_t)count * 1000000ULL) / windowUs) : 0;
+  }
+
+  portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+  unsigned long windowStartUs = 0;
+  uint32_t busyUs = 0;
+  uint32_t maxHoldUs = 0;
+  uint32_t transactions = 0;
+  uint32_t publishedBusyPermille = 0;
+  uint32_t publishedMaxHoldUs = 0;
+  uint32_t publishedTransactions = 0;
+  uint32_t peakHoldUs = 0;
+  uint32_t clientTransactions[I2C_CLIENT_COUNT];
+  uint32_t publishedClientTransactions[I2C_CLIENT_COUNT];
+};
+
+class OledChunkFlush {
+public:
+  // 128x64 panel: 8 pages of 128 columns. Data writes are split into
+  // slices of at most 64 bytes so slice + control byte fit the Wire buffer.
+  static const uint8_t COLS = 128;
+  static const uint8_t PAGES = 8;
+  static const uint8_t CHUNK_COLS = 64;
+  static const uint16_t FRAME_BYTES = COLS * PAGES;
+  static const uint8_t WINDOW_CMD_BYTES = 7;  // control + COLUMNADDR(3) + PAGEADDR(3)
+
+  void begin(TwoWire* wire, uint8_t addr, I2cBusMonitor* monitor) {
+    this->wire = wire;
+    this->addr = addr;
+    this->monitor = monitor;
+    pagesToScan = 0;
+    nextPage = 0;
+    invalidate();
+    frameBytes = 0;
+    lastFrameBytes = 0;
+    windowFrames = 0;
+    windowBytes = 0;
+    publishedAvgFrameBytes = 0;
+    publishedFrames = 0;
+  }
+
+  // Snapshot a finished frame for background transfer. Only columns that
+  // differ from the shadow copy of the panel are sent. A frame queued while
+  // an older one is still in flight just replaces the snapshot; the diff
+  // against the shadow picks up whatever is still stale.
+  void queue(const uint8_t* frame) {
+    queuePages(frame, 0xFF);
+  }
+
+  // Same, when only the pages in pageMask (bit n = page n) can have
+  // changed since the last queued frame (damage from UiWidgets.h). Other
+  // pages are neither copied nor scanned, unless invalidate() left them
+  // unsent.
+  void queuePages(const uint8_t* frame, uint8_t pageMask) {
+    for (uint8_t page = 0; page < PAGES; page++) {
+      if (forcedFromCol[page] < COLS) {
+        pageMask |= (uint8_t)(1U << page);
+      }
+      if (pageMask & (1U << page)) {
+        memcpy(&snapshot[page * COLS], &frame[page * COLS], COLS);
+      }
+    }
+    pagesToScan |= pageMask;
+  }
+
+  // The panel contents are unknown (blocking full-frame push, panel
+  // re-init); the next frame is sent in full.
+  void invalidate() {
+    memset(forcedFromCol, 0, sizeof(forcedFromCol));
+  }
+
+  bool pending() const {
+    return pagesToScan != 0;
+  }
+
+  // Write changed column windows until budgetUs is spent; always writes
+  // at least one slice when anything is pending.
+  void service(uint32_t budgetUs) {
+    if (wire == nullptr || pagesToScan == 0) {
+      return;
+    }
+    unsigned long startUs = micros();
+    while (pagesToScan != 0) {
+      uint8_t bit = (uint8_t)(1U << nextPage);
+      bool wrote = (pagesToScan & bit) && flushPageSlice(nextPage);
+      if (!wrote) {
+        // Page now matches the panel (or was not queued)
+        pagesToScan &= (uint8_t)~bit;
+        nextPage = (uint8_t)((nextPage + 1) % PAGES);
+        continue;
+      }
+      if ((uint32_t)(micros() - startUs) >= budgetUs) {
+        break;
+      }
+    }
+    if (pagesToScan == 0) {
+      lastFrameBytes = frameBytes;
+      windowBytes += frameBytes;
+      windowFrames++;
+      frameBytes = 0;
+    }
+  }
+
+  // Close the current stats window (call once per stats window).
+  void publish() {
+    publishedAvgFrameBytes = (windowFrames > 0) ? (windowBytes / windowFrames) : 0;
+    publishedFrames = windowFrames;
+    windowBytes = 0;
+    windowFrames = 0;
+  }
+
+  // Bytes on the wire (commands + data, excluding address) per frame
+  uint32_t lastFrameBytesSent() const { return lastFrameBytes; }
+  uint32_t avgFrameBytes() const { return publishedAvgFrameBytes; }
+  uint32_t framesPerWindow() const { return publishedFrames; }
+
+private:
+  // Send the next stale slice of one page. Returns false if the page
+  // already matches the panel.
+  bool flushPageSlice(uint8_t page) {
+    const uint8_t* src = &snapshot[page * COLS];
+    uint8_t* dst = &shadow[page * COLS];
+    int first = 0;
+    int last = COLS - 1;
+    bool forced = forcedFromCol[page] < COLS;
+    if (forced) {
+      // Shadow can't be trusted for this page yet: send it in full
+      first = forcedFromCol[page];
+    } else {
+      while (first < COLS && src[first] == dst[first]) {
+        first++;
+      }
+      if (first == COLS) {
+        return false;
+      }
+      while (src[last] == dst[last]) {
+        last--;
+      }
+    }
+    if ((last - first + 1) > CHUNK_COLS) {
+      last = first + CHUNK_COLS - 1;
+    }
+    uint8_t count = (uint8_t)(last - first + 1);
+    writeWindow(page, (uint8_t)first, (uint8_t)last, src + first, count);
+    memcpy(dst + first, src + first, count);
+    if (forced) {
+      forcedFromCol[page] = (uint8_t)(last + 1);
+    }
+    return true;
+  }
+
+  void writeWindow(uint8_t page, uint8_t col0, uint8_t col1, const uint8_t* data, uint8_t count) {
+    // Address window for this slice (command stream: control byte 0x00)
+    unsigned long startUs = micros();
+    wire->beginTransmission(addr);
+    wire->write((uint8_t)0x00);
+    wire->write((uint8_t)0x21);  // COLUMNADDR
+    wire->write(col0);
+    wire->write(col1);
+    wire->write((uint8_t)0x22);  // PAGEADDR
+    wire->write(page);
+    wire->write(page);
+    wire->endTransmission();
+    recordSince(startUs);
+
+    // Slice data (data stream: control byte 0x40)
+    startUs = micros();
+    wire->beginTransmission(addr);
+    wire->write((uint8_t)0x40);
+    wire->write(data, count);
+    wire->endTransmission();
+    recordSince(startUs);
+
+    frameBytes += WINDOW_CMD_BYTES + 1 + count;
+  }
+
+  void recordSince(unsigned long startUs) {
+    if (monitor != nullptr) {
+      monitor->record((uint32_t)(micros() - startUs), I2C_CLIENT_DISPLAY);
+    }
+  }
+
+  TwoWire* wire = nullptr;
+  uint8_t addr = 0x3C;
+  I2cBusMonitor* monitor = nullptr;
+  uint8_t snapshot[FRAME_BYTES];
+  uint8_t shadow[FRAME_BYTES];      // What the panel currently shows
+  uint8_t forcedFromCol[PAGES];     // First unsent column after invalidate(); COLS = in sync
+  uint8_t pagesToScan = 0;         // Bit per page still to compare against the panel
+  uint8_t nextPage = 0;
+  uint32_t frameBytes = 0;
+  uint32_t lastFrameBytes = 0;
+  uint32_t windowBytes = 0;
+  uint32_t windowFrames = 0;
+  uint32_t publishedAvgFrameBytes = 0;
+  uint32_t publishedFrames = 0;
+};
+
+#endif
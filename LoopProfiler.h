@@ -0,0 +1,129 @@
+// LoopProfiler.h - Per-subsystem loop() timing
+//
+// loop() runs every subsystem back to back, so the slowest stage sets the
+// latency of all the others. This accumulates the cost of each stage over a
+// fixed reporting window and publishes the averages and worst cases for the
+// DEBUG screen and Serial, so a regression shows up before a unit is flashed
+// in the field.
+//
+// Usage: take micros() at the start of loop(), then call mark() after each
+// stage with the previous timestamp; mark() returns the timestamp to pass to
+// the next stage. endIteration() closes the loop pass.
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+#include <Arduino.h>
+
+enum ProfileStage : uint8_t {
+  PROFILE_BUTTONS = 0,
+  PROFILE_UI_STATE,
+  PROFILE_BLE_STATE,
+  PROFILE_BATTERY,
+  PROFILE_SENSOR,
+  PROFILE_GBA_LINK,
+  PROFILE_DISPLAY,
+  PROFILE_HID,
+  PROFILE_STAGE_COUNT
+};
+
+// Short labels (4 chars max) so two stages fit on one 128px display row
+static const char* const PROFILE_STAGE_NAMES[PROFILE_STAGE_COUNT] = {
+  "btn", "ui", "ble", "bat", "uv", "gba", "disp", "hid"
+};
+
+struct ProfileStat {
+  uint32_t count;
+  uint32_t totalUs;
+  uint32_t maxUs;
+};
+
+class LoopProfiler {
+public:
+  void begin(unsigned long windowMs) {
+    this->windowMs = (windowMs > 0) ? windowMs : 1000UL;
+    windowStartMs = millis();
+    memset(accum, 0, sizeof(accum));
+    memset(published, 0, sizeof(published));
+    memset(&loopAccum, 0, sizeof(loopAccum));
+    memset(&loopPublished, 0, sizeof(loopPublished));
+    loopPeakUs = 0;
+    windowReady = false;
+  }
+
+  // Record the time spent since startUs against a stage.
+  // Returns the current timestamp so stages can be chained.
+  unsigned long mark(ProfileStage stage, unsigned long startUs) {
+    unsigned long nowUs = micros();
+    record(accum[stage], (uint32_t)(nowUs - startUs));
+    return nowUs;
+  }
+
+  // Close one loop() pass. Returns true when a reporting window has just
+  // been published (callers use this to refresh stats output).
+  bool endIteration(unsigned long loopStartUs) {
+    uint32_t elapsedUs = (uint32_t)(micros() - loopStartUs);
+    record(loopAccum, elapsedUs);
+    if (elapsedUs > loopPeakUs) {
+      loopPeakUs = elapsedUs;
+    }
+
+    unsigned long nowMs = millis();
+    if ((nowMs - windowStartMs) < windowMs) {
+      return false;
+    }
+    memcpy(published, accum, sizeof(published));
+    loopPublished = loopAccum;
+    memset(accum, 0, sizeof(accum));
+    memset(&loopAccum, 0, sizeof(loopAccum));
+    windowStartMs = nowMs;
+    windowReady = true;
+    return true;
+  }
+
+  bool hasWindow() const { return windowReady; }
+
+  uint32_t stageAvgUs(ProfileStage stage) const { return average(published[stage]); }
+  uint32_t stageMaxUs(ProfileStage stage) const { return published[stage].maxUs; }
+  uint32_t loopAvgUs() const { return average(loopPublished); }
+  uint32_t loopMaxUs() const { return loopPublished.maxUs; }
+  uint32_t loopPeakSinceBootUs() const { return loopPeakUs; }
+  uint32_t loopsPerWindow() const { return loopPublished.count; }
+  uint32_t loopTotalUs() const { return loopPublished.totalUs; }  // Busy time in the last window
+  uint32_t stageTotalUs(ProfileStage stage) const { return published[stage].totalUs; }
+  unsigned long windowDueMs() const { return windowStartMs + windowMs; }  // When endIteration() publishes next
+
+  // Stage with the highest worst-case cost in the last window
+  ProfileStage worstStage() const {
+    uint8_t worst = 0;
+    for (uint8_t i = 1; i < PROFILE_STAGE_COUNT; i++) {
+      if (published[i].maxUs > published[worst].maxUs) {
+        worst = i;
+      }
+    }
+    return (ProfileStage)worst;
+  }
+
+private:
+  static void record(ProfileStat& stat, uint32_t us) {
+    stat.count++;
+    stat.totalUs += us;
+    if (us > stat.maxUs) {
+      stat.maxUs = us;
+    }
+  }
+
+  static uint32_t average(const ProfileStat& stat) {
+    return (stat.count > 0) ? (stat.totalUs / stat.count) : 0;
+  }
+
+  ProfileStat accum[PROFILE_STAGE_COUNT];
+  ProfileStat published[PROFILE_STAGE_COUNT];
+  ProfileStat loopAccum;
+  ProfileStat loopPublished;
+  uint32_t loopPeakUs = 0;
+  unsigned long windowMs = 1000;
+  unsigned long windowStartMs = 0;
+  bool windowReady = false;
+};
+
+#endif
@@ -0,0 +1,417 @@
+// MeterPlanner.h - Press planning for the Incremental HID meter
+//
+// In Incremental mode the emulator meter moves one step per INC/DEC press
+// and clamps at 0 and stepsMax. Under mGBA, Boktai 1 has 10 steps for its
+// 8 bars, so bars 3 and 7 each cover two steps and the step a bar lands on
+// depends on the direction it is approached from.
+//
+// While our estimate of the emulator's step is valid, the meter is moved by
+// the plain delta. When it is not (new connection, game change, periodic
+// resync), the only way to learn the position is to press against one end
+// of the meter until it must have clamped; MeterStepModel prices both ends
+// so the cheaper one is used, and the choice is re-priced after every press
+// because the target bar can move while the clamp is in progress.
+//
+// MeterPlanner is the whole Incremental press plan: the step estimate, the
+// clamp and anchor syncs, the periodic resync and the press/release timing.
+// handleBlePresses() and updateBluetoothMeter() in the sketch drive it and
+// send the HID reports it asks for; host/meter_planner_sim runs it against
+// a simulated emulator meter.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef METER_PLANNER_H
+#define METER_PLANNER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "GameProfiles.h"
+
+static const int METER_DIR_DEC = -1;
+static const int METER_DIR_INC = 1;
+
+static inline int meterClamp(int v, int lo, int hi) {
+  return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+struct MeterStepModel {
+  int stepsMax;
+  int barsMax;
+  const int* stepToBar;           // nullptr when every step is one bar
+  const int* barToStepFromEmpty;  // First step showing a bar when rising
+  const int* barToStepFromFull;   // First step showing a bar when falling
+
+  int barFromStep(int step) const {
+    step = meterClamp(step, 0, stepsMax);
+    return (stepToBar != nullptr) ? stepToBar[step] : step;
+  }
+
+  int stepFromBar(int bar, bool fromEmpty) const {
+    bar = meterClamp(bar, 0, barsMax);
+    if (stepToBar == nullptr) {
+      return bar;
+    }
+    return fromEmpty ? barToStepFromEmpty[bar] : barToStepFromFull[bar];
+  }
+
+  // Presses to show targetBar once the meter is pinned at one end:
+  // clampPressesLeft more presses toward that end, then the refill.
+  int clampCost(int direction, int clampPressesLeft, int targetBar) const {
+    if (direction < 0) {
+      return clampPressesLeft + stepFromBar(targetBar, true);
+    }
+    return clampPressesLeft + (stepsMax - stepFromBar(targetBar, false));
+  }
+
+  // Clamp direction (-1 = empty, +1 = full) that reaches targetBar soonest
+  // from an unknown position. Ties go to the empty end, matching the old
+  // "lower half clamps down" rule at the midpoint.
+  int cheaperClampDirection(int targetBar) const {
+    return (clampCost(-1, stepsMax, targetBar) <= clampCost(1, stepsMax, targetBar)) ? -1 : 1;
+  }
+};
+
+// A game's emulator meter. With emuSteps (HID_BOKTAI1_MGBA_10_STEP_WORKAROUND)
+// it follows mGBA's step map from GameProfiles.h; otherwise, and for games
+// without an mGBA quirk, one step per bar.
+static inline MeterStepModel meterStepModelForGame(int game, bool emuSteps) {
+  game = meterClamp(game, 0, NUM_GAMES - 1);
+  if (!emuSteps) {
+    return { GAME_BARS[game], GAME_BARS[game], nullptr, nullptr, nullptr };
+  }
+  return { GAME_EMU_STEPS[game], GAME_BARS[game], GAME_EMU_STEP_TO_BAR[game], GAME_EMU_STEP_FROM_EMPTY[game],
+           GAME_EMU_STEP_FROM_FULL[game] };
+}
+
+// Convergence quality of the emulator meter against the sensor bar:
+// how long each change took to be shown, and bar-error time (bars off
+// times milliseconds) accumulated while the emulator meter was wrong.
+// Time spent clamping with an unknown position counts as the full bar
+// range off, since the meter may be anywhere.
+class MeterConvergenceStats {
+public:
+  void update(unsigned long nowMs, bool converged, int barError) {
+    if (lastUpdateMs != 0 && !lastConverged) {
+      barErrorMs += (uint64_t)lastBarError * (uint32_t)(nowMs - lastUpdateMs);
+    }
+    if (!converged && lastConverged) {
+      divergedSinceMs = nowMs;
+    } else if (converged && !lastConverged && lastUpdateMs != 0) {
+      lastConvergeMs = (uint32_t)(nowMs - divergedSinceMs);
+      if (lastConvergeMs > maxConvergeMs) {
+        maxConvergeMs = lastConvergeMs;
+      }
+      convergences++;
+      totalConvergeMs += lastConvergeMs;
+    }
+    if (lastUpdateMs == 0 && !converged) {
+      divergedSinceMs = nowMs;
+    }
+    lastUpdateMs = nowMs;
+    lastConverged = converged;
+    lastBarError = converged ? 0 : abs(barError);
+  }
+
+  uint32_t lastConvergeTimeMs() const { return lastConvergeMs; }
+  uint32_t maxConvergeTimeMs() const { return maxConvergeMs; }
+  uint32_t convergeCount() const { return convergences; }
+  uint32_t avgConvergeTimeMs() const { return convergences ? (uint32_t)(totalConvergeMs / convergences) : 0; }
+  // Bar-error seconds since boot, in tenths
+  uint32_t barErrorDeciSeconds() const { return (uint32_t)(barErrorMs / 100); }
+
+private:
+  unsigned long lastUpdateMs = 0;
+  unsigned long divergedSinceMs = 0;
+  bool lastConverged = true;
+  int lastBarError = 0;
+  uint64_t barErrorMs = 0;
+  uint32_t lastConvergeMs = 0;
+  uint32_t maxConvergeMs = 0;
+  uint32_t convergences = 0;
+  uint64_t totalConvergeMs = 0;
+};
+
+enum MeterSyncPhase {
+  METER_SYNC_NONE = 0,
+  METER_SYNC_CLAMP,   // Position unknown: pressing until pinned at one end
+  METER_SYNC_ANCHOR   // Position known, target is an end bar: over-press into it
+};
+
+enum MeterPressAction {
+  METER_PRESS_NONE = 0,
+  METER_PRESS_DOWN,   // Press the INC (direction > 0) or DEC button now
+  METER_PRESS_UP      // Release the button pressed last
+};
+
+class MeterPlanner {
+public:
+  // buttonsPerSecond presses a second, each held for half the interval.
+  // 0 never presses.
+  void setPressRate(unsigned int buttonsPerSecond) {
+    if (buttonsPerSecond == 0) {
+      pressIntervalMs = 0;
+      pressHoldMs = 0;
+      return;
+    }
+    pressIntervalMs = 1000UL / buttonsPerSecond;
+    if (pressIntervalMs == 0) {
+      pressIntervalMs = 1;
+    }
+    pressHoldMs = pressIntervalMs / 2;
+    if (pressHoldMs == 0) {
+      pressHoldMs = 1;
+    }
+  }
+
+  // Resyncs are due every intervalMs (0 = never) and wait at most
+  // maxDeferMs for the target bar to reach an end.
+  void setResyncTiming(unsigned long intervalMs, unsigned long maxDeferMs) {
+    resyncIntervalMs = intervalMs;
+    resyncMaxDeferMs = maxDeferMs;
+  }
+
+  // Forget any press in flight without counting it. The caller releases
+  // the button if pressHolding().
+  void cancelPress() {
+    holding = false;
+    pressDirection = 0;
+    pressStartMs = 0;
+    lastPressMs = 0;
+  }
+
+  // Position unknown and no sync in progress
+  void reset() {
+    clearSync();
+    syncStepsMax = 0;
+    estimateOk = false;
+    resyncDue = false;
+  }
+
+  void invalidate() { estimateOk = false; }
+
+  // Position known without pressing (USB only, where nothing else moves
+  // the meter)
+  void setEstimate(int steps) {
+    estimated = steps;
+    estimateOk = true;
+  }
+
+  // Clamp from an unknown position toward whichever end reaches targetBar
+  // in fewer presses (full clamp plus refill). The caller cancels any
+  // press in flight first.
+  void startClamp(const MeterStepModel& model, int targetBar, unsigned long nowMs) {
+    phase = METER_SYNC_CLAMP;
+    syncStepsMax = model.stepsMax;
+    syncDirection = model.cheaperClampDirection(meterClamp(targetBar, 0, model.barsMax));
+    syncRemaining = syncStepsMax;
+    estimateOk = false;
+    resyncDue = false;
+    lastResyncMs = nowMs;
+    clamps++;
+  }
+
+  // A due resync waits for the target bar to reach an end (anchor) and
+  // only falls back to a visible clamp+refill after maxDeferMs. Either
+  // starts between presses, never while one is held.
+  void updateResync(const MeterStepModel& model, int targetBar, unsigned long nowMs) {
+    if (resyncIntervalMs == 0 || phase != METER_SYNC_NONE) {
+      return;
+    }
+    if (!resyncDue && (nowMs - lastResyncMs) >= resyncIntervalMs) {
+      resyncDue = true;
+      resyncDueSinceMs = nowMs;
+    }
+    if (!resyncDue || holding) {
+      return;
+    }
+    bool atEnd = (targetBar == 0) || (targetBar == model.barsMax);
+    if (estimateOk && atEnd) {
+      startAnchor(model, (targetBar == 0) ? METER_DIR_DEC : METER_DIR_INC);
+    } else if ((nowMs - resyncDueSinceMs) >= resyncMaxDeferMs) {
+      startClamp(model, targetBar, nowMs);
+    }
+  }
+
+  // One pass of handleBlePresses(): release a press that has been held
+  // long enough, or start the next one when the interval allows.
+  // *direction is set for METER_PRESS_DOWN.
+  MeterPressAction poll(const MeterStepModel& model, int targetBar, unsigned long nowMs, int* direction) {
+    if (holding) {
+      if ((nowMs - pressStartMs) < pressHoldMs) {
+        return METER_PRESS_NONE;
+      }
+      holding = false;
+      pressReleased(model, pressDirection, nowMs);
+      return METER_PRESS_UP;
+    }
+    if (pressIntervalMs == 0 || (nowMs - lastPressMs) < pressIntervalMs) {
+      return METER_PRESS_NONE;
+    }
+    int next = nextPress(model, targetBar);
+    if (next == 0) {
+      return METER_PRESS_NONE;
+    }
+    pressDirection = next;
+    holding = true;
+    pressStartMs = nowMs;
+    lastPressMs = nowMs;
+    *direction = next;
+    return METER_PRESS_DOWN;
+  }
+
+  // When poll() has something to do next; false when nothing is pending
+  bool wakeAt(const MeterStepModel& model, int targetBar, unsigned long* atMs) const {
+    if (holding) {
+      *atMs = pressStartMs + pressHoldMs;
+      return true;
+    }
+    if (pressIntervalMs > 0 && hasWork(model, targetBar)) {
+      *atMs = lastPressMs + pressIntervalMs;
+      return true;
+    }
+    return false;
+  }
+
+  bool hasWork(const MeterStepModel& model, int targetBar) const {
+    if (phase != METER_SYNC_NONE) {
+      return true;
+    }
+    return estimateOk && model.barFromStep(estimated) != targetBar;
+  }
+
+  // The estimate against targetBar. While the position is unknown the
+  // meter may be anywhere, so it counts as the full bar range off.
+  void updateStats(MeterConvergenceStats& stats, const MeterStepModel& model, int targetBar,
+                   unsigned long nowMs) const {
+    if (phase == METER_SYNC_CLAMP || !estimateOk) {
+      stats.update(nowMs, false, (model.barsMax > 1) ? model.barsMax : 1);
+      return;
+    }
+    int error = targetBar - model.barFromStep(estimated);
+    stats.update(nowMs, error == 0, error);
+  }
+
+  MeterSyncPhase syncPhase() const { return phase; }
+  bool estimateValid() const { return estimateOk; }
+  int estimatedSteps() const { return estimated; }
+  bool isResyncDue() const { return resyncDue; }
+  bool pressHolding() const { return holding; }
+  unsigned long pressInterval() const { return pressIntervalMs; }
+  uint32_t clampCount() const { return clamps; }     // Resyncs that clamped from an unknown position
+  uint32_t anchorCount() const { return anchors; }   // Resyncs folded into a move to an end bar
+
+private:
+  int activeSteps(const MeterStepModel& model) const {
+    return (phase != METER_SYNC_NONE && syncStepsMax > 0) ? syncStepsMax : model.stepsMax;
+  }
+
+  void clearSync() {
+    phase = METER_SYNC_NONE;
+    syncRemaining = 0;
+    syncDirection = 0;
+  }
+
+  // Periodic resync folded into a move the meter is already making: when
+  // the target bar is at an end, keep pressing toward it for a full
+  // clamp's worth of presses. The in-game meter only ever moves toward the
+  // bar it should show, and the extra presses are absorbed by the clamp.
+  void startAnchor(const MeterStepModel& model, int direction) {
+    phase = METER_SYNC_ANCHOR;
+    syncStepsMax = model.stepsMax;
+    syncDirection = direction;
+    syncRemaining = syncStepsMax;
+  }
+
+  // The meter is pinned at the end we pressed toward. The refill to the
+  // target bar is then an ordinary delta move, so a bar change that
+  // arrived during the clamp is picked up without restarting anything.
+  void finishSync(unsigned long nowMs) {
+    estimated = (syncDirection == METER_DIR_DEC) ? 0 : syncStepsMax;
+    estimateOk = true;
+    clearSync();
+    resyncDue = false;
+    lastResyncMs = nowMs;
+  }
+
+  // Re-price the sync in progress against the target bar. Called before
+  // every sync press.
+  void replanSync(const MeterStepModel& model, int targetBar) {
+    targetBar = meterClamp(targetBar, 0, model.barsMax);
+    if (phase == METER_SYNC_ANCHOR) {
+      int endBar = (syncDirection == METER_DIR_DEC) ? 0 : model.barsMax;
+      if (targetBar != endBar) {
+        // The bar moved away from the end; the estimate is still valid, so
+        // drop back to delta moves and leave the resync due.
+        clearSync();
+      }
+      return;
+    }
+    if (phase != METER_SYNC_CLAMP) {
+      return;
+    }
+    int other = -syncDirection;
+    int costHere = model.clampCost(syncDirection, syncRemaining, targetBar);
+    int costOther = model.clampCost(other, model.stepsMax, targetBar);
+    if (costOther < costHere) {
+      syncDirection = other;
+      syncRemaining = model.stepsMax;
+    }
+  }
+
+  int nextPress(const MeterStepModel& model, int targetBar) {
+    if (phase != METER_SYNC_NONE) {
+      replanSync(model, targetBar);
+      if (phase != METER_SYNC_NONE) {
+        return (syncRemaining > 0) ? syncDirection : 0;
+      }
+    }
+    if (!estimateOk) {
+      return 0;
+    }
+    int estimatedBar = model.barFromStep(estimated);
+    if (targetBar > estimatedBar) {
+      return METER_DIR_INC;
+    }
+    return (targetBar < estimatedBar) ? METER_DIR_DEC : 0;
+  }
+
+  void pressReleased(const MeterStepModel& model, int direction, unsigned long nowMs) {
+    int stepsMax = activeSteps(model);
+    if (estimateOk && stepsMax > 0) {
+      estimated = meterClamp(estimated + ((direction > 0) ? 1 : (direction < 0) ? -1 : 0), 0, stepsMax);
+    }
+    if (phase == METER_SYNC_NONE) {
+      return;
+    }
+    syncRemaining--;
+    if (syncRemaining <= 0) {
+      if (phase == METER_SYNC_ANCHOR) {
+        anchors++;
+      }
+      finishSync(nowMs);
+    }
+  }
+
+  unsigned long pressIntervalMs = 0;
+  unsigned long pressHoldMs = 0;
+  unsigned long resyncIntervalMs = 0;
+  unsigned long resyncMaxDeferMs = 0;
+  bool holding = false;
+  int pressDirection = 0;
+  unsigned long pressStartMs = 0;
+  unsigned long lastPressMs = 0;
+
+  MeterSyncPhase phase = METER_SYNC_NONE;
+  int syncStepsMax = 0;
+  int syncRemaining = 0;
+  int syncDirection = 0;
+  bool estimateOk = false;
+  int estimated = 0;
+  bool resyncDue = false;
+  unsigned long resyncDueSinceMs = 0;
+  unsigned long lastResyncMs = 0;
+  uint32_t clamps = 0;
+  uint32_t anchors = 0;
+};
+
+#endif // METER_PLANNER_H
@@ -0,0 +1,213 @@
+// PowerManager.h - Frequency scaling, automatic light sleep and loop() waits
+//
+// loop() used to end every pass with delay(1), so the CPU never idled long
+// enough to slow down. Now it blocks until the earliest subsystem deadline
+// (DeadlineScheduler.h) or until an interrupt notifies it. While every task
+// is blocked, esp_pm runs the CPU at POWER_CPU_MIN_MHZ and, if the core was
+// built with tickless idle, drops into light sleep until the next timer or
+// GPIO wakeup. loop() holds a CPU_FREQ_MAX lock whenever it is running, so
+// sensor and HID work still happens at full speed.
+//
+// Light sleep stops the USB peripheral and the GBA link outputs, so callers
+// hold the chip awake (keepAwake) while either is in use. The BLE controller
+// takes its own lock and keeps its connection. Edge interrupts cannot wake
+// the chip from light sleep: wake sources must use level interrupts with
+// wakeup enabled (see powerArmLevelWake and ButtonInput::enableSleepWake).
+//
+// If esp_pm refuses light sleep, the manager falls back to frequency
+// scaling alone; if that is refused too (power management not compiled
+// in), it only replaces the fixed delay with the deadline wait.
+#ifndef POWER_MANAGER_H
+#define POWER_MANAGER_H
+
+#include <Arduino.h>
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "soc/gpio_reg.h"
+#include "DeadlineScheduler.h"
+
+enum PowerMode : uint8_t {
+  POWER_MODE_FIXED = 0,     // esp_pm unavailable: fixed clock, deadline waits only
+  POWER_MODE_DFS,           // Clock drops to the minimum while idle
+  POWER_MODE_LIGHT_SLEEP    // DFS plus automatic light sleep
+};
+
+static const char* const POWER_MODE_NAMES[] = { "fixed", "dfs", "light" };
+
+// Reasons to keep the chip out of light sleep (keepAwake bits)
+static const uint8_t POWER_AWAKE_USB = 0x01;
+static const uint8_t POWER_AWAKE_GBA_LINK = 0x02;
+
+static TaskHandle_t _powerWakeTask = nullptr;
+
+// Re-arm a GPIO level interrupt from its ISR (type 4 = low, 5 = high). With
+// wakeup enabled on the pin, the armed level also ends light sleep.
+static inline void IRAM_ATTR powerArmLevelWake(int pin, bool high) {
+  REG_SET_FIELD(GPIO_PIN0_REG + (pin * 4), GPIO_PIN0_INT_TYPE, high ? 5 : 4);
+}
+
+// Ends loop()'s current wait; safe from any ISR
+static inline void IRAM_ATTR powerWakeFromIsr() {
+  if (_powerWakeTask == nullptr) {
+    return;
+  }
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(_powerWakeTask, &woken);
+  if (woken == pdTRUE) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+class PowerLock {
+public:
+  void create(esp_pm_lock_type_t type, const char* name) {
+    if (handle == nullptr && esp_pm_lock_create(type, 0, name, &handle) != ESP_OK) {
+      handle = nullptr;
+    }
+  }
+  void acquire() {
+    if (handle != nullptr && !held) {
+      esp_pm_lock_acquire(handle);
+      held = true;
+    }
+  }
+  void release() {
+    if (handle != nullptr && held) {
+      esp_pm_lock_release(handle);
+      held = false;
+    }
+  }
+
+private:
+  esp_pm_lock_handle_t handle = nullptr;
+  bool held = false;
+};
+
+class PowerManager {
+public:
+  // Call from setup(): the calling task (loop()) is the one wait() blocks
+  PowerMode begin(uint32_t maxMhz, uint32_t minMhz, bool lightSleep) {
+    _powerWakeTask = xTaskGetCurrentTaskHandle();
+    maxCpuMhz = maxMhz;
+    minCpuMhz = minMhz;
+    esp_pm_config_t config = {};
+    config.max_freq_mhz = (int)maxMhz;
+    config.min_freq_mhz = (int)minMhz;
+    config.light_sleep_enable = lightSleep;
+    esp_err_t err = esp_pm_configure(&config);
+    if (err != ESP_OK && lightSleep) {
+      config.light_sleep_enable = false;
+      err = esp_pm_configure(&config);
+    }
+    if (err != ESP_OK) {
+      powerMode = POWER_MODE_FIXED;
+    } else {
+      powerMode = config.light_sleep_enable ? POWER_MODE_LIGHT_SLEEP : POWER_MODE_DFS;
+    }
+    if (powerMode == POWER_MODE_LIGHT_SLEEP) {
+      esp_sleep_enable_gpio_wakeup();
+    }
+    cpuLock.create(ESP_PM_CPU_FREQ_MAX, "loop");
+    awakeLock.create(ESP_PM_NO_LIGHT_SLEEP, "awake");
+    cpuLock.acquire();
+    lastWakeUs = esp_timer_get_time();
+    windowStartUs = lastWakeUs;
+    return powerMode;
+  }
+
+  PowerMode mode() const { return powerMode; }
+  bool scaling() const { return powerMode != POWER_MODE_FIXED; }
+  uint32_t maxMhz() const { return maxCpuMhz; }
+  uint32_t minMhz() const { return minCpuMhz; }
+
+  // Hold the chip out of light sleep while any POWER_AWAKE_* reason is set
+  void keepAwake(uint8_t reasons) {
+    if (reasons != 0) {
+      awakeLock.acquire();
+    } else {
+      awakeLock.release();
+    }
+    awakeReasons = reasons;
+  }
+  uint8_t awakeMask() const { return awakeReasons; }
+
+  // Block loop() for up to waitMs (at least one tick), or until notified.
+  // `source` is the deadline the wait was planned for. Returns true if an
+  // interrupt or another task ended the wait early.
+  bool wait(uint32_t waitMs, WakeSource source) {
+    int64_t startUs = esp_timer_get_time();
+    accum.activeUs += (uint32_t)(startUs - lastWakeUs);
+    TickType_t ticks = pdMS_TO_TICKS(waitMs);
+    if (ticks == 0) {
+      ticks = 1;
+    }
+    cpuLock.release();
+    bool notified = ulTaskNotifyTake(pdTRUE, ticks) > 0;
+    cpuLock.acquire();
+    int64_t nowUs = esp_timer_get_time();
+    uint32_t blockedUs = (uint32_t)(nowUs - startUs);
+    accum.blockedUs += blockedUs;
+    if (powerMode == POWER_MODE_LIGHT_SLEEP && awakeReasons == 0) {
+      accum.sleepableUs += blockedUs;
+    }
+    accum.wakes++;
+    accum.wakesBy[notified ? WAKE_INTERRUPT : source]++;
+    lastWakeUs = nowUs;
+    return notified;
+  }
+
+  // Close a stats window (once per DEBUG_STATS_WINDOW_MS, from loop())
+  void publish() {
+    int64_t nowUs = esp_timer_get_time();
+    published = accum;
+    published.windowUs = (uint32_t)(nowUs - windowStartUs);
+    accum = Window{};
+    windowStartUs = nowUs;
+  }
+
+  // Share of the last window, in permille
+  uint32_t activePermille() const { return permille(published.activeUs); }
+  uint32_t blockedPermille() const { return permille(published.blockedUs); }
+  uint32_t sleepablePermille() const { return permille(published.sleepableUs); }  // Blocked with light sleep allowed
+  uint32_t wakesPerWindow() const { return published.wakes; }
+  uint32_t wakesFor(WakeSource source) const { return published.wakesBy[source]; }
+
+  // Most frequent reason loop() woke in the last window
+  WakeSource topWakeSource() const {
+    uint8_t top = 0;
+    for (uint8_t i = 1; i <= WAKE_TIMEOUT; i++) {
+      if (published.wakesBy[i] > published.wakesBy[top]) {
+        top = i;
+      }
+    }
+    return (WakeSource)top;
+  }
+
+private:
+  struct Window {
+    uint32_t windowUs;
+    uint32_t activeUs;
+    uint32_t blockedUs;
+    uint32_t sleepableUs;
+    uint32_t wakes;
+    uint32_t wakesBy[WAKE_TIMEOUT + 1];
+  };
+
+  uint32_t permille(uint32_t us) const {
+    return (published.windowUs > 0) ? (uint32_t)(((uint64_t)us * 1000ULL) / published.windowUs) : 0;
+  }
+
+  PowerMode powerMode = POWER_MODE_FIXED;
+  uint32_t maxCpuMhz = 0;
+  uint32_t minCpuMhz = 0;
+  PowerLock cpuLock;
+  PowerLock awakeLock;
+  uint8_t awakeReasons = 0;
+  int64_t lastWakeUs = 0;
+  int64_t windowStartUs = 0;
+  Window accum = {};
+  Window published = {};
+};
+
+#endif // POWER_MANAGER_H
@@ -0,0 +1,315 @@
+// SessionLogFormat.h - Block format of the on-flash UV session log
+//
+// The log is a sequence of fixed-size blocks, each decodable on its own so
+// a torn or lost block only costs its own samples:
+//
+//   Header  magic "UVL1", session number, block sequence, time of the
+//           first sample (ms since that session's boot); little-endian
+//   Records one per sensor sample, until a 0xFF pad byte or block end
+//
+// Each record is a tag byte followed by varints:
+//
+//   tag     bars (bits 0-3), game (4-5), battery present (6), range mode (7)
+//   varint  ms since the previous sample
+//   varint  zigzag delta of the 20-bit raw UVS count
+//   varint  zigzag delta of the bar UVI in thousandths
+//   varint  zigzag delta of battery millivolts (battery present only)
+//
+// Deltas restart from zero at every block, so the first record of a block
+// carries absolute values. Consecutive samples rarely differ by much, so a
+// typical record is 4-6 bytes. A tag can never be 0xFF, because bars stay
+// below 15. The static_asserts below hold GameProfiles.h to the tag's
+// widths: at most 4 games and 14 bars.
+//
+// The 'L' dump prints every stored block as hex (SessionLogRawParser
+// below), so host/session_log_decode can read a log without LittleFS.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef SESSION_LOG_FORMAT_H
+#define SESSION_LOG_FORMAT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "GameProfiles.h"
+
+static const uint32_t SESSION_LOG_MAGIC = 0x314C5655;  // "UVL1"
+static const size_t SESSION_LOG_HEADER_BYTES = 16;
+static const size_t SESSION_LOG_MAX_RECORD_BYTES = 1 + 5 + 5 + 5 + 5;
+static const uint8_t SESSION_LOG_PAD = 0xFF;
+
+// Tag fields: a game needs its own index in 2 bits, and 15 bars (with game
+// 3, battery and the fast range) would make a tag equal to the pad byte
+static const int SESSION_LOG_TAG_GAMES = 4;
+static const int SESSION_LOG_TAG_MAX_BARS = 14;
+static_assert(NUM_GAMES <= SESSION_LOG_TAG_GAMES, "Session log tag has 2 bits for the game; widen it for more games");
+static_assert(GAME_MAX_BARS <= SESSION_LOG_TAG_MAX_BARS, "Session log tag has 4 bits for bars, and 15 is reserved");
+
+struct SessionLogSample {
+  uint32_t timeMs;      // ms since the session's boot
+  uint32_t rawUVS;
+  int32_t uviMilli;     // UVI used for bars, x1000
+  uint8_t bars;
+  uint8_t game;
+  uint8_t rangeMode;
+  bool hasBattery;      // batteryMv was updated by this record
+  uint16_t batteryMv;   // Last logged battery voltage (0 = none yet)
+};
+
+struct SessionLogBlockHeader {
+  uint16_t session;
+  uint32_t sequence;
+  uint32_t startMs;
+};
+
+static inline void sessionLogPut32(uint8_t* p, uint32_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t sessionLogGet32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint32_t sessionLogZigzag(int32_t v) {
+  return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static inline int32_t sessionLogUnzigzag(uint32_t v) {
+  return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+// Fills one block. append() returns false once the next record might not
+// fit; finish() pads the rest so the block can be written whole.
+class SessionLogBlockWriter {
+public:
+  void begin(uint8_t* block, size_t blockBytes, uint16_t session, uint32_t sequence, uint32_t startMs) {
+    buf = block;
+    size = blockBytes;
+    sessionLogPut32(buf, SESSION_LOG_MAGIC);
+    sessionLogPut32(buf + 4, session);
+    sessionLogPut32(buf + 8, sequence);
+    sessionLogPut32(buf + 12, startMs);
+    used = SESSION_LOG_HEADER_BYTES;
+    records = 0;
+    prevTimeMs = startMs;
+    prevRaw = 0;
+    prevUviMilli = 0;
+    prevBatteryMv = 0;
+  }
+
+  bool append(const SessionLogSample& s) {
+    if (used + SESSION_LOG_MAX_RECORD_BYTES > size) {
+      return false;
+    }
+    uint8_t tag = (uint8_t)((s.bars & 0x0F) | ((s.game & 0x03) << 4) |
+                            (s.hasBattery ? 0x40 : 0) | ((s.rangeMode & 0x01) << 7));
+    buf[used++] = tag;
+    putVarint(s.timeMs - prevTimeMs);
+    putVarint(sessionLogZigzag((int32_t)(s.rawUVS - prevRaw)));
+    putVarint(sessionLogZigzag(s.uviMilli - prevUviMilli));
+    if (s.hasBattery) {
+      putVarint(sessionLogZigzag((int32_t)s.batteryMv - (int32_t)prevBatteryMv));
+      prevBatteryMv = s.batteryMv;
+    }
+    prevTimeMs = s.timeMs;
+    prevRaw = s.rawUVS;
+    prevUviMilli = s.uviMilli;
+    records++;
+    return true;
+  }
+
+  void finish() {
+    memset(buf + used, SESSION_LOG_PAD, size - used);
+  }
+
+  size_t bytesUsed() const { return used; }
+  uint32_t recordCount() const { return records; }
+
+private:
+  void putVarint(uint32_t v) {
+    while (v >= 0x80) {
+      buf[used++] = (uint8_t)(v | 0x80);
+      v >>= 7;
+    }
+    buf[used++] = (uint8_t)v;
+  }
+
+  uint8_t* buf = nullptr;
+  size_t size = 0;
+  size_t used = 0;
+  uint32_t records = 0;
+  uint32_t prevTimeMs = 0;
+  uint32_t prevRaw = 0;
+  int32_t prevUviMilli = 0;
+  uint16_t prevBatteryMv = 0;
+};
+
+class SessionLogBlockReader {
+public:
+  // Returns false if the block does not start with a valid header
+  bool begin(const uint8_t* block, size_t blockBytes, SessionLogBlockHeader* header) {
+    buf = block;
+    size = blockBytes;
+    if (size < SESSION_LOG_HEADER_BYTES || sessionLogGet32(buf) != SESSION_LOG_MAGIC) {
+      return false;
+    }
+    header->session = (uint16_t)sessionLogGet32(buf + 4);
+    header->sequence = sessionLogGet32(buf + 8);
+    header->startMs = sessionLogGet32(buf + 12);
+    pos = SESSION_LOG_HEADER_BYTES;
+    last.timeMs = header->startMs;
+    last.rawUVS = 0;
+    last.uviMilli = 0;
+    last.batteryMv = 0;
+    return true;
+  }
+
+  // Next record, or false at the end of the block (or on a corrupt record)
+  bool next(SessionLogSample* out) {
+    if (pos >= size || buf[pos] == SESSION_LOG_PAD) {
+      return false;
+    }
+    uint8_t tag = buf[pos++];
+    uint32_t dt, dRaw, dUvi, dBattery = 0;
+    if (!getVarint(&dt) || !getVarint(&dRaw) || !getVarint(&dUvi)) {
+      return false;
+    }
+    bool hasBattery = (tag & 0x40) != 0;
+    if (hasBattery && !getVarint(&dBattery)) {
+      return false;
+    }
+    last.bars = tag & 0x0F;
+    last.game = (tag >> 4) & 0x03;
+    last.rangeMode = tag >> 7;
+    last.hasBattery = hasBattery;
+    last.timeMs += dt;
+    last.rawUVS += (uint32_t)sessionLogUnzigzag(dRaw);
+    last.uviMilli += sessionLogUnzigzag(dUvi);
+    if (hasBattery) {
+      last.batteryMv = (uint16_t)((int32_t)last.batteryMv + sessionLogUnzigzag(dBattery));
+    }
+    *out = last;
+    return true;
+  }
+
+private:
+  bool getVarint(uint32_t* out) {
+    uint32_t v = 0;
+    for (uint8_t shift = 0; shift < 35; shift += 7) {
+      if (pos >= size) {
+        return false;
+      }
+      uint8_t b = buf[pos++];
+      v |= (uint32_t)(b & 0x7F) << shift;
+      if ((b & 0x80) == 0) {
+        *out = v;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  const uint8_t* buf = nullptr;
+  size_t size = 0;
+  size_t pos = 0;
+  SessionLogSample last = {};
+};
+
+// ---- Raw dump ('L') ----
+//
+//   # session log raw <block bytes>
+//   <64 bytes as hex>            (block bytes / 64 lines per block)
+//   # end
+//
+// Blocks are printed whole, readable or not, in file order.
+
+static const char* const SESSION_LOG_RAW_BEGIN = "# session log raw";
+static const char* const SESSION_LOG_RAW_END = "# end";
+static const size_t SESSION_LOG_RAW_LINE_BYTES = 64;
+static const size_t SESSION_LOG_RAW_MAX_BLOCK = 16384;
+
+static inline int sessionLogFormatRawBegin(char* out, size_t size, size_t blockBytes) {
+  return snprintf(out, size, "%s %u", SESSION_LOG_RAW_BEGIN, (unsigned)blockBytes);
+}
+
+// count <= SESSION_LOG_RAW_LINE_BYTES; out needs 2 * count + 1 chars
+static inline void sessionLogFormatRawLine(char* out, const uint8_t* bytes, size_t count) {
+  static const char HEX_DIGITS[] = "0123456789abcdef";
+  for (size_t i = 0; i < count; i++) {
+    out[2 * i] = HEX_DIGITS[bytes[i] >> 4];
+    out[2 * i + 1] = HEX_DIGITS[bytes[i] & 0x0F];
+  }
+  out[2 * count] = '\0';
+}
+
+// Rebuilds the blocks of a raw dump, one line at a time. Lines before the
+// begin marker are skipped; onBlock(block, blockBytes) runs for each block
+// as its last line arrives.
+class SessionLogRawParser {
+public:
+  template <typename F>
+  bool line(const char* text, F onBlock) {
+    if (state == WAITING) {
+      size_t n = strlen(SESSION_LOG_RAW_BEGIN);
+      if (strncmp(text, SESSION_LOG_RAW_BEGIN, n) == 0) {
+        blockBytes = strtoul(text + n, nullptr, 10);
+        bool valid = blockBytes >= SESSION_LOG_HEADER_BYTES && blockBytes <= SESSION_LOG_RAW_MAX_BLOCK &&
+                     (blockBytes % SESSION_LOG_RAW_LINE_BYTES) == 0;
+        state = valid ? BLOCKS : FAILED;
+        filled = 0;
+        blocks = 0;
+      }
+      return state != FAILED;
+    }
+    if (state != BLOCKS) {
+      return state == DONE;
+    }
+    if (strncmp(text, SESSION_LOG_RAW_END, strlen(SESSION_LOG_RAW_END)) == 0) {
+      state = (filled == 0) ? DONE : FAILED;  // A partial block means a cut-off capture
+      return state == DONE;
+    }
+    for (size_t i = 0; i < SESSION_LOG_RAW_LINE_BYTES; i++) {
+      int hi = hexValue(text[2 * i]);
+      int lo = (hi < 0) ? -1 : hexValue(text[2 * i + 1]);
+      if (lo < 0) {
+        state = FAILED;
+        return false;
+      }
+      block[filled++] = (uint8_t)((hi << 4) | lo);
+    }
+    if (filled == blockBytes) {
+      onBlock((const uint8_t*)block, blockBytes);
+      filled = 0;
+      blocks++;
+    }
+    return true;
+  }
+
+  bool done() const { return state == DONE; }
+  bool failed() const { return state == FAILED; }
+  uint32_t blockCount() const { return blocks; }
+
+private:
+  enum State : uint8_t { WAITING, BLOCKS, DONE, FAILED };
+
+  static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  State state = WAITING;
+  size_t blockBytes = 0;
+  size_t filled = 0;
+  uint32_t blocks = 0;
+  uint8_t block[SESSION_LOG_RAW_MAX_BLOCK];
+};
+
+#endif // SESSION_LOG_FORMAT_H
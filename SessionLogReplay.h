@@ -0,0 +1,101 @@
+// SessionLogReplay.h - Logged samples through this build's bar pipeline
+//
+// Each logged raw count is converted with this build's calibration (the
+// divisor of the range mode it was taken in, enclosure compensation),
+// smoothed and classified the way handleUvSample() does it: the fixed-point
+// filter pipeline or the legacy EMA + hysteresis, restarted at every new
+// session and without hysteresis after a game change. Comparing replay_bars
+// with the logged bars shows what a threshold, calibration or filter
+// change would have done to a real session.
+//
+// The 'l' dump uses this on the device; host/session_log_decode runs it on
+// a PC against a raw 'L' dump. Both print the same CSV.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef SESSION_LOG_REPLAY_H
+#define SESSION_LOG_REPLAY_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+#include "BarThresholds.h"
+#include "SessionLogFormat.h"
+#include "UvFilter.h"
+
+struct SessionLogReplayConfig {
+  BarThresholdConfig bars;
+  float rangeDivisor[2];     // Counts per UVI in range mode 0 (slow) and 1 (fast)
+  bool filterPipeline;       // UV_FILTER_PIPELINE_ENABLED
+  UvFilterConfig filter;
+  bool smoothing;            // UVI_SMOOTHING_ENABLED (legacy path)
+  float smoothingAlpha;      // UVI_SMOOTHING_ALPHA
+};
+
+class SessionLogReplay {
+public:
+  void begin(const SessionLogReplayConfig& config) {
+    cfg = config;
+    barBuildStartsMilli(cfg.bars, startsMilli);
+    filter.configure(cfg.filter);
+    session = -1;
+    game = -1;
+    bars = 0;
+    smoothed = 0.0f;
+    uviForBars = 0.0f;
+  }
+
+  // Feed samples in log order; returns the replayed bar count
+  int update(const SessionLogBlockHeader& header, const SessionLogSample& sample) {
+    float uvi = barCompareUvi(cfg.bars, sample.rawUVS, cfg.rangeDivisor[sample.rangeMode & 1]);
+    bool newSession = header.session != session;
+    bool restart = newSession || (sample.game != game);
+    int g = barGameIndex(sample.game);
+    if (cfg.filterPipeline) {
+      if (newSession) {
+        filter.reset();
+      }
+      int32_t filtered = filter.update((int32_t)lroundf(uvi * 1000.0f), sample.timeMs);
+      uvi = filtered / 1000.0f;
+      bars = uvFilterBars(startsMilli[g], GAME_BARS[g], filtered, restart ? -1 : bars, filter.slope(),
+                          filter.config());
+    } else {
+      if (cfg.smoothing) {
+        smoothed = newSession ? uvi : (cfg.smoothingAlpha * uvi) + ((1.0f - cfg.smoothingAlpha) * smoothed);
+        uvi = smoothed;
+      }
+      bars = restart ? barsForUvi(cfg.bars, uvi, g) : barsForUviWithHysteresis(cfg.bars, uvi, g, bars);
+    }
+    session = header.session;
+    game = sample.game;
+    uviForBars = uvi;
+    return bars;
+  }
+
+  // UVI the last replayed bar count was classified from
+  float uvi() const { return uviForBars; }
+
+private:
+  SessionLogReplayConfig cfg = {};
+  int32_t startsMilli[NUM_GAMES][GAME_MAX_BARS] = {};
+  UvFilter filter;
+  int session = -1;
+  int game = -1;
+  int bars = 0;
+  float smoothed = 0.0f;
+  float uviForBars = 0.0f;
+};
+
+static const char* const SESSION_LOG_CSV_HEADER =
+    "session,ms,game,range,raw,uvi,bars,battery_mv,replay_uvi,replay_bars";
+
+// One CSV row: the logged sample (game 1-based, as on screen), then the replay
+static inline int sessionLogFormatCsv(char* out, size_t size, const SessionLogBlockHeader& header,
+                                      const SessionLogSample& sample, float replayUvi, int replayBars) {
+  return snprintf(out, size, "%u,%lu,%u,%u,%lu,%.3f,%u,%u,%.3f,%d", (unsigned)header.session,
+                  (unsigned long)sample.timeMs, (unsigned)(sample.game + 1), (unsigned)sample.rangeMode,
+                  (unsigned long)sample.rawUVS, sample.uviMilli / 1000.0f, (unsigned)sample.bars,
+                  (unsigned)sample.batteryMv, replayUvi, replayBars);
+}
+
+#endif // SESSION_LOG_REPLAY_H
@@ -0,0 +1,326 @@
+// SessionLogger.h - Append-only UV session log on LittleFS
+//
+// loop() encodes each sample into one of two RAM blocks (SessionLogFormat.h);
+// a full block is handed to a low-priority writer task that appends it to
+// the current log file in a single write, so loop() never waits on flash.
+// If the writer falls a whole block behind, samples are dropped and counted
+// rather than buffered without bound.
+//
+// Files are /uvlog/NNNNN.ulg, numbered in write order. A file is closed
+// after fileBytes and the oldest files are deleted to keep the log under
+// maxBytes, which leaves LittleFS free blocks to spread wear over. Each
+// boot starts a new file and session number. Mounting (which formats the
+// partition on first use) happens in the writer task, off the boot path;
+// samples taken meanwhile wait in the RAM blocks.
+//
+// Flash program/erase briefly stalls both cores' caches, which delays any
+// interrupt not in IRAM; see SESSION_LOG_ENABLED in config.h.
+#ifndef SESSION_LOGGER_H
+#define SESSION_LOGGER_H
+
+#include <Arduino.h>
+#include <FS.h>
+#include <LittleFS.h>
+#include <atomic>
+#include "SessionLogFormat.h"
+
+const size_t SESSION_LOG_BLOCK_BYTES = 4096;  // One LittleFS block / flash sector
+static const char* const SESSION_LOG_DIR = "/uvlog";
+
+class SessionLogger {
+public:
+  bool begin(uint32_t fileBytes, uint32_t maxBytes, int core) {
+    fileLimit = (fileBytes < SESSION_LOG_BLOCK_BYTES) ? SESSION_LOG_BLOCK_BYTES : fileBytes;
+    totalLimit = (maxBytes < fileLimit * 2) ? fileLimit * 2 : maxBytes;
+    full[0] = false;
+    full[1] = false;
+    active = 0;
+    writeIndex = 0;
+    sequence = 0;
+    blockOpen = false;
+    running = true;
+    BaseType_t created = xTaskCreatePinnedToCore(writerMain, "uvlog", 4096, this, 1, &writerTask, core);
+    if (created != pdPASS) {
+      writerTask = nullptr;
+      running = false;
+    }
+    return running;
+  }
+
+  // False if the task could not start or the filesystem failed to mount
+  bool isRunning() const { return running; }
+  bool isMounted() const { return mounted; }
+
+  void append(const SessionLogSample& sample) {
+    if (!running || paused) {
+      return;
+    }
+    if (!blockOpen) {
+      if (full[active].load()) {
+        dropped++;  // Writer still busy with this buffer
+        return;
+      }
+      writer.begin(buffers[active], SESSION_LOG_BLOCK_BYTES, 0, sequence++, sample.timeMs);
+      blockOpen = true;
+    }
+    if (!writer.append(sample)) {
+      sealActive();
+      append(sample);
+      return;
+    }
+    records++;
+  }
+
+  // Hand over the partly filled block and wait (up to timeoutMs) for the
+  // writer to drain. Used before sleep, restart and log dumps.
+  void flush(unsigned long timeoutMs) {
+    if (!running) {
+      return;
+    }
+    if (blockOpen) {
+      sealActive();
+    }
+    unsigned long startMs = millis();
+    while (!drained() && (millis() - startMs) < timeoutMs) {
+      delay(1);
+    }
+  }
+
+  bool drained() const { return !full[0].load() && !full[1].load(); }
+
+  // Stop appending (and close the file) so the log can be read back.
+  // Returns false, still logging, if the writer did not drain in time: a
+  // queued block may be the RAM block forEachBlock() reads through, and
+  // the file may still be open for writing.
+  bool pause() {
+    flush(1000);
+    if (!drained()) {
+      return false;
+    }
+    paused = true;
+    closeFile();  // The writer is idle, so the file is ours
+    return true;
+  }
+
+  void resume() { paused = false; }
+
+  // Every log file, oldest first. The callback gets its path.
+  template <typename F>
+  void forEachFile(F callback) {
+    scanFiles();
+    char path[32];
+    for (uint32_t n = oldestFile; n != 0 && n <= newestFile; n++) {
+      filePath(path, sizeof(path), n);
+      if (LittleFS.exists(path)) {
+        callback(path);
+      }
+    }
+  }
+
+  // Every stored block, oldest first, calling
+  // callback(const uint8_t* block, size_t blockBytes). Only while paused:
+  // it reads through one of the RAM blocks.
+  template <typename F>
+  void forEachBlock(F callback) {
+    uint8_t* block = buffers[0];
+    forEachFile([&](const char* path) {
+      File file = LittleFS.open(path, "r");
+      if (!file) {
+        return;
+      }
+      while (file.read(block, SESSION_LOG_BLOCK_BYTES) == SESSION_LOG_BLOCK_BYTES) {
+        callback((const uint8_t*)block, SESSION_LOG_BLOCK_BYTES);
+      }
+      file.close();
+    });
+  }
+
+  // Decode every logged sample, oldest first, calling
+  // callback(const SessionLogBlockHeader&, const SessionLogSample&).
+  // Only while paused. Returns the number of blocks that failed to decode.
+  template <typename F>
+  uint32_t forEachSample(F callback) {
+    uint32_t badBlocks = 0;
+    forEachBlock([&](const uint8_t* block, size_t blockBytes) {
+      SessionLogBlockReader reader;
+      SessionLogBlockHeader header;
+      if (!reader.begin(block, blockBytes, &header)) {
+        badBlocks++;
+        return;
+      }
+      SessionLogSample sample;
+      while (reader.next(&sample)) {
+        callback(header, sample);
+      }
+    });
+    return badBlocks;
+  }
+
+  // False, with nothing erased, if the log could not be paused
+  bool eraseAll() {
+    if (!pause()) {
+      return false;
+    }
+    forEachFile([](const char* path) { LittleFS.remove(path); });
+    scanFiles();
+    resume();
+    return true;
+  }
+
+  uint32_t recordsLogged() const { return records; }
+  uint32_t recordsDropped() const { return dropped; }
+  uint32_t blocksWritten() const { return blocks; }
+  uint32_t writeErrors() const { return errors; }
+  uint32_t maxWriteMs() const { return maxWriteUs / 1000; }
+  uint32_t storedBytes() const { return storedTotal; }
+  uint32_t filesKept() const { return (newestFile >= oldestFile && oldestFile != 0) ? (newestFile - oldestFile + 1) : 0; }
+
+private:
+  static void writerMain(void* arg) {
+    SessionLogger* self = static_cast<SessionLogger*>(arg);
+    if (!self->mount()) {
+      self->running = false;
+      self->writerTask = nullptr;
+      vTaskDelete(nullptr);
+      return;
+    }
+    for (;;) {
+      ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      while (self->full[self->writeIndex].load()) {
+        self->writeBlock(self->buffers[self->writeIndex]);
+        self->full[self->writeIndex].store(false);
+        self->writeIndex ^= 1;
+      }
+    }
+  }
+
+  bool mount() {
+    if (!LittleFS.begin(true)) {
+      return false;
+    }
+    if (!LittleFS.exists(SESSION_LOG_DIR)) {
+      LittleFS.mkdir(SESSION_LOG_DIR);
+    }
+    scanFiles();
+    nextFile = newestFile + 1;
+    session = (uint16_t)nextFile;
+    mounted = true;
+    return true;
+  }
+
+  void sealActive() {
+    writer.finish();
+    blockOpen = false;
+    full[active].store(true);
+    active ^= 1;
+    if (writerTask != nullptr) {
+      xTaskNotifyGive(writerTask);
+    }
+  }
+
+  void writeBlock(uint8_t* block) {
+    unsigned long startUs = micros();
+    sessionLogPut32(block + 4, session);  // Only known once mounted
+    if (!currentFile || currentFile.size() + SESSION_LOG_BLOCK_BYTES > fileLimit) {
+      openNextFile();
+    }
+    if (!currentFile || currentFile.write(block, SESSION_LOG_BLOCK_BYTES) != SESSION_LOG_BLOCK_BYTES) {
+      errors++;
+      closeFile();
+      return;
+    }
+    currentFile.flush();
+    blocks++;
+    storedTotal += SESSION_LOG_BLOCK_BYTES;
+    uint32_t elapsedUs = (uint32_t)(micros() - startUs);
+    if (elapsedUs > maxWriteUs) {
+      maxWriteUs = elapsedUs;
+    }
+  }
+
+  void openNextFile() {
+    closeFile();
+    // Make room for a whole new file before creating it
+    char path[32];
+    while (oldestFile != 0 && oldestFile <= newestFile && storedTotal + fileLimit > totalLimit) {
+      filePath(path, sizeof(path), oldestFile);
+      File old = LittleFS.open(path, "r");
+      uint32_t oldBytes = old ? (uint32_t)old.size() : 0;
+      if (old) {
+        old.close();
+      }
+      LittleFS.remove(path);
+      storedTotal = (storedTotal > oldBytes) ? (storedTotal - oldBytes) : 0;
+      oldestFile++;
+    }
+    filePath(path, sizeof(path), nextFile);
+    currentFile = LittleFS.open(path, "w");
+    if (currentFile) {
+      if (oldestFile == 0 || oldestFile > newestFile) {
+        oldestFile = nextFile;
+      }
+      newestFile = nextFile;
+      nextFile++;
+    }
+  }
+
+  void closeFile() {
+    if (currentFile) {
+      currentFile.close();
+    }
+  }
+
+  // Find the oldest and newest file numbers and the bytes in use
+  void scanFiles() {
+    oldestFile = 0;
+    newestFile = 0;
+    storedTotal = 0;
+    File dir = LittleFS.open(SESSION_LOG_DIR);
+    if (!dir) {
+      return;
+    }
+    File entry = dir.openNextFile();
+    while (entry) {
+      uint32_t n = (uint32_t)strtoul(entry.name(), nullptr, 10);
+      if (n > 0) {
+        if (oldestFile == 0 || n < oldestFile) oldestFile = n;
+        if (n > newestFile) newestFile = n;
+        storedTotal += (uint32_t)entry.size();
+      }
+      entry = dir.openNextFile();
+    }
+  }
+
+  static void filePath(char* out, size_t outSize, uint32_t n) {
+    snprintf(out, outSize, "%s/%05lu.ulg", SESSION_LOG_DIR, (unsigned long)n);
+  }
+
+  uint8_t buffers[2][SESSION_LOG_BLOCK_BYTES];
+  std::atomic<bool> full[2];
+  uint8_t active = 0;        // Buffer loop() is filling
+  uint8_t writeIndex = 0;    // Next buffer the writer expects (blocks stay in order)
+  bool blockOpen = false;
+  SessionLogBlockWriter writer;
+  TaskHandle_t writerTask = nullptr;
+  File currentFile;
+  volatile bool running = false;
+  volatile bool mounted = false;
+  volatile bool paused = false;
+
+  uint32_t fileLimit = 0;
+  uint32_t totalLimit = 0;
+  uint32_t oldestFile = 0;
+  uint32_t newestFile = 0;
+  uint32_t nextFile = 1;
+  uint16_t session = 0;
+  uint32_t sequence = 0;
+  uint32_t storedTotal = 0;
+
+  uint32_t records = 0;
+  uint32_t dropped = 0;
+  uint32_t blocks = 0;
+  uint32_t errors = 0;
+  uint32_t maxWriteUs = 0;
+};
+
+#endif // SESSION_LOGGER_H
@@ -24,10 +24,23 @@
 const uint16_t TQT_RGB565_BLACK = 0x0000;
 const uint16_t TQT_RGB565_WHITE = 0xFFFF;
 
+// Changed rows are pushed in bands of up to this many rows per SPI window
+const int16_t TQT_BAND_ROWS = 8;
+
 class TQTDisplay : public GFXcanvas1 {
 public:
   TQTDisplay(uint16_t w, uint16_t h) : GFXcanvas1(w, h) {
-    lineBuf = new uint16_t[w];
+    bytesPerRow = (w + 7) / 8;
+    bandBuf = new uint16_t[w * TQT_BAND_ROWS];
+    sentBuf = new uint8_t[bytesPerRow * h];
+    memset(sentBuf, 0, bytesPerRow * h);
+    // 1-bit canvas byte -> 8 RGB565 pixels (MSB = leftmost pixel)
+    expandLut = new uint16_t[256 * 8];
+    for (int b = 0; b < 256; b++) {
+      for (int bit = 0; bit < 8; bit++) {
+        expandLut[(b * 8) + bit] = (b & (0x80 >> bit)) ? TQT_RGB565_WHITE : TQT_RGB565_BLACK;
+      }
+    }
     bus = new Arduino_ESP32SPI(6 /* DC */, 5 /* CS */, 3 /* SCK */, 2 /* MOSI */,
                                GFX_NOT_DEFINED /* MISO */);
     gfx = new Arduino_GC9107(bus, 1 /* RST */, 0 /* rotation */, true /* IPS */);
@@ -39,6 +52,7 @@ public:
     }
     gfx->setRotation(rotation);
     gfx->fillScreen(TQT_RGB565_BLACK);
+    markPanelBlack();
     xOffset = ((int16_t)gfx->width() - (int16_t)width()) / 2;
     yOffset = ((int16_t)gfx->height() - (int16_t)height()) / 2;
     if (xOffset < 0) xOffset = 0;
@@ -52,24 +66,73 @@ public:
   }
 
   // Push the canvas to the panel (equivalent of Adafruit_SSD1306::display()).
+  // Only rows that differ from the last pushed frame are sent; runs of
+  // changed rows go out as one band per SPI address window, expanded to
+  // RGB565 a byte (8 pixels) at a time through the lookup table.
   void display() {
+    displayRows(0, height() - 1);
+  }
+
+  // Push when only rows firstRow..lastRow can have changed since the last
+  // push (damage from UiWidgets.h); other rows are not even compared.
+  void displayRows(int16_t firstRow, int16_t lastRow) {
+    unsigned long startUs = micros();
     const uint8_t* buf = getBuffer();
     int16_t w = width();
     int16_t h = height();
-    int16_t bytesPerRow = (w + 7) / 8;
-    for (int16_t row = 0; row < h; row++) {
-      const uint8_t* src = buf + (row * bytesPerRow);
-      for (int16_t col = 0; col < w; col++) {
-        lineBuf[col] = (src[col >> 3] & (0x80 >> (col & 7))) ? TQT_RGB565_WHITE
-                                                             : TQT_RGB565_BLACK;
+    if (panelResync) {
+      // Panel was blanked behind the canvas's back: compare everything
+      firstRow = 0;
+      lastRow = h - 1;
+      panelResync = false;
+    }
+    if (firstRow < 0) firstRow = 0;
+    if (lastRow > h - 1) lastRow = h - 1;
+    int16_t sent = 0;
+    int16_t row = firstRow;
+    while (row <= lastRow) {
+      if (memcmp(buf + (row * bytesPerRow), sentBuf + (row * bytesPerRow), bytesPerRow) == 0) {
+        row++;
+        continue;
       }
-      gfx->draw16bitRGBBitmap(xOffset, yOffset + row, lineBuf, w, 1);
+      int16_t bandStart = row;
+      int16_t bandRows = 0;
+      while (row <= lastRow && bandRows < TQT_BAND_ROWS &&
+             memcmp(buf + (row * bytesPerRow), sentBuf + (row * bytesPerRow), bytesPerRow) != 0) {
+        expandRow(buf + (row * bytesPerRow), bandBuf + (bandRows * w), w);
+        memcpy(sentBuf + (row * bytesPerRow), buf + (row * bytesPerRow), bytesPerRow);
+        bandRows++;
+        row++;
+      }
+      gfx->draw16bitRGBBitmap(xOffset, yOffset + bandStart, bandBuf, w, bandRows);
+      sent += bandRows;
+    }
+
+    uint32_t elapsedUs = (uint32_t)(micros() - startUs);
+    lastPushUs = elapsedUs;
+    if (elapsedUs > maxPushUs) {
+      maxPushUs = elapsedUs;
+    }
+    if (sent == h) {
+      lastFullPushUs = elapsedUs;
     }
+    lastRowsSent = sent;
+    lastRowsSkipped = h - sent;
+    totalRowsSkipped += (uint32_t)(h - sent);
   }
 
+  // Push timing and dirty-row statistics
+  uint32_t lastPushMicros() const { return lastPushUs; }
+  uint32_t maxPushMicros() const { return maxPushUs; }
+  uint32_t lastFullPushMicros() const { return lastFullPushUs; }
+  int16_t lastPushRowsSent() const { return lastRowsSent; }
+  int16_t lastPushRowsSkipped() const { return lastRowsSkipped; }
+  uint32_t rowsSkippedTotal() const { return totalRowsSkipped; }
+
   // Blank the physical panel (letterbox areas included).
   void fillPanelBlack() {
     gfx->fillScreen(TQT_RGB565_BLACK);
+    markPanelBlack();
   }
 
   // Panel sleep draws ~100uA; the backlight pin is handled by the sketch.
@@ -94,12 +157,39 @@ public:
   }
 
 private:
+  void expandRow(const uint8_t* src, uint16_t* dst, int16_t w) {
+    int16_t col = 0;
+    for (int16_t i = 0; col < w; i++) {
+      const uint16_t* px = &expandLut[src[i] * 8];
+      int16_t n = (w - col) < 8 ? (w - col) : 8;
+      memcpy(dst + col, px, n * sizeof(uint16_t));
+      col += n;
+    }
+  }
+
+  // The panel now shows an all-black canvas area; the next push sends
+  // only the lit rows.
+  void markPanelBlack() {
+    memset(sentBuf, 0, bytesPerRow * height());
+    panelResync = true;
+  }
+
   Arduino_DataBus* bus;
   Arduino_GC9107* gfx;
-  uint16_t* lineBuf;
+  uint16_t* bandBuf;
+  uint16_t* expandLut;
+  uint8_t* sentBuf;     // Canvas contents as last pushed to the panel
+  int16_t bytesPerRow = 0;
+  uint32_t lastPushUs = 0;
+  uint32_t maxPushUs = 0;
+  uint32_t lastFullPushUs = 0;
+  int16_t lastRowsSent = 0;
+  int16_t lastRowsSkipped = 0;
+  uint32_t totalRowsSkipped = 0;
   int16_t xOffset = 0;
   int16_t yOffset = 0;
   bool panelAsleep = true;
+  bool panelResync = false;
 };
 
 #endif
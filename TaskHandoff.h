@@ -0,0 +1,96 @@
+// TaskHandoff.h - Lock-free handoff primitives between loop() and the UI task
+//
+// The sensor/HID pipeline (loop(), core 1) and display rendering (UI task,
+// core 0) exchange state through exactly two channels, so neither side
+// ever blocks on the other:
+// - Seqlock<T>: the producer publishes a complete snapshot; the consumer
+//   copies it and retries if a write overlapped the copy. Suited to
+//   "latest value wins" state such as bars, UVI and battery level.
+// - SpscQueue<T, N>: single-producer/single-consumer ring for discrete
+//   events that must each be seen once, in order.
+#ifndef TASK_HANDOFF_H
+#define TASK_HANDOFF_H
+
+#include <Arduino.h>
+#include <atomic>
+
+template <typename T>
+class Seqlock {
+public:
+  // Producer only
+  void write(const T& value) {
+    uint32_t seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed);  // Odd: write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(&data, &value, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_release);
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  // Consumer: returns false if the copy overlapped a write (retry).
+  bool tryRead(T& out) const {
+    uint32_t before = sequence.load(std::memory_order_acquire);
+    if ((before & 1U) != 0) {
+      return false;
+    }
+    memcpy(&out, &data, sizeof(T));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequence.load(std::memory_order_relaxed) == before;
+  }
+
+  // Consumer: spin until a consistent copy is read. Writes are a short
+  // memcpy, so this only retries when the copy races a publish.
+  void read(T& out) const {
+    while (!tryRead(out)) {
+    }
+  }
+
+  uint32_t version() const {
+    return sequence.load(std::memory_order_acquire) >> 1;
+  }
+
+private:
+  std::atomic<uint32_t> sequence{0};
+  T data;
+};
+
+// N must be a power of two; one slot is kept free to tell full from empty.
+template <typename T, uint16_t N>
+class SpscQueue {
+  static_assert((N & (N - 1)) == 0, "SpscQueue size must be a power of two");
+
+public:
+  // Producer only. Returns false if the queue is full.
+  bool push(const T& value) {
+    uint16_t head = writeIndex.load(std::memory_order_relaxed);
+    uint16_t next = (uint16_t)((head + 1) & (N - 1));
+    if (next == readIndex.load(std::memory_order_acquire)) {
+      return false;
+    }
+    slots[head] = value;
+    writeIndex.store(next, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer only. Returns false if the queue is empty.
+  bool pop(T& out) {
+    uint16_t tail = readIndex.load(std::memory_order_relaxed);
+    if (tail == writeIndex.load(std::memory_order_acquire)) {
+      return false;
+    }
+    out = slots[tail];
+    readIndex.store((uint16_t)((tail + 1) & (N - 1)), std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return readIndex.load(std::memory_order_acquire) == writeIndex.load(std::memory_order_acquire);
+  }
+
+private:
+  T slots[N];
+  std::atomic<uint16_t> writeIndex{0};
+  std::atomic<uint16_t> readIndex{0};
+};
+
+#endif
@@ -0,0 +1,320 @@
+// Telemetry.h - Framed binary telemetry over USB CDC (DEBUG_SERIAL_TELEMETRY)
+//
+// The text UV/battery debug streams format floats on the hot path and block
+// once the CDC TX FIFO is full, so enabling them changes the timing being
+// observed. With telemetry on, loop() instead encodes one fixed-size frame
+// per sensor sample into a lock-free byte ring, and the ring is drained only
+// as far as the CDC port can take without blocking. A frame that does not
+// fit is dropped and counted.
+//
+// Frame (little-endian):
+//
+//   0xA5 0x5A  sync
+//   len        payload bytes
+//   type       TELEMETRY_FRAME_SAMPLE
+//   payload    TelemetrySample fields, in declaration order
+//   crc16      CRC-16/CCITT-FALSE over len, type and payload
+//
+// seq counts every frame generated, including dropped ones, so a reader can
+// tell device-side drops (the dropped field) from bytes lost in transit.
+// Both restart from zero when the device reboots; the parser takes a seq
+// that goes backwards, or a dropped count that falls, as a new session
+// rather than a gap. Other Serial text (boot log, perf stats) may be
+// interleaved; the parser skips anything that is not a valid frame.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies:
+// TelemetryParser is the reference reader and can be built into host tools
+// as-is.
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <atomic>
+
+static const uint8_t TELEMETRY_SYNC0 = 0xA5;
+static const uint8_t TELEMETRY_SYNC1 = 0x5A;
+static const uint8_t TELEMETRY_FRAME_SAMPLE = 0x01;
+static const size_t TELEMETRY_SAMPLE_PAYLOAD = 30;
+static const size_t TELEMETRY_MAX_FRAME = 4 + TELEMETRY_SAMPLE_PAYLOAD + 2;
+const size_t TELEMETRY_TX_BYTES = 1024;  // Device TX ring: ~28 frames
+
+// HID state flags
+static const uint8_t TELEMETRY_HID_USB = 0x01;        // XInput active
+static const uint8_t TELEMETRY_HID_BLE = 0x02;        // BLE connected
+static const uint8_t TELEMETRY_HID_HOLDING = 0x04;    // Incremental press held
+static const uint8_t TELEMETRY_HID_SYNCING = 0x08;    // Incremental clamp/anchor in progress
+
+struct TelemetrySample {
+  uint16_t seq;
+  uint32_t timeUs;       // Device time, wraps every ~71 min
+  uint32_t rawUVS;
+  int32_t uviMilli;      // UVI used for bars, x1000
+  uint8_t bars;
+  uint8_t numBars;
+  uint8_t game;
+  uint8_t rangeMode;
+  uint16_t batteryAdc;   // Averaged ADC count (0 = no reading yet)
+  uint16_t batteryMv;
+  uint8_t hidFlags;      // TELEMETRY_HID_*
+  uint8_t hidMode;       // HID_CONTROL_MODE
+  uint16_t hidButtons;   // XInput button bits
+  uint32_t dropped;      // Frames dropped on the device so far
+};
+
+static inline uint16_t telemetryCrc16(const uint8_t* data, size_t len) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= (uint16_t)data[i] << 8;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+// Writes a whole frame into out (TELEMETRY_MAX_FRAME bytes); returns its length
+static inline size_t telemetryEncodeSample(const TelemetrySample& s, uint8_t* out) {
+  size_t n = 0;
+  out[n++] = TELEMETRY_SYNC0;
+  out[n++] = TELEMETRY_SYNC1;
+  out[n++] = (uint8_t)TELEMETRY_SAMPLE_PAYLOAD;
+  out[n++] = TELEMETRY_FRAME_SAMPLE;
+  auto put = [&](uint32_t v, uint8_t bytes) {
+    for (uint8_t i = 0; i < bytes; i++) {
+      out[n++] = (uint8_t)(v >> (8 * i));
+    }
+  };
+  put(s.seq, 2);
+  put(s.timeUs, 4);
+  put(s.rawUVS, 4);
+  put((uint32_t)s.uviMilli, 4);
+  put(s.bars, 1);
+  put(s.numBars, 1);
+  put(s.game, 1);
+  put(s.rangeMode, 1);
+  put(s.batteryAdc, 2);
+  put(s.batteryMv, 2);
+  put(s.hidFlags, 1);
+  put(s.hidMode, 1);
+  put(s.hidButtons, 2);
+  put(s.dropped, 4);
+  uint16_t crc = telemetryCrc16(out + 2, n - 2);
+  put(crc, 2);
+  return n;
+}
+
+static inline bool telemetryDecodeSample(const uint8_t* p, size_t len, TelemetrySample* s) {
+  if (len != TELEMETRY_SAMPLE_PAYLOAD) {
+    return false;
+  }
+  size_t n = 0;
+  auto get = [&](uint8_t bytes) {
+    uint32_t v = 0;
+    for (uint8_t i = 0; i < bytes; i++) {
+      v |= (uint32_t)p[n++] << (8 * i);
+    }
+    return v;
+  };
+  s->seq = (uint16_t)get(2);
+  s->timeUs = get(4);
+  s->rawUVS = get(4);
+  s->uviMilli = (int32_t)get(4);
+  s->bars = (uint8_t)get(1);
+  s->numBars = (uint8_t)get(1);
+  s->game = (uint8_t)get(1);
+  s->rangeMode = (uint8_t)get(1);
+  s->batteryAdc = (uint16_t)get(2);
+  s->batteryMv = (uint16_t)get(2);
+  s->hidFlags = (uint8_t)get(1);
+  s->hidMode = (uint8_t)get(1);
+  s->hidButtons = (uint16_t)get(2);
+  s->dropped = get(4);
+  return true;
+}
+
+// Single-producer/single-consumer byte ring. push() never blocks: a frame
+// that does not fit whole is dropped. drain() writes only whole frames, and
+// only as many as the port reports it can take (availableForWrite()), so it
+// never blocks and other Serial text can never land inside a frame. If the
+// port still takes less than it offered, the tail stays on the last whole
+// frame written and the cut frame is sent again in full next time; the
+// reader skips the stray partial copy like any other garbage.
+template <size_t SIZE>
+class TelemetryTx {
+  static_assert((SIZE & (SIZE - 1)) == 0, "TelemetryTx size must be a power of two");
+
+public:
+  bool push(const uint8_t* frame, size_t len) {
+    uint32_t head = _head.load(std::memory_order_relaxed);
+    uint32_t tail = _tail.load(std::memory_order_acquire);
+    if (SIZE - (head - tail) < len) {
+      _dropped++;
+      return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+      _buf[(head + i) & (SIZE - 1)] = frame[i];
+    }
+    _head.store(head + (uint32_t)len, std::memory_order_release);
+    return true;
+  }
+
+  // frameBytes: size of every frame pushed
+  template <typename Port>
+  size_t drain(Port& port, size_t frameBytes) {
+    uint32_t tail = _tail.load(std::memory_order_relaxed);
+    uint32_t pending = _head.load(std::memory_order_acquire) - tail;
+    int room = port.availableForWrite();
+    if (pending == 0 || room < (int)frameBytes) {
+      return 0;
+    }
+    uint32_t chunk = (pending < (uint32_t)room) ? pending : (uint32_t)room;
+    chunk -= chunk % frameBytes;
+    uint32_t offset = tail & (SIZE - 1);
+    uint32_t first = (chunk < SIZE - offset) ? chunk : (uint32_t)(SIZE - offset);
+    size_t written = port.write(_buf + offset, first);
+    if (written == first && chunk > first) {
+      written += port.write(_buf, chunk - first);  // Wrapped part
+    }
+    // Keep the tail on a frame boundary: a cut frame goes out again whole
+    uint32_t whole = (uint32_t)(written - written % frameBytes);
+    if (whole != written) {
+      _shortWrites++;
+    }
+    _tail.store(tail + whole, std::memory_order_release);
+    return written;
+  }
+
+  uint32_t dropped() const { return _dropped; }
+  uint32_t shortWrites() const { return _shortWrites; }   // Frames cut by the port and resent
+  uint32_t pendingBytes() const { return _head.load() - _tail.load(); }
+
+private:
+  uint8_t _buf[SIZE];
+  std::atomic<uint32_t> _head{0};
+  std::atomic<uint32_t> _tail{0};
+  uint32_t _dropped = 0;
+  uint32_t _shortWrites = 0;
+};
+
+// Reassembles frames from a byte stream, resynchronising on the sync word
+// after garbage or a CRC failure, and keeps link statistics. Host-side:
+// host/telemetry_reader and host/test_telemetry use it.
+class TelemetryParser {
+public:
+  // Feed one byte; returns true when it completed a valid sample frame
+  bool feed(uint8_t b) {
+    switch (state) {
+      case 0:
+        if (b == TELEMETRY_SYNC0) {
+          state = 1;
+        } else {
+          skipped++;
+        }
+        return false;
+      case 1:
+        if (b == TELEMETRY_SYNC1) {
+          state = 2;
+        } else if (b == TELEMETRY_SYNC0) {
+          skipped++;  // The previous 0xA5 was not a sync
+        } else {
+          skipped += 2;
+          state = 0;
+        }
+        return false;
+      case 2:
+        if (b > TELEMETRY_SAMPLE_PAYLOAD) {
+          state = 0;
+          bad++;
+          return rescan(&b, 1);
+        }
+        frame[0] = b;
+        length = b;
+        have = 1;
+        state = 3;
+        return false;
+      default:
+        frame[have++] = b;
+        // len + type + payload + crc
+        if (have < (size_t)length + 4) {
+          return false;
+        }
+        state = 0;
+        if (finishFrame()) {
+          return true;
+        }
+        uint8_t consumed[TELEMETRY_MAX_FRAME];
+        memcpy(consumed, frame, have);
+        return rescan(consumed, have);
+    }
+  }
+
+  const TelemetrySample& sample() const { return last; }
+
+  uint32_t framesOk() const { return frames; }
+  uint32_t badFrames() const { return bad; }            // Bad length, type or CRC
+  uint32_t bytesSkipped() const { return skipped; }
+  uint32_t framesMissing() const { return missing; }      // seq gaps (device drops + transit)
+  uint32_t deviceDropped() const { return frames ? droppedBefore + last.dropped : 0; }
+  uint32_t sessions() const { return sessionCount; }     // Device boots seen (seq restarts)
+  // Samples per second over the frames received, from device timestamps
+  // within each session
+  float sampleRateHz() const {
+    if (frames <= sessionCount || spanUs == 0) return 0.0f;
+    return (float)(frames - sessionCount + missing) * 1000000.0f / (float)spanUs;
+  }
+
+private:
+  // A frame that fails (bad length or CRC) may have started on a false
+  // sync in garbage, or lost a byte in transit and run into the next
+  // frame. Its bytes after the sync word are searched again, so the next
+  // intact frame is not lost with it.
+  bool rescan(const uint8_t* bytes, size_t count) {
+    bool completed = false;
+    for (size_t i = 0; i < count; i++) {
+      completed = feed(bytes[i]) || completed;
+    }
+    return completed;
+  }
+
+  bool finishFrame() {
+    uint16_t crc = (uint16_t)(frame[length + 2] | (frame[length + 3] << 8));
+    TelemetrySample s;
+    if (crc != telemetryCrc16(frame, (size_t)length + 2) || frame[1] != TELEMETRY_FRAME_SAMPLE ||
+        !telemetryDecodeSample(frame + 2, length, &s)) {
+      bad++;
+      return false;
+    }
+    // A seq that does not move forward (by less than half its range), or a
+    // dropped count that falls, is a device that restarted: a new session
+    uint16_t step = (uint16_t)(s.seq - last.seq);
+    if (frames == 0 || step == 0 || step >= 0x8000 || s.dropped < last.dropped) {
+      if (frames > 0) {
+        droppedBefore += last.dropped;
+      }
+      sessionCount++;
+    } else {
+      missing += (uint32_t)(step - 1);
+      spanUs += s.timeUs - last.timeUs;
+    }
+    last = s;
+    frames++;
+    return true;
+  }
+
+  uint8_t state = 0;
+  uint8_t length = 0;
+  size_t have = 0;
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  TelemetrySample last = {};
+  uint32_t frames = 0;
+  uint32_t bad = 0;
+  uint32_t skipped = 0;
+  uint32_t missing = 0;
+  uint32_t sessionCount = 0;
+  uint32_t droppedBefore = 0;   // Device drops in earlier sessions
+  uint64_t spanUs = 0;
+};
+
+#endif // TELEMETRY_H
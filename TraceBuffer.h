@@ -0,0 +1,110 @@
+// TraceBuffer.h - Always-on event trace with cycle-counter timestamps
+//
+// Serial debug streams change loop() timing enough to hide the problems
+// they are meant to show. This keeps a fixed ring of compact binary events
+// instead: each record is two 32-bit words (CPU cycle count, then event
+// type, core and two arguments), written with one atomic index bump, so
+// tracing costs well under a microsecond and can stay enabled in the field.
+// Events come from loop(), the UI task, the TinyUSB task and the GBA timer
+// ISR; oldest records are overwritten.
+//
+// The ring lives in RTC memory (RTC_NOINIT, like the CDC mode flag), so a
+// trace recorded in XInput mode survives the restart into CDC mode:
+// enterCdcMode() freezes it, and the first dump in CDC mode prints it.
+//
+// CCOUNT is per core and wraps every ~18 s at 240 MHz. Freezing captures
+// a (cycle count, esp_timer) pair on each core; the reader works backward
+// from those anchors, unwrapping per core, so any gap shorter than one wrap
+// (less TRACE_REORDER_US) between events on the same core decodes exactly. Cycle stamps assume a
+// fixed CPU clock, so with frequency scaling or light sleep (PowerManager.h)
+// traceBegin() is told to stamp esp_timer microseconds instead; the frozen
+// trace then reports a 1 MHz clock and decodes the same way.
+//
+// The record layout, reader and latency pairing are in TraceFormat.h, so
+// host/trace_decode can decode a raw dump ('T') on a PC.
+#ifndef TRACE_BUFFER_H
+#define TRACE_BUFFER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_ipc.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "TraceFormat.h"
+
+RTC_NOINIT_ATTR static TraceStore _traceStore;
+static std::atomic<uint32_t> _traceHead{0};
+static volatile bool _traceRecording = false;
+static bool _traceTimerClock = false;   // Stamp esp_timer us instead of CCOUNT
+
+static inline void IRAM_ATTR traceEvent(TraceEventType type, uint8_t a = 0, uint16_t b = 0) {
+  if (!_traceRecording) {
+    return;
+  }
+  uint32_t cycles = _traceTimerClock ? (uint32_t)esp_timer_get_time() : esp_cpu_get_cycle_count();
+  uint32_t core = (uint32_t)esp_cpu_get_core_id();
+  uint32_t slot = _traceHead.fetch_add(1, std::memory_order_relaxed) & (TRACE_BUFFER_EVENTS - 1);
+  _traceStore.records[slot].cycles = cycles;
+  _traceStore.records[slot].info = traceRecordInfo(core, type, a, b);
+}
+
+static inline uint16_t traceSaturate16(uint32_t value) {
+  return (value > 0xFFFFUL) ? 0xFFFF : (uint16_t)value;
+}
+
+// Start recording. With keepFrozen, a trace frozen before a software
+// restart is held (recording stays off) until it has been dumped. Pass
+// timerClock when the CPU clock is not fixed.
+static inline bool traceBegin(bool enabled, bool keepFrozen, bool timerClock = false) {
+  _traceTimerClock = timerClock;
+  bool held = keepFrozen && esp_reset_reason() == ESP_RST_SW &&
+              _traceStore.magic == TRACE_FROZEN_MAGIC && _traceStore.cpuMhz != 0;
+  if (!held) {
+    _traceStore.magic = 0;
+    _traceHead.store(0, std::memory_order_relaxed);
+  }
+  _traceRecording = enabled && !held;
+  return held;
+}
+
+static inline bool traceHasFrozen() {
+  return _traceStore.magic == TRACE_FROZEN_MAGIC;
+}
+
+static void traceAnchorCore(void* arg) {
+  (void)arg;
+  uint32_t core = (uint32_t)esp_cpu_get_core_id() & 1;
+  _traceStore.anchorUs[core] = esp_timer_get_time();
+  // With the timer clock the ring stamps microseconds, so the anchor does too
+  _traceStore.anchorCycles[core] =
+      _traceTimerClock ? (uint32_t)_traceStore.anchorUs[core] : esp_cpu_get_cycle_count();
+}
+
+// Stop recording and pin the ring to wall time. Safe to call twice.
+static inline void traceFreeze() {
+  if (traceHasFrozen()) {
+    return;
+  }
+  _traceRecording = false;
+  traceAnchorCore(nullptr);
+  #if portNUM_PROCESSORS > 1
+  esp_ipc_call_blocking((uint32_t)(1 - xPortGetCoreID()), traceAnchorCore, nullptr);
+  #else
+  _traceStore.anchorUs[1] = _traceStore.anchorUs[0];
+  _traceStore.anchorCycles[1] = _traceStore.anchorCycles[0];
+  #endif
+  _traceStore.cpuMhz = _traceTimerClock ? 1 : getCpuFrequencyMhz();
+  _traceStore.head = _traceHead.load(std::memory_order_relaxed);
+  _traceStore.magic = TRACE_FROZEN_MAGIC;
+}
+
+// Discard the frozen trace and record afresh
+static inline void traceResume(bool enabled) {
+  _traceStore.magic = 0;
+  _traceHead.store(0, std::memory_order_relaxed);
+  _traceRecording = enabled;
+}
+
+#endif // TRACE_BUFFER_H
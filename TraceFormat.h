@@ -0,0 +1,362 @@
+// TraceFormat.h - Event trace records, reader and latency pairing
+//
+// The parts of the event trace that do not touch the hardware: the record
+// layout, the reader that turns a frozen ring into timed events, the
+// sensor->HID / sensor->GBA latency pairing and the text both dumps print.
+// TraceBuffer.h records into a TraceStore on the device. The 't' dump
+// decodes it there; the 'T' dump prints the store itself as hex, which
+// TraceRawParser rebuilds so host/trace_decode gives the same timeline on
+// a PC (and can be pointed at dumps saved from the field).
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef TRACE_FORMAT_H
+#define TRACE_FORMAT_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Power of two; 8 bytes each, in RTC memory (8 KB on the ESP32-S3)
+const uint32_t TRACE_BUFFER_EVENTS = 256;
+static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0,
+              "TRACE_BUFFER_EVENTS must be a power of two");
+
+static const uint32_t TRACE_FROZEN_MAGIC = 0x7EACE001;
+
+// Longest an ISR can hold off the event it interrupted; a core's gap
+// between events must stay this much under one counter wrap
+static const uint32_t TRACE_REORDER_US = 1000;
+
+enum TraceEventType : uint8_t {
+  TRACE_SENSOR_SAMPLE = 0,  // a = UV range mode (| 0x80 if ALS provisional), b = raw UVS (saturated)
+  TRACE_BAR_CHANGE,         // a = new bars, b = previous bars
+  TRACE_HID_PRESS,          // a = transports (TRACE_HID_*), b = button
+  TRACE_HID_RELEASE,        // a = transports (TRACE_HID_*), b = button
+  TRACE_BLE_REPORT,         // b = time sendGamepadReport() took, us
+  TRACE_USB_REPORT,         // a = TraceUsbResult, b = edges still queued
+  TRACE_GBA_PHASE,          // a = phase (0 low pair, 1 high pair), b = value
+  TRACE_FLUSH_START,        // Display frame handed to the flusher / panel
+  TRACE_FLUSH_END,          // b = bytes sent (OLED) or 0 (TFT)
+  TRACE_BUTTON,             // a = button (1 or 2), b = 1 pressed / 0 released
+  TRACE_ALS_STEP,           // a = 1 brighter / 0 darker, b = ALS counts (saturated)
+  TRACE_EVENT_COUNT
+};
+
+static const char* const TRACE_EVENT_NAMES[TRACE_EVENT_COUNT] = {
+  "sample", "bar", "press", "release", "ble", "usb", "gba", "flush", "flushed", "button", "als"
+};
+
+static const uint8_t TRACE_HID_BLE = 0x01;
+static const uint8_t TRACE_HID_USB = 0x02;
+
+enum TraceUsbResult : uint8_t {
+  TRACE_USB_SUBMITTED = 0,
+  TRACE_USB_DEFERRED,       // EP1 IN busy or bus not ready; first of a run only
+  TRACE_USB_DONE            // Transfer completed
+};
+
+struct TraceRecord {
+  uint32_t cycles;
+  uint32_t info;  // b (bits 0-15), a (16-23), type (24-30), core (31)
+};
+
+static inline uint32_t traceRecordInfo(uint32_t core, TraceEventType type, uint8_t a, uint16_t b) {
+  return (core << 31) | ((uint32_t)type << 24) | ((uint32_t)a << 16) | b;
+}
+
+struct TraceStore {
+  uint32_t magic;           // TRACE_FROZEN_MAGIC while holding a frozen trace
+  uint32_t head;            // Events written in total when frozen
+  uint32_t cpuMhz;
+  uint32_t anchorCycles[2];
+  int64_t anchorUs[2];
+  TraceRecord records[TRACE_BUFFER_EVENTS];
+};
+
+struct TraceEntry {
+  TraceEventType type;
+  uint8_t core;
+  uint8_t a;
+  uint16_t b;
+  int64_t timeUs;  // esp_timer time of the event (in the session that recorded it)
+};
+
+// Walks a frozen trace oldest to newest. The first pass counts counter
+// wraps per core so the second can turn each cycle stamp into a time.
+class TraceReader {
+public:
+  void begin(const TraceStore& store) {
+    _store = &store;
+    reorderCycles = store.cpuMhz * TRACE_REORDER_US;
+    head = store.head;
+    count = (head < TRACE_BUFFER_EVENTS) ? head : TRACE_BUFFER_EVENTS;
+    next = head - count;
+    for (uint8_t core = 0; core < 2; core++) {
+      seen[core] = false;
+      wraps[core] = 0;
+    }
+    for (uint32_t seq = next; seq != head; seq++) {
+      const TraceRecord& record = store.records[seq & (TRACE_BUFFER_EVENTS - 1)];
+      stepCore((uint8_t)(record.info >> 31), record.cycles);
+    }
+    // The anchor itself comes after every event on its core
+    for (uint8_t core = 0; core < 2; core++) {
+      if (seen[core]) {
+        stepCore(core, store.anchorCycles[core]);
+      }
+      anchorWraps[core] = wraps[core];
+      seen[core] = false;
+      wraps[core] = 0;
+    }
+  }
+
+  uint32_t events() const { return count; }
+  uint32_t overwritten() const { return head - count; }
+  uint32_t cpuMhz() const { return _store->cpuMhz; }
+
+  bool read(TraceEntry* out) {
+    if (next == head) {
+      return false;
+    }
+    const TraceRecord& record = _store->records[next & (TRACE_BUFFER_EVENTS - 1)];
+    next++;
+    uint8_t core = (uint8_t)(record.info >> 31);
+    stepCore(core, record.cycles);
+    uint64_t anchor = ((uint64_t)anchorWraps[core] << 32) | _store->anchorCycles[core];
+    uint64_t stamp = ((uint64_t)wraps[core] << 32) | record.cycles;
+    int64_t ageCycles = (int64_t)(anchor - stamp);
+    out->type = (TraceEventType)((record.info >> 24) & 0x7F);
+    out->core = core;
+    out->a = (uint8_t)(record.info >> 16);
+    out->b = (uint16_t)record.info;
+    out->timeUs = _store->anchorUs[core] - ageCycles / (int64_t)_store->cpuMhz;
+    return true;
+  }
+
+private:
+  // Any backward step is a wrap except one under TRACE_REORDER_US: that
+  // is an ISR that stamped its event between our cycle read and our slot
+  // claim. (Gaps between half and one wrap step back by less than half
+  // the counter range, so the threshold cannot sit at 2^31.)
+  void stepCore(uint8_t core, uint32_t cycles) {
+    if (seen[core] && cycles < lastCycles[core] && (lastCycles[core] - cycles) > reorderCycles) {
+      wraps[core]++;
+    }
+    seen[core] = true;
+    lastCycles[core] = cycles;
+  }
+
+  const TraceStore* _store = nullptr;
+  uint32_t reorderCycles = 0;
+  uint32_t head = 0;
+  uint32_t count = 0;
+  uint32_t next = 0;
+  bool seen[2];
+  uint32_t lastCycles[2];
+  uint32_t wraps[2];
+  uint32_t anchorWraps[2];
+};
+
+// Min/avg/max of one latency measured across a dump
+struct TraceLatency {
+  uint32_t count = 0;
+  uint32_t minUs = 0xFFFFFFFF;
+  uint32_t maxUs = 0;
+  uint64_t sumUs = 0;
+
+  void add(int64_t us) {
+    uint32_t value = (us > 0) ? (uint32_t)us : 0;
+    count++;
+    sumUs += value;
+    if (value < minUs) minUs = value;
+    if (value > maxUs) maxUs = value;
+  }
+};
+
+// Latency from the sample that changed the bar count to the first HID
+// output after it, and to the first GBA phase carrying the new value.
+// Feed it every entry in order.
+class TraceLatencyPairing {
+public:
+  explicit TraceLatencyPairing(bool gbaEnabled) : _gbaEnabled(gbaEnabled) {}
+
+  void add(const TraceEntry& entry) {
+    switch (entry.type) {
+      case TRACE_SENSOR_SAMPLE:
+        _sampleUs = entry.timeUs;
+        break;
+      case TRACE_BAR_CHANGE:
+        if (_sampleUs >= 0) {
+          _changeSampleUs = _sampleUs;
+          _changeBars = entry.a;
+          _hidPending = true;
+          _gbaPending = _gbaEnabled;
+        }
+        break;
+      case TRACE_HID_PRESS:
+      case TRACE_BLE_REPORT:
+        if (_hidPending) {
+          hid.add(entry.timeUs - _changeSampleUs);
+          _hidPending = false;
+        }
+        break;
+      case TRACE_USB_REPORT:
+        if (_hidPending && entry.a == TRACE_USB_SUBMITTED) {
+          hid.add(entry.timeUs - _changeSampleUs);
+          _hidPending = false;
+        }
+        break;
+      case TRACE_GBA_PHASE:
+        if (_gbaPending && entry.b == _changeBars) {
+          gba.add(entry.timeUs - _changeSampleUs);
+          _gbaPending = false;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+
+  TraceLatency hid;
+  TraceLatency gba;
+
+private:
+  bool _gbaEnabled;
+  int64_t _sampleUs = -1;
+  int64_t _changeSampleUs = -1;
+  bool _hidPending = false;
+  bool _gbaPending = false;
+  uint8_t _changeBars = 0;
+};
+
+// ---- Text output, shared by the device dump and host/trace_decode ----
+
+// "# trace: N events, M overwritten, F MHz"
+static inline int traceFormatSummary(char* out, size_t size, const TraceReader& reader) {
+  return snprintf(out, size, "# trace: %u events, %u overwritten, %u MHz", (unsigned)reader.events(),
+                  (unsigned)reader.overwritten(), (unsigned)reader.cpuMhz());
+}
+
+static const char* const TRACE_TIMELINE_HEADER = "# ms core event a b";
+
+// One timeline line: ms since the oldest event, core, event, arguments
+static inline int traceFormatEntry(char* out, size_t size, const TraceEntry& entry, int64_t firstUs) {
+  int64_t relUs = entry.timeUs - firstUs;
+  return snprintf(out, size, "%u.%03u %u %s %u %u", (unsigned)(relUs / 1000), (unsigned)(relUs % 1000),
+                  (unsigned)entry.core, (entry.type < TRACE_EVENT_COUNT) ? TRACE_EVENT_NAMES[entry.type] : "?",
+                  (unsigned)entry.a, (unsigned)entry.b);
+}
+
+static inline int traceFormatLatency(char* out, size_t size, const char* label, const TraceLatency& latency) {
+  if (latency.count == 0) {
+    return snprintf(out, size, "# %s us min/avg/max: n/a", label);
+  }
+  return snprintf(out, size, "# %s us min/avg/max: %u/%u/%u (n=%u)", label, (unsigned)latency.minUs,
+                  (unsigned)(latency.sumUs / latency.count), (unsigned)latency.maxUs, (unsigned)latency.count);
+}
+
+// ---- Raw dump ('T') ----
+//
+//   # trace raw <events in ring>
+//   <head> <cpuMhz> <anchorCycles0> <anchorCycles1> <anchorUs0> <anchorUs1>
+//   <cycles> <info>              (one per ring slot, slot order, hex)
+//   # end
+//
+// The whole ring is printed in slot order, so the store rebuilt on the host
+// is byte-for-byte the one the device holds.
+
+static const char* const TRACE_RAW_BEGIN = "# trace raw";
+static const char* const TRACE_RAW_END = "# end";
+
+static inline int traceFormatRawBegin(char* out, size_t size) {
+  return snprintf(out, size, "%s %u", TRACE_RAW_BEGIN, (unsigned)TRACE_BUFFER_EVENTS);
+}
+
+static inline int traceFormatRawHeader(char* out, size_t size, const TraceStore& store) {
+  return snprintf(out, size, "%lx %lx %lx %lx %llx %llx", (unsigned long)store.head, (unsigned long)store.cpuMhz,
+                  (unsigned long)store.anchorCycles[0], (unsigned long)store.anchorCycles[1],
+                  (unsigned long long)store.anchorUs[0], (unsigned long long)store.anchorUs[1]);
+}
+
+static inline int traceFormatRawRecord(char* out, size_t size, const TraceRecord& record) {
+  return snprintf(out, size, "%08lx %08lx", (unsigned long)record.cycles, (unsigned long)record.info);
+}
+
+// Rebuilds a TraceStore from the raw dump, one line at a time. Lines
+// before the begin marker (the rest of a Serial Monitor capture) are
+// skipped; a dump from a build with a different ring size is rejected.
+class TraceRawParser {
+public:
+  enum State : uint8_t { WAITING, HEADER, RECORDS, DONE, FAILED };
+
+  bool line(const char* text) {
+    if (_state == WAITING) {
+      size_t n = strlen(TRACE_RAW_BEGIN);
+      if (strncmp(text, TRACE_RAW_BEGIN, n) == 0) {
+        _state = (strtoul(text + n, nullptr, 10) == TRACE_BUFFER_EVENTS) ? HEADER : FAILED;
+        memset(&store, 0, sizeof(store));
+        _slot = 0;
+      }
+      return _state != FAILED;
+    }
+    if (_state == HEADER) {
+      uint64_t fields[6];
+      if (!parseHex(text, fields, 6)) {
+        _state = FAILED;
+        return false;
+      }
+      store.head = (uint32_t)fields[0];
+      store.cpuMhz = (uint32_t)fields[1];
+      store.anchorCycles[0] = (uint32_t)fields[2];
+      store.anchorCycles[1] = (uint32_t)fields[3];
+      store.anchorUs[0] = (int64_t)fields[4];
+      store.anchorUs[1] = (int64_t)fields[5];
+      _state = (store.cpuMhz != 0) ? RECORDS : FAILED;
+      return _state != FAILED;
+    }
+    if (_state == RECORDS) {
+      if (_slot == TRACE_BUFFER_EVENTS) {
+        _state = (strncmp(text, TRACE_RAW_END, strlen(TRACE_RAW_END)) == 0) ? DONE : FAILED;
+        if (_state == DONE) {
+          store.magic = TRACE_FROZEN_MAGIC;
+        }
+        return _state != FAILED;
+      }
+      uint64_t fields[2];
+      if (!parseHex(text, fields, 2)) {
+        _state = FAILED;
+        return false;
+      }
+      store.records[_slot].cycles = (uint32_t)fields[0];
+      store.records[_slot].info = (uint32_t)fields[1];
+      _slot++;
+      return true;
+    }
+    return _state == DONE;
+  }
+
+  bool done() const { return _state == DONE; }
+  bool failed() const { return _state == FAILED; }
+
+  TraceStore store;
+
+private:
+  static bool parseHex(const char* text, uint64_t* fields, int count) {
+    for (int i = 0; i < count; i++) {
+      char* end = nullptr;
+      fields[i] = strtoull(text, &end, 16);
+      if (end == text) {
+        return false;
+      }
+      text = end;
+    }
+    return true;
+  }
+
+  State _state = WAITING;
+  uint32_t _slot = 0;
+};
+
+#endif // TRACE_FORMAT_H
@@ -0,0 +1,555 @@
+// UiWidgets.h - Retained main-screen widgets with damage tracking
+//
+// drawMainDisplay() used to clear the frame and redraw every field for
+// every sensor sample, and the backends then diffed the whole frame to
+// find what had changed. Here each field is a widget that remembers what
+// it last drew. Setting a widget to the value it already shows does
+// nothing; a changed widget redraws itself straight into the frame buffer
+// and adds the rectangles it touched to the surface's damage list. The
+// sketch hands that list to the backend, which then only looks at those
+// rows (T-QT TFT) or pages (SSD1306). An unchanged screen costs nothing,
+// and a new UVI digit touches one 6x8 character cell.
+//
+// Text is blitted from character cells of the classic 6x8 Adafruit_GFX
+// font, rasterized once on first use: Adafruit_GFX draws a size-3 digit as
+// one fillRect per font pixel. Icons are blitted from sprites. Blits write
+// the frame buffer directly, in either layout: row-major (GFXcanvas1, used
+// for the T-QT canvas) or SSD1306 pages (8 rows per byte, LSB on top).
+#ifndef UI_WIDGETS_H
+#define UI_WIDGETS_H
+
+#include <Adafruit_GFX.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+enum UiBufferLayout : uint8_t {
+  UI_LAYOUT_ROWS = 0,   // GFXcanvas1: rows of bytes, MSB = leftmost pixel
+  UI_LAYOUT_PAGES       // Adafruit_SSD1306: columns of 8-row pages, LSB = top
+};
+
+struct UiRect {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+
+  bool empty() const { return w <= 0 || h <= 0; }
+  int32_t area() const { return empty() ? 0 : (int32_t)w * h; }
+};
+
+static inline UiRect uiRectUnion(const UiRect& a, const UiRect& b) {
+  if (a.empty()) return b;
+  if (b.empty()) return a;
+  int16_t x0 = (a.x < b.x) ? a.x : b.x;
+  int16_t y0 = (a.y < b.y) ? a.y : b.y;
+  int16_t x1 = ((a.x + a.w) > (b.x + b.w)) ? (a.x + a.w) : (b.x + b.w);
+  int16_t y1 = ((a.y + a.h) > (b.y + b.h)) ? (a.y + a.h) : (b.y + b.h);
+  return { x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0) };
+}
+
+const uint8_t UI_DAMAGE_RECTS = 8;
+
+// Rectangles changed since the backend was last told. Once the list is
+// full, further rectangles are merged into the last entry.
+class UiDamage {
+public:
+  void clear() { count = 0; }
+
+  void add(const UiRect& r) {
+    if (r.empty()) {
+      return;
+    }
+    if (count == UI_DAMAGE_RECTS) {
+      rects[count - 1] = uiRectUnion(rects[count - 1], r);
+      return;
+    }
+    rects[count++] = r;
+  }
+
+  bool empty() const { return count == 0; }
+  uint8_t size() const { return count; }
+  const UiRect& operator[](uint8_t i) const { return rects[i]; }
+
+  // Damaged pixels (overlapping rectangles count twice)
+  int32_t area() const {
+    int32_t total = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      total += rects[i].area();
+    }
+    return total;
+  }
+
+  UiRect bounds() const {
+    UiRect all = { 0, 0, 0, 0 };
+    for (uint8_t i = 0; i < count; i++) {
+      all = uiRectUnion(all, rects[i]);
+    }
+    return all;
+  }
+
+  // SSD1306 pages (8-row bands) touched, bit n = page n
+  uint8_t pageMask() const {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      int first = rects[i].y / 8;
+      int last = (rects[i].y + rects[i].h - 1) / 8;
+      for (int page = first; page <= last && page < 8; page++) {
+        mask |= (uint8_t)(1U << page);
+      }
+    }
+    return mask;
+  }
+
+private:
+  UiRect rects[UI_DAMAGE_RECTS];
+  uint8_t count = 0;
+};
+
+// A 1-bit frame buffer the widgets draw into, plus its damage list
+class UiSurface {
+public:
+  void begin(uint8_t* frame, int16_t frameWidth, int16_t frameHeight, UiBufferLayout frameLayout) {
+    buffer = frame;
+    width = frameWidth;
+    height = frameHeight;
+    layout = frameLayout;
+    rowBytes = (int16_t)((frameWidth + 7) / 8);
+    damage.clear();
+  }
+
+  int16_t frameWidth() const { return width; }
+
+  void fill(const UiRect& r, bool on) {
+    UiRect c = clip(r);
+    for (int16_t y = c.y; y < c.y + c.h; y++) {
+      for (int16_t x = c.x; x < c.x + c.w; x++) {
+        put(x, y, on);
+      }
+    }
+  }
+
+  // One-pixel border, clear inside (an outlined gauge segment)
+  void outline(const UiRect& r) {
+    fill(r, true);
+    fill({ (int16_t)(r.x + 1), (int16_t)(r.y + 1), (int16_t)(r.w - 2), (int16_t)(r.h - 2) }, false);
+  }
+
+  // Opaque blit of a row-major, MSB-first bitmap ((w + 7) / 8 bytes per row)
+  void blit(int16_t x0, int16_t y0, const uint8_t* bits, int16_t w, int16_t h) {
+    if (bits == nullptr) {
+      return;
+    }
+    int16_t stride = (int16_t)((w + 7) / 8);
+    UiRect c = clip({ x0, y0, w, h });
+    for (int16_t y = c.y; y < c.y + c.h; y++) {
+      const uint8_t* row = bits + ((y - y0) * stride);
+      for (int16_t x = c.x; x < c.x + c.w; x++) {
+        int16_t sx = x - x0;
+        put(x, y, (row[sx >> 3] & (0x80 >> (sx & 7))) != 0);
+      }
+    }
+  }
+
+  UiDamage damage;
+
+private:
+  UiRect clip(const UiRect& r) const {
+    int16_t x0 = (r.x < 0) ? 0 : r.x;
+    int16_t y0 = (r.y < 0) ? 0 : r.y;
+    int16_t x1 = ((r.x + r.w) > width) ? width : (int16_t)(r.x + r.w);
+    int16_t y1 = ((r.y + r.h) > height) ? height : (int16_t)(r.y + r.h);
+    return { x0, y0, (int16_t)(x1 - x0), (int16_t)(y1 - y0) };
+  }
+
+  inline void put(int16_t x, int16_t y, bool on) {
+    uint8_t* byte;
+    uint8_t bit;
+    if (layout == UI_LAYOUT_ROWS) {
+      byte = &buffer[(y * rowBytes) + (x >> 3)];
+      bit = (uint8_t)(0x80 >> (x & 7));
+    } else {
+      byte = &buffer[x + ((y >> 3) * width)];
+      bit = (uint8_t)(1 << (y & 7));
+    }
+    if (on) {
+      *byte |= bit;
+    } else {
+      *byte &= (uint8_t)~bit;
+    }
+  }
+
+  uint8_t* buffer = nullptr;
+  int16_t width = 0;
+  int16_t height = 0;
+  int16_t rowBytes = 0;
+  UiBufferLayout layout = UI_LAYOUT_ROWS;
+};
+
+const char UI_GLYPH_FIRST = 0x20;
+const char UI_GLYPH_LAST = 0x7E;
+const uint8_t UI_GLYPH_COUNT = (uint8_t)(UI_GLYPH_LAST - UI_GLYPH_FIRST + 1);
+const uint8_t UI_GLYPH_MAX_SIZE = 3;
+
+// Classic-font character cells (6x8 per text size step, spacing included,
+// background pixels cleared), rasterized on first use and kept
+class UiGlyphCache {
+public:
+  // Row-major, MSB-first bitmap of 6*size x 8*size pixels, or nullptr if
+  // the size is not cached or memory ran out
+  const uint8_t* cell(char c, uint8_t size) {
+    if (size < 1 || size > UI_GLYPH_MAX_SIZE) {
+      return nullptr;
+    }
+    if (c < UI_GLYPH_FIRST || c > UI_GLYPH_LAST) {
+      c = '?';
+    }
+    uint8_t*& slot = cells[size - 1][c - UI_GLYPH_FIRST];
+    if (slot == nullptr) {
+      slot = rasterize(c, size);
+    }
+    return slot;
+  }
+
+  uint32_t cellsRasterized() const { return rasterized; }
+
+private:
+  uint8_t* rasterize(char c, uint8_t size) {
+    int16_t w = (int16_t)(6 * size);
+    int16_t h = (int16_t)(8 * size);
+    GFXcanvas1 canvas(w, h);
+    if (canvas.getBuffer() == nullptr) {
+      return nullptr;
+    }
+    canvas.fillScreen(0);
+    canvas.drawChar(0, 0, (unsigned char)c, 1, 0, size);
+    size_t bytes = (size_t)((w + 7) / 8) * h;
+    uint8_t* bits = (uint8_t*)malloc(bytes);
+    if (bits != nullptr) {
+      memcpy(bits, canvas.getBuffer(), bytes);
+      rasterized++;
+    }
+    return bits;
+  }
+
+  uint8_t* cells[UI_GLYPH_MAX_SIZE][UI_GLYPH_COUNT] = {};
+  uint32_t rasterized = 0;
+};
+
+// ---- Widgets ----
+
+class UiWidget {
+public:
+  // Force a full redraw on the next draw() (the frame was drawn over)
+  void invalidate() {
+    dirty = true;
+    drawn = { 0, 0, 0, 0 };
+  }
+
+protected:
+  void clearDrawn(UiSurface& surface) {
+    surface.fill(drawn, false);
+    surface.damage.add(drawn);
+    drawn = { 0, 0, 0, 0 };
+  }
+
+  bool dirty = true;
+  UiRect drawn = { 0, 0, 0, 0 };   // What this widget covers on screen now
+};
+
+const uint8_t UI_LABEL_CHARS = 16;
+
+enum UiAlign : uint8_t {
+  UI_ALIGN_LEFT = 0,   // x is the left edge
+  UI_ALIGN_RIGHT       // x is one past the right edge
+};
+
+// A line of text. When the text keeps its position, only the character
+// cells that changed are redrawn.
+class UiLabel : public UiWidget {
+public:
+  void place(int16_t x, int16_t y, uint8_t textSize, UiAlign textAlign) {
+    anchorX = x;
+    topY = y;
+    size = textSize;
+    align = textAlign;
+    dirty = true;
+  }
+
+  void set(const char* value) {
+    if (strncmp(value, text, UI_LABEL_CHARS) == 0) {
+      return;
+    }
+    strncpy(text, value, UI_LABEL_CHARS);
+    text[UI_LABEL_CHARS] = '\0';
+    dirty = true;
+  }
+
+  // Left edge of the text as it will be drawn
+  int16_t left() const {
+    return (align == UI_ALIGN_RIGHT) ? (int16_t)(anchorX - textWidth()) : anchorX;
+  }
+
+  void draw(UiSurface& surface, UiGlyphCache& glyphs) {
+    if (!dirty) {
+      return;
+    }
+    dirty = false;
+    int16_t cellW = (int16_t)(6 * size);
+    int16_t cellH = (int16_t)(8 * size);
+    int16_t len = (int16_t)strlen(text);
+    UiRect now = { left(), topY, (int16_t)(len * cellW), cellH };
+
+    if (!drawn.empty() && drawn.x == now.x && drawn.y == now.y && drawn.h == now.h) {
+      // Same origin: touch only the cells that differ
+      int16_t drawnLen = (int16_t)(drawn.w / cellW);
+      int16_t cells = (len > drawnLen) ? len : drawnLen;
+      for (int16_t i = 0; i < cells; i++) {
+        if (i < len && i < drawnLen && text[i] == shown[i]) {
+          continue;
+        }
+        UiRect cell = { (int16_t)(now.x + (i * cellW)), now.y, cellW, cellH };
+        if (i < len) {
+          surface.blit(cell.x, cell.y, glyphs.cell(text[i], size), cellW, cellH);
+        } else {
+          surface.fill(cell, false);
+        }
+        surface.damage.add(cell);
+      }
+    } else {
+      clearDrawn(surface);
+      for (int16_t i = 0; i < len; i++) {
+        surface.blit((int16_t)(now.x + (i * cellW)), now.y, glyphs.cell(text[i], size), cellW, cellH);
+      }
+      surface.damage.add(now);
+    }
+    memcpy(shown, text, sizeof(shown));
+    drawn = now;
+  }
+
+private:
+  int16_t textWidth() const { return (int16_t)(strlen(text) * 6 * size); }
+
+  int16_t anchorX = 0;
+  int16_t topY = 0;
+  uint8_t size = 1;
+  UiAlign align = UI_ALIGN_LEFT;
+  char text[UI_LABEL_CHARS + 1] = "";
+  char shown[UI_LABEL_CHARS + 1] = "";
+};
+
+// A fixed-point number; it is only formatted when the value changes
+class UiNumber : public UiLabel {
+public:
+  void setValue(int32_t value, uint8_t decimals) {
+    if (formatted && value == lastValue && decimals == lastDecimals) {
+      return;
+    }
+    formatted = true;
+    lastValue = value;
+    lastDecimals = decimals;
+    char buf[UI_LABEL_CHARS + 1];
+    if (decimals == 0) {
+      snprintf(buf, sizeof(buf), "%ld", (long)value);
+    } else {
+      int32_t scale = 1;
+      for (uint8_t i = 0; i < decimals; i++) {
+        scale *= 10;
+      }
+      int32_t magnitude = (value < 0) ? -value : value;
+      snprintf(buf, sizeof(buf), "%s%ld.%0*ld", (value < 0) ? "-" : "", (long)(magnitude / scale),
+               (int)decimals, (long)(magnitude % scale));
+    }
+    set(buf);
+  }
+
+private:
+  bool formatted = false;
+  int32_t lastValue = 0;
+  uint8_t lastDecimals = 0;
+};
+
+// Segmented gauge (the Boktai sun gauge): filled segments for the count,
+// outlines for the rest. Only segments whose state changed are redrawn.
+class UiGauge : public UiWidget {
+public:
+  void place(int16_t y, int16_t h, int16_t areaWidth, int16_t segmentGap) {
+    topY = y;
+    height = h;
+    width = areaWidth;
+    gap = segmentGap;
+    dirty = true;
+    drawnTotal = -1;
+  }
+
+  void set(int filled, int total) {
+    if (filled == filledBars && total == totalBars) {
+      return;
+    }
+    filledBars = filled;
+    totalBars = total;
+    dirty = true;
+  }
+
+  void draw(UiSurface& surface) {
+    if (!dirty) {
+      return;
+    }
+    dirty = false;
+    if (totalBars != drawnTotal || drawn.empty()) {
+      clearDrawn(surface);
+      drawnTotal = totalBars;
+      drawnFilled = -1;
+    }
+    if (totalBars <= 0) {
+      return;
+    }
+    // Same geometry as drawBoktaiGauge()
+    int16_t barWidth = (int16_t)(width - 4);
+    int16_t segW = (int16_t)((barWidth - (gap * (totalBars - 1))) / totalBars);
+    if (segW < 1) {
+      segW = 1;
+    }
+    int16_t usedWidth = (int16_t)((segW * totalBars) + (gap * (totalBars - 1)));
+    int16_t xStart = (int16_t)((width - usedWidth) / 2);
+
+    for (int i = 0; i < totalBars; i++) {
+      bool on = i < filledBars;
+      if (drawnFilled >= 0 && (i < drawnFilled) == on) {
+        continue;
+      }
+      UiRect seg = { (int16_t)(xStart + (i * (segW + gap))), topY, segW, height };
+      if (on) {
+        surface.fill(seg, true);
+      } else {
+        surface.outline(seg);
+      }
+      surface.damage.add(seg);
+    }
+    drawnFilled = filledBars;
+    drawn = { xStart, topY, usedWidth, height };
+  }
+
+private:
+  int16_t topY = 0;
+  int16_t height = 0;
+  int16_t width = 0;
+  int16_t gap = 2;
+  int filledBars = 0;
+  int totalBars = 0;
+  int drawnFilled = -1;
+  int drawnTotal = -1;
+};
+
+// A sprite, optionally with a level bar filled inside it (battery icon)
+class UiIcon : public UiWidget {
+public:
+  // bits: row-major, MSB-first, (w + 7) / 8 bytes per row; kept by pointer
+  void setSprite(const uint8_t* bits, int16_t w, int16_t h) {
+    sprite = bits;
+    spriteW = w;
+    spriteH = h;
+    dirty = true;
+  }
+
+  // Area the level bar grows in, relative to the icon's top left
+  void setLevelArea(const UiRect& area) { levelArea = area; }
+
+  void set(int16_t x, int16_t y, bool show, int16_t levelPixels) {
+    if (x == posX && y == posY && show == visible && levelPixels == level) {
+      return;
+    }
+    posX = x;
+    posY = y;
+    visible = show;
+    level = levelPixels;
+    dirty = true;
+  }
+
+  void draw(UiSurface& surface) {
+    if (!dirty) {
+      return;
+    }
+    dirty = false;
+    clearDrawn(surface);
+    if (!visible || sprite == nullptr) {
+      return;
+    }
+    UiRect now = { posX, posY, spriteW, spriteH };
+    surface.blit(posX, posY, sprite, spriteW, spriteH);
+    if (level > 0 && !levelArea.empty()) {
+      int16_t w = (level < levelArea.w) ? level : levelArea.w;
+      surface.fill({ (int16_t)(posX + levelArea.x), (int16_t)(posY + levelArea.y), w, levelArea.h }, true);
+    }
+    surface.damage.add(now);
+    drawn = now;
+  }
+
+private:
+  const uint8_t* sprite = nullptr;
+  int16_t spriteW = 0;
+  int16_t spriteH = 0;
+  UiRect levelArea = { 0, 0, 0, 0 };
+  int16_t posX = 0;
+  int16_t posY = 0;
+  bool visible = false;
+  int16_t level = 0;
+};
+
+// Compose cost and damaged area per frame, published once per stats window
+class UiFrameStats {
+public:
+  void record(uint32_t composeUs, int32_t damagedPixels) {
+    lastUs = composeUs;
+    if (composeUs > maxUs) {
+      maxUs = composeUs;
+    }
+    lastPixels = damagedPixels;
+    windowUs += composeUs;
+    windowPixels += (uint32_t)damagedPixels;
+    windowFrames++;
+    totalFrames++;
+    if (damagedPixels == 0) {
+      windowIdle++;
+      totalIdle++;
+    }
+  }
+
+  void publish() {
+    publishedAvgUs = (windowFrames > 0) ? (windowUs / windowFrames) : 0;
+    publishedAvgPixels = (windowFrames > 0) ? (windowPixels / windowFrames) : 0;
+    publishedFrames = windowFrames;
+    publishedIdle = windowIdle;
+    windowUs = 0;
+    windowPixels = 0;
+    windowFrames = 0;
+    windowIdle = 0;
+  }
+
+  uint32_t lastComposeUs() const { return lastUs; }
+  uint32_t maxComposeUs() const { return maxUs; }
+  int32_t lastDamagedPixels() const { return lastPixels; }
+  uint32_t avgComposeUs() const { return publishedAvgUs; }
+  uint32_t avgDamagedPixels() const { return publishedAvgPixels; }
+  uint32_t framesPerWindow() const { return publishedFrames; }
+  uint32_t idleFramesPerWindow() const { return publishedIdle; }   // Nothing changed
+  uint32_t framesTotal() const { return totalFrames; }
+  uint32_t idleFramesTotal() const { return totalIdle; }
+
+private:
+  uint32_t lastUs = 0;
+  uint32_t maxUs = 0;
+  int32_t lastPixels = 0;
+  uint32_t windowUs = 0;
+  uint32_t windowPixels = 0;
+  uint32_t windowFrames = 0;
+  uint32_t windowIdle = 0;
+  uint32_t publishedAvgUs = 0;
+  uint32_t publishedAvgPixels = 0;
+  uint32_t publishedFrames = 0;
+  uint32_t publishedIdle = 0;
+  uint32_t totalFrames = 0;
+  uint32_t totalIdle = 0;
+};
+
+#endif // UI_WIDGETS_H
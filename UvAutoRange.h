@@ -0,0 +1,86 @@
+// UvAutoRange.h - Shade/bright range switching for the LTR390
+//
+// The slow range (20-bit, 400 ms in a 500 ms period) resolves the low UV of
+// the shade; the fast range (18-bit, 100 ms) follows bright light five
+// times as often with counts to spare (UV_RANGE_MODES in FirmwareConfig.h).
+// Every full UV sample is checked against two thresholds: the sensor moves
+// to the fast range at fastAboveUvi and back after two samples in a row
+// below slowBelowUvi, and the gap between the thresholds keeps a reading
+// that hovers at either edge in one range.
+// After a switch it stays put for at least minDwellMs, so a noisy stretch
+// costs one switch per dwell at worst.
+//
+// This file only decides; the sketch programs the sensors, drops the first
+// sample after a switch and rebuilds its divisor and bar tables.
+// host/test_uv_auto_range replays sun/shade traces through it and the bar
+// pipeline of SessionLogReplay.h to check bar latency and hysteresis.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef UV_AUTO_RANGE_H
+#define UV_AUTO_RANGE_H
+
+#include <stdint.h>
+
+struct UvAutoRangeConfig {
+  bool enabled;           // UV_AUTORANGE_ENABLED; off: the range never changes
+  float fastAboveUvi;     // Measured UVI that moves the slow range to the fast one
+  float slowBelowUvi;     // Measured UVI that moves it back (below fastAboveUvi)
+  uint32_t minDwellMs;    // Time in a range before the next switch
+};
+
+class UvAutoRange {
+public:
+  // Range indexes match UV_RANGE_SLOW / UV_RANGE_FAST
+  static constexpr int SLOW = 0;
+  static constexpr int FAST = 1;
+  // Samples below slowBelowUvi before moving down. The first one can come
+  // from the middle of a step into the shade, with the bars still on the
+  // way; switching there would leave them to finish at the slow rate.
+  static constexpr uint32_t SLOW_CONFIRM_SAMPLES = 2;
+
+  void configure(const UvAutoRangeConfig& config) {
+    cfg = config;
+  }
+
+  // A range was programmed (at boot, on a warm resume, or after update()
+  // asked for it); the dwell time starts over
+  void setMode(int mode, uint32_t nowMs) {
+    current = (mode == FAST) ? FAST : SLOW;
+    switchedMs = nowMs;
+    lowSamples = 0;
+  }
+
+  // Call with the measured UVI of every full UV sample. Returns true when
+  // the sensor should change range; mode() is then the new range.
+  bool update(float measuredUvi, uint32_t nowMs) {
+    lowSamples = (current == FAST && measuredUvi < cfg.slowBelowUvi) ? lowSamples + 1 : 0;
+    if (!cfg.enabled || (uint32_t)(nowMs - switchedMs) < cfg.minDwellMs) {
+      return false;
+    }
+    int target = current;
+    if (current == SLOW && measuredUvi >= cfg.fastAboveUvi) {
+      target = FAST;
+    } else if (lowSamples >= SLOW_CONFIRM_SAMPLES) {
+      target = SLOW;
+    }
+    if (target == current) {
+      return false;
+    }
+    setMode(target, nowMs);
+    switches++;
+    return true;
+  }
+
+  int mode() const { return current; }
+  uint32_t switchCount() const { return switches; }
+
+private:
+  UvAutoRangeConfig cfg = { false, 3.0f, 2.0f, 2000 };
+  int current = SLOW;
+  uint32_t switchedMs = 0;
+  uint32_t switches = 0;
+  uint32_t lowSamples = 0;   // Fast-range samples in a row below slowBelowUvi
+};
+
+#endif // UV_AUTO_RANGE_H
@@ -0,0 +1,102 @@
+// UvBarPipeline.h - One UV sample to a bar count
+//
+// handleUvSample() in the sketch and host/loop_bench both run every sample
+// through this: smoothing (the fixed-point filter pipeline of UvFilter.h
+// with UV_FILTER_PIPELINE_ENABLED, else the legacy EMA with
+// UVI_SMOOTHING_ENABLED, else none), then the bar lookup. Unsmoothed
+// samples are classified straight from their raw counts with BarRawTables,
+// which must be rebuilt for every divisor (range switch); smoothed ones
+// from the in-between UVI the smoothing produced.
+//
+// The caller keeps the last sample (raw counts and smoothed UVI) and the
+// bars shown, and passes lastBars = -1 wherever hysteresis must not hold
+// the old count (game change, a restarted filter).
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef UV_BAR_PIPELINE_H
+#define UV_BAR_PIPELINE_H
+
+#include <stdint.h>
+#include <math.h>
+#include "BarThresholds.h"
+#include "UvFilter.h"
+
+struct UvBarPipelineConfig {
+  BarThresholdConfig bars;
+  bool filterPipeline;       // UV_FILTER_PIPELINE_ENABLED
+  UvFilterConfig filter;
+  bool smoothing;            // UVI_SMOOTHING_ENABLED (legacy path)
+  float smoothingAlpha;      // UVI_SMOOTHING_ALPHA
+};
+
+class UvBarPipeline {
+public:
+  // Bar starts in UVI x1000 for the filter pipeline depend only on the
+  // config, so this runs once; setDivisor() follows for the raw tables.
+  void configure(const UvBarPipelineConfig& config) {
+    cfg = config;
+    barBuildStartsMilli(cfg.bars, startsMilli);
+    filter.configure(cfg.filter);
+    restart();
+  }
+
+  // Raw-count tables for the active sensor's counts per UVI
+  void setDivisor(float divisor) {
+    raw.rebuild(cfg.bars, divisor);
+  }
+
+  // Drop the smoothing history; the next sample starts it at its own level
+  void restart() {
+    filter.reset();
+    primed = false;
+  }
+
+  // Continue the legacy EMA from a known level (warm resume)
+  void resumeSmoothing(float uvi) {
+    if (cfg.smoothing) {
+      smoothed = uvi;
+      primed = true;
+    }
+  }
+
+  // Smooth one sample's bar-comparison UVI (barCompareUvi()) taken at nowMs
+  float smooth(float uvi, uint32_t nowMs) {
+    if (cfg.filterPipeline) {
+      return filter.update((int32_t)lroundf(uvi * 1000.0f), nowMs) / 1000.0f;
+    }
+    if (!cfg.smoothing) {
+      return uvi;
+    }
+    smoothed = primed ? (cfg.smoothingAlpha * uvi) + ((1.0f - cfg.smoothingAlpha) * smoothed) : uvi;
+    primed = true;
+    return smoothed;
+  }
+
+  // Bars for a sample's raw counts and smoothed UVI; lastBars < 0 skips
+  // hysteresis
+  int bars(uint32_t rawUVS, float smoothedUvi, int game, int lastBars) const {
+    game = barGameIndex(game);
+    if (cfg.filterPipeline) {
+      return uvFilterBars(startsMilli[game], GAME_BARS[game], (int32_t)lroundf(smoothedUvi * 1000.0f), lastBars,
+                          filter.slope(), filter.config());
+    }
+    if (cfg.smoothing) {
+      return (lastBars >= 0) ? barsForUviWithHysteresis(cfg.bars, smoothedUvi, game, lastBars)
+                             : barsForUvi(cfg.bars, smoothedUvi, game);
+    }
+    return (lastBars >= 0) ? raw.barsWithHysteresis(rawUVS, game, lastBars) : raw.bars(rawUVS, game);
+  }
+
+  const BarRawTables& rawTables() const { return raw; }
+
+private:
+  UvBarPipelineConfig cfg = {};
+  int32_t startsMilli[NUM_GAMES][GAME_MAX_BARS] = {};
+  BarRawTables raw;
+  UvFilter filter;
+  bool primed = false;
+  float smoothed = 0.0f;
+};
+
+#endif // UV_BAR_PIPELINE_H
@@ -0,0 +1,174 @@
+// UvFilter.h - Fixed-point UV filter pipeline (UV_FILTER_PIPELINE_ENABLED)
+//
+// The legacy filter is one EMA (UVI_SMOOTHING_ALPHA) plus a fixed
+// BAR_HYSTERESIS margin: heavy enough to stop flicker under moving cloud, it
+// also lags real changes by several samples. This pipeline works on UVI in
+// thousandths with integer math only and no allocation:
+//
+//   1. Median of the last N samples (N = 1, 3 or 5) rejects single-sample
+//      spikes without smoothing steps.
+//   2. One-Euro style low-pass: the cutoff rises with the filtered slope, so
+//      the output is heavily smoothed while the light is steady and follows
+//      closely while it is moving.
+//   3. Bar hysteresis scaled to the local spacing of the bar thresholds
+//      (GAME_BAR_RATIOS spacing varies ~20x across the gauge, so a fixed
+//      UVI margin is either too big at the bottom or useless at the top).
+//      While the slope is fast in one direction, the margin in that direction
+//      shrinks, so a real change is not held back; the margin against
+//      reversal is kept in full.
+#ifndef UV_FILTER_H
+#define UV_FILTER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+const uint8_t UV_FILTER_MEDIAN_MAX = 5;
+
+struct UvFilterConfig {
+  uint8_t medianN;             // 1 (off), 3 or 5
+  bool adaptive;               // One-Euro stage on/off
+  uint32_t minCutoffMilliHz;   // Cutoff while the light is steady
+  uint32_t betaMilliHz;        // Added cutoff per 1 UVI/s of slope
+  uint32_t slopeCutoffMilliHz; // Low-pass on the slope estimate itself
+  uint16_t hystPermille;       // Margin as a fraction of local threshold spacing (0 = none)
+  uint16_t slewPermille;       // Fraction of the margin kept in the direction of a fast move
+  int32_t slewMilliUviPerS;    // Slope that counts as a fast move
+};
+
+// alpha = dt / (dt + tau), tau = 1 / (2 pi fc), in Q16
+static inline uint32_t uvFilterAlphaQ16(uint32_t cutoffMilliHz, uint32_t dtMs) {
+  if (cutoffMilliHz == 0) {
+    return 0;
+  }
+  uint64_t tauUs = 159154943ULL / cutoffMilliHz;  // 1e9 / (2 pi)
+  uint64_t dtUs = (uint64_t)dtMs * 1000ULL;
+  return (uint32_t)((dtUs << 16) / (dtUs + tauUs));
+}
+
+class UvFilter {
+public:
+  void configure(const UvFilterConfig& config) {
+    cfg = config;
+    if (cfg.medianN != 3 && cfg.medianN != 5) {
+      cfg.medianN = 1;
+    }
+    reset();
+  }
+
+  void reset() {
+    primed = false;
+    count = 0;
+    next = 0;
+    slopeValue = 0;
+  }
+
+  // Feed one sample (UVI x1000); returns the filtered value
+  int32_t update(int32_t milliUvi, uint32_t nowMs) {
+    int32_t x = median(milliUvi);
+    if (!primed) {
+      primed = true;
+      lastMs = nowMs;
+      prevInput = x;
+      outputValue = x;
+      slopeValue = 0;
+      return outputValue;
+    }
+    uint32_t dtMs = nowMs - lastMs;
+    if (dtMs == 0) {
+      dtMs = 1;
+    }
+    lastMs = nowMs;
+
+    int32_t rawSlope = (int32_t)(((int64_t)(x - prevInput) * 1000) / (int64_t)dtMs);
+    prevInput = x;
+    uint32_t slopeAlpha = uvFilterAlphaQ16(cfg.slopeCutoffMilliHz, dtMs);
+    slopeValue += (int32_t)(((int64_t)(rawSlope - slopeValue) * slopeAlpha) >> 16);
+
+    if (!cfg.adaptive) {
+      outputValue = x;
+      return outputValue;
+    }
+    uint32_t cutoff = cfg.minCutoffMilliHz +
+                      (uint32_t)(((uint64_t)cfg.betaMilliHz * (uint32_t)abs(slopeValue)) / 1000ULL);
+    uint32_t alpha = uvFilterAlphaQ16(cutoff, dtMs);
+    outputValue += (int32_t)(((int64_t)(x - outputValue) * alpha) >> 16);
+    return outputValue;
+  }
+
+  int32_t output() const { return outputValue; }
+  int32_t slope() const { return slopeValue; }  // UVI x1000 per second
+  const UvFilterConfig& config() const { return cfg; }
+
+private:
+  int32_t median(int32_t x) {
+    if (cfg.medianN <= 1) {
+      return x;
+    }
+    window[next] = x;
+    next = (uint8_t)((next + 1) % cfg.medianN);
+    if (count < cfg.medianN) {
+      count++;
+    }
+    int32_t sorted[UV_FILTER_MEDIAN_MAX];
+    for (uint8_t i = 0; i < count; i++) {
+      int32_t v = window[i];
+      uint8_t j = i;
+      while (j > 0 && sorted[j - 1] > v) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = v;
+    }
+    return sorted[count / 2];
+  }
+
+  UvFilterConfig cfg = { 1, false, 1000, 0, 1000, 0, 1000, 0 };
+  bool primed = false;
+  uint32_t lastMs = 0;
+  int32_t prevInput = 0;
+  int32_t outputValue = 0;
+  int32_t slopeValue = 0;
+  int32_t window[UV_FILTER_MEDIAN_MAX];
+  uint8_t count = 0;
+  uint8_t next = 0;
+};
+
+// Bars for a filtered value. starts[k] is the UVI x1000 at which bar k+1
+// begins (numBars entries, ascending). Pass lastBars < 0 for no hysteresis.
+static inline int uvFilterBars(const int32_t* starts, int numBars, int32_t value, int lastBars,
+                               int32_t slope, const UvFilterConfig& cfg) {
+  int target = 0;
+  while (target < numBars && value >= starts[target]) {
+    target++;
+  }
+  if (lastBars < 0 || cfg.hystPermille == 0 || target == lastBars) {
+    return target;
+  }
+  if (lastBars > numBars) {
+    lastBars = numBars;
+  }
+
+  // Boundary being crossed: start of bar lastBars+1 going up, of bar
+  // lastBars going down
+  int edge = (target > lastBars) ? lastBars : lastBars - 1;
+  int32_t below = (edge > 0) ? (starts[edge] - starts[edge - 1]) : INT32_MAX;
+  int32_t above = (edge + 1 < numBars) ? (starts[edge + 1] - starts[edge]) : INT32_MAX;
+  int32_t spacing = (below < above) ? below : above;
+  if (spacing == INT32_MAX) {
+    spacing = 0;
+  }
+  int32_t margin = (int32_t)(((int64_t)spacing * cfg.hystPermille) / 1000);
+
+  bool rising = target > lastBars;
+  bool fastWithMove = rising ? (slope >= cfg.slewMilliUviPerS) : (slope <= -cfg.slewMilliUviPerS);
+  if (cfg.slewMilliUviPerS > 0 && fastWithMove) {
+    margin = (int32_t)(((int64_t)margin * cfg.slewPermille) / 1000);
+  }
+
+  if (rising) {
+    return (value >= starts[edge] + margin) ? target : lastBars;
+  }
+  return (value < starts[edge] - margin) ? target : lastBars;
+}
+
+#endif // UV_FILTER_H
@@ -0,0 +1,216 @@
+// UvFilterBench.h - Scores UV filter settings against logged samples
+//
+// Replays samples through a set of filter presets and scores each against a
+// reference bar count: the unfiltered bars with single-sample blips removed
+// (centered median, so it has no lag of its own). Flips are bar changes the
+// preset showed; lag is the time from a reference change until the preset
+// first shows the new count. Lower is better for both, and they trade
+// against each other.
+//
+// The 'b' command runs this over the device's session log; host/filter_bench
+// runs it over a raw 'L' dump, log files or synthetic sun/shade traces.
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef UV_FILTER_BENCH_H
+#define UV_FILTER_BENCH_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "BarThresholds.h"
+#include "SessionLogFormat.h"
+#include "SessionLogReplay.h"
+#include "UvFilter.h"
+
+// "legacy" is the float EMA + fixed UVI hysteresis path with both forced
+// on; "config" is the pipeline as configured, whether or not it is enabled.
+const int UV_FILTER_BENCH_PRESETS = 5;
+const int UV_FILTER_BENCH_LEGACY = 1;
+const int UV_FILTER_BENCH_TRUTH_SPAN = 5;  // Reference: centered median of this many unfiltered bar counts
+static const char* const UV_FILTER_BENCH_NAMES[UV_FILTER_BENCH_PRESETS] = {
+  "none", "legacy", "median3", "median3+1euro", "config"
+};
+
+struct UvFilterBenchScore {
+  uint32_t flips;
+  uint32_t lagCount;
+  uint64_t lagSumMs;
+  uint32_t lagMaxMs;
+  uint32_t unsettled;   // Reference moved on (or the session ended) before the preset caught up
+
+  uint32_t lagAvgMs() const { return lagCount ? (uint32_t)(lagSumMs / lagCount) : 0; }
+};
+
+class UvFilterBench {
+public:
+  // legacyMargin is the UVI margin for the legacy preset (BAR_HYSTERESIS)
+  void begin(const SessionLogReplayConfig& config, float legacyMargin) {
+    cfg = config;
+    margin = legacyMargin;
+    barBuildStartsMilli(cfg.bars, startsMilli);
+    UvFilterConfig configs[UV_FILTER_BENCH_PRESETS];
+    configs[0] = { 1, false, 1000, 0, 1000, 0, 1000, 0 };
+    configs[UV_FILTER_BENCH_LEGACY] = configs[0];  // Unused
+    configs[2] = { 3, false, 1000, 0, 1000, 0, 1000, 0 };
+    configs[3] = cfg.filter;
+    configs[3].medianN = 3;
+    configs[3].adaptive = true;
+    configs[3].hystPermille = 0;
+    configs[4] = cfg.filter;
+    for (int p = 0; p < UV_FILTER_BENCH_PRESETS; p++) {
+      filters[p].configure(configs[p]);
+      scores[p] = {};
+      pending[p] = false;
+    }
+    samples = 0;
+    referenceChanges = 0;
+    session = -1;
+    game = -1;
+    restartAll();
+  }
+
+  // Feed samples in log order
+  void add(const SessionLogBlockHeader& header, const SessionLogSample& sample) {
+    if (header.session != session || sample.game != game) {
+      restartAll();
+      session = header.session;
+      game = sample.game;
+    }
+    int g = barGameIndex(sample.game);
+    float uvi = barCompareUvi(cfg.bars, sample.rawUVS, cfg.rangeDivisor[sample.rangeMode & 1]);
+    int32_t uviMilli = (int32_t)lroundf(uvi * 1000.0f);
+
+    int bars[UV_FILTER_BENCH_PRESETS];
+    for (int p = 0; p < UV_FILTER_BENCH_PRESETS; p++) {
+      if (p == UV_FILTER_BENCH_LEGACY) {
+        legacySmoothed = (lastBars[p] < 0)
+                             ? uvi
+                             : (cfg.smoothingAlpha * uvi) + ((1.0f - cfg.smoothingAlpha) * legacySmoothed);
+        bars[p] = (lastBars[p] < 0) ? barsForUvi(cfg.bars, legacySmoothed, g)
+                                    : barsForUviWithMargin(cfg.bars, legacySmoothed, g, lastBars[p], margin);
+      } else {
+        int32_t filtered = filters[p].update(uviMilli, sample.timeMs);
+        bars[p] = uvFilterBars(startsMilli[g], GAME_BARS[g], filtered, lastBars[p], filters[p].slope(),
+                               filters[p].config());
+      }
+      if (lastBars[p] >= 0 && bars[p] != lastBars[p]) {
+        scores[p].flips++;
+      }
+      lastBars[p] = bars[p];
+    }
+
+    // Shift the window; evaluate its center once it is full
+    if (windowCount == UV_FILTER_BENCH_TRUTH_SPAN) {
+      for (int i = 1; i < UV_FILTER_BENCH_TRUTH_SPAN; i++) {
+        windowMs[i - 1] = windowMs[i];
+        windowRaw[i - 1] = windowRaw[i];
+        memcpy(windowBars[i - 1], windowBars[i], sizeof(windowBars[i]));
+      }
+      windowCount--;
+    }
+    windowMs[windowCount] = sample.timeMs;
+    windowRaw[windowCount] = bars[0];
+    memcpy(windowBars[windowCount], bars, sizeof(bars));
+    windowCount++;
+    samples++;
+    if (windowCount < UV_FILTER_BENCH_TRUTH_SPAN) {
+      return;
+    }
+
+    int sorted[UV_FILTER_BENCH_TRUTH_SPAN];
+    for (int i = 0; i < UV_FILTER_BENCH_TRUTH_SPAN; i++) {
+      int v = windowRaw[i];
+      int j = i;
+      while (j > 0 && sorted[j - 1] > v) {
+        sorted[j] = sorted[j - 1];
+        j--;
+      }
+      sorted[j] = v;
+    }
+    const int center = UV_FILTER_BENCH_TRUTH_SPAN / 2;
+    int truth = sorted[center];
+    uint32_t centerMs = windowMs[center];
+    if (truth != truthBars) {
+      if (truthBars >= 0) {
+        referenceChanges++;
+        for (int p = 0; p < UV_FILTER_BENCH_PRESETS; p++) {
+          if (pending[p]) {
+            scores[p].unsettled++;
+          }
+          pending[p] = true;
+        }
+        truthMs = centerMs;
+      }
+      truthBars = truth;
+    }
+    for (int p = 0; p < UV_FILTER_BENCH_PRESETS; p++) {
+      if (pending[p] && windowBars[center][p] == truthBars) {
+        uint32_t lagMs = centerMs - truthMs;
+        scores[p].lagCount++;
+        scores[p].lagSumMs += lagMs;
+        if (lagMs > scores[p].lagMaxMs) scores[p].lagMaxMs = lagMs;
+        pending[p] = false;
+      }
+    }
+  }
+
+  // Closes the last session; call once after the last sample
+  void finish() { restartAll(); }
+
+  uint32_t sampleCount() const { return samples; }
+  uint32_t referenceChangeCount() const { return referenceChanges; }
+  const UvFilterBenchScore& score(int preset) const { return scores[preset]; }
+
+private:
+  void restartAll() {
+    for (int p = 0; p < UV_FILTER_BENCH_PRESETS; p++) {
+      filters[p].reset();
+      if (pending[p]) {
+        scores[p].unsettled++;
+        pending[p] = false;
+      }
+      lastBars[p] = -1;
+    }
+    legacySmoothed = 0.0f;
+    windowCount = 0;
+    truthBars = -1;
+  }
+
+  SessionLogReplayConfig cfg = {};
+  float margin = 0.0f;
+  int32_t startsMilli[NUM_GAMES][GAME_MAX_BARS] = {};
+  UvFilter filters[UV_FILTER_BENCH_PRESETS];
+  UvFilterBenchScore scores[UV_FILTER_BENCH_PRESETS] = {};
+  bool pending[UV_FILTER_BENCH_PRESETS] = {};
+  int lastBars[UV_FILTER_BENCH_PRESETS] = {};
+  float legacySmoothed = 0.0f;
+
+  // Window of recent samples for the centered reference
+  uint32_t windowMs[UV_FILTER_BENCH_TRUTH_SPAN] = {};
+  int windowRaw[UV_FILTER_BENCH_TRUTH_SPAN] = {};
+  int windowBars[UV_FILTER_BENCH_TRUTH_SPAN][UV_FILTER_BENCH_PRESETS] = {};
+  int windowCount = 0;
+  int truthBars = -1;
+  uint32_t truthMs = 0;
+  uint32_t referenceChanges = 0;
+  uint32_t samples = 0;
+  int session = -1;
+  int game = -1;
+};
+
+static const char* const UV_FILTER_BENCH_TABLE_HEADER = "# preset flips lag_avg_ms lag_max_ms unsettled";
+
+static inline int uvFilterBenchFormatSummary(char* out, size_t size, const UvFilterBench& bench) {
+  return snprintf(out, size, "# filter benchmark: %lu samples, %lu reference bar changes",
+                  (unsigned long)bench.sampleCount(), (unsigned long)bench.referenceChangeCount());
+}
+
+static inline int uvFilterBenchFormatRow(char* out, size_t size, const UvFilterBench& bench, int preset) {
+  const UvFilterBenchScore& s = bench.score(preset);
+  return snprintf(out, size, "%s %lu %lu %lu %lu", UV_FILTER_BENCH_NAMES[preset], (unsigned long)s.flips,
+                  (unsigned long)s.lagAvgMs(), (unsigned long)s.lagMaxMs, (unsigned long)s.unsettled);
+}
+
+#endif // UV_FILTER_BENCH_H
@@ -0,0 +1,426 @@
+// UvFusion.h - One UV sample stream from several staggered LTR390s
+//
+// One LTR390 in the shade range delivers a sample every 500 ms, each an
+// average over the 400 ms before it. With UV_SENSOR_COUNT sensors (behind a
+// TCA9548A mux or on a second bus), the firmware starts each sensor's
+// conversion one cycle/N after the previous one, so a fresh sample arrives
+// every cycle/N. UvFusion turns those samples into a single stream in the
+// reference sensor's raw counts, which the rest of the firmware (raw bar
+// tables, enclosure compensation, filters, logging) uses unchanged:
+//
+//   1. Calibration: each sensor's raw count maps linearly onto the reference
+//      (scale for its sensitivity and window transmittance, offset for the
+//      enclosure offset), set by the caller from config.h.
+//   2. Outlier rejection: each new sample is compared with the median of the
+//      other sensors' latest samples. A sensor that disagrees by more than
+//      outlierFraction (at least outlierMinCounts) on outlierStrikes samples
+//      in a row is left out of the stream until it agrees again. A real
+//      sun/shade step reaches every sensor within one cycle, so it never
+//      collects enough strikes. Needs three sensors online; with two there
+//      is no majority and nothing is left out.
+//   3. Fusion: either the newest accepted sample (lowest lag: a new value
+//      every cycle/N) or the mean of all accepted samples from the last
+//      cycle (same rate, less noise, half a cycle more lag).
+//
+// Sensors that drop off the bus are marked offline by the caller; fusion
+// carries on with the rest. uvFusionSimulate() drives the fusion with
+// mocked sensors (steps, gain spread, a dirty window, a sensor dropping
+// out) and reports update rate, error and step latency (serial command 'm',
+// and host/uv_fusion_sim; host/test_uv_fusion checks the class itself).
+//
+// Like AbsoluteMeter.h, this file has no Arduino dependencies and can be
+// built into host tools as-is.
+#ifndef UV_FUSION_H
+#define UV_FUSION_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+static const int UV_FUSION_MAX_SENSORS = 4;
+
+struct UvFusionConfig {
+  bool average;              // Mean of the cycle's samples instead of the newest
+  float outlierFraction;     // Disagreement with the others' median, as a share of it
+  float outlierMinCounts;    // ... but never less than this (reference counts)
+  uint8_t outlierStrikes;    // Disagreements in a row before a sensor is left out
+  uint32_t freshMs;          // Samples older than this are not compared or averaged
+};
+
+class UvFusion {
+public:
+  void configure(const UvFusionConfig& config, int count) {
+    cfg = config;
+    sensorCount = (count < 1) ? 1 : (count > UV_FUSION_MAX_SENSORS ? UV_FUSION_MAX_SENSORS : count);
+    for (int i = 0; i < UV_FUSION_MAX_SENSORS; i++) {
+      sensors[i] = Sensor{};
+      sensors[i].scale = 1.0f;
+    }
+  }
+
+  // Reference counts = scale * raw + offset
+  void setCalibration(int i, float scale, float offset) {
+    sensors[i].scale = scale;
+    sensors[i].offset = offset;
+  }
+
+  // Samples older than this (normally one cycle) are not compared or averaged
+  void setFreshMs(uint32_t ms) { cfg.freshMs = ms; }
+  void setOutlierMinCounts(float counts) { cfg.outlierMinCounts = counts; }
+
+  // An offline sensor's last sample is forgotten; it rejoins unexcluded
+  void setOnline(int i, bool online) {
+    Sensor& s = sensors[i];
+    s.online = online;
+    s.hasValue = false;
+    s.strikes = 0;
+  }
+
+  // Add sensor i's sample. Returns true with *fusedCounts (reference raw
+  // counts) unless the sensor is currently left out as an outlier.
+  bool add(int i, uint32_t raw, uint32_t nowMs, float* fusedCounts) {
+    Sensor& s = sensors[i];
+    float value = s.scale * (float)raw + s.offset;
+    if (value < 0.0f) {
+      value = 0.0f;
+    }
+
+    float others[UV_FUSION_MAX_SENSORS];
+    int n = 0;
+    for (int j = 0; j < sensorCount; j++) {
+      if (j != i && isFresh(j, nowMs) && !isExcluded(j)) {
+        others[n++] = sensors[j].value;
+      }
+    }
+    if (n >= 2) {
+      float median = medianOf(others, n);
+      float margin = cfg.outlierFraction * median;
+      if (margin < cfg.outlierMinCounts) {
+        margin = cfg.outlierMinCounts;
+      }
+      if (fabsf(value - median) > margin) {
+        if (s.strikes < 255) {
+          s.strikes++;
+        }
+      } else {
+        s.strikes = 0;
+      }
+    } else {
+      s.strikes = 0;
+    }
+    s.value = value;
+    s.timeMs = nowMs;
+    s.hasValue = true;
+    s.samples++;
+    if (isExcluded(i)) {
+      s.rejected++;
+      return false;
+    }
+
+    if (!cfg.average) {
+      *fusedCounts = value;
+      return true;
+    }
+    float sum = value;
+    int used = 1;
+    for (int j = 0; j < sensorCount; j++) {
+      if (j != i && isFresh(j, nowMs) && !isExcluded(j)) {
+        sum += sensors[j].value;
+        used++;
+      }
+    }
+    *fusedCounts = sum / (float)used;
+    return true;
+  }
+
+  int count() const { return sensorCount; }
+  bool online(int i) const { return sensors[i].online; }
+  bool isExcluded(int i) const { return cfg.outlierStrikes > 0 && sensors[i].strikes >= cfg.outlierStrikes; }
+  int onlineCount() const {
+    int n = 0;
+    for (int i = 0; i < sensorCount; i++) {
+      n += sensors[i].online ? 1 : 0;
+    }
+    return n;
+  }
+  float lastCounts(int i) const { return sensors[i].hasValue ? sensors[i].value : 0.0f; }
+  uint32_t samples(int i) const { return sensors[i].samples; }
+  uint32_t rejected(int i) const { return sensors[i].rejected; }
+
+private:
+  struct Sensor {
+    float scale;
+    float offset;
+    float value;
+    uint32_t timeMs;
+    uint32_t samples;
+    uint32_t rejected;
+    uint8_t strikes;
+    bool online;
+    bool hasValue;
+  };
+
+  bool isFresh(int j, uint32_t nowMs) const {
+    const Sensor& s = sensors[j];
+    return s.online && s.hasValue && (nowMs - s.timeMs) <= cfg.freshMs;
+  }
+
+  static float medianOf(float* v, int n) {
+    for (int a = 1; a < n; a++) {
+      float x = v[a];
+      int b = a - 1;
+      while (b >= 0 && v[b] > x) {
+        v[b + 1] = v[b];
+        b--;
+      }
+      v[b + 1] = x;
+    }
+    return (n & 1) ? v[n / 2] : 0.5f * (v[n / 2 - 1] + v[n / 2]);
+  }
+
+  UvFusionConfig cfg = { false, 0.25f, 200.0f, 3, 500 };
+  int sensorCount = 1;
+  Sensor sensors[UV_FUSION_MAX_SENSORS] = {};
+};
+
+// Calibration for one sensor: its sensitivity relative to the reference,
+// and its window's transmittance. With enclosure compensation, a sensor
+// behind a clearer window than the enclosure's (reference) is scaled down
+// to what the reference would read, and the enclosure offset is added for
+// the share of the window it does not have. Zero or negative factors count
+// as 1.
+static inline void uvFusionCalibration(float sensitivity, float windowTransmittance, bool enclosureComp,
+                                       float enclosureTransmittance, float enclosureOffsetUvi, float divisor,
+                                       float* scale, float* offset) {
+  if (sensitivity <= 0.0f) {
+    sensitivity = 1.0f;
+  }
+  float window = 1.0f;
+  if (enclosureComp && windowTransmittance > 0.0f && enclosureTransmittance > 0.0f) {
+    window = enclosureTransmittance / windowTransmittance;
+  }
+  *scale = window / sensitivity;
+  *offset = enclosureComp ? enclosureOffsetUvi * divisor * (1.0f - window) : 0.0f;
+}
+
+// ---- Mocked sensors ----
+
+struct UvFusionSimConfig {
+  int sensors;
+  uint32_t cycleMs;           // Per-sensor sample period (staggered by cycleMs / sensors)
+  uint32_t integrationMs;
+  float gain[UV_FUSION_MAX_SENSORS];   // True sensitivity of each sensor (1 = reference)
+  bool calibrated;            // Fusion scales by 1/gain (per-sensor calibration done)
+  int dirtySensor;            // Sensor whose window loses dirtyLoss from dirtyFromMs (-1 = none)
+  float dirtyLoss;
+  uint32_t dirtyFromMs;
+  int droppedSensor;          // Sensor that falls off the bus in [dropFromMs, dropToMs) (-1 = none)
+  uint32_t dropFromMs;
+  uint32_t dropToMs;
+  float lowCounts;            // Light levels (reference counts) stepped between
+  float highCounts;
+  uint32_t holdMinMs;         // Time between steps, uniformly random
+  uint32_t holdMaxMs;
+  uint32_t noisePermille;     // Per-sample noise, +/- uniform
+  uint32_t durationMs;
+  uint32_t seed;
+  UvFusionConfig fusion;
+};
+
+struct UvFusionSimResult {
+  uint32_t outputs;
+  uint32_t intervalAvgMs;     // Between fused outputs
+  uint32_t intervalMaxMs;
+  uint32_t errorPermille;     // Mean |output - true level| / level, away from steps
+  uint32_t steps;
+  uint32_t stepsSettled;      // Steps an output reached before the next step
+  uint32_t stepLatencyAvgMs;  // Step -> first output within 10% of the new level
+  uint32_t rejected;          // Samples left out as outliers
+};
+
+static inline uint32_t uvFusionSimRandom(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// Steps the light between two levels and samples it with `sensors` mocked
+// LTR390s, each averaging the light over its integration window and
+// delivering every cycleMs, staggered like the firmware does. A dropped
+// sensor is taken offline after two missed cycles, as the firmware does
+// after failed reads.
+static inline void uvFusionSimulate(const UvFusionSimConfig& c, UvFusionSimResult* result) {
+  *result = UvFusionSimResult{};
+  // Separate streams for the light and the noise, so every sensor count
+  // sees the same steps
+  uint32_t rng = c.seed ? c.seed : 1;
+  uint32_t noiseRng = rng ^ 0x9E3779B9u;
+  int n = (c.sensors < 1) ? 1 : (c.sensors > UV_FUSION_MAX_SENSORS ? UV_FUSION_MAX_SENSORS : c.sensors);
+  UvFusion fusion;
+  fusion.configure(c.fusion, n);
+  for (int i = 0; i < n; i++) {
+    fusion.setCalibration(i, c.calibrated ? 1.0f / c.gain[i] : 1.0f, 0.0f);
+    fusion.setOnline(i, true);
+  }
+  uint32_t span = (c.holdMaxMs > c.holdMinMs) ? c.holdMaxMs - c.holdMinMs : 0;
+  auto hold = [&]() -> uint32_t {
+    return c.holdMinMs + (span ? uvFusionSimRandom(&rng) % (span + 1) : 0);
+  };
+
+  // Light is a step function; steps are further apart than one
+  // integration, so a window sees at most the last edge
+  bool high = false;
+  uint32_t lastEdgeMs = 0;
+  uint32_t nextEdgeMs = hold();
+  bool pendingStep = false;
+  uint32_t stepMs = 0;
+  uint64_t stepLatencySumMs = 0;
+  uint32_t lastOutputMs = 0;
+  bool haveOutput = false;
+  uint64_t intervalSumMs = 0;
+  double errorSum = 0.0;
+  uint32_t errorCount = 0;
+  bool dropApplied = false;
+
+  auto levelAt = [&](uint32_t t) -> float {
+    bool h = (t >= lastEdgeMs) ? high : !high;
+    return h ? c.highCounts : c.lowCounts;
+  };
+
+  for (uint32_t t = 0; t < c.durationMs; t++) {
+    if (t == nextEdgeMs) {
+      high = !high;
+      lastEdgeMs = t;
+      nextEdgeMs = t + hold();
+      result->steps++;      // Counted as it starts, so every sensor count agrees
+      pendingStep = true;
+      stepMs = t;
+    }
+    if (c.droppedSensor >= 0 && c.droppedSensor < n) {
+      bool dropped = t >= c.dropFromMs && t < c.dropToMs;
+      if (dropped && !dropApplied && t >= c.dropFromMs + 2 * c.cycleMs) {
+        fusion.setOnline(c.droppedSensor, false);
+        dropApplied = true;
+      } else if (!dropped && dropApplied) {
+        fusion.setOnline(c.droppedSensor, true);
+        dropApplied = false;
+      }
+    }
+    for (int i = 0; i < n; i++) {
+      uint32_t offset = (c.cycleMs * (uint32_t)i) / (uint32_t)n;
+      if (t < offset + c.integrationMs || ((t - offset - c.integrationMs) % c.cycleMs) != 0) {
+        continue;
+      }
+      if (i == c.droppedSensor && t >= c.dropFromMs && t < c.dropToMs) {
+        continue;
+      }
+      if (i == c.droppedSensor && !fusion.online(i)) {
+        continue;
+      }
+      float sum = 0.0f;
+      for (uint32_t s = t - c.integrationMs; s < t; s++) {
+        sum += levelAt(s);
+      }
+      float gain = c.gain[i];
+      if (i == c.dirtySensor && t >= c.dirtyFromMs) {
+        gain *= (1.0f - c.dirtyLoss);
+      }
+      int32_t noise = c.noisePermille
+                        ? (int32_t)(uvFusionSimRandom(&noiseRng) % (2 * c.noisePermille + 1)) - (int32_t)c.noisePermille
+                        : 0;
+      float raw = (sum / (float)c.integrationMs) * gain * (1.0f + noise / 1000.0f);
+      float fused = 0.0f;
+      if (!fusion.add(i, (uint32_t)(raw + 0.5f), t, &fused)) {
+        result->rejected++;
+        continue;
+      }
+      result->outputs++;
+      if (haveOutput) {
+        uint32_t interval = t - lastOutputMs;
+        intervalSumMs += interval;
+        if (interval > result->intervalMaxMs) {
+          result->intervalMaxMs = interval;
+        }
+      }
+      lastOutputMs = t;
+      haveOutput = true;
+      float level = high ? c.highCounts : c.lowCounts;
+      if (pendingStep && fabsf(fused - level) <= 0.1f * level) {
+        stepLatencySumMs += t - stepMs;
+        result->stepsSettled++;
+        pendingStep = false;
+      }
+      if ((t - lastEdgeMs) >= c.integrationMs + c.cycleMs && level > 0.0f) {
+        errorSum += fabsf(fused - level) / level;
+        errorCount++;
+      }
+    }
+  }
+  result->intervalAvgMs = (result->outputs > 1) ? (uint32_t)(intervalSumMs / (result->outputs - 1)) : 0;
+  result->errorPermille = errorCount ? (uint32_t)lround(errorSum * 1000.0 / errorCount) : 0;
+  result->stepLatencyAvgMs = result->stepsSettled ? (uint32_t)(stepLatencySumMs / result->stepsSettled) : 0;
+}
+
+// ---- Scenarios shared by the 'm' command and host/uv_fusion_sim ----
+
+struct UvFusionSimScenario {
+  const char* name;
+  int sensors;
+  int dirty;                  // Sensor with a dirty window (-1 = none)
+  int dropped;                // Sensor that falls off the bus (-1 = none)
+};
+
+// 1 to 4 sensors, then 4 with one window losing half its light after
+// 10 min, and 4 with one sensor off the bus from 10 to 30 min
+static const UvFusionSimScenario UV_FUSION_SIM_SCENARIOS[] = {
+  { "x1", 1, -1, -1 }, { "x2", 2, -1, -1 }, { "x3", 3, -1, -1 }, { "x4", 4, -1, -1 },
+  { "x4+dirty", 4, 2, -1 }, { "x4+drop", 4, -1, 1 },
+};
+static const float UV_FUSION_SIM_GAINS[UV_FUSION_MAX_SENSORS] = { 1.0f, 1.08f, 0.93f, 1.04f };
+
+// Steps every 3-15 s between UVI 2 and 9 at `divisor` counts per UVI, a
+// 500 ms cycle with 400 ms integration, 3% noise and the gain spread above
+// (calibrated away), with the caller's fusion settings
+static inline UvFusionSimConfig uvFusionSimScenarioConfig(const UvFusionSimScenario& scenario, float divisor,
+                                                          const UvFusionConfig& fusion, uint32_t durationMs,
+                                                          uint32_t seed) {
+  UvFusionSimConfig config = {};
+  config.sensors = scenario.sensors;
+  config.cycleMs = 500;
+  config.integrationMs = 400;
+  for (int i = 0; i < UV_FUSION_MAX_SENSORS; i++) {
+    config.gain[i] = UV_FUSION_SIM_GAINS[i];
+  }
+  config.calibrated = true;
+  config.dirtySensor = scenario.dirty;
+  config.dirtyLoss = 0.5f;
+  config.dirtyFromMs = 600000UL;
+  config.droppedSensor = scenario.dropped;
+  config.dropFromMs = 600000UL;
+  config.dropToMs = 1800000UL;
+  config.lowCounts = 2.0f * divisor;
+  config.highCounts = 9.0f * divisor;
+  config.holdMinMs = 3000;
+  config.holdMaxMs = 15000;
+  config.noisePermille = 30;
+  config.durationMs = durationMs;
+  config.seed = seed;
+  config.fusion = fusion;
+  return config;
+}
+
+static const char* const UV_FUSION_SIM_TABLE_HEADER =
+    "# scenario outputs int_avg_ms int_max_ms err_permille step_lat_ms rejected";
+
+static inline int uvFusionSimFormatRow(char* out, size_t size, const char* scenario,
+                                       const UvFusionSimResult& result) {
+  return snprintf(out, size, "%s %lu %lu %lu %lu %lu %lu", scenario, (unsigned long)result.outputs,
+                  (unsigned long)result.intervalAvgMs, (unsigned long)result.intervalMaxMs,
+                  (unsigned long)result.errorPermille, (unsigned long)result.stepLatencyAvgMs,
+                  (unsigned long)result.rejected);
+}
+
+#endif // UV_FUSION_H
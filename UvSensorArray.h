@@ -0,0 +1,74 @@
+// UvSensorArray.h - Wiring and per-sensor state for UV_SENSOR_COUNT LTR390s
+//
+// Every LTR390 answers at 0x53, so extra sensors need their own bus
+// segment: a channel of a TCA9548A-style mux on the main bus, or the second
+// I2C controller (Wire1). A sensor left directly on the main bus (mux
+// channel -1) is addressed with every mux channel switched off, so it never
+// shares the bus with a sensor behind the mux. The mux remembers its
+// channel, so I2cMux only writes when the selection changes.
+//
+// With more than one sensor the firmware starts each conversion itself
+// (converting / startAtMs below) and UvFusion.h merges the samples; the
+// single-sensor path (INT pin, ALS assist) is unchanged.
+#ifndef UV_SENSOR_ARRAY_H
+#define UV_SENSOR_ARRAY_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "Adafruit_LTR390.h"
+#include "I2cBus.h"
+
+static const int UV_SENSOR_MAX = 4;
+
+struct UvSensor {
+  Adafruit_LTR390 ltr;
+  TwoWire* wire = &Wire;
+  int8_t muxChannel = -1;        // TCA9548A channel on the main bus (-1 = none)
+  bool online = false;
+  bool converting = false;       // Conversion started and not read yet
+  unsigned long startAtMs = 0;   // When the next conversion starts
+  unsigned long startedMs = 0;   // When the current one started
+  uint8_t failures = 0;          // Failed reads/writes in a row
+  unsigned long retryAtMs = 0;   // Offline: next attempt to bring it back
+};
+
+class I2cMux {
+public:
+  void begin(TwoWire* wire, uint8_t addr, I2cBusMonitor* monitor) {
+    this->wire = wire;
+    this->addr = addr;
+    this->monitor = monitor;
+    selected = SELECTED_UNKNOWN;
+  }
+
+  // Route the bus to one downstream channel (-1 = none). Returns false if
+  // the mux did not acknowledge.
+  bool select(int8_t channel) {
+    if (wire == nullptr) {
+      return channel < 0;
+    }
+    uint8_t mask = (channel < 0) ? 0 : (uint8_t)(1U << channel);
+    if (mask == selected) {
+      return true;
+    }
+    unsigned long startUs = micros();
+    wire->beginTransmission(addr);
+    wire->write(mask);
+    bool ok = wire->endTransmission() == 0;
+    if (monitor != nullptr) {
+      monitor->record((uint32_t)(micros() - startUs), I2C_CLIENT_SENSOR);
+    }
+    selected = ok ? mask : SELECTED_UNKNOWN;
+    return ok;
+  }
+
+private:
+  static const uint16_t SELECTED_UNKNOWN = 0x100;
+
+  TwoWire* wire = nullptr;
+  uint8_t addr = 0x70;
+  I2cBusMonitor* monitor = nullptr;
+  uint16_t selected = SELECTED_UNKNOWN;
+};
+
+#endif // UV_SENSOR_ARRAY_H
@@ -0,0 +1,130 @@
+// WarmResume.h - State carried across deep sleep for a fast wake
+//
+// Deep sleep resets the chip, so every wake used to be a cold boot: game 1,
+// sensor configured from scratch, no bar until the first 400 ms integration
+// after the power-on hold and splash. enterDeepSleep() now leaves a snapshot
+// in RTC slow memory (RTC_NOINIT, like the CDC mode flag) and a button wake
+// restores it: last game/screen and debug page, the LTR390 ranging mode so
+// the sensor is programmed once for the light it was last in, and the last
+// reading, which is shown as a provisional bar until the first real sample
+// lands. The sensor is brought up before the power-on hold instead of after
+// it, so its first integration runs while the button is held, and the
+// "Ojo del Sol ON" splash is skipped.
+//
+// The snapshot is only trusted on an EXT0 (button) wake with a matching
+// magic and checksum; any other reset cause discards it.
+#ifndef WARM_RESUME_H
+#define WARM_RESUME_H
+
+#include <Arduino.h>
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+
+static const uint32_t WARM_RESUME_MAGIC = 0x0D501E01;
+
+struct WarmResumeState {
+  uint32_t magic;
+  int8_t currentGame;
+  int8_t currentScreen;
+  int8_t debugPage;
+  int8_t uvRangeMode;     // Index into UV_RANGE_MODES (gain/resolution/rate)
+  uint32_t rawUVS;
+  float uviRaw;
+  float uvi;              // Value used for bars (compensated, smoothed)
+  uint32_t checksum;
+};
+
+RTC_NOINIT_ATTR static WarmResumeState _warmResumeState;
+
+static inline uint32_t warmResumeChecksum(const WarmResumeState& state) {
+  // FNV-1a over everything but the checksum itself
+  const uint8_t* bytes = (const uint8_t*)&state;
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < offsetof(WarmResumeState, checksum); i++) {
+    hash = (hash ^ bytes[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+static inline void saveWarmResumeState(const WarmResumeState& state) {
+  _warmResumeState = state;
+  _warmResumeState.magic = WARM_RESUME_MAGIC;
+  _warmResumeState.checksum = warmResumeChecksum(_warmResumeState);
+}
+
+static inline void clearWarmResumeState() {
+  _warmResumeState.magic = 0;
+}
+
+// Copy out the snapshot if this boot is a button wake from deep sleep and
+// the snapshot is intact. Discards it otherwise.
+static inline bool loadWarmResumeState(WarmResumeState* out) {
+  if (esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_EXT0 ||
+      _warmResumeState.magic != WARM_RESUME_MAGIC ||
+      _warmResumeState.checksum != warmResumeChecksum(_warmResumeState)) {
+    clearWarmResumeState();
+    return false;
+  }
+  *out = _warmResumeState;
+  return true;
+}
+
+// ============================================================================
+// Boot phase timing
+// ============================================================================
+// setup() marks the end of each stage; loop() marks the first bar computed
+// from a real sample. Times are esp_timer microseconds since the app started
+// (the ROM/bootloader time before that is not visible to the app).
+
+enum BootPhase : uint8_t {
+  BOOT_PHASE_USB = 0,
+  BOOT_PHASE_DISPLAY,
+  BOOT_PHASE_SENSOR,
+  BOOT_PHASE_POWER_ON,   // Waiting for the power-on hold
+  BOOT_PHASE_SPLASH,
+  BOOT_PHASE_BLE,
+  BOOT_PHASE_UI,
+  BOOT_PHASE_FIRST_BAR,  // First bar from a real sample, marked in loop()
+  BOOT_PHASE_COUNT
+};
+
+// Short labels (4 chars max) so two phases fit on one 128px display row
+static const char* const BOOT_PHASE_NAMES[BOOT_PHASE_COUNT] = {
+  "usb", "disp", "uv", "hold", "spl", "ble", "ui", "bar"
+};
+
+class BootProfiler {
+public:
+  void begin(bool warm) {
+    warmBoot = warm;
+    lastUs = 0;
+    memset(phaseUs, 0, sizeof(phaseUs));
+    memset(marked, 0, sizeof(marked));
+  }
+
+  // Close a phase: its cost is the time since the previous mark. Phases
+  // skipped on this boot stay at zero. A phase is only recorded once.
+  void mark(BootPhase phase) {
+    if (marked[phase]) {
+      return;
+    }
+    uint32_t nowUs = (uint32_t)esp_timer_get_time();
+    phaseUs[phase] = nowUs - lastUs;
+    lastUs = nowUs;
+    marked[phase] = true;
+  }
+
+  bool done(BootPhase phase) const { return marked[phase]; }
+  uint32_t phaseMs(BootPhase phase) const { return phaseUs[phase] / 1000; }
+  uint32_t totalMs() const { return lastUs / 1000; }  // Up to the latest mark
+  bool warm() const { return warmBoot; }
+
+private:
+  bool warmBoot = false;
+  uint32_t lastUs = 0;
+  uint32_t phaseUs[BOOT_PHASE_COUNT];
+  bool marked[BOOT_PHASE_COUNT];
+};
+
+#endif // WARM_RESUME_H
@@ -10,6 +10,14 @@
 //
 // NOTE: This overrides TinyUSB descriptor callbacks. Normal boot uses XInput.
 // A runtime RTC flag can switch descriptors to CDC for firmware upload mode.
+//
+// Reports are never dropped because EP1 IN is still busy with the previous
+// one. sendReport() stores the newest controller state and marks it dirty;
+// the transfer-complete callback submits whatever is pending as soon as the
+// endpoint frees up, so intermediate states that were superseded before
+// they could go out are merged (coalesced). Press/release edges that must
+// each reach the host (incremental-mode taps) go through sendEdgeReport()
+// instead, which keeps them in an ordered queue ahead of the latest state.
 
 #pragma once
 
@@ -21,6 +29,8 @@
 #include "device/usbd.h"
 #include "device/usbd_pvt.h"
 #include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "TraceBuffer.h"
 
 // ============================================================================
 // CDC mode flag — persists across software resets and deep sleep.
@@ -267,10 +277,15 @@ const uint16_t* tud_descriptor_string_cb(uint8_t index, uint16_t langid) {
 
 static const uint8_t XINPUT_EP_IN = 0x81;
 
+// Implemented after XboxHIDGamepad; forward the endpoint events to it.
+static void xinputOnReportDone(void);
+static void xinputOnBusReset(void);
+
 static void xinput_driver_init(void) {}
 
 static void xinput_driver_reset(uint8_t rhport) {
   (void)rhport;
+  xinputOnBusReset();
 }
 
 static uint16_t xinput_driver_open(uint8_t rhport,
@@ -305,7 +320,10 @@ static bool xinput_driver_control_xfer_cb(uint8_t rhport, uint8_t stage,
 
 static bool xinput_driver_xfer_cb(uint8_t rhport, uint8_t ep_addr,
                                   xfer_result_t result, uint32_t xferred_bytes) {
-  (void)rhport; (void)ep_addr; (void)result; (void)xferred_bytes;
+  (void)rhport; (void)result; (void)xferred_bytes;
+  if (ep_addr == XINPUT_EP_IN) {
+    xinputOnReportDone();
+  }
   return true;
 }
 
@@ -334,61 +352,246 @@ extern "C" const usbd_class_driver_t* usbd_app_driver_get_cb(uint8_t* driver_cou
 // XboxHIDGamepad - high-level API
 // ============================================================================
 
+// Ordered press/release reports that may wait behind an in-flight transfer
+static const uint8_t XINPUT_EDGE_QUEUE_LEN = 8;
+
 class XboxHIDGamepad {
 public:
   XboxHIDGamepad() {
-    memset(&_report, 0, sizeof(_report));
-    _report.report_id   = 0x00;
-    _report.report_size = 0x14;
+    initReport(_report);
+    initReport(_latest);
   }
 
   void begin() {
     // Descriptors and driver are registered via TinyUSB callback overrides
     // at link time. No runtime registration needed.
+    _instance = this;
   }
 
-  /// Send a full Xbox 360 controller state report.
+  /// Set the latest Xbox 360 controller state and send it as soon as the
+  /// IN endpoint is free. A state replaced before it went out is merged
+  /// into the newer one.
   /// @param buttons  XInput button bitmask (XINPUT_GAMEPAD_* ORed together)
   /// @param triggerL Left trigger 0-255
   /// @param triggerR Right trigger 0-255
   /// @param lx,ly    Left stick (-32768 to 32767)
   /// @param rx,ry    Right stick (-32768 to 32767)
-  /// @return true if the report was queued for transmission
+  /// @return true if the state was accepted for transmission
   bool sendReport(uint16_t buttons, uint8_t triggerL, uint8_t triggerR,
                   int16_t lx, int16_t ly, int16_t rx, int16_t ry) {
     if (isXInputCdcMode()) return false;
-    _report.report_id    = 0x00;
-    _report.report_size  = 0x14;
-    _report.buttons_lo   = (uint8_t)(buttons & 0xFF);
-    _report.buttons_hi   = (uint8_t)((buttons >> 8) & 0xFF);
-    _report.trigger_left  = triggerL;
-    _report.trigger_right = triggerR;
-    _report.stick_left_x  = lx;
-    _report.stick_left_y  = ly;
-    _report.stick_right_x = rx;
-    _report.stick_right_y = ry;
-    memset(_report.reserved, 0, sizeof(_report.reserved));
+    XInputReport_t report;
+    fillReport(report, buttons, triggerL, triggerR, lx, ly, rx, ry);
+    portENTER_CRITICAL(&_mux);
+    if (_latestDirty) {
+      _coalesced++;
+    }
+    _latest = report;
+    _latestDirty = true;
+    portEXIT_CRITICAL(&_mux);
+    trySubmit();
+    return true;
+  }
+
+  /// Like sendReport(), but the report is never merged: it is sent after
+  /// any earlier edges and before any later state. Use for press/release
+  /// transitions the host must see individually.
+  bool sendEdgeReport(uint16_t buttons, uint8_t triggerL, uint8_t triggerR,
+                      int16_t lx, int16_t ly, int16_t rx, int16_t ry) {
+    if (isXInputCdcMode()) return false;
+    XInputReport_t report;
+    fillReport(report, buttons, triggerL, triggerR, lx, ly, rx, ry);
+    portENTER_CRITICAL(&_mux);
+    // The edge carries the full state, so it supersedes a pending latest
+    if (_latestDirty) {
+      _latestDirty = false;
+      _coalesced++;
+    }
+    if (_edgeCount < XINPUT_EDGE_QUEUE_LEN) {
+      _edges[(_edgeHead + _edgeCount) % XINPUT_EDGE_QUEUE_LEN] = report;
+      _edgeCount++;
+    } else {
+      // Queue full: keep order by folding this edge into the latest state
+      _latest = report;
+      _latestDirty = true;
+      _coalesced++;
+    }
+    portEXIT_CRITICAL(&_mux);
+    trySubmit();
+    return true;
+  }
+
+  /// Call once per loop() pass: resubmits anything left pending while the
+  /// bus was suspended or not yet configured (no completion callback will
+  /// arrive in that case).
+  void service() {
+    if (isXInputCdcMode() || !hasPending()) return;
+    trySubmit();
+  }
+
+  bool hasPending() {
+    portENTER_CRITICAL(&_mux);
+    bool pending = _latestDirty || (_edgeCount > 0);
+    portEXIT_CRITICAL(&_mux);
+    return pending;
+  }
+
+  // Counters since boot
+  uint32_t reportsSubmitted() const { return _submitted; }
+  uint32_t reportsCoalesced() const { return _coalesced; }
+  uint32_t reportsRetried() const { return _retried; }  // Deferred because EP1 IN was busy or not ready
+  uint8_t edgesQueued() const { return _edgeCount; }
+
+  // TinyUSB callbacks (via xinputOnReportDone / xinputOnBusReset)
+  void onReportDone() {
+    portENTER_CRITICAL(&_mux);
+    _inFlight = false;
+    portEXIT_CRITICAL(&_mux);
+    traceEvent(TRACE_USB_REPORT, TRACE_USB_DONE, _edgeCount);
+    trySubmit();
+  }
+
+  void onBusReset() {
+    // An aborted transfer never completes. Keep everything still queued
+    // and put the aborted report back in front of it (reports carry the
+    // full state, so resending one that did get through is harmless).
+    // With nothing pending, resend the last state so the host has it once
+    // it configures the device again.
+    portENTER_CRITICAL(&_mux);
+    if (_inFlight) {
+      _inFlight = false;
+      if (_edgeCount < XINPUT_EDGE_QUEUE_LEN) {
+        _edgeHead = (uint8_t)((_edgeHead + XINPUT_EDGE_QUEUE_LEN - 1) % XINPUT_EDGE_QUEUE_LEN);
+        _edges[_edgeHead] = _report;
+        _edgeCount++;
+      }
+    }
+    if (!_latestDirty && _edgeCount == 0) {
+      _latest = _report;
+      _latestDirty = true;
+    }
+    portEXIT_CRITICAL(&_mux);
+  }
+
+  static XboxHIDGamepad* instance() { return _instance; }
+
+private:
+  static void initReport(XInputReport_t& report) {
+    memset(&report, 0, sizeof(report));
+    report.report_id   = 0x00;
+    report.report_size = 0x14;
+  }
+
+  static void fillReport(XInputReport_t& report, uint16_t buttons, uint8_t triggerL, uint8_t triggerR,
+                         int16_t lx, int16_t ly, int16_t rx, int16_t ry) {
+    initReport(report);
+    report.buttons_lo    = (uint8_t)(buttons & 0xFF);
+    report.buttons_hi    = (uint8_t)((buttons >> 8) & 0xFF);
+    report.trigger_left  = triggerL;
+    report.trigger_right = triggerR;
+    report.stick_left_x  = lx;
+    report.stick_left_y  = ly;
+    report.stick_right_x = rx;
+    report.stick_right_y = ry;
+  }
+
+  // Submit the next pending report if EP1 IN is free. Runs from loop() and
+  // from the TinyUSB task's completion callback; claiming the endpoint is
+  // what serializes the two, and _report is only written while claimed.
+  // TinyUSB calls may block on its own mutex, so they stay outside _mux.
+  void trySubmit() {
+    if (!hasPending()) return;
 
     if (tud_suspended()) {
       tud_remote_wakeup();
     }
+    if (!tud_ready() || !usbd_edpt_claim(0, XINPUT_EP_IN)) {
+      noteDeferred();
+      return;
+    }
 
-    if (!tud_ready() || usbd_edpt_busy(0, XINPUT_EP_IN))
-      return false;
-
-    if (!usbd_edpt_claim(0, XINPUT_EP_IN))
-      return false;
+    portENTER_CRITICAL(&_mux);
+    bool have = true;
+    if (_edgeCount > 0) {
+      _report = _edges[_edgeHead];
+      _edgeHead = (uint8_t)((_edgeHead + 1) % XINPUT_EDGE_QUEUE_LEN);
+      _edgeCount--;
+    } else if (_latestDirty) {
+      _report = _latest;
+      _latestDirty = false;
+    } else {
+      have = false;  // Drained by the other context between checks
+    }
+    portEXIT_CRITICAL(&_mux);
+    if (!have) {
+      usbd_edpt_release(0, XINPUT_EP_IN);
+      return;
+    }
 
     // 5th arg (ZLP flag) is an ESP32-Arduino TinyUSB extension; not present in upstream TinyUSB.
     if (!usbd_edpt_xfer(0, XINPUT_EP_IN, (uint8_t*)&_report, sizeof(XInputReport_t), false)) {
       usbd_edpt_release(0, XINPUT_EP_IN);
-      return false;
+      // Put the state back unless something newer is already waiting
+      portENTER_CRITICAL(&_mux);
+      if (!_latestDirty && _edgeCount == 0) {
+        _latest = _report;
+        _latestDirty = true;
+      }
+      portEXIT_CRITICAL(&_mux);
+      noteDeferred();
+      return;
     }
-    return true;
+    portENTER_CRITICAL(&_mux);
+    _inFlight = true;
+    _submitted++;
+    _deferTraced = false;
+    uint8_t edgesLeft = _edgeCount;
+    portEXIT_CRITICAL(&_mux);
+    traceEvent(TRACE_USB_REPORT, TRACE_USB_SUBMITTED, edgesLeft);
   }
 
-private:
-  XInputReport_t _report;
+  void noteDeferred() {
+    portENTER_CRITICAL(&_mux);
+    _retried++;
+    // service() retries every loop() pass while the bus is down; trace
+    // only the first deferral of a run
+    bool trace = !_deferTraced;
+    _deferTraced = true;
+    uint8_t edgesLeft = _edgeCount;
+    portEXIT_CRITICAL(&_mux);
+    if (trace) {
+      traceEvent(TRACE_USB_REPORT, TRACE_USB_DEFERRED, edgesLeft);
+    }
+  }
+
+  static XboxHIDGamepad* _instance;
+
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  XInputReport_t _report;   // In-flight transfer buffer (owned while EP1 IN is claimed)
+  bool _inFlight = false;   // _report submitted, completion not seen yet
+  XInputReport_t _latest;   // Newest state not yet sent
+  bool _latestDirty = false;
+  XInputReport_t _edges[XINPUT_EDGE_QUEUE_LEN];
+  uint8_t _edgeHead = 0;
+  uint8_t _edgeCount = 0;
+  uint32_t _submitted = 0;
+  uint32_t _coalesced = 0;
+  uint32_t _retried = 0;
+  bool _deferTraced = false;
 };
 
+XboxHIDGamepad* XboxHIDGamepad::_instance = nullptr;
+
+static void xinputOnReportDone(void) {
+  if (XboxHIDGamepad::instance() != nullptr) {
+    XboxHIDGamepad::instance()->onReportDone();
+  }
+}
+
+static void xinputOnBusReset(void) {
+  if (XboxHIDGamepad::instance() != nullptr) {
+    XboxHIDGamepad::instance()->onBusReset();
+  }
+}
+
 #endif // ARDUINO_USB_MODE check
@@ -90,21 +90,92 @@ const float UVI_SMOOTHING_ALPHA = 0.5;  // 0.0-1.0. Controls how much weight new
 const bool BAR_HYSTERESIS_ENABLED = false;
 const float BAR_HYSTERESIS = 0.200;       // UV Index margin for bar changes
 
+// Fixed-point filter pipeline (UvFilter.h). When enabled it replaces the
+// smoothing and hysteresis settings above: a median of the last few samples
+// drops single-sample spikes, a One-Euro low-pass smooths hard while the
+// light is steady and opens up while it is changing, and the bar hysteresis
+// margin is a fraction of the local bar spacing instead of a fixed UVI.
+// Compare settings against a recorded session with the 'b' serial command
+// (needs SESSION_LOG_ENABLED).
+const bool UV_FILTER_PIPELINE_ENABLED = false;
+const int UV_FILTER_MEDIAN_N = 3;               // 1 (off), 3 or 5 samples
+const bool UV_FILTER_ADAPTIVE_ENABLED = true;   // One-Euro stage
+const float UV_FILTER_MIN_CUTOFF_HZ = 0.3f;     // Cutoff while the UV level is steady. Lower = smoother.
+const float UV_FILTER_BETA = 2.0f;              // Cutoff added (Hz) per UVI/s of change. Higher = less lag.
+const float UV_FILTER_SLOPE_CUTOFF_HZ = 1.0f;   // Smoothing of the rate-of-change estimate
+const float UV_FILTER_HYSTERESIS = 0.15f;       // Margin as a fraction of the gap between bar thresholds
+const float UV_FILTER_SLEW_UVI_PER_S = 0.5f;    // Change rate that counts as a real move
+const float UV_FILTER_SLEW_KEEP = 0.25f;        // Fraction of the margin kept in the direction of a real move
+
 // -----------------------------------------------------------------------------
-// GAME DEFINITIONS
+// UV AUTO-RANGING
+// -----------------------------------------------------------------------------
+// The LTR390 runs at 18x gain / 20-bit / 500ms in shade (datasheet accuracy
+// setting). In bright light that resolution isn't needed, so auto-ranging
+// switches to 18x / 18-bit / 100ms and bar changes appear ~5x sooner.
+// The gap between the two thresholds is the hysteresis band; the minimum
+// dwell time stops flapping around a threshold. Moving down also waits for a
+// second sample below the lower threshold (UvAutoRange.h).
+const bool UV_AUTORANGE_ENABLED = true;
+const float UV_AUTORANGE_FAST_ABOVE_UVI = 3.0f;  // Measured UVI to enter fast mode
+const float UV_AUTORANGE_SLOW_BELOW_UVI = 2.0f;  // Measured UVI to return to slow mode
+const unsigned long UV_AUTORANGE_MIN_DWELL_MS = 2000;
+
+// -----------------------------------------------------------------------------
+// ALS-ASSISTED STEP DETECTION
 // -----------------------------------------------------------------------------
-// Number of supported games
-const int NUM_GAMES = 3;
+// Walking between sun and shade normally takes one to two UV samples to show
+// (up to ~1s in the shade range, more with smoothing). With the assist on,
+// every UV sample is followed by a 25ms ambient-light (ALS) conversion. When
+// the ALS level jumps by UV_ALS_STEP_RATIO, the bars move straight to a
+// provisional value from a UVI-per-ALS ratio learned while the light was
+// steady, and the next full UV sample confirms or corrects it. See
+// AlsAssist.h; the 'a' serial command replays sun/shade steps with and
+// without it. Costs ~30ms per UV sample (the sensor has a single ADC), so
+// it only runs in the slow UV range; fast-range samples are quick enough.
+const bool UV_ALS_ASSIST_ENABLED = false;
+const float UV_ALS_STEP_RATIO = 1.6f;          // ALS change (up or down) that counts as a step
+const float UV_ALS_STABLE_RATIO = 1.1f;        // ALS change small enough to learn the ratio from
+const float UV_ALS_LEARN_WEIGHT = 0.25f;       // Weight of each steady sample in the learned ratio
+const uint32_t UV_ALS_MIN_COUNTS = 50;         // Below this (gain 1, 16-bit) it is too dark to judge
 
-// Game names (shown on display)
-const char* const GAME_NAMES[NUM_GAMES] = {
-  "BOKTAI 1",
-  "BOKTAI 2", 
-  "BOKTAI 3"
-};
+// -----------------------------------------------------------------------------
+// MULTIPLE UV SENSORS
+// -----------------------------------------------------------------------------
+// Up to 4 LTR390s, started one cycle/N apart so a fresh sample arrives every
+// 500/N ms in shade (and ~112/N ms in bright light) instead of every 500 ms.
+// All LTR390s share address 0x53, so sensor 0 stays on the main bus and the
+// others go behind a TCA9548A mux (UV_SENSOR_MUX_CHANNEL) or on a second I2C
+// bus (UV_SENSOR_BUS = 1, pins below). Samples are mapped onto sensor 0's
+// counts, a sensor that keeps disagreeing with the others is left out, and
+// a sensor that stops answering is dropped and retried every
+// UV_SENSOR_RETRY_MS. See UvFusion.h; the 'm' serial command runs the fusion
+// on simulated sensors. With more than one sensor, LTR390_INT_PIN and
+// UV_ALS_ASSIST_ENABLED are not used.
+const int UV_SENSOR_COUNT = 1;
+const uint8_t UV_SENSOR_MUX_ADDR = 0x70;                 // TCA9548A (A0-A2 low)
+const int8_t UV_SENSOR_BUS[4] = { 0, 0, 0, 0 };          // 0 = main bus, 1 = second bus
+const int8_t UV_SENSOR_MUX_CHANNEL[4] = { -1, 0, 1, 2 }; // Main-bus mux channel, -1 = no mux
+const int UV_SENSOR_BUS1_SDA_PIN = -1;                   // Second bus pins (only if a sensor uses it)
+const int UV_SENSOR_BUS1_SCL_PIN = -1;
+// Per-sensor calibration against sensor 0: counts it reads for the same
+// light (1.0 = same), and its own window transmittance (0 = the enclosure
+// value above).
+const float UV_SENSOR_SENSITIVITY[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+const float UV_SENSOR_TRANSMITTANCE[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+const bool UV_SENSOR_FUSE_AVERAGE = false;       // false = newest sample (fastest), true = mean of the last cycle (steadiest)
+const float UV_SENSOR_OUTLIER_FRACTION = 0.25f;  // Disagreement with the other sensors that counts against one
+const float UV_SENSOR_OUTLIER_MIN_UVI = 0.3f;    // ... but never less than this
+const uint8_t UV_SENSOR_OUTLIER_STRIKES = 3;     // Disagreements in a row before it is left out (0 = never)
+const uint8_t UV_SENSOR_MAX_FAILURES = 3;        // Failed reads in a row before a sensor is dropped
+const unsigned long UV_SENSOR_RETRY_MS = 5000;
 
-// Bar counts per game
-const int GAME_BARS[NUM_GAMES] = { 8, 10, 10 };
+// -----------------------------------------------------------------------------
+// GAME DEFINITIONS
+// -----------------------------------------------------------------------------
+// Games, their names, bar counts, cartridge curves, emulator step models and
+// GBA link patch levels are declared once in GameProfiles.h; every per-game
+// table is generated from there. A new game also needs a UV range below.
 
 // -----------------------------------------------------------------------------
 // MANUAL MODE CALIBRATION (only used when AUTO_MODE = false)
@@ -141,20 +212,27 @@ const int BAT_PIN = 4;       // GPIO4 - built-in battery voltage divider
 const bool BATTERY_SENSE_ENABLED = false;
 const int BAT_PIN = 2;       // D1/A1 (GPIO2) - connect to voltage divider midpoint
 #endif
-const float VOLT_MIN = 3.3;  // 0% Battery
-const float VOLT_MAX = 4.2;  // 100% Battery (must be > VOLT_MIN)
+const float VOLT_MIN = 3.3;  // 0% Battery (linear mapping only)
+const float VOLT_MAX = 4.2;  // 100% Battery (linear mapping only; must be > VOLT_MIN)
 const unsigned long BATTERY_SAMPLE_MS = 1000;  // Battery update interval
+// Battery % follows a typical LiPo discharge curve (BatteryCurve.h). The
+// curve is for a resting cell; BATTERY_SAG_MV is added back to the voltage
+// measured while running to account for the drop under the device's load.
+// false = linear between VOLT_MIN and VOLT_MAX.
+const bool BATTERY_LIPO_CURVE_ENABLED = true;
+const int BATTERY_SAG_MV = 50;
 
 // Voltage divider calibration multiplier
-// Theoretical: 2.0 for equal resistors (2:1 ratio)
+// Theoretical: 2.0 for equal resistors (2:1 ratio). The ADC reading already
+// uses the chip's factory (eFuse) calibration, so this only needs to cover
+// resistor tolerance.
 // Adjust if battery % is wrong at full charge:
 //   - If % too LOW:  increase this value
 //   - If % too HIGH: decrease this value
 #if defined(BOARD_LILYGO_T_QT_PRO)
 const float VOLT_DIVIDER_MULT = 2.00;  // Built-in divider is 2:1
 #else
-// Default 2.20 compensates for typical ADC/resistor variance on the XIAO build
-const float VOLT_DIVIDER_MULT = 2.20;
+const float VOLT_DIVIDER_MULT = 2.00;
 #endif
 
 // -----------------------------------------------------------------------------
@@ -162,9 +240,37 @@ const float VOLT_DIVIDER_MULT = 2.20;
 // -----------------------------------------------------------------------------
 // Keep disabled by default; only enable after battery sensing is verified.
 const bool BATTERY_CUTOFF_ENABLED = false;
-const float VOLT_CUTOFF = VOLT_MIN;  // Cutoff threshold under load
+const float VOLT_CUTOFF = VOLT_MIN;  // Cutoff threshold under load (filtered voltage, no sag compensation)
 const unsigned long BATTERY_CUTOFF_HOLD_MS = 5000;
 
+// -----------------------------------------------------------------------------
+// SLEEP BETWEEN EVENTS
+// -----------------------------------------------------------------------------
+// loop() sleeps until the next thing it has to do (sensor poll, HID press,
+// button debounce, BLE icon flash...) or an interrupt, instead of running
+// every millisecond. While idle the CPU drops to POWER_CPU_MIN_MHZ and, if
+// the ESP32 core supports it, into automatic light sleep. Light sleep is
+// skipped while USB (XInput or Serial) or the GBA link is in use; BLE keeps
+// its connection either way. false = the old fixed 1 ms loop.
+const bool POWER_SCHEDULER_ENABLED = true;
+const uint32_t POWER_CPU_MAX_MHZ = 240;
+const uint32_t POWER_CPU_MIN_MHZ = 80;     // 80 keeps the APB clock (I2C, timers, USB) unchanged
+const bool POWER_LIGHT_SLEEP_ENABLED = true;
+const unsigned long POWER_MAX_SLEEP_MS = 100;  // Longest wait (BLE connection changes are polled)
+const unsigned long POWER_SERIAL_POLL_MS = 20; // Serial command polling when DEBUG_SERIAL = true
+// Rough currents (mA) for the estimate on the Power debug page, from the
+// ESP32-S3 datasheet. Replace them with measurements of your build.
+const float POWER_EST_BUSY_MA = 45.0f;         // CPU running at POWER_CPU_MAX_MHZ
+const float POWER_EST_IDLE_MAX_MA = 32.0f;     // CPU idle at POWER_CPU_MAX_MHZ (no scaling)
+const float POWER_EST_IDLE_MIN_MA = 22.0f;     // CPU idle at POWER_CPU_MIN_MHZ
+const float POWER_EST_LIGHT_SLEEP_MA = 0.3f;
+const float POWER_EST_BLE_MA = 10.0f;          // Radio average while advertising or connected
+#if defined(BOARD_LILYGO_T_QT_PRO)
+const float POWER_EST_DISPLAY_MA = 20.0f;      // TFT and backlight
+#else
+const float POWER_EST_DISPLAY_MA = 8.0f;       // SSD1306, typical screen
+#endif
+
 // =============================================================================
 // USER INTERFACE
 // =============================================================================
@@ -187,8 +293,15 @@ const int BUTTON_PIN = 1;    // D0 (GPIO1)
 const bool BUTTON2_ENABLED = false;
 const int BUTTON2_PIN = -1;
 #endif
+// Button edges are read by interrupt and timed from the edge itself, so
+// these hold however busy the main loop is.
 const unsigned long DEBOUNCE_MS = 50;       // Button debounce time
 const unsigned long LONG_PRESS_MS = 2000;   // Hold 2 seconds to power on/off
+const unsigned long BUTTON_DOUBLE_TAP_MS = 300;  // Max gap between the taps of a double tap
+// On a button wake from deep sleep, restore the last game/screen, sensor
+// range and reading from RTC memory, start the sensor during the power-on
+// hold and skip the wake splash. false = every wake is a cold boot.
+const bool WARM_RESUME_ENABLED = true;
 
 // -----------------------------------------------------------------------------
 // DISPLAY / I2C
@@ -212,7 +325,20 @@ const uint8_t TQT_DISPLAY_ROTATION = 0;
 const int I2C_SDA_PIN = 5;                // D4 (GPIO5)
 const int I2C_SCL_PIN = 6;                // D5 (GPIO6)
 const uint8_t DISPLAY_I2C_ADDR = 0x3C;   // Some SSD1306 modules use 0x3D
+// Display frames are pushed in 64-byte chunks between other bus traffic.
+// Each loop() pass writes chunks until this budget is spent (at least one),
+// bounding how long the sensor read and HID paths wait behind the display.
+const uint32_t I2C_DISPLAY_FLUSH_BUDGET_US = 1500;
 #endif
+// I2C bus clock. 400kHz (Fast-mode) is the LTR390's rated maximum, so the
+// shared bus stays there even though the SSD1306 tolerates faster clocks.
+const uint32_t I2C_CLOCK_HZ = 400000;
+// Optional LTR390 INT output (active LOW). When wired to a free GPIO, the
+// sensor is read only after it signals a new sample instead of polling its
+// status register. -1 = not wired (poll). Keep the safety poll interval
+// longer than the measurement period; it recovers from a missed edge.
+const int LTR390_INT_PIN = -1;
+const unsigned long LTR390_INT_SAFETY_POLL_MS = 1000;
 
 // -----------------------------------------------------------------------------
 // DISPLAY SCREENSAVER
@@ -247,6 +373,14 @@ const int GBA_PIN_SO = 8;   // D9 (GPIO8)  - payload bit 0 (SO)
 // Per-phase hold time. A full 4-bit value takes two phases.
 // Example: 5ms => one phase every 5ms, full value refresh about every 10ms.
 const unsigned long GBA_LINK_FRAME_TOGGLE_MS = 5;
+// Drive phase toggles from a hardware timer interrupt so phase timing does not
+// depend on loop() latency. Set false to fall back to polled output from loop().
+const bool GBA_LINK_HW_TIMER_ENABLED = true;
+// Link protocol v2: Gray-coded halves, so the game commits a one-bar change
+// on the first read that sees it instead of waiting for two matching reads.
+// Requires patches built with LINK_V2 (see GBA Link Patches/Source); the
+// released .ips patches are v1. The 'g' serial command simulates both.
+const bool GBA_LINK_PROTOCOL_V2 = false;
 
 // -----------------------------------------------------------------------------
 // HID CONTROLLER (shared by Bluetooth and USB)
@@ -255,10 +389,13 @@ const unsigned long GBA_LINK_FRAME_TOGGLE_MS = 5;
 // 0 = Incremental: uses HID_BUTTON_DEC/INC to step the emulator meter.
 //     (BLE transport also supports clamp+refill resync behavior.)
 // 1 = Single Analog: maps bar count to a proportional deflection on one analog axis.
+// 2 = Absolute: sends the cartridge sensor value (0x00-0xE8) in the triggers
+//     plus a check byte on the HID_SINGLE_ANALOG_AXIS axis; one report per
+//     change (see AbsoluteMeter.h / For Emulator Devs.md).
 const uint8_t HID_CONTROL_MODE = 0;
 
-// Workaround: mGBA uses 10 steps for Boktai 1 even though it has 8 bars.
-// Set false if mGBA is fixed to use 8 steps.
+// Workaround: mGBA uses 10 steps for Boktai 1 even though it has 8 bars
+// (emuStepToBar in GameProfiles.h). Set false if mGBA is fixed to use 8 steps.
 const bool HID_BOKTAI1_MGBA_10_STEP_WORKAROUND = true;
 
 // Incremental mode button mapping (shared by Bluetooth and USB)
@@ -268,7 +405,8 @@ const unsigned int HID_BUTTONS_PER_SECOND = 20;     // Button press rate; 0 disa
 const uint16_t HID_BUTTON_DEC = 0x2000;              // L3 (Left Stick click)
 const uint16_t HID_BUTTON_INC = 0x4000;              // R3 (Right Stick click)
 
-// Single Analog axis (shared by Bluetooth and USB; used when HID_CONTROL_MODE = 1):
+// Single Analog axis (shared by Bluetooth and USB; used when HID_CONTROL_MODE = 1,
+// and as the check-byte axis in mode 2, where the sign is ignored):
 // 0 = Left  X-  (left stick left)
 // 1 = Left  X+  (left stick right)
 // 2 = Left  Y-  (left stick up)
@@ -299,6 +437,10 @@ const char BLE_MANUFACTURER[] = "Ojo del Sol";
 const unsigned long BLE_PAIRING_TIMEOUT_MS = 60000;
 const bool BLE_RESYNC_ENABLED = true;
 const unsigned long BLE_RESYNC_INTERVAL_MS = 60000; // Clamp + refill interval
+// A due resync is folded into the next move to 0 or full bars, which only
+// over-presses into the end the meter is already heading for. If the sensor
+// never reaches an end, a clamp + refill is forced after this extra delay.
+const unsigned long BLE_RESYNC_MAX_DEFER_MS = 300000;
 
 // -----------------------------------------------------------------------------
 // USB HID
@@ -312,6 +454,22 @@ const unsigned long BLE_RESYNC_INTERVAL_MS = 60000; // Clamp + refill interval
 // to XInput-on-next-wake with another 2s hold.
 const bool USB_HID_ENABLED = true;
 
+// =============================================================================
+// TASKS
+// =============================================================================
+// Display rendering runs in its own FreeRTOS task so OLED/TFT transfers never
+// delay sensor reads, bar updates, HID reports or the GBA link in loop()
+// (which stays on core 1). When false, rendering runs inline from loop().
+const bool UI_TASK_ENABLED = true;
+const int UI_TASK_CORE = 0;                  // Core for the UI task (BLE host also runs on core 0)
+const uint32_t UI_TASK_STACK_BYTES = 6144;
+const unsigned long UI_TASK_PERIOD_MS = 10;  // Idle wake period (screensaver, debug page rotation)
+// Draw the main screen from retained widgets: each field redraws only when
+// its value changes, from pre-rasterized glyph cells, and only the damaged
+// rows (TFT) or pages (OLED) are compared and pushed. An unchanged frame
+// costs nothing. Set false to rebuild the whole frame for every sample.
+const bool UI_RETAINED_WIDGETS = true;
+
 // =============================================================================
 // DEBUG
 // =============================================================================
@@ -321,5 +479,48 @@ const bool DEBUG_SERIAL = false;
 // Periodic Serial debug stream controls. These only apply when DEBUG_SERIAL = true.
 const bool DEBUG_SERIAL_BATTERY = false;
 const bool DEBUG_SERIAL_UV = true;
+// Prints a per-subsystem loop() timing summary once per DEBUG_STATS_WINDOW_MS.
+const bool DEBUG_SERIAL_PERF = false;
+// Replace the UV and battery text streams with one binary frame per sensor
+// sample (raw UVS, UVI, bars, battery ADC/voltage, HID state, sequence
+// number and timestamp). Frames are queued and sent only as fast as the CDC
+// port accepts them, never blocking loop(); overruns drop frames and count
+// them. Frame format and a reference reader are in Telemetry.h.
+const bool DEBUG_SERIAL_TELEMETRY = false;
+
+// Runtime statistics (loop() timing per subsystem and other counters).
+// When true, the XInput/CDC debug screen cycles through extra stats pages.
+const bool DEBUG_STATS_ENABLED = true;
+const unsigned long DEBUG_STATS_WINDOW_MS = 1000;  // Averaging window for timing stats
+const unsigned long DEBUG_STATS_PAGE_MS = 3000;    // How long each debug page is shown
+
+// Event trace: a small ring of timestamped events (sensor samples, bar
+// changes, HID presses/reports, GBA phases, display flushes, button edges)
+// kept in RTC memory. Cheap enough to leave on; it survives the restart
+// into CDC mode, where sending 't' over Serial (DEBUG_SERIAL = true) dumps
+// the timeline with sensor-to-HID and sensor-to-GBA latencies.
+const bool TRACE_ENABLED = true;
+
+// Session log: every sensor sample (raw count, bar UVI, bars, game, range
+// mode, plus battery voltage every SESSION_LOG_BATTERY_MS) delta-encoded
+// into 4 KB blocks and appended to LittleFS on the "spiffs" partition by a
+// background task, for calibration work on long outdoor sessions. A typical
+// sample takes 5 bytes. The oldest files are deleted to stay under
+// SESSION_LOG_MAX_KB (keep it below the partition size). In CDC mode with
+// DEBUG_SERIAL = true, send 'l' to dump the log as CSV (replayed through
+// the current bar thresholds), 'b' to score the UV filter settings against
+// it, or 'E' to erase it.
+// Off by default: each flash block write stalls the CPU caches for a few
+// ms, which can stretch GBA link phases and delay BLE/USB reports.
+const bool SESSION_LOG_ENABLED = false;
+const uint32_t SESSION_LOG_FILE_KB = 64;
+const uint32_t SESSION_LOG_MAX_KB = 768;
+const unsigned long SESSION_LOG_BATTERY_MS = 10000;
+
+// At boot, compare the precomputed raw-count bar tables against the float
+// bar math for every 20-bit sensor count and print the mismatch count.
+// Adds several seconds to boot. host/test_bar_thresholds runs the same
+// check on a PC; this one covers the ESP32's own float rounding.
+const bool DEBUG_VERIFY_BAR_TABLES = false;
 
 #endif
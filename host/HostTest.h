@@ -0,0 +1,48 @@
+// HostTest.h - Minimal checks for the host tests
+//
+// CHECK() records a failure with its location and keeps going, so one run
+// shows every broken case; hostTestResult() prints the total and gives the
+// process exit code ctest looks at.
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+inline int hostTestFailures = 0;
+inline int hostTestChecks = 0;
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    hostTestChecks++;                                                        \
+    if (!(cond)) {                                                           \
+      hostTestFailures++;                                                    \
+      if (hostTestFailures <= 20) {                                          \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+      }                                                                      \
+    }                                                                        \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                       \
+  do {                                                                       \
+    hostTestChecks++;                                                        \
+    long long _a = (long long)(a);                                           \
+    long long _b = (long long)(b);                                           \
+    if (_a != _b) {                                                          \
+      hostTestFailures++;                                                    \
+      if (hostTestFailures <= 20) {                                          \
+        fprintf(stderr, "%s:%d: %s == %lld, expected %s == %lld\n", __FILE__, \
+                __LINE__, #a, _a, #b, _b);                                   \
+      }                                                                      \
+    }                                                                        \
+  } while (0)
+
+inline int hostTestResult(const char* name) {
+  if (hostTestFailures > 0) {
+    printf("%s: %d of %d checks failed\n", name, hostTestFailures, hostTestChecks);
+    return 1;
+  }
+  printf("%s: %d checks passed\n", name, hostTestChecks);
+  return 0;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,200 @@
+// als_assist_bench.cpp - ALS-assisted step response on a PC (AlsAssist.h)
+//
+//   als_assist_bench [--game N] [--minutes M] [--seeds K]
+//   als_assist_bench --check
+//
+// Replays synthetic sun/shade transitions through the sensor timing model
+// of AlsAssist.h and prints the step-response latency of the bars with and
+// without the ALS assist, per scene and UV range. It uses the bar
+// thresholds, smoothing, hysteresis and detector settings of the config.h
+// this tool was built with. The "walk" rows with one seed match the
+// device's 'a' command for the same game. --seeds K repeats every run with
+// K seeds and reports the totals, the average latency over every settled
+// transition and the worst latency of any run.
+//
+// --check (run by ctest) runs every game and scene. Runs with and without
+// the assist must see the same transitions, with hardly any false steps.
+// In every scene and range the assist must not raise the average or the
+// worst latency. It must settle at least as many transitions, and sun ->
+// shade steps faster on average, unless the walk-through lasts two UV
+// samples or more: the UV samples then track the ramp themselves, and
+// which few samples land on a bar edge is down to noise. In the
+// fast range the assist is off (alsAssistInRange()), so its rows match
+// the ones without it. On instant, noise-free
+// edges without smoothing or hysteresis, every provisional bar but the first
+// into the shade (nothing learned at that level yet) is the final level,
+// and the worst latency is known: one UV period plus one integration
+// without the assist, two integrations plus two ALS slots with it (the
+// first shade step waiting for its confirming sample).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FirmwareConfig.h"
+#include "HostTest.h"
+
+struct BenchDisplay {
+  float barStarts[GAME_MAX_BARS];
+  int numBars;
+  float smoothingAlpha;
+  float hysteresisUvi;
+};
+
+// The sketch's display settings for a game, as runAlsAssistSimulation() sets them
+static BenchDisplay configuredDisplay(int game) {
+  BenchDisplay display;
+  BarThresholdConfig bars = getBarThresholdConfig();
+  display.numBars = GAME_BARS[game];
+  for (int bar = 1; bar <= display.numBars; bar++) {
+    display.barStarts[bar - 1] = barThreshold(bars, game, bar);
+  }
+  display.smoothingAlpha = (UVI_SMOOTHING_ENABLED && !UV_FILTER_PIPELINE_ENABLED) ? UVI_SMOOTHING_ALPHA : 0.0f;
+  display.hysteresisUvi = (BAR_HYSTERESIS_ENABLED && !UV_FILTER_PIPELINE_ENABLED) ? BAR_HYSTERESIS : 0.0f;
+  return display;
+}
+
+// Totals of one scene/range/assist combination over several seeds
+static AlsSimResult runSeeds(const AlsSimConfig& base, const BenchDisplay& display, uint32_t seeds) {
+  AlsSimResult total = {};
+  uint64_t latencySumMs = 0;
+  uint64_t shadeSumMs = 0;
+  for (uint32_t s = 0; s < seeds; s++) {
+    AlsSimConfig config = base;
+    config.seed = base.seed + s;
+    config.barStarts = display.barStarts;
+    config.numBars = display.numBars;
+    config.smoothingAlpha = display.smoothingAlpha;
+    config.hysteresisUvi = display.hysteresisUvi;
+    AlsSimResult result;
+    alsAssistSimulate(config, &result);
+    total.transitions += result.transitions;
+    total.settled += result.settled;
+    total.shadeSettled += result.shadeSettled;
+    total.provisionals += result.provisionals;
+    total.provisionalExact += result.provisionalExact;
+    total.falseSteps += result.falseSteps;
+    latencySumMs += (uint64_t)result.latencyAvgMs * result.settled;
+    shadeSumMs += (uint64_t)result.shadeAvgMs * result.shadeSettled;
+    if (result.latencyMaxMs > total.latencyMaxMs) {
+      total.latencyMaxMs = result.latencyMaxMs;
+    }
+  }
+  total.latencyAvgMs = total.settled ? (uint32_t)(latencySumMs / total.settled) : 0;
+  total.shadeAvgMs = total.shadeSettled ? (uint32_t)(shadeSumMs / total.shadeSettled) : 0;
+  return total;
+}
+
+static AlsSimConfig benchConfig(const AlsSimScene& scene, int range, bool assist, uint32_t durationMs,
+                                uint32_t seed) {
+  AlsSimConfig config = alsSimSceneConfig(scene, range == 1, assist, durationMs, seed);
+  config.detector = getAlsAssistConfig();
+  return config;
+}
+
+static void printTable(int game, uint32_t minutes, uint32_t seeds) {
+  BenchDisplay display = configuredDisplay(game);
+  printf("# ALS assist simulation: %s, %lu min per run, %lu seed%s\n", GAME_NAMES[game], (unsigned long)minutes,
+         (unsigned long)seeds, seeds == 1 ? "" : "s");
+  char line[112];
+  for (const AlsSimScene& scene : ALS_SIM_SCENES) {
+    printf("# %s: UVI %.1f <-> %.1f, %lu ms walk-through\n", scene.name, scene.sunUvi, scene.shadeUvi,
+           (unsigned long)scene.rampMs);
+    puts(ALS_SIM_TABLE_HEADER);
+    for (int range = 0; range < 2; range++) {
+      for (int assist = 0; assist < 2; assist++) {
+        AlsSimResult result =
+            runSeeds(benchConfig(scene, range, assist != 0, minutes * 60000UL, 12345), display, seeds);
+        alsSimFormatRow(line, sizeof(line), ALS_SIM_RANGE_NAMES[range], assist != 0, result);
+        puts(line);
+      }
+    }
+  }
+}
+
+static int runCheck() {
+  const uint32_t SEEDS = 3;
+  const uint32_t DURATION_MS = 1800000UL;
+  printf("als_assist_bench --check\n");
+  for (int game = 0; game < NUM_GAMES; game++) {
+    BenchDisplay display = configuredDisplay(game);
+    for (const AlsSimScene& scene : ALS_SIM_SCENES) {
+      for (int range = 0; range < 2; range++) {
+        AlsSimResult off = runSeeds(benchConfig(scene, range, false, DURATION_MS, 1000), display, SEEDS);
+        AlsSimResult on = runSeeds(benchConfig(scene, range, true, DURATION_MS, 1000), display, SEEDS);
+        // Same seeds, same light
+        CHECK_EQ(on.transitions, off.transitions);
+        CHECK(on.falseSteps * 100 < on.transitions);   // Under 1%
+        // Never a regression, on average or at worst
+        CHECK(on.latencyAvgMs <= off.latencyAvgMs);
+        CHECK(on.latencyMaxMs <= off.latencyMaxMs);
+        uint32_t periodMs = (range == 1) ? 100 : 500;
+        if (scene.rampMs < 2 * periodMs && alsAssistInRange(range == 1)) {
+          CHECK(on.settled >= off.settled);
+          CHECK(on.shadeAvgMs < off.shadeAvgMs);
+        }
+        printf("  %-6s %-9s %s: shade %4lu -> %3lu ms, all %4lu -> %3lu ms, worst %4lu -> %4lu ms, "
+               "%lu/%lu provisional exact, %lu false\n",
+               GAME_NAMES[game], scene.name, ALS_SIM_RANGE_NAMES[range], (unsigned long)off.shadeAvgMs,
+               (unsigned long)on.shadeAvgMs, (unsigned long)off.latencyAvgMs, (unsigned long)on.latencyAvgMs,
+               (unsigned long)off.latencyMaxMs, (unsigned long)on.latencyMaxMs, (unsigned long)on.provisionalExact,
+               (unsigned long)on.provisionals, (unsigned long)on.falseSteps);
+      }
+    }
+  }
+
+  // Instant, noise-free edges with no smoothing or hysteresis: known bounds
+  for (int range = 0; range < 2; range++) {
+    BenchDisplay display = configuredDisplay(0);
+    display.smoothingAlpha = 0.0f;
+    display.hysteresisUvi = 0.0f;
+    AlsSimConfig offConfig = benchConfig(ALS_SIM_SCENES[1], range, false, DURATION_MS, 1000);
+    AlsSimConfig onConfig = benchConfig(ALS_SIM_SCENES[1], range, true, DURATION_MS, 1000);
+    offConfig.noisePermille = 0;
+    onConfig.noisePermille = 0;
+    AlsSimResult off = runSeeds(offConfig, display, SEEDS);
+    AlsSimResult on = runSeeds(onConfig, display, SEEDS);
+    CHECK_EQ(off.settled, off.transitions);
+    CHECK_EQ(on.settled, on.transitions);
+    CHECK(off.latencyMaxMs <= offConfig.uvPeriodMs + offConfig.uvIntegrationMs);
+    if (!alsAssistInRange(range == 1)) {
+      CHECK_EQ(on.provisionals, 0);   // Off in this range: the same run
+      CHECK_EQ(on.latencyMaxMs, off.latencyMaxMs);
+      CHECK_EQ(on.latencyAvgMs, off.latencyAvgMs);
+    } else {
+      CHECK(on.latencyMaxMs <= 2 * (onConfig.uvIntegrationMs + onConfig.alsSlotMs));
+      CHECK(on.latencyAvgMs < off.latencyAvgMs);
+      CHECK_EQ(on.provisionals, on.transitions);
+      CHECK_EQ(on.provisionalExact + SEEDS, on.provisionals);   // One miss per seed
+    }
+    CHECK_EQ(on.falseSteps, 0);
+    printf("  edge %s, no noise or filters: worst %lu ms without, %lu ms with the assist\n",
+           ALS_SIM_RANGE_NAMES[range], (unsigned long)off.latencyMaxMs, (unsigned long)on.latencyMaxMs);
+  }
+  return hostTestResult("als_assist_bench");
+}
+
+int main(int argc, char** argv) {
+  int game = 1;
+  uint32_t minutes = 60;
+  uint32_t seeds = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--check") == 0) {
+      return runCheck();
+    } else if (strcmp(argv[i], "--game") == 0 && i + 1 < argc) {
+      game = atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+      minutes = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seeds") == 0 && i + 1 < argc) {
+      seeds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--game N] [--minutes M] [--seeds K] | --check\n", argv[0]);
+      return 2;
+    }
+  }
+  if (game < 1 || game > NUM_GAMES || minutes == 0 || seeds == 0) {
+    fprintf(stderr, "%s: --game must be 1-%d, --minutes and --seeds at least 1\n", argv[0], NUM_GAMES);
+    return 2;
+  }
+  printTable(game - 1, minutes, seeds);
+  return 0;
+}
@@ -0,0 +1,273 @@
+// filter_bench.cpp - UV filter presets scored on a PC (UvFilterBench.h)
+//
+//   filter_bench [--block-bytes N] capture.txt | NNNNN.ulg ...
+//   filter_bench [--check]
+//
+// With log input (a Serial Monitor capture holding a raw 'L' dump, or log
+// files copied off the LittleFS partition) it prints the same table as the
+// device's 'b' command, with the calibration and filter settings of the
+// config.h this tool was built with. Without input it scores the presets on
+// synthetic traces instead: walking between sun and shade, cloud edges,
+// single-sample reflections, slow drifts across a threshold and bright sun
+// in the fast range, for every game. --check (run by ctest) also checks the
+// scoring on noise-free steps, where the lag and flip counts are known, and
+// fails if the pipeline as set in config.h shows more flips than no filter
+// on the noisy scenes or lags more than the legacy smoothing in the slow
+// range.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "FirmwareConfig.h"
+#include "HostTest.h"
+#include "SessionLogFormat.h"
+#include "UvFilterBench.h"
+
+static UvFilterBench bench;
+static uint32_t badBlocks = 0;
+
+static uint32_t rngState = 0x5EED0017;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// Uniform in [-1, 1)
+static float rngSigned() {
+  return (float)(rngNext() % 2000001) / 1000000.0f - 1.0f;
+}
+
+static void benchBlock(const uint8_t* block, size_t blockBytes) {
+  SessionLogBlockReader reader;
+  SessionLogBlockHeader header;
+  if (!reader.begin(block, blockBytes, &header)) {
+    badBlocks++;
+    return;
+  }
+  SessionLogSample sample;
+  while (reader.next(&sample)) {
+    bench.add(header, sample);
+  }
+}
+
+// Same inputs as session_log_decode
+static bool benchFile(const char* path, size_t blockBytes) {
+  FILE* in = fopen(path, "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "filter_bench: cannot open %s\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(in);
+
+  if (data.size() >= 4 && sessionLogGet32(data.data()) == SESSION_LOG_MAGIC) {
+    for (size_t offset = 0; offset + blockBytes <= data.size(); offset += blockBytes) {
+      benchBlock(data.data() + offset, blockBytes);
+    }
+    return true;
+  }
+
+  static SessionLogRawParser parser;
+  parser = SessionLogRawParser();
+  data.push_back('\0');
+  char* text = (char*)data.data();
+  while (*text != '\0' && !parser.done() && !parser.failed()) {
+    char* end = text + strcspn(text, "\r\n");
+    char saved = *end;
+    *end = '\0';
+    parser.line(text, benchBlock);
+    text = (saved == '\0') ? end : end + 1;
+  }
+  if (!parser.done()) {
+    fprintf(stderr, "filter_bench: %s: no complete raw log dump (\"%s\" ... \"%s\")\n", path,
+            SESSION_LOG_RAW_BEGIN, SESSION_LOG_RAW_END);
+    return false;
+  }
+  return true;
+}
+
+static void printTable(const char* title) {
+  char line[128];
+  if (title != nullptr) {
+    printf("## %s\n", title);
+  }
+  uvFilterBenchFormatSummary(line, sizeof(line), bench);
+  puts(line);
+  puts(UV_FILTER_BENCH_TABLE_HEADER);
+  for (int p = 0; p < UV_FILTER_BENCH_PRESETS; p++) {
+    uvFilterBenchFormatRow(line, sizeof(line), bench, p);
+    puts(line);
+  }
+}
+
+// Synthetic traces. The scene gives the open-air UVI the thresholds compare
+// against; the logged raw count is what the sensor behind the enclosure
+// would read for it.
+enum SceneKind { SCENE_STEPS, SCENE_WALK, SCENE_CLOUD, SCENE_REFLECTIONS, SCENE_DRIFT, SCENE_BRIGHT, SCENE_COUNT };
+static const char* const SCENE_NAMES[SCENE_COUNT] = { "noise-free steps", "sun/shade walk", "cloud edges",
+                                                      "reflections", "threshold drift", "bright sun (fast range)" };
+static const uint32_t SCENE_MINUTES = 60;
+
+static uint32_t rawForUvi(const SessionLogReplayConfig& config, float uvi, int rangeMode) {
+  const BarThresholdConfig& bars = config.bars;
+  float measured = uvi;
+  if (bars.openAirThresholds && bars.enclosureComp && bars.transmittance > 0.0f) {
+    measured = uvi * bars.transmittance + bars.offsetUvi;
+  }
+  float raw = measured * config.rangeDivisor[rangeMode];
+  uint32_t maxRaw = (rangeMode == 0) ? 0xFFFFF : 0x3FFFF;   // 20-bit / 18-bit
+  return (raw <= 0.0f) ? 0 : (raw >= (float)maxRaw ? maxRaw : (uint32_t)lroundf(raw));
+}
+
+static void runScene(const SessionLogReplayConfig& config, SceneKind kind, uint16_t session, int game) {
+  static const float LEVELS[] = { 0.2f, 1.2f, 2.4f, 3.6f, 5.0f, 7.5f, 9.0f, 11.0f, 13.5f };
+  const int numLevels = (int)(sizeof(LEVELS) / sizeof(LEVELS[0]));
+  const int rangeMode = (kind == SCENE_BRIGHT) ? 1 : 0;
+  const uint32_t periodMs = (rangeMode == 0) ? 500 : 100;
+  const float noise = (kind == SCENE_STEPS) ? 0.0f : 0.03f;
+
+  SessionLogBlockHeader header = { session, 0, 0 };
+  SessionLogSample sample = {};
+  sample.game = (uint8_t)game;
+  sample.rangeMode = (uint8_t)rangeMode;
+  float level = (kind == SCENE_BRIGHT) ? 9.0f : LEVELS[rngNext() % numLevels];
+  float drift = 0.0f;
+  uint32_t holdUntilMs = 0;
+  uint32_t timeMs = 1000;
+  for (uint32_t t = 0;; t += periodMs) {
+    if (t >= holdUntilMs) {
+      if (t >= SCENE_MINUTES * 60000) {
+        break;   // End on a level boundary so the reference sees the last step
+      }
+      switch (kind) {
+        case SCENE_STEPS:
+          level = LEVELS[rngNext() % numLevels];
+          holdUntilMs = t + 5000 + (rngNext() % 20) * 1000;
+          break;
+        case SCENE_WALK:
+        case SCENE_REFLECTIONS:
+          level = LEVELS[rngNext() % numLevels];
+          holdUntilMs = t + 3000 + (rngNext() % 27) * 1000;
+          break;
+        case SCENE_CLOUD:
+          // Sun and a cloud shadow at ~40%, edges every 1-6 s
+          level = (level > 6.0f) ? 4.4f : 11.0f;
+          holdUntilMs = t + 1000 + (rngNext() % 11) * 500;
+          break;
+        case SCENE_DRIFT:
+          level = 0.5f + (rngNext() % 130) / 10.0f;
+          drift = rngSigned() * 0.02f;   // UVI per sample
+          holdUntilMs = t + 20000 + (rngNext() % 40) * 1000;
+          break;
+        case SCENE_BRIGHT:
+          level = 8.0f + (rngNext() % 60) / 10.0f;
+          holdUntilMs = t + 2000 + (rngNext() % 10) * 1000;
+          break;
+        default:
+          break;
+      }
+    }
+    level += drift;
+    if (level < 0.0f) level = 0.0f;
+    float uvi = level * (1.0f + noise * rngSigned());
+    if (kind == SCENE_REFLECTIONS && rngNext() % 20 == 0) {
+      uvi *= (rngNext() & 1) ? 1.8f : 0.4f;   // One-sample glint or shadow
+    }
+    timeMs += periodMs + ((noise > 0.0f) ? rngNext() % 5 : 0);   // Loop jitter
+    sample.timeMs = timeMs;
+    sample.rawUVS = rawForUvi(config, uvi, rangeMode);
+    bench.add(header, sample);
+  }
+}
+
+// One scene for every game, scored from scratch
+static void benchScene(const SessionLogReplayConfig& config, SceneKind kind) {
+  bench.begin(config, BAR_HYSTERESIS);
+  for (int game = 0; game < NUM_GAMES; game++) {
+    runScene(config, kind, (uint16_t)(kind * NUM_GAMES + game), game);
+  }
+  bench.finish();
+}
+
+int main(int argc, char** argv) {
+  size_t blockBytes = 4096;
+  bool check = false;
+  std::vector<const char*> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--block-bytes") == 0 && i + 1 < argc) {
+      blockBytes = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--check") == 0) {
+      check = true;
+    } else if (argv[i][0] == '-') {
+      fprintf(stderr, "usage: %s [--block-bytes N] capture.txt | NNNNN.ulg ...\n       %s [--check]\n", argv[0],
+              argv[0]);
+      return 2;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (blockBytes < SESSION_LOG_HEADER_BYTES || (check && !paths.empty())) {
+    fprintf(stderr, "usage: %s [--block-bytes N] capture.txt | NNNNN.ulg ...\n       %s [--check]\n", argv[0],
+            argv[0]);
+    return 2;
+  }
+
+  const SessionLogReplayConfig config = getSessionLogReplayConfig();
+  if (!paths.empty()) {
+    bench.begin(config, BAR_HYSTERESIS);
+    bool ok = true;
+    for (const char* path : paths) {
+      ok = benchFile(path, blockBytes) && ok;
+    }
+    bench.finish();
+    printTable(nullptr);
+    printf("# %u unreadable blocks\n", badBlocks);
+    return ok ? 0 : 1;
+  }
+
+  printf("filter_bench: %u min per scene and game, config.h presets\n", SCENE_MINUTES);
+  for (int kind = 0; kind < SCENE_COUNT; kind++) {
+    benchScene(config, (SceneKind)kind);
+    printTable(SCENE_NAMES[kind]);
+    if (!check) {
+      continue;
+    }
+    const UvFilterBenchScore& none = bench.score(0);
+    const UvFilterBenchScore& legacy = bench.score(UV_FILTER_BENCH_LEGACY);
+    const UvFilterBenchScore& median = bench.score(2);
+    const UvFilterBenchScore& configured = bench.score(UV_FILTER_BENCH_PRESETS - 1);
+    if (kind == SCENE_STEPS) {
+      // Steps held >= 5 s: the unfiltered bars are the reference, and a
+      // 3-sample median shows every step exactly one sample late
+      CHECK(bench.referenceChangeCount() > 0);
+      CHECK_EQ(none.flips, bench.referenceChangeCount());
+      CHECK_EQ(none.lagMaxMs, 0);
+      CHECK_EQ(none.unsettled, 0);
+      CHECK_EQ(median.flips, bench.referenceChangeCount());
+      CHECK_EQ(median.lagCount, bench.referenceChangeCount());
+      CHECK_EQ(median.lagSumMs, 500ULL * median.lagCount);
+      CHECK_EQ(median.lagMaxMs, 500);
+    } else {
+      // Clean steps can show one extra flip where the smoothed value passes
+      // a bar on its way; noise and glints must be filtered out
+      if (kind == SCENE_REFLECTIONS || kind == SCENE_DRIFT || kind == SCENE_BRIGHT) {
+        CHECK(configured.flips < none.flips);
+      }
+      // The legacy EMA works per sample, so at 100 ms samples it is five
+      // times faster than in the slow range it was tuned for
+      if (kind != SCENE_BRIGHT) {
+        CHECK(configured.lagAvgMs() <= legacy.lagAvgMs());
+      }
+    }
+  }
+  return check ? hostTestResult("filter_bench") : 0;
+}
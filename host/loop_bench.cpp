@@ -0,0 +1,702 @@
+// loop_bench.cpp - loop() on a virtual clock
+//
+// Runs the firmware's loop() stage order (buttons, BLE, battery, sensor,
+// GBA link, UI state, display, HID) against mocked peripherals: an LTR390
+// that integrates a sun/shade scene, I2C transfers timed at I2C_CLOCK_HZ,
+// a display whose flush costs its dirty bytes, HID report and GPIO sinks,
+// and a button that bounces. The firmware headers do the real work with
+// the values in config.h: ButtonDebounce.h, UvBarPipeline.h (sample to
+// bars), UvAutoRange.h (range switching), MeterPlanner.h (Incremental HID
+// presses, against an emulator meter that moves on every press),
+// GbaLinkCodec.h, DeadlineScheduler.h and LoopProfiler.h. Only the glue
+// that lives in the .ino next to NimBLE, TinyUSB, the LTR390 registers and
+// the GPIO registers is modelled here.
+//
+// Time only moves when something says so: each I/O advances the clock by
+// its modelled bus time, and each stage is charged its measured host CPU
+// time times --cpu-scale (0 = I/O only, fully repeatable). Between passes
+// loop() blocks until the next DeadlineScheduler deadline, as with
+// POWER_SCHEDULER_ENABLED; a button edge ends the wait early.
+//
+// Reported: per-stage average/worst cost (LoopProfiler.h) and the worst
+// latency from each event to the output it drives.
+//
+// Usage: loop_bench [--seconds N] [--cpu-scale X] [--seed N] [--check]
+//
+// --check runs at cpu scale 0 and fails if a latency exceeds what the
+// config.h timing of its subsystem allows (ctest runs this).
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include <Arduino.h>
+#include "config.h"
+#include "LoopProfiler.h"
+#include "DeadlineScheduler.h"
+#include "ButtonDebounce.h"
+#include "GbaLinkCodec.h"
+#include "MeterPlanner.h"
+#include "FirmwareConfig.h"
+
+// ---- Options ----
+
+static uint32_t benchSeconds = 600;
+static double cpuScale = 10.0;   // Rough ESP32-S3 @ 240 MHz vs. a desktop core
+static uint32_t benchSeed = 1;
+static bool checkMode = false;
+
+// ---- Latency bookkeeping ----
+
+struct LatencyStat {
+  const char* name;
+  uint32_t count;
+  uint64_t sumUs;
+  uint64_t maxUs;
+
+  void add(uint64_t us) {
+    count++;
+    sumUs += us;
+    if (us > maxUs) maxUs = us;
+  }
+};
+
+enum LatencyKind {
+  LAT_SAMPLE_TO_BARS,
+  LAT_BARS_TO_HID_PRESS,
+  LAT_BARS_TO_HID_SYNCED,
+  LAT_BARS_TO_GBA,
+  LAT_BARS_TO_DISPLAY,
+  LAT_EDGE_TO_BUTTON,
+  LAT_COUNT
+};
+
+static LatencyStat latency[LAT_COUNT] = {
+  { "uv ready -> bars", 0, 0, 0 },
+  { "bars -> hid press", 0, 0, 0 },
+  { "bars -> hid synced", 0, 0, 0 },
+  { "bars -> gba commit", 0, 0, 0 },
+  { "bars -> display", 0, 0, 0 },
+  { "edge -> button event", 0, 0, 0 },
+};
+
+// ---- Mocks ----
+
+static uint32_t rngState = 1;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+// Open-air UVI: a level held for a few seconds, then a jump (cloud edge,
+// walking into shade) or a small drift
+struct SunScene {
+  static const uint32_t SEGMENT_US = 3700000;
+  float levels[4096];
+
+  void init() {
+    static const float STEPS[] = { 0.2f, 1.2f, 2.4f, 3.6f, 5.0f, 7.5f, 9.0f, 11.0f, 13.5f };
+    const int numSteps = (int)(sizeof(STEPS) / sizeof(STEPS[0]));
+    float level = STEPS[0];
+    for (int i = 0; i < 4096; i++) {
+      if ((rngNext() % 3) == 0) {
+        level = level * (0.95f + (rngNext() % 100) / 1000.0f);   // Drift
+      } else {
+        level = STEPS[rngNext() % numSteps];
+      }
+      levels[i] = level;
+    }
+  }
+
+  float uviAt(uint64_t us) const { return levels[(us / SEGMENT_US) % 4096]; }
+};
+
+static SunScene scene;
+
+// I2C transaction on the shared bus: address + register write, repeated
+// start, address + `bytes` reads, 9 bit times each, plus driver overhead
+static const uint32_t I2C_DRIVER_OVERHEAD_US = 25;
+static uint64_t i2cBusyUs = 0;
+
+static void i2cTransfer(uint32_t bytes) {
+  uint64_t us = I2C_DRIVER_OVERHEAD_US + ((uint64_t)(bytes + 3) * 9ULL * 1000000ULL) / I2C_CLOCK_HZ;
+  hostClockUs += us;
+  i2cBusyUs += us;
+}
+
+// LTR390 in UVS mode: free-running conversions of integrationMs every
+// periodMs; data is ready at the end of each integration and holds the
+// scene averaged over it
+struct MockLtr390 {
+  static const uint32_t BURST_LEN = 12;   // MAIN_STATUS (0x07) through UVS_DATA (0x12)
+
+  uint32_t periodMs = 500;
+  uint32_t integrationMs = 400;
+  float divisor = UV_SENSITIVITY_COUNTS_PER_UVI;
+  uint64_t conversionStartUs = 0;
+  bool ready = false;
+  uint32_t raw = 0;
+  uint64_t readyAtUs = 0;
+
+  // configureUvSensorRange() for a UV_RANGE_MODES entry
+  void setRange(int mode) {
+    const UvRangeMode& m = UV_RANGE_MODES[mode];
+    integrationMs = (uint32_t)resolutionToIntegrationMs(m.resolution);
+    periodMs = (uint32_t)measRateToMs(m.measRate);
+    periodMs = (integrationMs > periodMs) ? integrationMs : periodMs;
+    divisor = getUvDivisorForRange(mode);
+    i2cTransfer(1);   // Gain
+    i2cTransfer(1);   // Resolution / rate
+    conversionStartUs = hostClockUs;
+    ready = false;
+  }
+
+  void advance() {
+    uint64_t periodUs = (uint64_t)periodMs * 1000ULL;
+    while (hostClockUs >= conversionStartUs + integrationMs * 1000ULL) {
+      float sum = 0.0f;
+      int n = 0;
+      for (uint64_t t = conversionStartUs; t < conversionStartUs + integrationMs * 1000ULL; t += 5000) {
+        sum += scene.uviAt(t);
+        n++;
+      }
+      float counts = (sum / n) * UV_ENCLOSURE_TRANSMITTANCE * divisor;
+      raw = (counts >= (float)BAR_RAW_MAX) ? BAR_RAW_MAX : (uint32_t)lroundf(counts);
+      readyAtUs = conversionStartUs + integrationMs * 1000ULL;
+      ready = true;
+      conversionStartUs += periodUs;
+    }
+  }
+
+  // One status + data burst; true with new counts if a conversion finished
+  bool readBurst(uint32_t* rawUVS, uint64_t* readyUs) {
+    i2cTransfer(BURST_LEN);
+    advance();
+    if (!ready) return false;
+    ready = false;
+    *rawUVS = raw;
+    *readyUs = readyAtUs;
+    return true;
+  }
+};
+
+// Button on a GPIO edge interrupt: a scripted press every few seconds with
+// contact bounce on both edges, and a double tap now and then
+struct MockButtonPin {
+  static const int MAX_EDGES = 64;
+  uint64_t edgeUs[MAX_EDGES];
+  bool edgeLevel[MAX_EDGES];
+  int count = 0;
+  int next = 0;
+  uint64_t nextPressUs = 2500000;
+
+  void addBouncy(uint64_t atUs, bool pressed) {
+    int bounces = (int)(rngNext() % 4);
+    for (int i = 0; i < bounces && count < MAX_EDGES - 2; i++) {
+      edgeUs[count] = atUs + i * 400;
+      edgeLevel[count++] = pressed;
+      edgeUs[count] = atUs + i * 400 + 150;
+      edgeLevel[count++] = !pressed;
+    }
+    edgeUs[count] = atUs + bounces * 400;
+    edgeLevel[count++] = pressed;
+  }
+
+  // Refill the script once the previous presses have been consumed
+  void plan() {
+    if (next < count) return;
+    count = 0;
+    next = 0;
+    uint64_t t = nextPressUs;
+    int presses = ((rngNext() % 4) == 0) ? 2 : 1;
+    for (int i = 0; i < presses; i++) {
+      uint32_t holdUs = 80000 + rngNext() % 120000;
+      addBouncy(t, true);
+      addBouncy(t + holdUs, false);
+      t += holdUs + 90000;
+    }
+    nextPressUs = t + 4000000 + (rngNext() % 3000000);
+  }
+
+  bool pending() const { return next < count; }
+  uint64_t nextEdgeUs() const { return edgeUs[next]; }
+};
+
+// ---- Firmware state (what the .ino keeps in globals) ----
+
+static LoopProfiler loopProfiler;
+static DeadlineScheduler loopScheduler;
+static ButtonDebouncer gameButton;
+static MockButtonPin gameButtonPin;
+static MockLtr390 ltr;
+
+static BarThresholdConfig barConfig;
+static UvBarPipeline uvBars;
+static UvAutoRange uvAutoRange;
+
+static int currentGame = 0;
+static bool gameChanged = false;
+static int cachedFilledBars = 0;
+static bool ltrDiscardNextSample = false;
+static bool ltrHasSample = false;
+static uint32_t ltrLastSampleMs = 0;
+
+static uint64_t barChangeUs = 0;         // Latest bar change, for the output latencies
+static bool uiRedrawPending = false;
+
+// HID_CONTROL_MODE 0: INC/DEC presses planned by MeterPlanner; the
+// emulator meter takes one step per press
+static MeterPlanner bleMeter;
+static int emulatorSteps = 0;
+static uint32_t hidReports = 0;
+static bool hidPressPending = false;
+static uint64_t hidPressSinceUs = 0;
+static bool hidSyncPending = false;
+static uint64_t hidSyncSinceUs = 0;
+
+// GBA link with GBA_LINK_HW_TIMER_ENABLED: the timer drives one half of
+// the code per phase; the GBA reads the port once per frame
+static uint8_t gbaPublished = 0;
+static uint8_t gbaDriven = 0;
+static uint64_t gbaNextPhaseUs = 0;
+static bool gbaPhaseHigh = false;
+static uint64_t gbaNextReadUs = 7000;
+static GbaLinkDecoder gbaDecoder;
+static uint8_t gbaCommitted = GBA_LINK_NO_LINK;
+static bool gbaPending = false;
+static uint8_t gbaTarget = 0;
+static uint64_t gbaSinceUs = 0;
+static uint32_t gpioWrites = 0;
+
+// Display: the bar gauge band is the widget that changes with the bars
+#if defined(BOARD_LILYGO_T_QT_PRO)
+static const uint32_t DISPLAY_DIRTY_BYTES = 128 * 24 * 2;   // RGB565 band
+static const uint32_t DISPLAY_BUS_HZ = 40000000;            // Arduino_ESP32SPI default
+static const uint32_t DISPLAY_BITS_PER_BYTE = 8;
+#else
+static const uint32_t DISPLAY_DIRTY_BYTES = 128 * 2;        // Two SSD1306 pages
+static const uint32_t DISPLAY_BUS_HZ = I2C_CLOCK_HZ;
+static const uint32_t DISPLAY_BITS_PER_BYTE = 9;
+#endif
+
+static uint64_t displayFlushUs() {
+  return ((uint64_t)DISPLAY_DIRTY_BYTES * DISPLAY_BITS_PER_BYTE * 1000000ULL) / DISPLAY_BUS_HZ;
+}
+
+// ---- Stage bodies ----
+
+static void sendHidReport() {
+  hidReports++;   // BLE notify and USB report are queued; the stacks send them
+}
+
+static void onBarsChanged() {
+  barChangeUs = hostClockUs;
+  uiRedrawPending = true;
+  if (!hidPressPending) {
+    hidPressPending = true;
+    hidPressSinceUs = hostClockUs;
+  }
+  if (!hidSyncPending) {
+    hidSyncPending = true;
+    hidSyncSinceUs = hostClockUs;
+  }
+  gbaPending = true;
+  gbaTarget = (uint8_t)cachedFilledBars;
+  gbaSinceUs = hostClockUs;
+}
+
+static int getCurrentSampleBars(uint32_t rawUVS, float uvi, bool applyHysteresis) {
+  return uvBars.bars(rawUVS, uvi, currentGame, applyHysteresis ? cachedFilledBars : -1);
+}
+
+// getBleStepModel()
+static MeterStepModel getBleStepModel(int game) {
+  return meterStepModelForGame(barGameIndex(game), HID_BOKTAI1_MGBA_10_STEP_WORKAROUND);
+}
+
+// resetBlePressState() + startBleResync(): release, then clamp for the new meter
+static void startBleResync(int bars) {
+  if (bleMeter.pressHolding()) {
+    sendHidReport();
+  }
+  bleMeter.cancelPress();
+  bleMeter.startClamp(getBleStepModel(currentGame), bars, (uint32_t)millis());
+}
+
+static uint32_t lastRawUVS = 0;
+static float lastUviForBars = 0.0f;
+
+static void setBars(int bars) {
+  if (bars != cachedFilledBars) {
+    cachedFilledBars = bars;
+    onBarsChanged();
+  }
+}
+
+static void handleGameButton() {
+  while (gameButtonPin.pending() && gameButtonPin.nextEdgeUs() <= hostClockUs) {
+    gameButton.edge(gameButtonPin.edgeLevel[gameButtonPin.next],
+                    (uint32_t)(gameButtonPin.edgeUs[gameButtonPin.next] / 1000ULL));
+    gameButtonPin.next++;
+  }
+  gameButton.poll((uint32_t)millis());
+  ButtonEvent event;
+  while (gameButton.nextEvent(&event)) {
+    if (event.type == BUTTON_EVENT_PRESS || event.type == BUTTON_EVENT_TAP) {
+      latency[LAT_EDGE_TO_BUTTON].add((uint64_t)(uint32_t)(millis() - event.timeMs) * 1000ULL);
+    }
+    if (event.type == BUTTON_EVENT_TAP) {
+      currentGame = (currentGame + 1) % NUM_GAMES;
+      gameChanged = true;
+      setBars(getCurrentSampleBars(lastRawUVS, lastUviForBars, false));
+      // The emulator's meter for the new game, from wherever the old one was
+      emulatorSteps = meterClamp(emulatorSteps, 0, getBleStepModel(currentGame).stepsMax);
+      startBleResync(cachedFilledBars);
+    }
+  }
+}
+
+// applyUvRangeMode()
+static void applyUvRangeMode(int mode) {
+  ltr.setRange(mode);
+  uvBars.setDivisor(ltr.divisor);
+  uvAutoRange.setMode(mode, (uint32_t)millis());
+}
+
+static void updateUvAutoRange(float measuredUvi) {
+  if (!uvAutoRange.update(measuredUvi, (uint32_t)millis())) {
+    return;
+  }
+  applyUvRangeMode(uvAutoRange.mode());
+  ltrDiscardNextSample = true;
+}
+
+static uint32_t getLtr390PollStartMs() {
+  return (uint32_t)((ltr.periodMs * LTR390_POLL_START_PCT) / 100UL);
+}
+
+static bool pollSensor() {
+  uint32_t now = (uint32_t)millis();
+  if (ltrHasSample && (uint32_t)(now - ltrLastSampleMs) < getLtr390PollStartMs()) {
+    return false;
+  }
+  uint32_t rawUVS;
+  uint64_t readyUs;
+  if (!ltr.readBurst(&rawUVS, &readyUs)) {
+    return false;
+  }
+  ltrLastSampleMs = now;
+  ltrHasSample = true;
+  if (ltrDiscardNextSample) {
+    ltrDiscardNextSample = false;
+    return false;
+  }
+
+  // handleUvSample()
+  float measuredUvi = barMeasuredUvi(rawUVS, ltr.divisor);
+  float uviForBars = uvBars.smooth(barCompareUvi(barConfig, rawUVS, ltr.divisor), now);
+  lastRawUVS = rawUVS;
+  lastUviForBars = uviForBars;
+  setBars(getCurrentSampleBars(rawUVS, uviForBars, !gameChanged));
+  gameChanged = false;
+  latency[LAT_SAMPLE_TO_BARS].add(hostClockUs - readyUs);
+  bleMeter.updateResync(getBleStepModel(currentGame), cachedFilledBars, now);   // updateBluetoothMeter()
+  updateUvAutoRange(measuredUvi);
+  return true;
+}
+
+// Timer phases and GBA frame reads up to now, with the value published so far
+static void advanceGbaLink() {
+  uint64_t phaseUs = GBA_LINK_FRAME_TOGGLE_MS * 1000ULL;
+  while (true) {
+    bool phaseFirst = gbaNextPhaseUs <= gbaNextReadUs;
+    uint64_t t = phaseFirst ? gbaNextPhaseUs : gbaNextReadUs;
+    if (t > hostClockUs) {
+      break;
+    }
+    if (phaseFirst) {
+      gbaPhaseHigh = !gbaPhaseHigh;
+      gbaDriven = gbaLinkEncode(gbaPublished, GBA_LINK_PROTOCOL_V2);
+      gbaNextPhaseUs += phaseUs;
+      continue;
+    }
+    uint8_t index;
+    if (gbaDecoder.read(gbaLinkPortBits(gbaDriven, gbaPhaseHigh), &index)) {
+      gbaCommitted = index;
+      if (gbaPending && t >= gbaSinceUs && index == gbaTarget) {
+        latency[LAT_BARS_TO_GBA].add(t - gbaSinceUs);
+        gbaPending = false;
+      }
+    }
+    gbaNextReadUs += GBA_LINK_GBA_FRAME_US;
+  }
+}
+
+static void updateGbaLinkOutput(int bars) {
+  if (!GBA_LINK_ENABLED) {
+    return;
+  }
+  uint8_t value = gbaLinkValueForBars(bars);
+  if (value != gbaPublished) {
+    gbaPublished = value;
+    gpioWrites++;   // gbaLinkTimer.publish(): one store the ISR picks up
+  }
+}
+
+// The UI task (UI_TASK_ENABLED) renders on the other core as soon as it is
+// notified; otherwise runUiFrame() pays for the flush inside loop()
+static void runDisplay() {
+  if (!uiRedrawPending) {
+    return;
+  }
+  uiRedrawPending = false;
+  if (!UI_TASK_ENABLED) {
+    hostClockUs += displayFlushUs();
+    latency[LAT_BARS_TO_DISPLAY].add(hostClockUs - barChangeUs);
+  } else {
+    latency[LAT_BARS_TO_DISPLAY].add(hostClockUs + displayFlushUs() - barChangeUs);
+  }
+}
+
+static void handleBlePresses() {
+  if (HID_CONTROL_MODE != 0) {
+    return;
+  }
+  uint32_t now = (uint32_t)millis();
+  MeterStepModel model = getBleStepModel(currentGame);
+  int direction = 0;
+  MeterPressAction action = bleMeter.poll(model, cachedFilledBars, now, &direction);
+  if (action == METER_PRESS_DOWN) {
+    sendHidReport();
+    emulatorSteps = meterClamp(emulatorSteps + direction, 0, model.stepsMax);
+    if (hidPressPending) {
+      latency[LAT_BARS_TO_HID_PRESS].add(hostClockUs - hidPressSinceUs);
+      hidPressPending = false;
+    }
+  } else if (action == METER_PRESS_UP) {
+    sendHidReport();
+    if (hidSyncPending && !bleMeter.hasWork(model, cachedFilledBars) &&
+        model.barFromStep(emulatorSteps) == cachedFilledBars) {
+      latency[LAT_BARS_TO_HID_SYNCED].add(hostClockUs - hidSyncSinceUs);
+      hidSyncPending = false;
+    }
+  }
+  if (!bleMeter.pressHolding() && !bleMeter.hasWork(model, cachedFilledBars)) {
+    hidPressPending = false;   // Back where the meter already was
+    hidSyncPending = false;
+  }
+}
+
+static void planLoopDeadlines(uint32_t now) {
+  uint32_t dueMs;
+  if (gameButton.nextDeadline(&dueMs)) {
+    loopScheduler.at(WAKE_BUTTONS, dueMs);
+  }
+  if (ltrHasSample) {
+    loopScheduler.at(WAKE_SENSOR, ltrLastSampleMs + getLtr390PollStartMs());
+  } else {
+    loopScheduler.after(WAKE_SENSOR, now, 1);
+  }
+  unsigned long hidWakeMs = 0;
+  if (HID_CONTROL_MODE == 0 && bleMeter.wakeAt(getBleStepModel(currentGame), cachedFilledBars, &hidWakeMs)) {
+    loopScheduler.at(WAKE_HID, (uint32_t)hidWakeMs);
+  }
+  loopScheduler.at(WAKE_STATS, loopProfiler.windowDueMs());
+}
+
+// ---- loop() ----
+
+template <typename F>
+static void chargeCpu(F&& body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - start).count();
+  hostClockUs += (uint64_t)(ns * cpuScale / 1000.0);
+}
+
+struct StageTotals {
+  uint64_t totalUs[PROFILE_STAGE_COUNT];
+  uint32_t maxUs[PROFILE_STAGE_COUNT];
+  uint64_t loopTotalUs;
+  uint32_t loopMaxUs;
+  uint64_t loops;
+};
+
+static StageTotals totals;
+static uint64_t blockedUs = 0;
+static uint32_t wakes = 0;
+static uint32_t wakesBy[WAKE_TIMEOUT + 1];
+
+static void loopOnce() {
+  unsigned long loopStartUs = micros();
+  unsigned long stageUs = loopStartUs;
+
+  chargeCpu([] { handleGameButton(); });
+  stageUs = loopProfiler.mark(PROFILE_BUTTONS, stageUs);
+  stageUs = loopProfiler.mark(PROFILE_BLE_STATE, stageUs);   // NimBLE callbacks set flags only
+  stageUs = loopProfiler.mark(PROFILE_BATTERY, stageUs);     // Battery task publishes readings
+  chargeCpu([] { pollSensor(); });
+  stageUs = loopProfiler.mark(PROFILE_SENSOR, stageUs);
+  chargeCpu([] {
+    advanceGbaLink();
+    updateGbaLinkOutput(cachedFilledBars);
+  });
+  stageUs = loopProfiler.mark(PROFILE_GBA_LINK, stageUs);
+  stageUs = loopProfiler.mark(PROFILE_UI_STATE, stageUs);
+  chargeCpu([] { runDisplay(); });
+  stageUs = loopProfiler.mark(PROFILE_DISPLAY, stageUs);
+  chargeCpu([] { handleBlePresses(); });
+  loopProfiler.mark(PROFILE_HID, stageUs);
+
+  if (loopProfiler.endIteration(loopStartUs)) {
+    for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+      totals.totalUs[i] += loopProfiler.stageTotalUs((ProfileStage)i);
+      if (loopProfiler.stageMaxUs((ProfileStage)i) > totals.maxUs[i]) {
+        totals.maxUs[i] = loopProfiler.stageMaxUs((ProfileStage)i);
+      }
+    }
+    totals.loopTotalUs += loopProfiler.loopTotalUs();
+    totals.loops += loopProfiler.loopsPerWindow();
+    if (loopProfiler.loopMaxUs() > totals.loopMaxUs) {
+      totals.loopMaxUs = loopProfiler.loopMaxUs();
+    }
+  }
+
+  // sleepUntilNextDeadline(): at least one tick, ended early by an edge
+  uint32_t now = (uint32_t)millis();
+  loopScheduler.clear();
+  planLoopDeadlines(now);
+  WakeSource source;
+  uint32_t waitMs = loopScheduler.waitMs(now, POWER_MAX_SLEEP_MS, &source);
+  if (waitMs == 0) {
+    waitMs = 1;
+  }
+  uint64_t wakeUs = hostClockUs + (uint64_t)waitMs * 1000ULL;
+  gameButtonPin.plan();
+  if (gameButtonPin.pending() && gameButtonPin.nextEdgeUs() < wakeUs) {
+    wakeUs = (gameButtonPin.nextEdgeUs() > hostClockUs) ? gameButtonPin.nextEdgeUs() : hostClockUs;
+    source = WAKE_INTERRUPT;
+  }
+  blockedUs += wakeUs - hostClockUs;
+  hostClockUs = wakeUs;
+  wakes++;
+  wakesBy[source]++;
+}
+
+static void setup() {
+  rngState = benchSeed ? benchSeed : 1;
+  scene.init();
+  barConfig = getBarThresholdConfig();
+  uvBars.configure(getUvBarPipelineConfig());
+  uvAutoRange.configure(getUvAutoRangeConfig());
+  applyUvRangeMode(UV_RANGE_SLOW);
+  gameButton.configure(DEBOUNCE_MS, LONG_PRESS_MS, BUTTON_DOUBLE_TAP_MS);
+  gameButton.reset(false, (uint32_t)millis(), false);
+  gbaDecoder.reset(GBA_LINK_PROTOCOL_V2);
+  // initHidPressTiming(), then a connection with the meter anywhere
+  bleMeter.setPressRate(HID_BUTTONS_PER_SECOND);
+  bleMeter.setResyncTiming(BLE_RESYNC_ENABLED ? BLE_RESYNC_INTERVAL_MS : 0, BLE_RESYNC_MAX_DEFER_MS);
+  startBleResync(cachedFilledBars);
+  loopProfiler.begin(DEBUG_STATS_WINDOW_MS);
+}
+
+// ---- Report ----
+
+static void printReport() {
+  double seconds = hostClockUs / 1e6;
+  printf("loop_bench: %.0f s virtual, cpu scale %.1f, %llu loops, %u wakes, %.1f%% blocked\n", seconds,
+         cpuScale, (unsigned long long)totals.loops, wakes, 100.0 * blockedUs / hostClockUs);
+  printf("  %u range switches, %u HID reports, %u GBA values, I2C busy %.2f%%\n", uvAutoRange.switchCount(), hidReports,
+         gpioWrites, 100.0 * i2cBusyUs / hostClockUs);
+  printf("\n  stage   avg_us  max_us\n");
+  for (int i = 0; i < PROFILE_STAGE_COUNT; i++) {
+    printf("  %-6s %7.1f %7u\n", PROFILE_STAGE_NAMES[i],
+           totals.loops ? (double)totals.totalUs[i] / totals.loops : 0.0, totals.maxUs[i]);
+  }
+  printf("  %-6s %7.1f %7u\n", "loop", totals.loops ? (double)totals.loopTotalUs / totals.loops : 0.0,
+         totals.loopMaxUs);
+  printf("\n  wakes by");
+  for (int i = 0; i <= WAKE_TIMEOUT; i++) {
+    if (wakesBy[i] > 0) printf(" %s=%u", WAKE_SOURCE_NAMES[i], wakesBy[i]);
+  }
+  printf("\n\n  latency                 count   avg_ms   max_ms\n");
+  for (int i = 0; i < LAT_COUNT; i++) {
+    const LatencyStat& s = latency[i];
+    printf("  %-22s %6u %8.2f %8.2f\n", s.name, s.count, s.count ? s.sumUs / 1000.0 / s.count : 0.0,
+           s.maxUs / 1000.0);
+  }
+}
+
+// Worst cases the firmware's own timing allows, with 1 ms of scheduling slack
+static int checkBudgets() {
+  const uint64_t tickUs = 1000;
+  uint64_t burstUs = I2C_DRIVER_OVERHEAD_US + ((MockLtr390::BURST_LEN + 3) * 9ULL * 1000000ULL) / I2C_CLOCK_HZ;
+  uint64_t hidIntervalUs = bleMeter.pressInterval() * 1000ULL;
+  uint64_t phaseUs = GBA_LINK_FRAME_TOGGLE_MS * 1000ULL;
+  struct Budget {
+    LatencyKind kind;
+    uint64_t maxUs;
+  } budgets[] = {
+    // Polled every tick from the poll start, so at most a tick plus the burst read
+    { LAT_SAMPLE_TO_BARS, tickUs + burstUs + tickUs },
+    // A press waits for the previous one's interval at most
+    { LAT_BARS_TO_HID_PRESS, hidIntervalUs + tickUs },
+    // Both halves on the wire within two phases, then up to four frame
+    // reads until two in a row agree (v1) or the changed half is seen (v2)
+    { LAT_BARS_TO_GBA, 2 * phaseUs + 4 * GBA_LINK_GBA_FRAME_US + tickUs },
+    { LAT_BARS_TO_DISPLAY, displayFlushUs() + tickUs },
+    // Edges wake loop(); an edge inside a lock-out is taken when it ends
+    { LAT_EDGE_TO_BUTTON, DEBOUNCE_MS * 1000ULL + tickUs },
+  };
+  int failures = 0;
+  for (const Budget& b : budgets) {
+    const LatencyStat& s = latency[b.kind];
+    if (s.count == 0 || s.maxUs > b.maxUs) {
+      printf("FAIL: %s max %.2f ms (budget %.2f ms, %u samples)\n", s.name, s.maxUs / 1000.0, b.maxUs / 1000.0,
+             s.count);
+      failures++;
+    }
+  }
+  // Without CPU cost a pass is only its I/O: one burst read plus a range switch
+  if (totals.loopMaxUs > burstUs + 2 * I2C_DRIVER_OVERHEAD_US + 200) {
+    printf("FAIL: loop pass max %u us\n", totals.loopMaxUs);
+    failures++;
+  }
+  if (latency[LAT_BARS_TO_HID_SYNCED].count == 0) {
+    printf("FAIL: HID meter never synced\n");
+    failures++;
+  }
+  printf(failures ? "\nloop_bench: %d budget failures\n" : "\nloop_bench: all budgets met\n", failures);
+  return failures;
+}
+
+int main(int argc, char** argv) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) {
+      benchSeconds = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--cpu-scale") == 0 && i + 1 < argc) {
+      cpuScale = strtod(argv[++i], nullptr);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      benchSeed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--check") == 0) {
+      checkMode = true;
+    } else {
+      fprintf(stderr, "usage: %s [--seconds N] [--cpu-scale X] [--seed N] [--check]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (checkMode) {
+    cpuScale = 0.0;
+  }
+
+  setup();
+  uint64_t endUs = (uint64_t)benchSeconds * 1000000ULL;
+  while (hostClockUs < endUs) {
+    loopOnce();
+  }
+  printReport();
+  return (checkMode && checkBudgets() != 0) ? 1 : 0;
+}
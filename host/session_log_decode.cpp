@@ -0,0 +1,110 @@
+// session_log_decode.cpp - Session log to CSV, replayed on a PC
+//
+//   session_log_decode [--block-bytes N] capture.txt | NNNNN.ulg ...
+//
+// Each input is either a Serial Monitor capture holding a raw 'L' dump or
+// a log file copied off the LittleFS partition (blocks of --block-bytes,
+// 4096 by default). Prints the same CSV as the device's 'l' dump, with
+// replay_uvi/replay_bars from the config.h this tool was built with, so a
+// threshold or filter change can be tried on a field log before flashing.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "FirmwareConfig.h"
+#include "SessionLogFormat.h"
+#include "SessionLogReplay.h"
+
+static SessionLogReplay replay;
+static uint32_t samples = 0;
+static uint32_t badBlocks = 0;
+
+static void decodeBlock(const uint8_t* block, size_t blockBytes) {
+  SessionLogBlockReader reader;
+  SessionLogBlockHeader header;
+  if (!reader.begin(block, blockBytes, &header)) {
+    badBlocks++;
+    return;
+  }
+  char line[128];
+  SessionLogSample sample;
+  while (reader.next(&sample)) {
+    int replayBars = replay.update(header, sample);
+    sessionLogFormatCsv(line, sizeof(line), header, sample, replay.uvi(), replayBars);
+    puts(line);
+    samples++;
+  }
+}
+
+static bool decodeFile(const char* path, size_t blockBytes) {
+  FILE* in = fopen(path, "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "session_log_decode: cannot open %s\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data;
+  uint8_t chunk[4096];
+  size_t n;
+  while ((n = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    data.insert(data.end(), chunk, chunk + n);
+  }
+  fclose(in);
+
+  if (data.size() >= 4 && sessionLogGet32(data.data()) == SESSION_LOG_MAGIC) {
+    for (size_t offset = 0; offset + blockBytes <= data.size(); offset += blockBytes) {
+      decodeBlock(data.data() + offset, blockBytes);
+    }
+    if (data.size() % blockBytes != 0) {
+      fprintf(stderr, "session_log_decode: %s: %zu trailing bytes ignored\n", path, data.size() % blockBytes);
+    }
+    return true;
+  }
+
+  // Text capture: one line at a time through the raw dump parser
+  static SessionLogRawParser parser;
+  parser = SessionLogRawParser();
+  data.push_back('\0');
+  char* text = (char*)data.data();
+  while (*text != '\0' && !parser.done() && !parser.failed()) {
+    char* end = text + strcspn(text, "\r\n");
+    char saved = *end;
+    *end = '\0';
+    parser.line(text, decodeBlock);
+    text = (saved == '\0') ? end : end + 1;
+  }
+  if (!parser.done()) {
+    fprintf(stderr, "session_log_decode: %s: no complete raw log dump (\"%s\" ... \"%s\")\n", path,
+            SESSION_LOG_RAW_BEGIN, SESSION_LOG_RAW_END);
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  size_t blockBytes = 4096;
+  std::vector<const char*> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--block-bytes") == 0 && i + 1 < argc) {
+      blockBytes = strtoul(argv[++i], nullptr, 10);
+    } else if (argv[i][0] == '-') {
+      paths.clear();
+      break;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty() || blockBytes < SESSION_LOG_HEADER_BYTES) {
+    fprintf(stderr, "usage: %s [--block-bytes N] capture.txt | NNNNN.ulg ...\n", argv[0]);
+    return 2;
+  }
+
+  replay.begin(getSessionLogReplayConfig());
+  puts(SESSION_LOG_CSV_HEADER);
+  bool ok = true;
+  for (const char* path : paths) {
+    ok = decodeFile(path, blockBytes) && ok;
+  }
+  printf("# %u samples, %u unreadable blocks\n", samples, badBlocks);
+  return ok ? 0 : 1;
+}
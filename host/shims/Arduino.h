@@ -0,0 +1,21 @@
+// Arduino.h - Host stand-in for the Arduino core
+//
+// Just enough for the firmware headers that take their time from millis()
+// and micros() (LoopProfiler.h). Time is virtual: it only moves when a
+// host program advances hostClockUs, so runs are repeatable.
+#ifndef HOST_ARDUINO_SHIM_H
+#define HOST_ARDUINO_SHIM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+inline uint64_t hostClockUs = 0;
+
+inline unsigned long micros() { return (unsigned long)(uint32_t)hostClockUs; }
+inline unsigned long millis() { return (unsigned long)(uint32_t)(hostClockUs / 1000ULL); }
+inline void delayMicroseconds(unsigned int us) { hostClockUs += us; }
+inline void delay(unsigned long ms) { hostClockUs += (uint64_t)ms * 1000ULL; }
+
+#endif // HOST_ARDUINO_SHIM_H
@@ -0,0 +1,72 @@
+// telemetry_reader.cpp - Binary telemetry stream (DEBUG_SERIAL_TELEMETRY) on a PC
+//
+//   telemetry_reader [capture.bin | -] [--csv] [--every N]
+//
+// Reads a raw capture of the CDC port (or stdin, e.g. piped from the serial
+// device) through TelemetryParser. --csv prints every valid frame as a row;
+// --every N prints the running statistics every N frames. The summary at the
+// end reports frames received, bad frames, bytes of interleaved text skipped,
+// frames missing from seq gaps, frames the device dropped and the sample rate
+// measured from the device timestamps.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Telemetry.h"
+
+static void printStats(const TelemetryParser& parser) {
+  printf("# %u frames ok, %u bad, %u bytes skipped, %u missing, %u dropped by device, %u session%s, %.3f Hz\n",
+         parser.framesOk(), parser.badFrames(), parser.bytesSkipped(), parser.framesMissing(),
+         parser.deviceDropped(), parser.sessions(), parser.sessions() == 1 ? "" : "s", parser.sampleRateHz());
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  bool csv = false;
+  unsigned long every = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--csv") == 0) {
+      csv = true;
+    } else if (strcmp(argv[i], "--every") == 0 && i + 1 < argc) {
+      every = strtoul(argv[++i], nullptr, 10);
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      fprintf(stderr, "usage: %s [capture.bin | -] [--csv] [--every N]\n", argv[0]);
+      return 2;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  FILE* in = (path == nullptr || strcmp(path, "-") == 0) ? stdin : fopen(path, "rb");
+  if (in == nullptr) {
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], path);
+    return 2;
+  }
+  if (csv) {
+    puts("seq,time_us,raw,uvi,bars,num_bars,game,range,battery_adc,battery_mv,hid_flags,hid_mode,hid_buttons,dropped");
+  }
+  static TelemetryParser parser;
+  int c;
+  while ((c = fgetc(in)) != EOF) {
+    if (!parser.feed((uint8_t)c)) {
+      continue;
+    }
+    if (csv) {
+      const TelemetrySample& s = parser.sample();
+      printf("%u,%lu,%lu,%.3f,%u,%u,%u,%u,%u,%u,0x%02X,%u,0x%04X,%lu\n", (unsigned)s.seq,
+             (unsigned long)s.timeUs, (unsigned long)s.rawUVS, s.uviMilli / 1000.0f, (unsigned)s.bars,
+             (unsigned)s.numBars, (unsigned)(s.game + 1), (unsigned)s.rangeMode, (unsigned)s.batteryAdc,
+             (unsigned)s.batteryMv, (unsigned)s.hidFlags, (unsigned)s.hidMode, (unsigned)s.hidButtons,
+             (unsigned long)s.dropped);
+    }
+    if (every != 0 && parser.framesOk() % every == 0) {
+      printStats(parser);
+      fflush(stdout);
+    }
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  printStats(parser);
+  return parser.framesOk() > 0 ? 0 : 1;
+}
@@ -0,0 +1,163 @@
+// test_absolute_meter.cpp - Absolute HID meter encode/decode (AbsoluteMeter.h)
+//
+// Every (cartValue, bars, numBars) combination goes through encode and
+// decode: a report is accepted exactly when the cart value is in range and
+// agrees with the bar count, and then decodes to the same values. The
+// normalized decoder gets the same reports as an 8-bit XInput host and a
+// 10-bit BLE host would present them. Random reports measure how often the
+// CRC-8 check lets through something the device never sent.
+#include <stdio.h>
+#include <initializer_list>
+
+#include "HostTest.h"
+#include "AbsoluteMeter.h"
+
+static const uint32_t BLE_TRIGGER_MAX = 1023;   // XBOX_TRIGGER_MAX in the BLE gamepad library
+
+// absoluteTriggerToBle() in the sketch
+static uint16_t triggerToBle(uint8_t value) {
+  return (uint16_t)(((uint32_t)value * BLE_TRIGGER_MAX + 127) / 255);
+}
+
+static bool expectValid(uint8_t cartValue, uint8_t bars, uint8_t numBars) {
+  if (cartValue > ABS_METER_CART_DARK || bars > numBars) return false;
+  return absMeterBarsFromLevel((uint8_t)(ABS_METER_CART_DARK - cartValue), numBars) == bars;
+}
+
+static void checkSame(bool ok, const AbsMeterValue& value, bool valid, uint8_t cartValue, uint8_t bars,
+                      uint8_t numBars) {
+  CHECK_EQ(ok, valid);
+  if (ok && valid) {
+    CHECK_EQ(value.cartValue, cartValue);
+    CHECK_EQ(value.bars, bars);
+    CHECK_EQ(value.numBars, numBars);
+  }
+}
+
+static void roundTrip() {
+  uint32_t accepted = 0;
+  for (uint8_t numBars : { (uint8_t)8, (uint8_t)10 }) {
+    for (int bars = 0; bars <= numBars; bars++) {
+      for (int cartValue = 0; cartValue <= 255; cartValue++) {
+        AbsMeterReport report = absMeterEncode((uint8_t)cartValue, (uint8_t)bars, numBars);
+        bool valid = expectValid((uint8_t)cartValue, (uint8_t)bars, numBars);
+        AbsMeterValue value;
+
+        checkSame(absMeterDecode(report, &value), value, valid, (uint8_t)cartValue, (uint8_t)bars, numBars);
+        accepted += valid ? 1 : 0;
+
+        // XInput: 8-bit triggers; axis normalized by 32768 or 32767
+        for (float axisScale : { 32768.0f, 32767.0f }) {
+          bool ok = absMeterDecodeNormalized(report.triggerLeft / 255.0f, report.triggerRight / 255.0f,
+                                             report.axis / axisScale, &value);
+          checkSame(ok, value, valid, (uint8_t)cartValue, (uint8_t)bars, numBars);
+        }
+        // BLE: 10-bit triggers
+        bool ok = absMeterDecodeNormalized((float)triggerToBle(report.triggerLeft) / BLE_TRIGGER_MAX,
+                                           (float)triggerToBle(report.triggerRight) / BLE_TRIGGER_MAX,
+                                           report.axis / 32768.0f, &value);
+        checkSame(ok, value, valid, (uint8_t)cartValue, (uint8_t)bars, numBars);
+
+        // CRC-8 catches every single-bit error in the triggers and check byte
+        if (valid) {
+          for (int bit = 0; bit < 24; bit++) {
+            AbsMeterReport bad = report;
+            if (bit < 8) {
+              bad.triggerLeft ^= (uint8_t)(1 << bit);
+            } else if (bit < 16) {
+              bad.triggerRight ^= (uint8_t)(1 << (bit - 8));
+            } else {
+              bad.axis = (int16_t)((uint16_t)bad.axis ^ (uint16_t)(1 << (bit - 8)));
+            }
+            CHECK(!absMeterDecode(bad, &value));
+          }
+        }
+      }
+    }
+  }
+  // One valid report per level and game size
+  CHECK_EQ(accepted, 2 * (ABS_METER_LEVEL_MAX + 1));
+  printf("  round trip: %u valid reports, all decode on 8-bit and 10-bit triggers\n", accepted);
+}
+
+// Every level the device sends, from the bars the game would show
+static void levelsFromDevice() {
+  for (uint8_t numBars : { (uint8_t)8, (uint8_t)10 }) {
+    for (int level = 0; level <= ABS_METER_LEVEL_MAX; level++) {
+      uint8_t bars = absMeterBarsFromLevel((uint8_t)level, numBars);
+      AbsMeterValue value;
+      CHECK(absMeterDecode(absMeterEncode((uint8_t)(ABS_METER_CART_DARK - level), bars, numBars), &value));
+      for (int shown = 0; shown <= numBars; shown++) {
+        uint8_t clamped = absMeterClampLevelToBars((uint8_t)level, (uint8_t)shown, numBars);
+        CHECK_EQ(absMeterBarsFromLevel(clamped, numBars), shown);
+      }
+    }
+    CHECK_EQ(absMeterBarsFromLevel(0, numBars), 0);
+    CHECK_EQ(absMeterBarsFromLevel(ABS_METER_LEVEL_FULL, numBars), numBars);
+    CHECK_EQ(absMeterBarsFromLevel(ABS_METER_LEVEL_FULL - 1, numBars), numBars - 1);
+  }
+}
+
+static uint32_t rngState = 0x2545F491;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static void fuzz() {
+  const uint32_t N = 20000000;
+  AbsMeterValue value;
+
+  // Arbitrary controller input
+  uint32_t accepted = 0;
+  for (uint32_t i = 0; i < N; i++) {
+    uint32_t r = rngNext();
+    AbsMeterReport report = { (uint8_t)r, (uint8_t)(r >> 8), (int16_t)(uint16_t)(rngNext() >> 16) };
+    accepted += absMeterDecode(report, &value) ? 1 : 0;
+  }
+  double rate = (double)accepted / N;
+  printf("  random reports:            %u of %u accepted (1 in %.0f)\n", accepted, N, accepted ? 1.0 / rate : 0.0);
+  // Only 2 x 233 of the 65536 trigger pairs are valid, then 1 in 256 on the check
+  CHECK(rate < 2.0 * (2.0 * 233.0 / 65536.0) / 256.0);
+
+  // Worst case: triggers that already form a valid value, axis random
+  accepted = 0;
+  for (uint32_t i = 0; i < N; i++) {
+    uint8_t numBars = (rngNext() & 1) ? 10 : 8;
+    uint8_t level = (uint8_t)(rngNext() % (ABS_METER_LEVEL_MAX + 1));
+    AbsMeterReport report = absMeterEncode((uint8_t)(ABS_METER_CART_DARK - level),
+                                           absMeterBarsFromLevel(level, numBars), numBars);
+    report.axis = (int16_t)(uint16_t)(rngNext() >> 16);
+    accepted += absMeterDecode(report, &value) ? 1 : 0;
+  }
+  rate = (double)accepted / N;
+  printf("  valid triggers, random axis: %u of %u accepted (1 in %.0f)\n", accepted, N, accepted ? 1.0 / rate : 0.0);
+  CHECK(rate < 1.2 / 256.0);
+
+  // A controller at rest or with squeezed triggers: stick near centre or
+  // at an end, triggers anywhere
+  uint32_t restAccepted = 0;
+  for (int left = 0; left <= 255; left++) {
+    for (int right = 0; right <= 255; right++) {
+      for (int axis : { 0, -1, 1, 128, -129, 32767, -32768 }) {
+        AbsMeterReport report = { (uint8_t)left, (uint8_t)right, (int16_t)axis };
+        restAccepted += absMeterDecode(report, &value) ? 1 : 0;
+      }
+    }
+  }
+  printf("  idle stick, any triggers:  %u of %u accepted\n", restAccepted, 256 * 256 * 7);
+  AbsMeterReport rest = { 0, 0, 0 };
+  CHECK(!absMeterDecode(rest, &value));
+  AbsMeterReport squeezed = { 255, 255, 0 };
+  CHECK(!absMeterDecode(squeezed, &value));
+}
+
+int main() {
+  printf("test_absolute_meter\n");
+  roundTrip();
+  levelsFromDevice();
+  fuzz();
+  return hostTestResult("test_absolute_meter");
+}
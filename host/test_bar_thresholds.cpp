@@ -0,0 +1,209 @@
+// test_bar_thresholds.cpp - Raw-count bar tables against the float path
+//
+// BarRawTables::rebuild() bisects the 20-bit range against the float path;
+// this checks the result count by count. The config.h settings are swept
+// over every raw count, for every game and every previous bar count, at
+// both auto-range divisors and with hysteresis off and forced on. Variants
+// (manual ranges, no enclosure compensation, an offset, thresholds taken
+// on measured UVI, a range with saturation <= min) are checked within two
+// counts of every table entry, which is where a bisection error would show.
+//
+// The device can fuse a multiply-add that the host does not (or the other
+// way round), so DEBUG_VERIFY_BAR_TABLES still runs the same sweep on the
+// ESP32 itself.
+#include <stdio.h>
+#include <chrono>
+#include <initializer_list>
+
+#include "HostTest.h"
+#include "FirmwareConfig.h"
+#include "BarThresholds.h"
+
+// The auto-range divisors, from UV_RANGE_MODES
+static const float DIVISOR_SLOW = getUvDivisorForRange(UV_RANGE_SLOW);
+static const float DIVISOR_FAST = getUvDivisorForRange(UV_RANGE_FAST);
+
+static uint64_t mismatches = 0;
+
+static void checkCount(const BarThresholdConfig& cfg, const BarRawTables& tables, float divisor, int game,
+                       uint32_t raw) {
+  float uvi = barCompareUvi(cfg, raw, divisor);
+  if (tables.bars(raw, game) != barsForUvi(cfg, uvi, game)) {
+    mismatches++;
+  }
+  for (int lastBars = 0; lastBars <= GAME_BARS[game]; lastBars++) {
+    if (tables.barsWithHysteresis(raw, game, lastBars) != barsForUviWithHysteresis(cfg, uvi, game, lastBars)) {
+      mismatches++;
+    }
+  }
+}
+
+static void sweepAll(const char* name, const BarThresholdConfig& cfg, float divisor) {
+  BarRawTables tables;
+  tables.rebuild(cfg, divisor);
+  uint64_t before = mismatches;
+  for (int game = 0; game < NUM_GAMES; game++) {
+    for (uint32_t raw = 0; raw <= BAR_RAW_MAX; raw++) {
+      checkCount(cfg, tables, divisor, game, raw);
+    }
+  }
+  printf("  full sweep  %-24s /%-6.0f %llu mismatches\n", name, divisor,
+         (unsigned long long)(mismatches - before));
+}
+
+static void checkNear(const BarThresholdConfig& cfg, const BarRawTables& tables, float divisor, int game,
+                      uint32_t edge) {
+  if (edge == BAR_RAW_NEVER) {
+    return;
+  }
+  for (int64_t raw = (int64_t)edge - 2; raw <= (int64_t)edge + 2; raw++) {
+    if (raw >= 0 && raw <= (int64_t)BAR_RAW_MAX) {
+      checkCount(cfg, tables, divisor, game, (uint32_t)raw);
+    }
+  }
+}
+
+// Every count within two of a table entry, plus the ends of the range
+static void sweepEdges(const char* name, const BarThresholdConfig& cfg, float divisor) {
+  BarRawTables tables;
+  tables.rebuild(cfg, divisor);
+  uint64_t before = mismatches;
+  for (int game = 0; game < NUM_GAMES; game++) {
+    checkNear(cfg, tables, divisor, game, 0);
+    checkNear(cfg, tables, divisor, game, BAR_RAW_MAX);
+    for (int k = 1; k <= GAME_BARS[game]; k++) {
+      checkNear(cfg, tables, divisor, game, tables.start(game, k));
+      float start = barThreshold(cfg, game, k);
+      // The hysteresis edges, found the same way rebuild() does
+      for (float edgeUvi : { start + cfg.hysteresis, start - cfg.hysteresis }) {
+        uint32_t lo = 0;
+        uint32_t hi = BAR_RAW_MAX + 1;
+        while (lo < hi) {
+          uint32_t mid = lo + (hi - lo) / 2;
+          if (barCompareUvi(cfg, mid, divisor) >= edgeUvi) {
+            hi = mid;
+          } else {
+            lo = mid + 1;
+          }
+        }
+        checkNear(cfg, tables, divisor, game, lo);
+      }
+    }
+  }
+  printf("  edges       %-24s /%-6.0f %llu mismatches\n", name, divisor,
+         (unsigned long long)(mismatches - before));
+}
+
+// The tables must also agree with the bars the thresholds imply: every
+// count below start(k) shows fewer than k bars, start(k) itself at least k
+static void checkMonotonic(const BarThresholdConfig& cfg, float divisor) {
+  BarRawTables tables;
+  tables.rebuild(cfg, divisor);
+  for (int game = 0; game < NUM_GAMES; game++) {
+    uint32_t previous = 0;
+    for (int k = 1; k <= GAME_MAX_BARS; k++) {
+      uint32_t start = tables.start(game, k);
+      if (k > GAME_BARS[game]) {
+        CHECK(start == BAR_RAW_NEVER);
+        continue;
+      }
+      CHECK(start >= previous);
+      if (start != BAR_RAW_NEVER) {
+        CHECK(tables.bars(start, game) >= k);
+        if (start > 0) {
+          CHECK(tables.bars(start - 1, game) < k);
+        }
+        previous = start;
+      }
+    }
+  }
+}
+
+// Raw tables vs. float path per classified sample, as the firmware uses them
+static void timePaths(const BarThresholdConfig& cfg) {
+  BarRawTables tables;
+  auto t0 = std::chrono::steady_clock::now();
+  tables.rebuild(cfg, DIVISOR_SLOW);
+  auto t1 = std::chrono::steady_clock::now();
+  volatile int sink = 0;
+  const uint32_t step = 7;
+  uint32_t samples = 0;
+  for (uint32_t raw = 0; raw <= BAR_RAW_MAX; raw += step, samples++) {
+    sink = sink + tables.barsWithHysteresis(raw, 0, 3);
+  }
+  auto t2 = std::chrono::steady_clock::now();
+  for (uint32_t raw = 0; raw <= BAR_RAW_MAX; raw += step) {
+    sink = sink + barsForUviWithHysteresis(cfg, barCompareUvi(cfg, raw, DIVISOR_SLOW), 0, 3);
+  }
+  auto t3 = std::chrono::steady_clock::now();
+  auto ns = [](auto a, auto b) { return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count(); };
+  printf("  rebuild %.1f us; per sample: raw tables %.1f ns, float path %.1f ns (host)\n", ns(t0, t1) / 1000.0,
+         ns(t1, t2) / samples, ns(t2, t3) / samples);
+}
+
+int main() {
+  BarThresholdConfig base = getBarThresholdConfig();
+  BarThresholdConfig hyst = base;
+  hyst.hysteresis = (BAR_HYSTERESIS > 0.0f) ? BAR_HYSTERESIS : 0.2f;
+
+  printf("test_bar_thresholds\n");
+  // Datasheet reference: 2300 counts/UVI at 18x, 20-bit; 18-bit is a quarter
+  CHECK(DIVISOR_SLOW == 2300.0f);
+  CHECK(DIVISOR_FAST == 575.0f);
+  for (float divisor : { DIVISOR_SLOW, DIVISOR_FAST }) {
+    sweepAll("config.h", base, divisor);
+    sweepAll("config.h + hysteresis", hyst, divisor);
+  }
+
+  BarThresholdConfig manual = hyst;
+  const float mins[] = { 0.5f, 2.0f, 1.0f };
+  const float sats[] = { 10.0f, 16.5f, 13.1f };
+  for (int game = 0; game < NUM_GAMES; game++) {
+    manual.uvMin[game] = mins[game % 3];
+    manual.uvSat[game] = sats[game % 3];
+  }
+  BarThresholdConfig noComp = hyst;
+  noComp.enclosureComp = false;
+  BarThresholdConfig offset = hyst;
+  offset.offsetUvi = 0.3f;
+  offset.transmittance = 0.55f;
+  BarThresholdConfig measured = hyst;
+  measured.openAirThresholds = false;
+  BarThresholdConfig flat = hyst;
+  flat.uvSat[0] = flat.uvMin[0];       // Saturation <= min: all or nothing
+  flat.uvSat[1] = flat.uvMin[1] - 1.0f;
+  BarThresholdConfig wide = base;
+  wide.hysteresis = 1.5f;              // Wider than some bars
+
+  struct Variant {
+    const char* name;
+    const BarThresholdConfig* cfg;
+  } variants[] = {
+    { "config.h", &base },        { "config.h + hysteresis", &hyst }, { "manual ranges", &manual },
+    { "no compensation", &noComp }, { "offset + 0.55 transmit.", &offset }, { "measured thresholds", &measured },
+    { "saturation <= min", &flat }, { "hysteresis 1.5", &wide },
+  };
+  for (const Variant& v : variants) {
+    for (float divisor : { DIVISOR_SLOW, DIVISOR_FAST, 115.0f }) {
+      sweepEdges(v.name, *v.cfg, divisor);
+      checkMonotonic(*v.cfg, divisor);
+    }
+  }
+  CHECK_EQ(mismatches, 0);
+
+  // Spot values: config.h defaults put bar 1 at UVI 1.0 on open air
+  if (AUTO_MODE && UV_ENCLOSURE_COMP_ENABLED && UV_THRESHOLDS_CALIBRATED_OPEN_AIR) {
+    BarRawTables tables;
+    tables.rebuild(base, DIVISOR_SLOW);
+    uint32_t bar1 = tables.start(0, 1);
+    CHECK(barCompareUvi(base, bar1, DIVISOR_SLOW) >= AUTO_UV_MIN);
+    CHECK(barCompareUvi(base, bar1 - 1, DIVISOR_SLOW) < AUTO_UV_MIN);
+    for (int game = 0; game < NUM_GAMES; game++) {
+      CHECK_EQ(tables.bars(0, game), 0);
+      CHECK_EQ(tables.bars(BAR_RAW_MAX, game), GAME_BARS[game]);
+    }
+  }
+
+  timePaths(hyst);
+  return hostTestResult("test_bar_thresholds");
+}
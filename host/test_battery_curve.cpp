@@ -0,0 +1,101 @@
+// test_battery_curve.cpp - LiPo percent lookup (BatteryCurve.h)
+//
+// The curve table must run strictly downhill in both voltage and percent.
+// The lookup must return every table point's percent exactly and never
+// decrease as the voltage rises. It must clamp to 0 and 100 outside the
+// table and round to the nearest percent between points. The linear fallback
+// is checked the same way, plus its guard against VOLT_MAX <= VOLT_MIN.
+#include <stdio.h>
+
+#include "HostTest.h"
+#include "BatteryCurve.h"
+
+static void checkTable() {
+  CHECK_EQ(LIPO_CURVE[0].pct, 100);
+  CHECK_EQ(LIPO_CURVE[LIPO_CURVE_POINTS - 1].pct, 0);
+  for (int i = 1; i < LIPO_CURVE_POINTS; i++) {
+    CHECK(LIPO_CURVE[i].mv < LIPO_CURVE[i - 1].mv);
+    CHECK(LIPO_CURVE[i].pct < LIPO_CURVE[i - 1].pct);
+  }
+}
+
+static void checkCurve() {
+  for (int i = 0; i < LIPO_CURVE_POINTS; i++) {
+    CHECK_EQ(batteryCurvePercent(LIPO_CURVE[i].mv), LIPO_CURVE[i].pct);
+  }
+
+  // Clamped ends
+  CHECK_EQ(batteryCurvePercent(4201), 100);
+  CHECK_EQ(batteryCurvePercent(5000), 100);
+  CHECK_EQ(batteryCurvePercent(INT32_MAX / 1000), 100);
+  CHECK_EQ(batteryCurvePercent(3299), 0);
+  CHECK_EQ(batteryCurvePercent(0), 0);
+  CHECK_EQ(batteryCurvePercent(-500), 0);
+
+  // Between points: linear, rounded to nearest (half up)
+  CHECK_EQ(batteryCurvePercent(4175), 98);   // 95 + 25 * 5 / 50 = 97.5
+  CHECK_EQ(batteryCurvePercent(3845), 53);   // 50 + 5 * 5 / 10 = 52.5
+  CHECK_EQ(batteryCurvePercent(3844), 52);
+  CHECK_EQ(batteryCurvePercent(3455), 3);    // 0 + 155 * 5 / 310 = 2.5
+  CHECK_EQ(batteryCurvePercent(3454), 2);
+  CHECK_EQ(batteryCurvePercent(3650), 8);    // 5 + 40 * 5 / 80 = 7.5
+
+  // Every millivolt: within 0-100, never lower than at the millivolt below,
+  // and never more than one percent from the exact interpolation
+  int previous = batteryCurvePercent(2999);
+  int worstStep = 0;
+  bool inRange = true;
+  bool monotonic = true;
+  bool nearest = true;
+  for (int32_t mv = 3000; mv <= 4500; mv++) {
+    int pct = batteryCurvePercent(mv);
+    inRange = inRange && pct >= 0 && pct <= 100;
+    monotonic = monotonic && pct >= previous;
+    if (pct - previous > worstStep) {
+      worstStep = pct - previous;
+    }
+    previous = pct;
+    if (mv > LIPO_CURVE[LIPO_CURVE_POINTS - 1].mv && mv < LIPO_CURVE[0].mv) {
+      for (int i = 1; i < LIPO_CURVE_POINTS; i++) {
+        const BatteryCurvePoint& hi = LIPO_CURVE[i - 1];
+        const BatteryCurvePoint& lo = LIPO_CURVE[i];
+        if (mv >= lo.mv && mv < hi.mv) {
+          double exact = lo.pct + (double)(mv - lo.mv) * (hi.pct - lo.pct) / (hi.mv - lo.mv);
+          nearest = nearest && pct - exact <= 0.5 && exact - pct < 0.5;
+          break;
+        }
+      }
+    }
+  }
+  CHECK(inRange);
+  CHECK(monotonic);
+  CHECK(nearest);
+  printf("  curve: 3000-4500 mV, largest step %d%% per mV\n", worstStep);
+}
+
+static void checkLinear() {
+  CHECK_EQ(batteryLinearPercent(3300, 3300, 4200), 0);
+  CHECK_EQ(batteryLinearPercent(4200, 3300, 4200), 100);
+  CHECK_EQ(batteryLinearPercent(3750, 3300, 4200), 50);
+  CHECK_EQ(batteryLinearPercent(3000, 3300, 4200), 0);
+  CHECK_EQ(batteryLinearPercent(4500, 3300, 4200), 100);
+  CHECK_EQ(batteryLinearPercent(4000, 4200, 4200), 0);   // Guard
+  CHECK_EQ(batteryLinearPercent(4000, 4200, 3300), 0);
+
+  int previous = 0;
+  bool monotonic = true;
+  for (int32_t mv = 3000; mv <= 4500; mv++) {
+    int pct = batteryLinearPercent(mv, 3300, 4200);
+    monotonic = monotonic && pct >= previous && pct <= 100;
+    previous = pct;
+  }
+  CHECK(monotonic);
+}
+
+int main() {
+  printf("test_battery_curve\n");
+  checkTable();
+  checkCurve();
+  checkLinear();
+  return hostTestResult("test_battery_curve");
+}
@@ -0,0 +1,388 @@
+// test_button_debounce.cpp - Debounce and gesture timelines (ButtonDebounce.h)
+//
+// Scripted edge timelines (clean taps, contact bounce on press and release,
+// glitches shorter than the lock-out, double taps on and past the window,
+// long presses seen by poll() or only by the release edge, reset() with a
+// press in progress, a full event queue) are checked event for event. Every
+// script also runs with its clock offset so it straddles the millis() wrap,
+// and must give the same events at the same relative times. A random
+// session of presses with bounce bursts then checks that each physical press
+// gives exactly one PRESS and one RELEASE at the first edge's time, again
+// across the wrap.
+#include <stdio.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "ButtonDebounce.h"
+
+static const uint32_t DEBOUNCE_MS = 50;
+static const uint32_t LONG_PRESS_MS = 2000;
+static const uint32_t DOUBLE_TAP_MS = 300;
+
+// Clock offsets every script runs at: none, and placements that put the
+// wrap inside a lock-out, a long press and a double-tap window
+static const uint32_t BASES[] = { 0, 12345, 0xFFFFFFFFu - 20, 0xFFFFFFFFu - 1100, 0xFFFFFFFFu - 2500,
+                                  0xFFFFFFFFu - 5200 };
+
+static uint32_t rngState = 0xB077011u;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static uint32_t rngRange(uint32_t lo, uint32_t hi) {
+  return lo + rngNext() % (hi - lo + 1);
+}
+
+enum StepKind { EDGE_DOWN, EDGE_UP, POLL };
+
+struct Step {
+  StepKind kind;
+  uint32_t timeMs;
+};
+
+struct Expect {
+  ButtonEventType type;
+  uint32_t timeMs;
+  uint32_t heldMs;
+};
+
+static const char* eventName(ButtonEventType type) {
+  static const char* const NAMES[] = { "PRESS", "RELEASE", "LONG_PRESS", "TAP", "DOUBLE_TAP" };
+  return NAMES[type];
+}
+
+struct Start {
+  bool pressed;
+  uint32_t timeMs;
+  bool ignoreHeld;
+};
+
+static std::vector<ButtonEvent> runScript(const Start& start, const std::vector<Step>& steps, uint32_t base,
+                                          uint32_t* dropped) {
+  ButtonDebouncer debouncer;
+  debouncer.configure(DEBOUNCE_MS, LONG_PRESS_MS, DOUBLE_TAP_MS);
+  debouncer.reset(start.pressed, base + start.timeMs, start.ignoreHeld);
+  std::vector<ButtonEvent> events;
+  for (const Step& step : steps) {
+    if (step.kind == POLL) {
+      debouncer.poll(base + step.timeMs);
+    } else {
+      debouncer.edge(step.kind == EDGE_DOWN, base + step.timeMs);
+    }
+    // Read after every step except the queue test's, like loop() does
+    if (dropped == nullptr) {
+      ButtonEvent event;
+      while (debouncer.nextEvent(&event)) {
+        event.timeMs -= base;
+        events.push_back(event);
+      }
+    }
+  }
+  ButtonEvent event;
+  while (debouncer.nextEvent(&event)) {
+    event.timeMs -= base;
+    events.push_back(event);
+  }
+  if (dropped != nullptr) {
+    *dropped = debouncer.eventsDropped();
+  }
+  return events;
+}
+
+static void checkScript(const char* name, const Start& start, const std::vector<Step>& steps,
+                        const std::vector<Expect>& expected) {
+  for (uint32_t base : BASES) {
+    std::vector<ButtonEvent> events = runScript(start, steps, base, nullptr);
+    bool same = events.size() == expected.size();
+    for (size_t i = 0; same && i < events.size(); i++) {
+      same = events[i].type == expected[i].type && events[i].timeMs == expected[i].timeMs &&
+             events[i].heldMs == expected[i].heldMs;
+    }
+    CHECK(same);
+    if (!same) {
+      fprintf(stderr, "  %s at base %u:\n", name, base);
+      for (const ButtonEvent& e : events) {
+        fprintf(stderr, "    got  %-10s %u held %u\n", eventName(e.type), e.timeMs, e.heldMs);
+      }
+      for (const Expect& e : expected) {
+        fprintf(stderr, "    want %-10s %u held %u\n", eventName(e.type), e.timeMs, e.heldMs);
+      }
+    }
+  }
+}
+
+static const Start IDLE = { false, 0, false };
+
+static void checkScripts() {
+  checkScript("tap", IDLE, { { EDGE_DOWN, 1000 }, { EDGE_UP, 1120 }, { POLL, 1500 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1120, 120 },
+                { BUTTON_EVENT_TAP, 1120, 120 } });
+
+  // Bounce on both edges: one press and one release, at the first edge
+  checkScript("bounce", IDLE,
+              { { EDGE_DOWN, 1000 }, { EDGE_UP, 1003 }, { EDGE_DOWN, 1007 }, { EDGE_UP, 1012 },
+                { EDGE_DOWN, 1020 }, { POLL, 1100 }, { EDGE_UP, 1300 }, { EDGE_DOWN, 1302 },
+                { EDGE_UP, 1310 }, { EDGE_DOWN, 1331 }, { EDGE_UP, 1340 }, { POLL, 1400 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1300, 300 },
+                { BUTTON_EVENT_TAP, 1300, 300 } });
+
+  // A glitch that ends released inside the lock-out: the release is dated
+  // to its edge, and something that short is not a tap
+  checkScript("glitch", IDLE, { { EDGE_DOWN, 1000 }, { EDGE_UP, 1010 }, { POLL, 1200 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1010, 10 } });
+
+  // A release that bounces past the end of the press lock-out is still one
+  // release; the lock-out restarts at the first release edge
+  checkScript("late bounce", IDLE,
+              { { EDGE_DOWN, 1000 }, { EDGE_UP, 1060 }, { EDGE_DOWN, 1070 }, { EDGE_UP, 1080 },
+                { POLL, 1200 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1060, 60 },
+                { BUTTON_EVENT_TAP, 1060, 60 } });
+
+  // The lock-out ending is only seen by the next edge, with no poll between:
+  // the pending release starts a lock-out of its own, which has also ended
+  // by the time of the new press
+  checkScript("edge ends lock-out", IDLE, { { EDGE_DOWN, 1000 }, { EDGE_UP, 1040 }, { EDGE_DOWN, 1400 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1040, 40 },
+                { BUTTON_EVENT_PRESS, 1400, 0 } });
+
+  // Double tap: the second press starts within DOUBLE_TAP_MS of the first
+  // release. Both TAPs are sent; a third tap starts a new pair.
+  checkScript("double tap", IDLE,
+              { { EDGE_DOWN, 1000 }, { EDGE_UP, 1100 }, { EDGE_DOWN, 1250 }, { EDGE_UP, 1350 },
+                { EDGE_DOWN, 1500 }, { EDGE_UP, 1600 }, { POLL, 2000 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1100, 100 },
+                { BUTTON_EVENT_TAP, 1100, 100 },
+                { BUTTON_EVENT_PRESS, 1250, 0 },
+                { BUTTON_EVENT_RELEASE, 1350, 100 },
+                { BUTTON_EVENT_TAP, 1350, 100 },
+                { BUTTON_EVENT_DOUBLE_TAP, 1350, 100 },
+                { BUTTON_EVENT_PRESS, 1500, 0 },
+                { BUTTON_EVENT_RELEASE, 1600, 100 },
+                { BUTTON_EVENT_TAP, 1600, 100 } });
+
+  checkScript("double tap on the window", IDLE,
+              { { EDGE_DOWN, 1000 }, { EDGE_UP, 1100 }, { EDGE_DOWN, 1100 + DOUBLE_TAP_MS }, { EDGE_UP, 1500 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1100, 100 },
+                { BUTTON_EVENT_TAP, 1100, 100 },
+                { BUTTON_EVENT_PRESS, 1100 + DOUBLE_TAP_MS, 0 },
+                { BUTTON_EVENT_RELEASE, 1500, 100 },
+                { BUTTON_EVENT_TAP, 1500, 100 },
+                { BUTTON_EVENT_DOUBLE_TAP, 1500, 100 } });
+
+  checkScript("double tap too late", IDLE,
+              { { EDGE_DOWN, 1000 }, { EDGE_UP, 1100 }, { EDGE_DOWN, 1101 + DOUBLE_TAP_MS }, { EDGE_UP, 1501 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1100, 100 },
+                { BUTTON_EVENT_TAP, 1100, 100 },
+                { BUTTON_EVENT_PRESS, 1101 + DOUBLE_TAP_MS, 0 },
+                { BUTTON_EVENT_RELEASE, 1501, 100 },
+                { BUTTON_EVENT_TAP, 1501, 100 } });
+
+  // A too-short press between taps breaks the pair
+  checkScript("glitch between taps", IDLE,
+              { { EDGE_DOWN, 1000 }, { EDGE_UP, 1100 }, { EDGE_DOWN, 1150 }, { EDGE_UP, 1160 },
+                { POLL, 1210 }, { EDGE_DOWN, 1250 }, { EDGE_UP, 1350 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1100, 100 },
+                { BUTTON_EVENT_TAP, 1100, 100 },
+                { BUTTON_EVENT_PRESS, 1150, 0 },
+                { BUTTON_EVENT_RELEASE, 1160, 10 },
+                { BUTTON_EVENT_PRESS, 1250, 0 },
+                { BUTTON_EVENT_RELEASE, 1350, 100 },
+                { BUTTON_EVENT_TAP, 1350, 100 } });
+
+  // Long press seen by poll(): not a millisecond early, dated to press +
+  // LONG_PRESS_MS however late the poll, once, and no TAP after it
+  checkScript("long press", IDLE,
+              { { EDGE_DOWN, 1000 }, { POLL, 1000 + LONG_PRESS_MS - 1 }, { POLL, 1000 + LONG_PRESS_MS + 700 },
+                { POLL, 6000 }, { EDGE_UP, 7000 }, { POLL, 7100 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_LONG_PRESS, 1000 + LONG_PRESS_MS, LONG_PRESS_MS },
+                { BUTTON_EVENT_RELEASE, 7000, 6000 } });
+
+  // No poll while held (loop() stalled): the release edge fires the long
+  // press first
+  checkScript("long press at release", IDLE, { { EDGE_DOWN, 1000 }, { EDGE_UP, 4000 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_LONG_PRESS, 1000 + LONG_PRESS_MS, LONG_PRESS_MS },
+                { BUTTON_EVENT_RELEASE, 4000, 3000 } });
+
+  // Released one millisecond short of a long press: a tap
+  checkScript("just short of long", IDLE,
+              { { EDGE_DOWN, 1000 }, { POLL, 2000 }, { EDGE_UP, 1000 + LONG_PRESS_MS - 1 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1000 + LONG_PRESS_MS - 1, LONG_PRESS_MS - 1 },
+                { BUTTON_EVENT_TAP, 1000 + LONG_PRESS_MS - 1, LONG_PRESS_MS - 1 } });
+
+  // A long press does not pair with the tap before it, nor the tap after
+  checkScript("tap, long, tap", IDLE,
+              { { EDGE_DOWN, 1000 }, { EDGE_UP, 1100 }, { EDGE_DOWN, 1200 }, { POLL, 3300 },
+                { EDGE_UP, 3400 }, { EDGE_DOWN, 3500 }, { EDGE_UP, 3600 } },
+              { { BUTTON_EVENT_PRESS, 1000, 0 },
+                { BUTTON_EVENT_RELEASE, 1100, 100 },
+                { BUTTON_EVENT_TAP, 1100, 100 },
+                { BUTTON_EVENT_PRESS, 1200, 0 },
+                { BUTTON_EVENT_LONG_PRESS, 1200 + LONG_PRESS_MS, LONG_PRESS_MS },
+                { BUTTON_EVENT_RELEASE, 3400, 2200 },
+                { BUTTON_EVENT_PRESS, 3500, 0 },
+                { BUTTON_EVENT_RELEASE, 3600, 100 },
+                { BUTTON_EVENT_TAP, 3600, 100 } });
+
+  // Held at reset (the boot-time button check): never a tap; with
+  // ignoreHeld never a long press either, until it is released and pressed
+  // again
+  checkScript("held at reset, ignored", { true, 500, true },
+              { { POLL, 5000 }, { EDGE_UP, 5100 }, { EDGE_DOWN, 5300 }, { POLL, 5300 + LONG_PRESS_MS } },
+              { { BUTTON_EVENT_RELEASE, 5100, 4600 },
+                { BUTTON_EVENT_PRESS, 5300, 0 },
+                { BUTTON_EVENT_LONG_PRESS, 5300 + LONG_PRESS_MS, LONG_PRESS_MS } });
+  checkScript("held at reset", { true, 500, false }, { { POLL, 3000 }, { EDGE_UP, 3100 } },
+              { { BUTTON_EVENT_LONG_PRESS, 500 + LONG_PRESS_MS, LONG_PRESS_MS },
+                { BUTTON_EVENT_RELEASE, 3100, 2600 } });
+  checkScript("short hold at reset", { true, 500, false }, { { EDGE_UP, 600 }, { POLL, 1000 } },
+              { { BUTTON_EVENT_RELEASE, 600, 100 } });
+}
+
+// Events pile up while loop() is not reading: the first eight are kept in
+// order and the rest are counted
+static void checkQueue() {
+  std::vector<Step> steps;
+  for (uint32_t i = 0; i < 5; i++) {
+    steps.push_back({ EDGE_DOWN, 1000 + i * 1000 });
+    steps.push_back({ EDGE_UP, 1100 + i * 1000 });
+  }
+  for (uint32_t base : BASES) {
+    uint32_t dropped = 0;
+    std::vector<ButtonEvent> events = runScript(IDLE, steps, base, &dropped);
+    CHECK_EQ(events.size(), BUTTON_EVENT_QUEUE);
+    CHECK_EQ(dropped, 15 - BUTTON_EVENT_QUEUE);   // 5 x PRESS, RELEASE, TAP
+    CHECK(events.size() == BUTTON_EVENT_QUEUE && events[0].type == BUTTON_EVENT_PRESS && events[0].timeMs == 1000 &&
+          events[7].type == BUTTON_EVENT_RELEASE && events[7].timeMs == 3100);
+  }
+}
+
+// nextDeadline() gives the lock-out end while locked, and the long press
+// while held, with the earlier of the two when both apply
+static void checkDeadlines() {
+  for (uint32_t base : BASES) {
+    ButtonDebouncer debouncer;
+    debouncer.configure(DEBOUNCE_MS, LONG_PRESS_MS, DOUBLE_TAP_MS);
+    debouncer.reset(false, base, false);
+    uint32_t deadline = 0;
+    CHECK(!debouncer.nextDeadline(&deadline));
+    debouncer.edge(true, base + 1000);
+    CHECK(debouncer.nextDeadline(&deadline));
+    CHECK_EQ(deadline - base, 1000 + DEBOUNCE_MS);
+    CHECK(debouncer.isSettling());
+    debouncer.poll(base + 1000 + DEBOUNCE_MS);
+    CHECK(!debouncer.isSettling());
+    CHECK(debouncer.nextDeadline(&deadline));
+    CHECK_EQ(deadline - base, 1000 + LONG_PRESS_MS);
+    debouncer.poll(deadline);
+    CHECK(!debouncer.nextDeadline(&deadline));
+    debouncer.edge(false, base + 5000);
+    CHECK(debouncer.nextDeadline(&deadline));
+    CHECK_EQ(deadline - base, 5000 + DEBOUNCE_MS);
+    debouncer.poll(base + 6000);
+    CHECK(!debouncer.nextDeadline(&deadline));
+    CHECK(!debouncer.isPressed());
+  }
+}
+
+// Random presses, each with bounce bursts shorter than the lock-out on both
+// edges: one PRESS at the first down edge, one RELEASE at the first up edge,
+// TAP/LONG_PRESS by the hold time
+static void checkRandomBounce() {
+  size_t presses = 0;
+  size_t mismatches = 0;
+  for (uint32_t base : BASES) {
+    ButtonDebouncer debouncer;
+    debouncer.configure(DEBOUNCE_MS, LONG_PRESS_MS, DOUBLE_TAP_MS);
+    debouncer.reset(false, base, false);
+    std::vector<Expect> expected;
+    std::vector<ButtonEvent> events;
+    uint32_t t = 1000;
+    uint32_t lastTapMs = 0;
+    bool hasLastTap = false;
+    auto drain = [&]() {
+      ButtonEvent event;
+      while (debouncer.nextEvent(&event)) {
+        event.timeMs -= base;
+        events.push_back(event);
+      }
+    };
+    // A burst starting at `at` that settles at `level` before the lock-out ends
+    auto burst = [&](bool level, uint32_t at) {
+      debouncer.edge(level, base + at);
+      uint32_t edgeMs = at;
+      int bounces = (int)rngRange(0, 3);
+      for (int b = 0; b < bounces; b++) {
+        edgeMs += rngRange(1, 8);
+        debouncer.edge(!level, base + edgeMs);
+        edgeMs += rngRange(1, 8);
+        debouncer.edge(level, base + edgeMs);
+      }
+      if (rngNext() % 3 == 0) {
+        debouncer.poll(base + at + rngRange(0, DEBOUNCE_MS + 10));
+      }
+      drain();
+    };
+    for (int i = 0; i < 2000; i++) {
+      uint32_t held = (rngNext() % 10 == 0) ? rngRange(LONG_PRESS_MS - 100, LONG_PRESS_MS + 1000)
+                                            : rngRange(DEBOUNCE_MS, 400);
+      burst(true, t);
+      expected.push_back({ BUTTON_EVENT_PRESS, t, 0 });
+      if (held >= LONG_PRESS_MS) {
+        expected.push_back({ BUTTON_EVENT_LONG_PRESS, t + LONG_PRESS_MS, LONG_PRESS_MS });
+      }
+      burst(false, t + held);
+      expected.push_back({ BUTTON_EVENT_RELEASE, t + held, held });
+      if (held < LONG_PRESS_MS) {
+        expected.push_back({ BUTTON_EVENT_TAP, t + held, held });
+        if (hasLastTap && t - lastTapMs <= DOUBLE_TAP_MS) {
+          expected.push_back({ BUTTON_EVENT_DOUBLE_TAP, t + held, held });
+          hasLastTap = false;
+        } else {
+          hasLastTap = true;
+          lastTapMs = t + held;
+        }
+      } else {
+        hasLastTap = false;
+      }
+      t += held + rngRange(DEBOUNCE_MS, 600);
+      presses++;
+    }
+    debouncer.poll(base + t);
+    drain();
+    bool same = events.size() == expected.size();
+    for (size_t k = 0; same && k < events.size(); k++) {
+      same = events[k].type == expected[k].type && events[k].timeMs == expected[k].timeMs &&
+             events[k].heldMs == expected[k].heldMs;
+    }
+    mismatches += same ? 0 : 1;
+    CHECK(same);
+    CHECK_EQ(debouncer.eventsDropped(), 0);
+  }
+  printf("  random bounce: %zu presses over %zu clock offsets, %zu mismatched runs\n", presses,
+         sizeof(BASES) / sizeof(BASES[0]), mismatches);
+}
+
+int main() {
+  printf("test_button_debounce\n");
+  checkScripts();
+  checkQueue();
+  checkDeadlines();
+  checkRandomBounce();
+  return hostTestResult("test_button_debounce");
+}
@@ -0,0 +1,191 @@
+// test_deadline_scheduler.cpp - Deadline ordering (DeadlineScheduler.h)
+//
+// Scripted cases cover ties (the lower source wins), a source posting
+// several deadlines (the earliest wins, in either order), overdue deadlines
+// (the most overdue wins and the wait is zero), the wait cap, clear() and
+// millis() wrapping between now and a deadline or between two deadlines.
+// Random passes then post deadlines up to ~12 days either side of a random
+// now and compare next() and waitMs() with a linear minimum taken in 64-bit
+// time.
+#include <stdio.h>
+#include <stdint.h>
+
+#include "HostTest.h"
+#include "DeadlineScheduler.h"
+
+static uint32_t rngState = 0xDEAD1122u;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static void expectNext(const DeadlineScheduler& scheduler, uint32_t nowMs, uint32_t dueMs, WakeSource source) {
+  uint32_t gotMs = 0;
+  WakeSource got = WAKE_TIMEOUT;
+  CHECK(scheduler.next(nowMs, &gotMs, &got));
+  CHECK_EQ(gotMs, dueMs);
+  CHECK_EQ(got, source);
+}
+
+static void expectWait(const DeadlineScheduler& scheduler, uint32_t nowMs, uint32_t maxMs, uint32_t waitMs,
+                       WakeSource source) {
+  WakeSource got = WAKE_SOURCE_COUNT;
+  CHECK_EQ(scheduler.waitMs(nowMs, maxMs, &got), waitMs);
+  CHECK_EQ(got, source);
+}
+
+static void checkScripts() {
+  // Clock placements: plain, and with the wrap just ahead of or behind now
+  const uint32_t nows[] = { 1000, 0xFFFFFFFFu - 5, 0xFFFFFFFFu - 500, 3, 0x7FFFFFF0u, 0x80000005u };
+  for (uint32_t now : nows) {
+    DeadlineScheduler scheduler;
+    uint32_t dueMs = 0;
+    WakeSource source = WAKE_TIMEOUT;
+    CHECK(!scheduler.next(now, &dueMs, &source));
+    expectWait(scheduler, now, 250, 250, WAKE_TIMEOUT);
+
+    // Earliest wins, whatever order the sources post in
+    scheduler.after(WAKE_STATS, now, 40);
+    scheduler.after(WAKE_SENSOR, now, 30);
+    scheduler.after(WAKE_BATTERY, now, 100);
+    expectNext(scheduler, now, now + 30, WAKE_SENSOR);
+    expectWait(scheduler, now, 250, 30, WAKE_SENSOR);
+    expectWait(scheduler, now, 30, 30, WAKE_SENSOR);   // Cap exactly at the deadline
+    expectWait(scheduler, now, 29, 29, WAKE_TIMEOUT);
+    CHECK(scheduler.has(WAKE_STATS));
+    CHECK(!scheduler.has(WAKE_BLE));
+
+    // Ties go to the lower source index, whichever posted first
+    scheduler.after(WAKE_SERIAL, now, 30);
+    scheduler.after(WAKE_BUTTONS, now, 30);
+    expectNext(scheduler, now, now + 30, WAKE_BUTTONS);
+
+    // A source's earlier deadline wins; a later one is ignored
+    scheduler.after(WAKE_HID, now, 20);
+    scheduler.after(WAKE_HID, now, 60);
+    expectNext(scheduler, now, now + 20, WAKE_HID);
+    scheduler.after(WAKE_HID, now, 10);
+    expectNext(scheduler, now, now + 10, WAKE_HID);
+
+    // Overdue: the most overdue wins, and nothing waits
+    scheduler.at(WAKE_DISPLAY, now - 5);
+    scheduler.at(WAKE_GBA_LINK, now - 50);
+    expectNext(scheduler, now, now - 50, WAKE_GBA_LINK);
+    expectWait(scheduler, now, 250, 0, WAKE_GBA_LINK);
+    scheduler.at(WAKE_BLE, now);   // Due now counts as due
+    expectWait(scheduler, now, 250, 0, WAKE_GBA_LINK);
+
+    // Overdue ties also go to the lower source
+    scheduler.at(WAKE_SENSOR, now - 50);
+    expectNext(scheduler, now, now - 50, WAKE_SENSOR);
+
+    scheduler.clear();
+    CHECK(!scheduler.has(WAKE_SENSOR));
+    CHECK(!scheduler.next(now, &dueMs, &source));
+
+    // After clear(), a later deadline than before is taken as posted
+    scheduler.after(WAKE_HID, now, 500);
+    expectNext(scheduler, now, now + 500, WAKE_HID);
+    expectWait(scheduler, now, 250, 250, WAKE_TIMEOUT);
+    expectWait(scheduler, now + 400, 250, 100, WAKE_HID);   // Time moves on
+    expectWait(scheduler, now + 600, 250, 0, WAKE_HID);
+  }
+
+  // Two deadlines either side of the wrap: the one before the wrap is
+  // earlier, although its raw value is larger
+  DeadlineScheduler scheduler;
+  uint32_t now = 0xFFFFFF00u;
+  scheduler.at(WAKE_STATS, 0x00000010u);
+  scheduler.at(WAKE_SERIAL, 0xFFFFFFF0u);
+  expectNext(scheduler, now, 0xFFFFFFF0u, WAKE_SERIAL);
+  expectWait(scheduler, now, 1000, 0xF0, WAKE_SERIAL);
+  scheduler.at(WAKE_SERIAL, 0x00000020u);   // Later (after the wrap): ignored
+  expectNext(scheduler, now, 0xFFFFFFF0u, WAKE_SERIAL);
+  scheduler.clear();
+  scheduler.at(WAKE_SERIAL, 0x00000020u);
+  scheduler.at(WAKE_SERIAL, 0xFFFFFFF8u);   // Earlier (before the wrap): taken
+  expectNext(scheduler, now, 0xFFFFFFF8u, WAKE_SERIAL);
+  expectWait(scheduler, 0x00000004u, 1000, 0, WAKE_SERIAL);   // Clock wrapped past it
+}
+
+// Random deadlines against a linear minimum over 64-bit offsets from now
+static void checkRandom() {
+  const int PASSES = 200000;
+  const int64_t SPAN_MS = 1LL << 30;   // ~12 days either side
+  uint32_t mismatches = 0;
+  uint32_t ties = 0;
+  uint32_t overdue = 0;
+  uint32_t capped = 0;
+  for (int pass = 0; pass < PASSES; pass++) {
+    uint32_t now = (pass % 4 == 0) ? 0xFFFFFFFFu - (rngNext() % 100000) : rngNext();
+    DeadlineScheduler scheduler;
+    bool posted[WAKE_SOURCE_COUNT] = {};
+    int64_t earliest[WAKE_SOURCE_COUNT] = {};
+    int posts = (int)(rngNext() % 24);
+    // Small spans make ties likely; large ones exercise the wrap. Half the
+    // passes post only future deadlines, or nearly every pass is overdue.
+    int64_t span = (rngNext() & 1) ? 40 : SPAN_MS;
+    bool futureOnly = (rngNext() & 1) != 0;
+    for (int p = 0; p < posts; p++) {
+      int s = (int)(rngNext() % WAKE_SOURCE_COUNT);
+      int64_t offset = futureOnly ? (int64_t)(rngNext() % (uint32_t)(span + 1))
+                                  : (int64_t)(rngNext() % (uint32_t)(2 * span + 1)) - span;
+      scheduler.at((WakeSource)s, now + (uint32_t)offset);
+      if (!posted[s] || offset < earliest[s]) {
+        earliest[s] = offset;
+        posted[s] = true;
+      }
+    }
+
+    int best = -1;
+    int tied = 0;
+    for (int s = 0; s < WAKE_SOURCE_COUNT; s++) {
+      if (!posted[s]) {
+        continue;
+      }
+      if (best < 0 || earliest[s] < earliest[best]) {
+        best = s;
+        tied = 0;
+      } else if (earliest[s] == earliest[best]) {
+        tied++;
+      }
+      bool has = scheduler.has((WakeSource)s);
+      mismatches += has ? 0 : 1;
+    }
+    ties += (tied > 0) ? 1 : 0;
+
+    uint32_t dueMs = 0;
+    WakeSource source = WAKE_TIMEOUT;
+    bool found = scheduler.next(now, &dueMs, &source);
+    uint32_t maxMs = 1 + rngNext() % 100;
+    WakeSource waitSource = WAKE_SOURCE_COUNT;
+    uint32_t wait = scheduler.waitMs(now, maxMs, &waitSource);
+    if (best < 0) {
+      mismatches += (found || wait != maxMs || waitSource != WAKE_TIMEOUT) ? 1 : 0;
+      continue;
+    }
+    int64_t ahead = earliest[best];
+    overdue += (ahead <= 0) ? 1 : 0;
+    capped += (ahead > (int64_t)maxMs) ? 1 : 0;
+    uint32_t expectWaitMs = (ahead <= 0) ? 0 : (ahead > (int64_t)maxMs ? maxMs : (uint32_t)ahead);
+    WakeSource expectSource = (ahead > (int64_t)maxMs) ? WAKE_TIMEOUT : (WakeSource)best;
+    bool same = found && source == (WakeSource)best && dueMs == now + (uint32_t)ahead && wait == expectWaitMs &&
+                waitSource == expectSource;
+    mismatches += same ? 0 : 1;
+  }
+  CHECK_EQ(mismatches, 0);
+  CHECK(ties > 0);
+  CHECK(overdue > 0);
+  CHECK(capped > 0);
+  printf("  random: %d passes (%u with ties, %u overdue, %u past the cap), %u mismatches\n", PASSES, ties, overdue,
+         capped, mismatches);
+}
+
+int main() {
+  printf("test_deadline_scheduler\n");
+  checkScripts();
+  checkRandom();
+  return hostTestResult("test_deadline_scheduler");
+}
@@ -0,0 +1,250 @@
+// test_game_profiles.cpp - Game registry tables and link patch data (GameProfiles.h)
+//
+//   test_game_profiles ["GBA Link Patches/Source"]
+//   test_game_profiles --emit
+//
+// The generated tables are checked against the profiles they come from.
+// Bar starts must rise from 0 to 1 along the bounds. Every link level must
+// show its own bar count on the game's gauge, and the other link indexes
+// must read as full or, with no link, as empty. Single Analog midpoints must
+// fall inside their bands. The emulator step maps must agree both ways.
+//
+// With the patch source folder (ctest passes it), every `<prefix>*.asm` is
+// matched to its game by GAME_PROFILES[g].patchPrefix. Its dataarea `dcb`
+// line must hold the same bytes gameProfileFormatDataArea() prints for that
+// game, the line the device's 'p' command prints. Every patch file must
+// belong to a game, and every game with a prefix must have a patch.
+//
+// --emit prints the dataarea block of every game with a link patch, the
+// same text as the device's 'p' command, so a new profile's patch data is
+// generated from GAME_PROFILES rather than copied by hand.
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+#include "GameProfiles.h"
+
+static void checkTables() {
+  for (int g = 0; g < NUM_GAMES; g++) {
+    const GameProfile& p = GAME_PROFILES[g];
+    CHECK_EQ(GAME_BARS[g], p.numBars);
+    CHECK(strcmp(GAME_NAMES[g], p.name) == 0);
+    for (int h = 0; h < g; h++) {
+      CHECK(strcmp(GAME_NAMES[h], GAME_NAMES[g]) != 0);
+      if (p.patchPrefix != nullptr && GAME_PROFILES[h].patchPrefix != nullptr) {
+        CHECK(strcmp(GAME_PROFILES[h].patchPrefix, p.patchPrefix) != 0);
+      }
+    }
+
+    // Bar starts: 0 for the first bar, 1 for the last, rising in between,
+    // each one level below its lower neighbour's bound
+    CHECK(GAME_BAR_RATIOS[g][0] == 0.0f);
+    CHECK(GAME_BAR_RATIOS[g][p.numBars - 1] == 1.0f);
+    for (int b = 0; b < p.numBars; b++) {
+      float expected = (float)(p.bounds[b] - 1) / (float)(GAME_LEVEL_FULL - 1);
+      CHECK(GAME_BAR_RATIOS[g][b] == expected);
+      if (b > 0) {
+        CHECK(GAME_BAR_RATIOS[g][b] > GAME_BAR_RATIOS[g][b - 1]);
+      }
+    }
+
+    // Link table: each level shows its bar count on the gauge, higher
+    // indexes read as full, and no link (lines high) as no sunlight
+    for (int i = 0; i < GAME_LINK_TABLE_SIZE; i++) {
+      uint8_t level = GAME_LINK_TABLES[g][i];
+      int shown = 0;
+      while (shown < p.numBars && level >= p.bounds[shown]) {
+        shown++;
+      }
+      if (i == GAME_LINK_INDEX_NONE) {
+        CHECK_EQ(level, 0);
+      } else if (i <= p.numBars) {
+        CHECK_EQ(level, p.linkLevels[i]);
+        CHECK_EQ(shown, i);
+      } else {
+        CHECK_EQ(level, GAME_LEVEL_FULL);
+      }
+    }
+
+    // Single Analog: midpoint of band b of numBars + 1
+    for (int b = 0; b <= p.numBars; b++) {
+      float f = GAME_ANALOG_FRACTIONS[g][b];
+      CHECK(f > (float)b / (p.numBars + 1) && f < (float)(b + 1) / (p.numBars + 1));
+    }
+
+    // Emulator steps: the first step showing each bar, from either side,
+    // maps back to that bar, and the step before it shows less
+    int steps = GAME_EMU_STEPS[g];
+    CHECK_EQ(steps, (p.emuSteps > 0) ? p.emuSteps : p.numBars);
+    CHECK_EQ(GAME_EMU_STEP_TO_BAR[g][0], 0);
+    CHECK_EQ(GAME_EMU_STEP_TO_BAR[g][steps], p.numBars);
+    for (int b = 0; b <= p.numBars; b++) {
+      int fromEmpty = GAME_EMU_STEP_FROM_EMPTY[g][b];
+      int fromFull = GAME_EMU_STEP_FROM_FULL[g][b];
+      CHECK(fromEmpty <= fromFull);
+      CHECK_EQ(GAME_EMU_STEP_TO_BAR[g][fromEmpty], b);
+      CHECK_EQ(GAME_EMU_STEP_TO_BAR[g][fromFull], b);
+      if (fromEmpty > 0) {
+        CHECK(GAME_EMU_STEP_TO_BAR[g][fromEmpty - 1] < b);
+      }
+      if (fromFull < steps) {
+        CHECK(GAME_EMU_STEP_TO_BAR[g][fromFull + 1] > b);
+      }
+    }
+  }
+
+  // Formatter limits
+  char line[96];
+  CHECK(!gameProfileFormatDataArea(-1, line, sizeof(line)));
+  CHECK(!gameProfileFormatDataArea(NUM_GAMES, line, sizeof(line)));
+  CHECK(!gameProfileFormatDataArea(0, line, 4 + 5 * GAME_LINK_TABLE_SIZE - 1));
+  CHECK(gameProfileFormatDataArea(0, line, 4 + 5 * GAME_LINK_TABLE_SIZE));
+  CHECK_EQ(strlen(line), 4 + 5 * GAME_LINK_TABLE_SIZE - 1);
+}
+
+// The bytes of a `dcb 0x..,0x..` line, whatever the whitespace
+static bool parseDcb(const std::string& line, std::vector<int>* bytes) {
+  size_t pos = line.find_first_not_of(" \t");
+  if (pos == std::string::npos || line.compare(pos, 3, "dcb") != 0) {
+    return false;
+  }
+  bytes->clear();
+  const char* s = line.c_str() + pos + 3;
+  while (*s != '\0') {
+    while (*s == ' ' || *s == '\t' || *s == ',') {
+      s++;
+    }
+    if (*s == '\0' || *s == '\r' || *s == '\n' || (s[0] == '/' && s[1] == '/')) {
+      break;
+    }
+    char* end = nullptr;
+    long v = strtol(s, &end, 0);
+    if (end == s || v < 0 || v > 255) {
+      return false;
+    }
+    bytes->push_back((int)v);
+    s = end;
+  }
+  return !bytes->empty();
+}
+
+// The dcb line after `dataarea:` in one patch source
+static bool readDataArea(const std::filesystem::path& path, std::vector<int>* bytes) {
+  FILE* in = fopen(path.string().c_str(), "r");
+  if (in == nullptr) {
+    return false;
+  }
+  char buf[512];
+  bool inDataArea = false;
+  bool found = false;
+  while (!found && fgets(buf, sizeof(buf), in) != nullptr) {
+    std::string line(buf);
+    if (line.compare(0, 9, "dataarea:") == 0) {
+      inDataArea = true;
+    } else if (inDataArea) {
+      size_t pos = line.find_first_not_of(" \t\r\n");
+      if (pos == std::string::npos || line.compare(pos, 2, "//") == 0) {
+        continue;
+      }
+      found = parseDcb(line, bytes);
+      break;
+    }
+  }
+  fclose(in);
+  return found;
+}
+
+static void checkPatches(const char* dir) {
+  std::vector<std::filesystem::path> files;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    if (entry.path().extension() == ".asm") {
+      files.push_back(entry.path());
+    }
+  }
+  if (ec) {
+    fprintf(stderr, "cannot read %s: %s\n", dir, ec.message().c_str());
+  }
+  CHECK(!ec);
+  std::sort(files.begin(), files.end());
+
+  int patched[NUM_GAMES] = {};
+  for (const auto& file : files) {
+    std::string name = file.filename().string();
+    // The longest matching prefix claims the file
+    int game = -1;
+    size_t longest = 0;
+    for (int g = 0; g < NUM_GAMES; g++) {
+      const char* prefix = GAME_PROFILES[g].patchPrefix;
+      if (prefix != nullptr && name.compare(0, strlen(prefix), prefix) == 0 && strlen(prefix) > longest) {
+        game = g;
+        longest = strlen(prefix);
+      }
+    }
+    if (game < 0) {
+      fprintf(stderr, "%s: no game has its prefix\n", name.c_str());
+    }
+    CHECK(game >= 0);
+    if (game < 0) {
+      continue;
+    }
+    patched[game]++;
+
+    std::vector<int> bytes;
+    bool read = readDataArea(file, &bytes);
+    if (!read) {
+      fprintf(stderr, "%s: no dcb line after dataarea:\n", name.c_str());
+    }
+    CHECK(read);
+    char line[96];
+    std::vector<int> expected;
+    CHECK(gameProfileFormatDataArea(game, line, sizeof(line)));
+    CHECK(parseDcb(line, &expected));
+    if (read && bytes != expected) {
+      fprintf(stderr, "%s: dataarea differs from %s's profile\n  patch: ", name.c_str(), GAME_NAMES[game]);
+      for (size_t i = 0; i < bytes.size(); i++) {
+        fprintf(stderr, "%s0x%02X", i ? "," : "", bytes[i]);
+      }
+      fprintf(stderr, "\n  %s\n", line);
+    }
+    CHECK(bytes == expected);
+    printf("  %-9s %s, %zu bytes\n", name.c_str(), GAME_NAMES[game], bytes.size());
+  }
+  for (int g = 0; g < NUM_GAMES; g++) {
+    if (GAME_PROFILES[g].patchPrefix != nullptr && patched[g] == 0) {
+      fprintf(stderr, "%s: no %s*.asm in %s\n", GAME_NAMES[g], GAME_PROFILES[g].patchPrefix, dir);
+      CHECK(patched[g] > 0);
+    }
+  }
+}
+
+static void emitDataAreas() {
+  char line[96];
+  for (int game = 0; game < NUM_GAMES; game++) {
+    if (!gameProfileFormatDataArea(game, line, sizeof(line))) {
+      continue;
+    }
+    printf("# %s: %s*.asm\ndataarea:\n%s\n%s\n", GAME_NAMES[game], GAME_PROFILES[game].patchPrefix,
+           GAME_LINK_DATAAREA_COMMENT, line);
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1 && strcmp(argv[1], "--emit") == 0) {
+    emitDataAreas();
+    return 0;
+  }
+  printf("test_game_profiles\n");
+  checkTables();
+  if (argc > 1) {
+    checkPatches(argv[1]);
+  } else {
+    printf("  no patch folder given, dataarea lines not checked\n");
+  }
+  return hostTestResult("test_game_profiles");
+}
@@ -0,0 +1,193 @@
+// test_gba_link_codec.cpp - GBA link encoding, patch model and simulator (GbaLinkCodec.h)
+//
+// The v2 Gray code must change one bit per one-bar step, so every mix of
+// old and new halves the patch can assemble decodes to the old or the new
+// count. v1 must show the mixes that make its patches wait for a second
+// read. The decoder is driven read by read through the commit rules of
+// both patches. The simulator then runs the 'g' scenarios over many seeds:
+// v2 must commit faster than v1 on average with fewer false commits in
+// every scenario, and for one-bar steps on the timer also at worst, with
+// almost no false commits. With jumps, v2's false commits must stay under
+// 4% of changes on the timer and 9% with polled phases.
+#include <stdio.h>
+
+#include "HostTest.h"
+#include "GbaLinkCodec.h"
+
+static const int MAX_BARS = 10;   // Largest bar count any game sends
+
+static uint8_t halvesOf(uint8_t lowFrom, uint8_t highFrom) {
+  return (uint8_t)((lowFrom & 0x03) | (highFrom & 0x0C));
+}
+
+static void checkCodes() {
+  for (int v = 0; v < 16; v++) {
+    CHECK_EQ(gbaLinkEncode((uint8_t)v, false), v);
+    CHECK_EQ(gbaLinkGrayDecode(gbaLinkEncode((uint8_t)v, true)), v);
+    // The GBA's own SO line is grounded, so no code looks like "no link"
+    CHECK((gbaLinkPortBits(gbaLinkEncode((uint8_t)v, true), false) & 0x0F) != GBA_LINK_NO_LINK);
+    CHECK((gbaLinkPortBits(gbaLinkEncode((uint8_t)v, true), true) & 0x0F) != GBA_LINK_NO_LINK);
+  }
+
+  int v1Mixed = 0;
+  for (int v = 0; v < MAX_BARS; v++) {
+    for (int step = 0; step < 2; step++) {
+      uint8_t from = (uint8_t)(step == 0 ? v : v + 1);
+      uint8_t to = (uint8_t)(step == 0 ? v + 1 : v);
+      uint8_t a = gbaLinkEncode(from, true);
+      uint8_t b = gbaLinkEncode(to, true);
+      uint8_t diff = a ^ b;
+      CHECK(diff != 0 && (diff & (diff - 1)) == 0);   // Exactly one bit
+      for (int mix = 0; mix < 2; mix++) {
+        uint8_t code = mix ? halvesOf(a, b) : halvesOf(b, a);
+        uint8_t decoded = gbaLinkGrayDecode(code);
+        CHECK(decoded == from || decoded == to);
+        uint8_t plain = mix ? halvesOf(from, to) : halvesOf(to, from);
+        v1Mixed += (plain != from && plain != to) ? 1 : 0;
+      }
+    }
+  }
+  // 3 <-> 4 and 7 <-> 8 change both halves
+  CHECK(v1Mixed > 0);
+  CHECK_EQ(halvesOf(5, 6), 5);   // Only the low half changes
+  CHECK_EQ(halvesOf(6, 5), 6);
+  CHECK_EQ(halvesOf(3, 4), 7);
+  CHECK_EQ(halvesOf(4, 3), 0);
+  printf("  codes: v1 has %d mixed-half values for one-bar steps, v2 none\n", v1Mixed);
+}
+
+// One read of a code in a phase; returns the committed index or -1
+static int readPhase(GbaLinkDecoder& decoder, uint8_t value, bool phaseHigh) {
+  uint8_t index = 0;
+  uint8_t code = gbaLinkEncode(value, decoder.v2);
+  return decoder.read(gbaLinkPortBits(code, phaseHigh), &index) ? index : -1;
+}
+
+static void checkDecoder() {
+  for (int v2 = 0; v2 < 2; v2++) {
+    for (int value = 0; value <= MAX_BARS; value++) {
+      // From reset: both halves, then a matching read commits
+      GbaLinkDecoder decoder;
+      decoder.reset(v2 != 0);
+      readPhase(decoder, (uint8_t)value, false);
+      readPhase(decoder, (uint8_t)value, true);
+      CHECK_EQ(readPhase(decoder, (uint8_t)value, false), value);
+      CHECK_EQ(readPhase(decoder, (uint8_t)value, true), value);
+
+      // All lines high: "no link", passed through as its own index
+      uint8_t index = 0;
+      CHECK(decoder.read(GBA_LINK_NO_LINK, &index));
+      CHECK_EQ(index, GBA_LINK_NO_LINK);
+    }
+
+    // One-bar steps up and down from every value: v2 commits on the first
+    // read that sees the changed half if the frame before read the other
+    // phase, and one read later if it read the same phase; v1 needs a
+    // second matching read
+    for (int from = 0; from <= MAX_BARS; from++) {
+      for (int dir = -1; dir <= 1; dir += 2) {
+        int to = from + dir;
+        if (to < 0 || to > MAX_BARS) {
+          continue;
+        }
+        uint8_t changed = gbaLinkEncode((uint8_t)from, v2 != 0) ^ gbaLinkEncode((uint8_t)to, v2 != 0);
+        bool highChanged = (changed & 0x0C) != 0;
+        for (int samePhase = 0; samePhase < 2; samePhase++) {
+          GbaLinkDecoder decoder;
+          decoder.reset(v2 != 0);
+          for (int i = 0; i < 4; i++) {
+            readPhase(decoder, (uint8_t)from, ((i & 1) != 0) == (highChanged == (samePhase != 0)));
+          }
+          int first = readPhase(decoder, (uint8_t)to, highChanged);
+          if (v2 && !samePhase) {
+            CHECK_EQ(first, to);
+          } else if (v2) {
+            CHECK_EQ(first, -1);
+            CHECK_EQ(readPhase(decoder, (uint8_t)to, !highChanged), to);
+          } else {
+            CHECK_EQ(first, -1);
+            int second = readPhase(decoder, (uint8_t)to, !highChanged);
+            int third = readPhase(decoder, (uint8_t)to, highChanged);
+            CHECK(second == to || third == to);   // Third when both halves changed
+          }
+        }
+      }
+    }
+
+    // A multi-bar jump waits for two reads that assemble the same value.
+    // 2 -> 9 first reads 1 (the new low half next to the old high half).
+    // After a read of the other phase, v2's one-bar rule commits it: the
+    // false commits the simulator still shows for jumps. After a read of
+    // the same phase the old high half may be stale, so v2 waits.
+    for (int samePhase = 0; samePhase < 2; samePhase++) {
+      GbaLinkDecoder decoder;
+      decoder.reset(v2 != 0);
+      for (int i = 0; i < 4; i++) {
+        readPhase(decoder, 2, ((i & 1) != 0) != (samePhase != 0));
+      }
+      int jump = readPhase(decoder, 9, false);
+      CHECK_EQ(jump, (v2 && !samePhase) ? 1 : -1);
+      CHECK_EQ(readPhase(decoder, 9, true), -1);
+      CHECK_EQ(readPhase(decoder, 9, false), 9);
+    }
+  }
+}
+
+static void checkSimulator() {
+  const int SEEDS = 10;
+  const uint32_t PHASE_US = 5000;
+  for (const GbaLinkSimScenario& scenario : GBA_LINK_SIM_SCENARIOS) {
+    GbaLinkSimResult total[2] = {};
+    uint64_t latencySumUs[2] = {};
+    for (int seed = 0; seed < SEEDS; seed++) {
+      for (int v2 = 0; v2 < 2; v2++) {
+        GbaLinkSimResult result;
+        gbaLinkSimulate(gbaLinkSimScenarioConfig(scenario, v2 != 0, PHASE_US, 600000UL, 1000 + seed), &result);
+        // Every change is committed, superseded, or still pending at the end
+        CHECK(result.committed + result.superseded <= result.changes);
+        CHECK(result.committed + result.superseded + 1 >= result.changes);
+        total[v2].changes += result.changes;
+        total[v2].committed += result.committed;
+        total[v2].falseCommits += result.falseCommits;
+        latencySumUs[v2] += (uint64_t)result.latencyAvgUs * result.committed;
+        if (result.latencyMaxUs > total[v2].latencyMaxUs) {
+          total[v2].latencyMaxUs = result.latencyMaxUs;
+        }
+      }
+    }
+    // Same seeds, same changes sent
+    CHECK_EQ(total[0].changes, total[1].changes);
+    uint64_t avgUs[2];
+    for (int v2 = 0; v2 < 2; v2++) {
+      avgUs[v2] = total[v2].committed ? latencySumUs[v2] / total[v2].committed : 0;
+    }
+    CHECK(total[1].falseCommits < total[0].falseCommits);
+    CHECK(avgUs[1] < avgUs[0]);
+    // With the timer, one-bar steps are also faster at worst and almost
+    // never false. Polled phases can drift in step with the game frame, so
+    // the GBA reads one phase for several frames running. Neither protocol
+    // sees a change in the other half until that ends, and v2 commits some
+    // of these late changes that v1 never commits before the next one. So
+    // v2's polled worst case is not better there.
+    if (scenario.jumpPercent == 0 && scenario.jitterUs == 0) {
+      CHECK(total[1].latencyMaxUs <= total[0].latencyMaxUs);
+      CHECK(total[1].falseCommits * 500 < total[1].changes);   // Under 0.2%
+    }
+    // Jumps that tear next to the old value between two reads
+    if (scenario.jumpPercent > 0) {
+      uint32_t capPercent = (scenario.jitterUs == 0) ? 4 : 9;
+      CHECK(total[1].falseCommits * 100 < total[1].changes * capPercent);
+    }
+    printf("  %-13s v1 %5.2f%% false, %4.1f/%5.1f ms   v2 %5.2f%% false, %4.1f/%5.1f ms\n", scenario.name,
+           total[0].falseCommits * 100.0 / total[0].changes, avgUs[0] / 1000.0, total[0].latencyMaxUs / 1000.0,
+           total[1].falseCommits * 100.0 / total[1].changes, avgUs[1] / 1000.0, total[1].latencyMaxUs / 1000.0);
+  }
+}
+
+int main() {
+  printf("test_gba_link_codec\n");
+  checkCodes();
+  checkDecoder();
+  checkSimulator();
+  return hostTestResult("test_gba_link_codec");
+}
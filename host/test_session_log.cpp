@@ -0,0 +1,315 @@
+// test_session_log.cpp - Session log blocks, raw dump and replay
+//
+// Synthetic sessions (random-walk raw counts, both range modes, game
+// changes, battery readings, long gaps and full-scale jumps) are written
+// into 4096-byte blocks and read back field for field. Every block is then
+// torn at every byte offset, as an interrupted flash write leaves it
+// (erased 0xFF from the cut on): the reader must return exactly the
+// records that were complete before the cut and stop. The raw 'L' dump is
+// printed and parsed back, and SessionLogReplay is checked against the
+// firmware's raw-count bar tables, which is what loop() classifies
+// unsmoothed samples with.
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+#include "FirmwareConfig.h"
+#include "SessionLogFormat.h"
+#include "SessionLogReplay.h"
+
+static const size_t BLOCK_BYTES = 4096;   // SESSION_LOG_BLOCK_BYTES
+
+static uint32_t rngState = 0x9E3779B9;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+static int32_t rngRange(int32_t lo, int32_t hi) {
+  return lo + (int32_t)(rngNext() % (uint32_t)(hi - lo + 1));
+}
+
+struct Block {
+  std::vector<uint8_t> bytes;
+  SessionLogBlockHeader header;
+  std::vector<SessionLogSample> samples;   // As the reader should return them
+  std::vector<size_t> recordEnds;          // Offset just past each record
+};
+
+struct Log {
+  std::vector<Block> blocks;
+};
+
+static void checkSame(const SessionLogSample& got, const SessionLogSample& want) {
+  CHECK_EQ(got.timeMs, want.timeMs);
+  CHECK_EQ(got.rawUVS, want.rawUVS);
+  CHECK_EQ(got.uviMilli, want.uviMilli);
+  CHECK_EQ(got.bars, want.bars);
+  CHECK_EQ(got.game, want.game);
+  CHECK_EQ(got.rangeMode, want.rangeMode);
+  CHECK_EQ(got.hasBattery, want.hasBattery);
+  CHECK_EQ(got.batteryMv, want.batteryMv);
+}
+
+// Sessions the way logSessionSample() writes them: one writer per block,
+// a new block when the next record might not fit
+static Log writeLog(int sessions, int samplesPerSession) {
+  Log log;
+  uint32_t sequence = 0;
+  for (int session = 1; session <= sessions; session++) {
+    SessionLogBlockWriter writer;
+    Block block;
+    bool open = false;
+    uint32_t timeMs = (uint32_t)rngRange(500, 3000);
+    int32_t raw = rngRange(0, 200000);
+    uint8_t game = (uint8_t)rngRange(0, NUM_GAMES - 1);
+    uint8_t range = 0;
+    uint16_t batteryMv = 0;
+    for (int i = 0; i < samplesPerSession; i++) {
+      // Mostly small steps, now and then a jump across the whole range
+      raw += rngRange(-3000, 3000);
+      if (rngRange(0, 200) == 0) raw = (rngNext() & 1) ? 0xFFFFF : 0;
+      raw = (raw < 0) ? 0 : (raw > 0xFFFFF ? 0xFFFFF : raw);
+      if (rngRange(0, 100) == 0) range ^= 1;
+      if (rngRange(0, 300) == 0) game = (uint8_t)((game + 1) % NUM_GAMES);
+      timeMs += (range == 0) ? 500 : 100;
+      if (rngRange(0, 500) == 0) timeMs += (uint32_t)rngRange(60000, 2000000000);
+
+      SessionLogSample s;
+      s.timeMs = timeMs;
+      s.rawUVS = (uint32_t)raw;
+      s.uviMilli = (int32_t)(raw * 1000LL / ((range == 0) ? 2300 : 575)) - rngRange(0, 40);
+      s.bars = (uint8_t)rngRange(0, GAME_BARS[game]);
+      s.game = game;
+      s.rangeMode = range;
+      s.hasBattery = (i % 60) == 0;
+      if (s.hasBattery) {
+        batteryMv = (uint16_t)rngRange(3300, 4200);
+      }
+      s.batteryMv = s.hasBattery ? batteryMv : 0;
+
+      if (!open || !writer.append(s)) {
+        if (open) {
+          writer.finish();
+          log.blocks.push_back(block);
+        }
+        block = Block();
+        block.bytes.assign(BLOCK_BYTES, 0);
+        block.header = { (uint16_t)session, sequence++, timeMs };
+        writer.begin(block.bytes.data(), BLOCK_BYTES, (uint16_t)session, block.header.sequence, timeMs);
+        open = true;
+        CHECK(writer.append(s));
+      }
+      // The reader carries the last voltage logged in the same block
+      SessionLogSample expected = s;
+      if (!s.hasBattery) {
+        expected.batteryMv = block.samples.empty() ? 0 : block.samples.back().batteryMv;
+      }
+      block.samples.push_back(expected);
+      block.recordEnds.push_back(writer.bytesUsed());
+    }
+    writer.finish();
+    log.blocks.push_back(block);
+  }
+  return log;
+}
+
+static void checkRoundTrip(const Log& log) {
+  size_t records = 0;
+  size_t bytes = 0;
+  for (const Block& block : log.blocks) {
+    SessionLogBlockReader reader;
+    SessionLogBlockHeader header = {};
+    CHECK(reader.begin(block.bytes.data(), BLOCK_BYTES, &header));
+    CHECK_EQ(header.session, block.header.session);
+    CHECK_EQ(header.sequence, block.header.sequence);
+    CHECK_EQ(header.startMs, block.header.startMs);
+    SessionLogSample sample;
+    size_t n = 0;
+    while (reader.next(&sample)) {
+      if (n < block.samples.size()) {
+        checkSame(sample, block.samples[n]);
+      }
+      n++;
+    }
+    CHECK_EQ(n, block.samples.size());
+    records += n;
+    bytes += block.recordEnds.back() - SESSION_LOG_HEADER_BYTES;
+  }
+  printf("  round trip: %zu records in %zu blocks, %.2f bytes per record\n", records, log.blocks.size(),
+         (double)bytes / records);
+}
+
+// Erased flash from `cut` on, at every offset of every block
+static void checkTorn(const Log& log) {
+  uint64_t cuts = 0;
+  for (const Block& block : log.blocks) {
+    std::vector<uint8_t> torn(BLOCK_BYTES);
+    for (size_t cut = 0; cut <= block.recordEnds.back(); cut++) {
+      memcpy(torn.data(), block.bytes.data(), cut);
+      memset(torn.data() + cut, SESSION_LOG_PAD, BLOCK_BYTES - cut);
+      SessionLogBlockReader reader;
+      SessionLogBlockHeader header;
+      bool valid = reader.begin(torn.data(), BLOCK_BYTES, &header);
+      if (cut < 4) {
+        CHECK(!valid);   // Magic not written
+        continue;
+      }
+      CHECK(valid);
+      size_t complete = 0;
+      while (complete < block.recordEnds.size() && block.recordEnds[complete] <= cut) {
+        complete++;
+      }
+      if (cut < SESSION_LOG_HEADER_BYTES) {
+        continue;   // Header fields partly erased; records are not reached
+      }
+      SessionLogSample sample;
+      size_t n = 0;
+      while (reader.next(&sample)) {
+        if (n < complete) {
+          checkSame(sample, block.samples[n]);
+        }
+        n++;
+      }
+      CHECK_EQ(n, complete);
+      cuts++;
+    }
+  }
+  printf("  torn blocks: %llu cut offsets, each returned exactly the complete records\n", (unsigned long long)cuts);
+
+  // Lost header: the whole block is skipped
+  std::vector<uint8_t> bad = log.blocks[0].bytes;
+  bad[1] ^= 0x40;
+  SessionLogBlockReader reader;
+  SessionLogBlockHeader header;
+  CHECK(!reader.begin(bad.data(), BLOCK_BYTES, &header));
+}
+
+static void checkRawDump(const Log& log) {
+  std::vector<std::string> lines = { "Session log: 3 files", "l" };
+  char line[2 * SESSION_LOG_RAW_LINE_BYTES + 1];
+  sessionLogFormatRawBegin(line, sizeof(line), BLOCK_BYTES);
+  lines.push_back(line);
+  for (const Block& block : log.blocks) {
+    for (size_t offset = 0; offset < BLOCK_BYTES; offset += SESSION_LOG_RAW_LINE_BYTES) {
+      sessionLogFormatRawLine(line, block.bytes.data() + offset, SESSION_LOG_RAW_LINE_BYTES);
+      lines.push_back(line);
+    }
+  }
+  lines.push_back(SESSION_LOG_RAW_END);
+
+  static SessionLogRawParser parser;
+  size_t index = 0;
+  bool same = true;
+  for (const std::string& text : lines) {
+    CHECK(parser.line(text.c_str(), [&](const uint8_t* block, size_t blockBytes) {
+      same = same && index < log.blocks.size() && blockBytes == BLOCK_BYTES &&
+             memcmp(block, log.blocks[index].bytes.data(), BLOCK_BYTES) == 0;
+      index++;
+    }));
+  }
+  CHECK(parser.done());
+  CHECK(same);
+  CHECK_EQ(index, log.blocks.size());
+  CHECK_EQ(parser.blockCount(), log.blocks.size());
+
+  // A capture cut off mid-block, and a bad hex digit
+  auto ignore = [](const uint8_t*, size_t) {};
+  static SessionLogRawParser cut;
+  for (size_t i = 0; i < 2 + 1 + 64 + 10; i++) {
+    cut.line(lines[i].c_str(), ignore);
+  }
+  CHECK(!cut.line(SESSION_LOG_RAW_END, ignore));
+  CHECK(cut.failed());
+  static SessionLogRawParser badHex;
+  badHex.line(lines[2].c_str(), ignore);
+  std::string corrupt = lines[3];
+  corrupt[17] = 'g';
+  CHECK(!badHex.line(corrupt.c_str(), ignore));
+  static SessionLogRawParser badSize;
+  CHECK(!badSize.line("# session log raw 100", ignore));
+}
+
+// Unsmoothed replay must give what loop() showed: the raw-count tables at
+// the sample's range divisor, hysteresis except after a session or game
+// change
+static void checkReplay(const Log& log) {
+  SessionLogReplayConfig config = getSessionLogReplayConfig();
+  config.filterPipeline = false;
+  config.smoothing = false;
+  for (float hysteresis : { 0.0f, 0.2f, 1.0f }) {
+    config.bars.hysteresis = hysteresis;
+    BarRawTables tables[2];
+    tables[0].rebuild(config.bars, config.rangeDivisor[0]);
+    tables[1].rebuild(config.bars, config.rangeDivisor[1]);
+    SessionLogReplay replay;
+    replay.begin(config);
+    int session = -1;
+    int game = -1;
+    int bars = 0;
+    uint64_t mismatches = 0;
+    uint64_t samples = 0;
+    for (const Block& block : log.blocks) {
+      for (const SessionLogSample& s : block.samples) {
+        bool restart = block.header.session != session || s.game != game;
+        const BarRawTables& t = tables[s.rangeMode];
+        bars = restart ? t.bars(s.rawUVS, s.game) : t.barsWithHysteresis(s.rawUVS, s.game, bars);
+        session = block.header.session;
+        game = s.game;
+        mismatches += (replay.update(block.header, s) != bars) ? 1 : 0;
+        samples++;
+      }
+    }
+    CHECK_EQ(mismatches, 0);
+    printf("  replay vs raw tables, hysteresis %.1f: %llu samples, %llu mismatches\n", hysteresis,
+           (unsigned long long)samples, (unsigned long long)mismatches);
+  }
+
+  // Filter pipeline: a steady level settles on its bar count, and a new
+  // session starts over from the first sample without hysteresis
+  config = getSessionLogReplayConfig();
+  config.filterPipeline = true;
+  BarRawTables slow;
+  slow.rebuild(config.bars, config.rangeDivisor[0]);
+  SessionLogReplay replay;
+  replay.begin(config);
+  SessionLogBlockHeader first = { 1, 0, 0 };
+  SessionLogBlockHeader second = { 2, 1, 0 };
+  SessionLogSample s = {};
+  s.rawUVS = 40000;
+  int bars = 0;
+  for (int i = 0; i < 100; i++) {
+    s.timeMs = 500 * i;
+    bars = replay.update(first, s);
+  }
+  CHECK_EQ(bars, slow.bars(40000, 0));
+  s.rawUVS = 2000;
+  s.timeMs = 0;
+  CHECK_EQ(replay.update(second, s), slow.bars(2000, 0));
+  CHECK(fabsf(replay.uvi() - barCompareUvi(config.bars, 2000, config.rangeDivisor[0])) < 0.001f);
+
+  // CSV row as the device prints it
+  char line[128];
+  SessionLogSample row = {};
+  row.timeMs = 123456;
+  row.rawUVS = 23000;
+  row.uviMilli = 15230;
+  row.bars = 6;
+  row.game = 1;
+  row.rangeMode = 1;
+  row.batteryMv = 3987;
+  sessionLogFormatCsv(line, sizeof(line), second, row, 14.5f, 5);
+  CHECK(strcmp(line, "2,123456,2,1,23000,15.230,6,3987,14.500,5") == 0);
+}
+
+int main() {
+  printf("test_session_log\n");
+  Log log = writeLog(4, 6000);
+  checkRoundTrip(log);
+  checkTorn(log);
+  checkRawDump(log);
+  checkReplay(log);
+  return hostTestResult("test_session_log");
+}
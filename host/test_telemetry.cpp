@@ -0,0 +1,312 @@
+// test_telemetry.cpp - Telemetry frames, TX ring and parser (Telemetry.h)
+//
+// Frames round-trip field for field, and the CRC is the standard
+// CRC-16/CCITT-FALSE. A device-side stream is built the way loop() makes
+// it: frames pushed into TelemetryTx faster than a mock CDC port drains
+// them, with boot/perf text printed between drains. The parser must see
+// every frame the ring accepted, count the ones it dropped as seq gaps and
+// skip exactly the text. The same stream through a port that sometimes
+// takes less than it offered must stay frame-aligned: every accepted frame
+// still arrives, and only the stray partial copies are skipped. A device
+// that reboots mid-capture starts a new session instead of a 65535-frame
+// gap. Another stream is damaged in transit (garbage containing sync
+// bytes, flipped bits, lost bytes, frames cut short): every frame not
+// itself damaged must still come through, and the statistics must account
+// for the rest.
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+#include "HostTest.h"
+#include "Telemetry.h"
+
+static uint32_t rngState = 0xC0FFEE11;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+
+static TelemetrySample randomSample(uint16_t seq, uint32_t timeUs) {
+  TelemetrySample s;
+  s.seq = seq;
+  s.timeUs = timeUs;
+  s.rawUVS = rngNext() & 0xFFFFF;
+  s.uviMilli = (int32_t)(rngNext() % 40000) - 500;
+  s.bars = (uint8_t)(rngNext() % 11);
+  s.numBars = (rngNext() & 1) ? 8 : 10;
+  s.game = (uint8_t)(rngNext() % 3);
+  s.rangeMode = (uint8_t)(rngNext() & 1);
+  s.batteryAdc = (uint16_t)(rngNext() & 0xFFF);
+  s.batteryMv = (uint16_t)(3300 + rngNext() % 900);
+  s.hidFlags = (uint8_t)(rngNext() & 0x0F);
+  s.hidMode = (uint8_t)(rngNext() % 3);
+  s.hidButtons = (uint16_t)rngNext();
+  s.dropped = rngNext() % 1000;
+  return s;
+}
+
+static bool sameSample(const TelemetrySample& a, const TelemetrySample& b) {
+  return a.seq == b.seq && a.timeUs == b.timeUs && a.rawUVS == b.rawUVS && a.uviMilli == b.uviMilli &&
+         a.bars == b.bars && a.numBars == b.numBars && a.game == b.game && a.rangeMode == b.rangeMode &&
+         a.batteryAdc == b.batteryAdc && a.batteryMv == b.batteryMv && a.hidFlags == b.hidFlags &&
+         a.hidMode == b.hidMode && a.hidButtons == b.hidButtons && a.dropped == b.dropped;
+}
+
+static void checkFrames() {
+  const uint8_t check[] = { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+  CHECK_EQ(telemetryCrc16(check, sizeof(check)), 0x29B1);
+
+  for (int i = 0; i < 10000; i++) {
+    TelemetrySample s = randomSample((uint16_t)rngNext(), rngNext());
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    CHECK_EQ(telemetryEncodeSample(s, frame), TELEMETRY_MAX_FRAME);
+    TelemetrySample d = {};
+    CHECK(telemetryDecodeSample(frame + 4, frame[2], &d));
+    CHECK(sameSample(s, d));
+    TelemetryParser parser;
+    size_t completed = 0;
+    for (size_t n = 0; n < TELEMETRY_MAX_FRAME; n++) {
+      completed += parser.feed(frame[n]) ? 1 : 0;
+    }
+    CHECK_EQ(completed, 1);
+    CHECK(sameSample(parser.sample(), s));
+  }
+}
+
+// CDC port that takes a random amount each drain, like a host that is
+// slow to poll. With shortWrites it sometimes takes less than it offered,
+// like a USB CDC write cut off by a timeout.
+struct MockPort {
+  std::vector<uint8_t>* out;
+  int room = 0;
+  bool shortWrites = false;
+  int availableForWrite() { return room; }
+  size_t write(const uint8_t* data, size_t len) {
+    if (shortWrites && len > 0 && rngNext() % 4 == 0) {
+      len = rngNext() % len;
+    }
+    out->insert(out->end(), data, data + len);
+    room -= (int)len;
+    return len;
+  }
+};
+
+static void checkDeviceStream(bool shortWrites) {
+  TelemetryTx<TELEMETRY_TX_BYTES> tx;
+  std::vector<uint8_t> wire;
+  MockPort port = { &wire, 0, shortWrites };
+  std::vector<TelemetrySample> accepted;
+  size_t textBytes = 0;
+  const char* const texts[] = { "Loop us avg/max/peak: 812/2410/5120\r\n", "I2C: 0 errors\r\n",
+                                "Battery: 3.91V (ADC 2422)\r\n" };
+  uint32_t timeUs = 4294000000u;   // Wraps during the run
+  const int SAMPLES = 20000;
+  for (int i = 0; i < SAMPLES; i++) {
+    TelemetrySample s = randomSample((uint16_t)i, timeUs);   // seq wraps at 65536 on the device too
+    s.dropped = tx.dropped();
+    timeUs += 100000;   // 10 Hz
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t len = telemetryEncodeSample(s, frame);
+    if (tx.push(frame, len)) {
+      accepted.push_back(s);
+    }
+    // Drained once per loop pass; the host reads in bursts and stalls
+    port.room = ((rngNext() % 4) == 0) ? (int)(rngNext() % 64) : (int)(rngNext() % 300);
+    if ((i / 2000) % 2 == 1) {
+      port.room = (int)(rngNext() % 40);   // Host not keeping up: the ring fills and drops
+    }
+    tx.drain(port, TELEMETRY_MAX_FRAME);
+    if (rngNext() % 50 == 0) {
+      const char* text = texts[rngNext() % 3];
+      wire.insert(wire.end(), text, text + strlen(text));
+      textBytes += strlen(text);
+    }
+  }
+  port.room = 1 << 30;
+  port.shortWrites = false;
+  tx.drain(port, TELEMETRY_MAX_FRAME);
+  CHECK_EQ(tx.pendingBytes(), 0);
+
+  TelemetryParser parser;
+  size_t index = 0;
+  bool inOrder = true;
+  for (uint8_t b : wire) {
+    if (parser.feed(b)) {
+      inOrder = inOrder && index < accepted.size() && sameSample(parser.sample(), accepted[index]);
+      index++;
+    }
+  }
+  CHECK(inOrder);
+  CHECK_EQ(index, accepted.size());
+  CHECK(tx.dropped() > 0);
+  CHECK_EQ(accepted.size() + tx.dropped(), SAMPLES);
+  CHECK_EQ(parser.framesOk(), accepted.size());
+  if (shortWrites) {
+    // Each cut leaves one partial copy: at most one bad frame, and its
+    // bytes skipped on top of the text
+    CHECK(tx.shortWrites() > 0);
+    CHECK(parser.badFrames() <= tx.shortWrites());
+    CHECK(parser.bytesSkipped() >= textBytes);
+    CHECK(parser.bytesSkipped() < textBytes + tx.shortWrites() * TELEMETRY_MAX_FRAME);
+  } else {
+    CHECK_EQ(tx.shortWrites(), 0);
+    CHECK_EQ(parser.badFrames(), 0);
+    CHECK_EQ(parser.bytesSkipped(), textBytes);
+  }
+  // Every frame the ring dropped shows up as a seq gap, except drops after
+  // the last frame that got through
+  uint32_t droppedAtLast = accepted.back().dropped;
+  CHECK_EQ(parser.framesMissing(), droppedAtLast);
+  CHECK_EQ(parser.deviceDropped(), droppedAtLast);
+  CHECK_EQ(parser.sessions(), 1);
+  CHECK(fabsf(parser.sampleRateHz() - 10.0f) < 0.001f);
+  printf("  device stream%s: %d samples, %u dropped by the ring, %u cut by the port, %zu delivered, "
+         "%u bytes skipped, %.3f Hz\n",
+         shortWrites ? " (short writes)" : "", SAMPLES, tx.dropped(), tx.shortWrites(), index,
+         parser.bytesSkipped(), parser.sampleRateHz());
+}
+
+// Two boots in one capture: seq and dropped restart from zero. Each
+// session's gaps count, the restart does not.
+static void checkRestart() {
+  std::vector<uint8_t> wire;
+  const int RUNS[2] = { 3000, 1200 };
+  uint32_t expectMissing = 0;
+  uint32_t expectDropped = 0;
+  for (int run = 0; run < 2; run++) {
+    uint32_t dropped = 0;
+    uint32_t timeUs = 5000000u * (uint32_t)(run + 1);
+    for (int i = 0; i < RUNS[run]; i++) {
+      if (i % 7 == 3) {
+        dropped++;   // Dropped by the ring: a seq gap
+        if (i < RUNS[run] - 1) {
+          expectMissing++;
+        }
+      } else {
+        TelemetrySample s = randomSample((uint16_t)i, timeUs + 100000u * (uint32_t)i);
+        s.dropped = dropped;
+        uint8_t frame[TELEMETRY_MAX_FRAME];
+        size_t len = telemetryEncodeSample(s, frame);
+        wire.insert(wire.end(), frame, frame + len);
+      }
+    }
+    expectDropped += dropped - ((RUNS[run] - 1) % 7 == 3 ? 1 : 0);
+  }
+  TelemetryParser parser;
+  for (uint8_t b : wire) {
+    parser.feed(b);
+  }
+  CHECK_EQ(parser.sessions(), 2);
+  CHECK_EQ(parser.framesMissing(), expectMissing);
+  CHECK_EQ(parser.deviceDropped(), expectDropped);
+  CHECK(fabsf(parser.sampleRateHz() - 10.0f) < 0.001f);
+  printf("  restart: %u sessions, %u missing, %u dropped by device, %.3f Hz\n", parser.sessions(),
+         parser.framesMissing(), parser.deviceDropped(), parser.sampleRateHz());
+
+  // A restart that keeps climbing past the old seq still shows in the
+  // dropped count falling
+  parser = TelemetryParser();
+  uint8_t frame[TELEMETRY_MAX_FRAME];
+  TelemetrySample s = randomSample(10, 0);
+  s.dropped = 40;
+  size_t len = telemetryEncodeSample(s, frame);
+  for (size_t n = 0; n < len; n++) parser.feed(frame[n]);
+  s = randomSample(20, 1000000);
+  s.dropped = 0;
+  len = telemetryEncodeSample(s, frame);
+  for (size_t n = 0; n < len; n++) parser.feed(frame[n]);
+  CHECK_EQ(parser.sessions(), 2);
+  CHECK_EQ(parser.framesMissing(), 0);
+}
+
+static void checkDamagedStream() {
+  const int FRAMES = 50000;
+  std::vector<uint8_t> wire;
+  std::vector<TelemetrySample> sent;
+  std::vector<bool> damaged;
+  uint32_t timeUs = 0;
+  for (int i = 0; i < FRAMES; i++) {
+    TelemetrySample s = randomSample((uint16_t)i, timeUs);
+    s.dropped = 0;
+    timeUs += 100000;
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t len = telemetryEncodeSample(s, frame);
+    bool hurt = true;
+    switch (rngNext() % 20) {
+      case 0:   // Bit flip
+        frame[rngNext() % len] ^= (uint8_t)(1u << (rngNext() % 8));
+        break;
+      case 1: { // Lost byte
+        size_t at = rngNext() % len;
+        memmove(frame + at, frame + at + 1, len - at - 1);
+        len--;
+        break;
+      }
+      case 2:   // Truncated (port reset mid-frame)
+        len = 1 + rngNext() % (len - 1);
+        break;
+      default:
+        hurt = false;
+        break;
+    }
+    // Garbage before the frame, sometimes with sync bytes in it
+    if (rngNext() % 10 == 0) {
+      size_t junk = rngNext() % 40;
+      for (size_t k = 0; k < junk; k++) {
+        uint32_t r = rngNext() % 8;
+        wire.push_back(r == 0 ? TELEMETRY_SYNC0 : (r == 1 ? TELEMETRY_SYNC1 : (uint8_t)rngNext()));
+      }
+    }
+    wire.insert(wire.end(), frame, frame + len);
+    sent.push_back(s);
+    damaged.push_back(hurt);
+  }
+
+  TelemetryParser parser;
+  std::vector<bool> received(FRAMES, false);
+  size_t wrong = 0;
+  for (uint8_t b : wire) {
+    if (parser.feed(b)) {
+      const TelemetrySample& s = parser.sample();
+      // Frames are 0..FRAMES-1 with seq = index mod 65536
+      if (s.seq < FRAMES && sameSample(s, sent[s.seq])) {
+        received[s.seq] = true;
+      } else {
+        wrong++;
+      }
+    }
+  }
+  size_t intactLost = 0;
+  size_t damagedCount = 0;
+  for (int i = 0; i < FRAMES; i++) {
+    if (damaged[i]) {
+      damagedCount++;
+    } else {
+      intactLost += received[i] ? 0 : 1;
+    }
+  }
+  CHECK_EQ(wrong, 0);
+  CHECK_EQ(intactLost, 0);
+  // Gaps are counted between the first and last frame received
+  int first = 0;
+  int last = FRAMES - 1;
+  while (!received[first]) first++;
+  while (!received[last]) last--;
+  CHECK_EQ(parser.framesOk() + parser.framesMissing(), last - first + 1);
+  printf("  damaged stream: %d frames, %zu damaged, %u received, %zu intact lost, %u bad, %u missing, %u bytes skipped\n",
+         FRAMES, damagedCount, parser.framesOk(), intactLost, parser.badFrames(), parser.framesMissing(),
+         parser.bytesSkipped());
+}
+
+int main() {
+  printf("test_telemetry\n");
+  checkFrames();
+  checkDeviceStream(false);
+  checkDamagedStream();
+  checkDeviceStream(true);
+  checkRestart();
+  return hostTestResult("test_telemetry");
+}
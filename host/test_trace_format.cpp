@@ -0,0 +1,280 @@
+// test_trace_format.cpp - Event trace decoding (TraceFormat.h)
+//
+// A synthetic session is written into a TraceStore the way traceEvent()
+// and traceFreeze() fill it: two cores with unsynchronized cycle counters
+// at 240 MHz, several counter wraps inside the ring, long idle gaps, a
+// ring that has been overwritten many times and an ISR whose stamp lands
+// just behind the event before it. Every decoded time must be the true
+// time to the microsecond, and the sensor->HID / sensor->GBA latencies
+// must be the ones the session was built with. The same is done with the
+// 1 MHz esp_timer clock across its 32-bit wrap, and the raw 'T' dump is
+// printed and parsed back.
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "HostTest.h"
+#include "TraceFormat.h"
+
+static uint32_t rngState = 0x1234567;
+static uint32_t rngNext() {
+  rngState ^= rngState << 13;
+  rngState ^= rngState >> 17;
+  rngState ^= rngState << 5;
+  return rngState;
+}
+static uint32_t rngRange(uint32_t lo, uint32_t hi) {
+  return lo + rngNext() % (hi - lo + 1);
+}
+
+struct TrueEvent {
+  int64_t us;        // esp_timer time
+  uint8_t core;
+  TraceEventType type;
+  uint8_t a;
+  uint16_t b;
+  int chain;         // Index into chains, or -1
+};
+
+struct Chain {
+  uint32_t hidUs;
+  uint32_t gbaUs;
+};
+
+struct Session {
+  uint32_t cpuMhz;
+  int64_t counterOffsetUs[2];   // Each core's counter started at a different time
+  std::vector<TrueEvent> events;
+  std::vector<Chain> chains;
+  int64_t freezeUs;
+
+  uint32_t counter(uint8_t core, int64_t us) const {
+    if (cpuMhz == 1) {
+      return (uint32_t)us;
+    }
+    return (uint32_t)((uint64_t)(us + counterOffsetUs[core]) * cpuMhz);
+  }
+
+  void add(int64_t us, uint8_t core, TraceEventType type, uint8_t a = 0, uint16_t b = 0, int chain = -1) {
+    events.push_back({ us, core, type, a, b, chain });
+  }
+
+  void store(TraceStore* out) const {
+    memset(out, 0, sizeof(*out));
+    for (size_t seq = 0; seq < events.size(); seq++) {
+      const TrueEvent& e = events[seq];
+      TraceRecord& record = out->records[seq & (TRACE_BUFFER_EVENTS - 1)];
+      record.cycles = counter(e.core, e.us);
+      record.info = traceRecordInfo(e.core, e.type, e.a, e.b);
+    }
+    out->head = (uint32_t)events.size();
+    out->cpuMhz = cpuMhz;
+    for (uint8_t core = 0; core < 2; core++) {
+      out->anchorUs[core] = freezeUs + core;   // The second core is anchored a little later
+      out->anchorCycles[core] = counter(core, freezeUs + core);
+    }
+    out->magic = TRACE_FROZEN_MAGIC;
+  }
+};
+
+// Sample -> bar change -> press (loop, core 1), USB submit and GBA phases
+// (core 0), then idle samples and flushes; now and then a long idle gap.
+// Every core sees an event at least every maxGapUs.
+static Session buildSession(uint32_t cpuMhz, int64_t startUs, uint32_t chains, uint32_t maxGapUs) {
+  Session s;
+  s.cpuMhz = cpuMhz;
+  s.counterOffsetUs[0] = 3000000;
+  s.counterOffsetUs[1] = 11000001;
+  int64_t t = startUs;
+  uint8_t bars = 0;
+  for (uint32_t i = 0; i < chains; i++) {
+    uint8_t newBars = (uint8_t)((bars + rngRange(1, 7)) % 9);
+    Chain chain;
+    chain.hidUs = rngRange(600, 2500);
+    chain.gbaUs = chain.hidUs + rngRange(4000, 70000);
+    int index = (int)s.chains.size();
+    s.chains.push_back(chain);
+    s.add(t, 1, TRACE_SENSOR_SAMPLE, 0, (uint16_t)rngNext(), index);
+    s.add(t + 250, 1, TRACE_BAR_CHANGE, newBars, bars, index);
+    s.add(t + chain.hidUs, 1, TRACE_HID_PRESS, TRACE_HID_USB, 1, index);
+    s.add(t + chain.hidUs + 40, 0, TRACE_USB_REPORT, TRACE_USB_DEFERRED, 1, index);
+    s.add(t + chain.hidUs + 900, 0, TRACE_USB_REPORT, TRACE_USB_SUBMITTED, 0, index);
+    s.add(t + chain.gbaUs - 2000, 0, TRACE_GBA_PHASE, 0, bars, index);   // Old value still going out
+    s.add(t + chain.gbaUs, 0, TRACE_GBA_PHASE, 1, newBars, index);
+    // An ISR stamped between the loop's cycle read and its slot claim
+    s.add(t + chain.gbaUs + 100, 0, TRACE_FLUSH_START, 0, 0, index);
+    s.add(t + chain.gbaUs + 97, 0, TRACE_BUTTON, 1, 1, index);
+    bars = newBars;
+    t += chain.gbaUs + 1000;
+
+    uint32_t idle = rngRange(0, 12);
+    for (uint32_t k = 0; k < idle; k++) {
+      t += 1000000;
+      s.add(t, 1, TRACE_SENSOR_SAMPLE, 0, (uint16_t)rngNext());
+      s.add(t + 5000, 0, TRACE_FLUSH_END, 0, 1024);
+    }
+    t += (rngRange(0, 2) == 0) ? rngRange(1000000, maxGapUs) : 250000;
+  }
+  s.freezeUs = t + 500000;
+  return s;
+}
+
+// Move the session so the middle of what the ring holds is at `us`
+static void centreRingAt(Session* s, int64_t us) {
+  size_t first = s->events.size() - TRACE_BUFFER_EVENTS;
+  int64_t delta = us - (s->events[first].us + s->freezeUs) / 2;
+  for (TrueEvent& e : s->events) {
+    e.us += delta;
+  }
+  s->freezeUs += delta;
+}
+
+struct Decoded {
+  uint32_t checked = 0;
+  uint32_t timeErrors = 0;
+  TraceLatencyPairing latency{ true };
+};
+
+static Decoded decode(const Session& s, const TraceStore& store) {
+  Decoded d;
+  TraceReader reader;
+  reader.begin(store);
+  CHECK_EQ(reader.events(), (s.events.size() < TRACE_BUFFER_EVENTS) ? s.events.size() : TRACE_BUFFER_EVENTS);
+  CHECK_EQ(reader.overwritten(), s.events.size() - reader.events());
+  CHECK_EQ(reader.cpuMhz(), s.cpuMhz);
+  size_t seq = s.events.size() - reader.events();
+  TraceEntry entry;
+  while (reader.read(&entry)) {
+    const TrueEvent& e = s.events[seq++];
+    CHECK_EQ(entry.type, e.type);
+    CHECK_EQ(entry.core, e.core);
+    CHECK_EQ(entry.a, e.a);
+    CHECK_EQ(entry.b, e.b);
+    if (entry.timeUs != e.us) {
+      d.timeErrors++;
+    }
+    d.checked++;
+    d.latency.add(entry);
+  }
+  CHECK_EQ(seq, s.events.size());
+  return d;
+}
+
+// Latencies of the chains whose sample is still in the ring
+static void expectedLatencies(const Session& s, TraceLatency* hid, TraceLatency* gba) {
+  size_t first = s.events.size() - ((s.events.size() < TRACE_BUFFER_EVENTS) ? s.events.size() : TRACE_BUFFER_EVENTS);
+  for (size_t seq = first; seq < s.events.size(); seq++) {
+    const TrueEvent& e = s.events[seq];
+    if (e.type == TRACE_SENSOR_SAMPLE && e.chain >= 0) {
+      hid->add(s.chains[e.chain].hidUs);
+      gba->add(s.chains[e.chain].gbaUs);
+    }
+  }
+}
+
+static void checkSession(const char* name, const Session& s, double minWraps) {
+  TraceStore store;
+  s.store(&store);
+  Decoded d = decode(s, store);
+  CHECK_EQ(d.timeErrors, 0);
+
+  TraceLatency hid;
+  TraceLatency gba;
+  expectedLatencies(s, &hid, &gba);
+  CHECK(hid.count > 0);
+  CHECK_EQ(d.latency.hid.count, hid.count);
+  CHECK_EQ(d.latency.hid.minUs, hid.minUs);
+  CHECK_EQ(d.latency.hid.maxUs, hid.maxUs);
+  CHECK_EQ(d.latency.hid.sumUs, hid.sumUs);
+  CHECK_EQ(d.latency.gba.count, gba.count);
+  CHECK_EQ(d.latency.gba.minUs, gba.minUs);
+  CHECK_EQ(d.latency.gba.maxUs, gba.maxUs);
+  CHECK_EQ(d.latency.gba.sumUs, gba.sumUs);
+
+  // Without the GBA link only the HID latency is paired
+  TraceLatencyPairing noGba(false);
+  TraceReader reader;
+  reader.begin(store);
+  TraceEntry entry;
+  while (reader.read(&entry)) {
+    noGba.add(entry);
+  }
+  CHECK_EQ(noGba.hid.count, hid.count);
+  CHECK_EQ(noGba.gba.count, 0);
+
+  // Wraps each core's counter went through while the ring was recorded
+  size_t first = s.events.size() - d.checked;
+  double spanS = (double)(s.freezeUs - s.events[first].us) / 1e6;
+  double wrapS = 4294967296.0 / s.cpuMhz / 1e6;
+  printf("  %-26s %u events over %.0f s (%.1f counter wraps), %u chains, %u time errors\n", name, d.checked, spanS,
+         spanS / wrapS, hid.count, d.timeErrors);
+  CHECK(spanS / wrapS >= minWraps);
+}
+
+static void checkRawRoundTrip(const Session& s) {
+  TraceStore store;
+  s.store(&store);
+  std::vector<std::string> lines = { "Event trace from the XInput session held; send 't' to dump it", "" };
+  char line[96];
+  traceFormatRawBegin(line, sizeof(line));
+  lines.push_back(line);
+  traceFormatRawHeader(line, sizeof(line), store);
+  lines.push_back(line);
+  for (uint32_t i = 0; i < TRACE_BUFFER_EVENTS; i++) {
+    traceFormatRawRecord(line, sizeof(line), store.records[i]);
+    lines.push_back(line);
+  }
+  lines.push_back(TRACE_RAW_END);
+
+  TraceRawParser parser;
+  for (const std::string& text : lines) {
+    CHECK(parser.line(text.c_str()));
+  }
+  CHECK(parser.done());
+  CHECK(memcmp(&parser.store, &store, sizeof(store)) == 0);
+
+  // A dump from a build with another ring size, and a truncated one
+  TraceRawParser other;
+  CHECK(!other.line("# trace raw 128"));
+  CHECK(other.failed());
+  TraceRawParser truncated;
+  for (size_t i = 0; i < lines.size() - 10; i++) {
+    truncated.line(lines[i].c_str());
+  }
+  CHECK(!truncated.line(TRACE_RAW_END));
+  CHECK(!truncated.done());
+}
+
+static void checkText() {
+  char line[96];
+  TraceEntry entry = { TRACE_GBA_PHASE, 0, 1, 7, 1000000 + 12034 };
+  traceFormatEntry(line, sizeof(line), entry, 1000000);
+  CHECK(strcmp(line, "12.034 0 gba 1 7") == 0);
+  TraceLatency latency;
+  traceFormatLatency(line, sizeof(line), "sensor->HID", latency);
+  CHECK(strcmp(line, "# sensor->HID us min/avg/max: n/a") == 0);
+  latency.add(100);
+  latency.add(301);
+  traceFormatLatency(line, sizeof(line), "sensor->HID", latency);
+  CHECK(strcmp(line, "# sensor->HID us min/avg/max: 100/200/301 (n=2)") == 0);
+}
+
+int main() {
+  printf("test_trace_format\n");
+  // Gaps up to 16 s per core: under one CCOUNT wrap (17.9 s at 240 MHz)
+  Session cycles = buildSession(240, 5000000, 400, 16000000);
+  checkSession("240 MHz cycle counter", cycles, 2.0);
+
+  // esp_timer stamps wrap at 2^32 us (71.6 min), halfway through the ring
+  Session timer = buildSession(1, 0, 400, 16000000);
+  centreRingAt(&timer, 4294967296LL);
+  checkSession("1 MHz esp_timer clock", timer, 0.0);
+
+  // Fewer events than the ring holds
+  Session shortSession = buildSession(240, 1000, 5, 2000000);
+  checkSession("ring not yet full", shortSession, 0.0);
+
+  checkRawRoundTrip(cycles);
+  checkText();
+  return hostTestResult("test_trace_format");
+}
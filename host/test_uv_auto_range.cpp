@@ -0,0 +1,320 @@
+// test_uv_auto_range.cpp - Range switching on sun/shade traces (UvAutoRange.h)
+//
+// Scripted samples check the thresholds, the dwell time, the second sample
+// before moving down, and that nothing changes with auto-ranging off. Synthetic sun/shade traces then run
+// through a model of the sensor: 400 ms samples every 500 ms in the slow
+// range, 100 ms ones in the fast range, counts at each range's divisor,
+// the first sample after a switch discarded as on the device. Each sample
+// goes through the bar pipeline of SessionLogReplay.h with this build's
+// config.h, so the latency is from the light changing to the bars showing
+// their settled level, end to end.
+//
+// With auto-ranging, no scene may settle fewer transitions or take longer
+// on average or at worst than the slow range alone, and steps between two
+// bright levels must settle in under half the time. Hysteresis: light
+// hovering at either threshold, with 10% noise, switches once and then
+// stays; every scene switches at most once per transition; and light that
+// jumps across the whole band every few samples switches no sooner than
+// one dwell after the last switch. The same hovering light with no band and
+// no dwell would flap, which shows the check can see it.
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "FirmwareConfig.h"
+#include "HostTest.h"
+
+struct TraceConfig {
+  float levelA;            // The trace starts here
+  float levelB;            // ... and alternates with this level
+  uint32_t holdMinMs;      // Time between transitions, uniformly random
+  uint32_t holdMaxMs;
+  uint32_t rampMs;         // Time to walk through the edge
+  uint32_t noisePermille;  // Reading noise, +/- uniform
+  uint32_t durationMs;
+  uint32_t seed;
+};
+
+struct TraceResult {
+  uint32_t transitions;    // Light changes that move the settled bars
+  uint32_t settled;        // ... that the bars reached before the next one
+  uint32_t latencyAvgMs;   // Transition start -> bars first at the settled level
+  uint32_t latencyMaxMs;
+  uint32_t samples;        // Samples classified (discarded ones not counted)
+  uint32_t switches;
+  uint32_t minSwitchGapMs; // Shortest time between two switches
+};
+
+static uint32_t rngNext(uint32_t* state) {
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+static SessionLogSample sampleAt(uint32_t timeMs, float uvi, int mode, int game) {
+  SessionLogSample sample = {};
+  float counts = uvi * getUvDivisorForRange(mode);
+  uint8_t res = UV_RANGE_MODES[mode].resolution;
+  uint32_t rawMax = (1UL << ((res == LTR390_RES_CODE_13BIT) ? 13 : 20 - res)) - 1;   // Data bits
+  sample.timeMs = timeMs;
+  sample.rawUVS = (counts <= 0.0f) ? 0 : (counts >= (float)rawMax) ? rawMax : (uint32_t)lroundf(counts);
+  sample.game = (uint8_t)game;
+  sample.rangeMode = (uint8_t)mode;
+  return sample;
+}
+
+// Where the bars come to rest after the light moves from one steady level
+// to another, without noise
+static int settledBars(int game, float fromUvi, float toUvi) {
+  SessionLogReplay replay;
+  replay.begin(getSessionLogReplayConfig());
+  SessionLogBlockHeader header = { 1, 0, 0 };
+  int bars = 0;
+  uint32_t t = 0;
+  for (int i = 0; i < 100; i++, t += 500) {
+    bars = replay.update(header, sampleAt(t, (i < 40) ? fromUvi : toUvi, UV_RANGE_SLOW, game));
+  }
+  return bars;
+}
+
+static TraceResult simulate(const TraceConfig& trace, const UvAutoRangeConfig& rangeConfig, int game) {
+  TraceResult r = {};
+  r.minSwitchGapMs = UINT32_MAX;
+  uint32_t rng = trace.seed ? trace.seed : 1;
+  uint32_t noiseRng = rng ^ 0x9E3779B9u;
+  auto hold = [&]() -> uint64_t {
+    uint32_t span = trace.holdMaxMs - trace.holdMinMs;
+    return trace.holdMinMs + (span ? rngNext(&rng) % (span + 1) : 0);
+  };
+  const int toA = settledBars(game, trace.levelB, trace.levelA);
+  const int toB = settledBars(game, trace.levelA, trace.levelB);
+
+  bool atA = true;
+  uint64_t lastEdgeMs = 0;
+  uint64_t nextEdgeMs = hold();
+  bool pending = false;
+  uint64_t pendingSinceMs = 0;
+  int pendingTarget = 0;
+  uint64_t latencySumMs = 0;
+  // Light at t, moving past any edges on the way (queries in time order)
+  auto light = [&](uint64_t t) -> float {
+    while (t >= nextEdgeMs) {
+      atA = !atA;
+      lastEdgeMs = nextEdgeMs;
+      nextEdgeMs += hold();
+      pending = (toA != toB) && lastEdgeMs < trace.durationMs;
+      pendingSinceMs = lastEdgeMs;
+      pendingTarget = atA ? toA : toB;
+      r.transitions += pending ? 1 : 0;
+    }
+    float to = atA ? trace.levelA : trace.levelB;
+    float from = atA ? trace.levelB : trace.levelA;
+    if (trace.rampMs > 0 && lastEdgeMs > 0 && t < lastEdgeMs + trace.rampMs) {
+      return from + (to - from) * (float)(t - lastEdgeMs) / (float)trace.rampMs;
+    }
+    return to;
+  };
+
+  UvAutoRange ranging;
+  ranging.configure(rangeConfig);
+  ranging.setMode(UV_RANGE_SLOW, 0);
+  SessionLogReplay replay;
+  replay.begin(getSessionLogReplayConfig());
+  SessionLogBlockHeader header = { 1, 0, 0 };
+  bool discard = false;
+  uint64_t lastSwitchMs = 0;
+  uint64_t t = 0;
+  while (t < trace.durationMs) {
+    int mode = ranging.mode();
+    const UvRangeMode& m = UV_RANGE_MODES[mode];
+    uint32_t intMs = (uint32_t)resolutionToIntegrationMs(m.resolution);
+    uint32_t rateMs = (uint32_t)measRateToMs(m.measRate);
+    uint64_t end = t + intMs;
+    float sum = 0.0f;
+    for (uint64_t s = t; s < end; s++) {
+      sum += light(s);
+    }
+    light(end);
+    t += (rateMs > intMs) ? rateMs : intMs;
+    if (discard) {
+      discard = false;   // Straddled the switch
+      continue;
+    }
+    int32_t n = (int32_t)(rngNext(&noiseRng) % (2 * trace.noisePermille + 1)) - (int32_t)trace.noisePermille;
+    SessionLogSample sample = sampleAt((uint32_t)end, sum / (float)intMs * (1.0f + n / 1000.0f), mode, game);
+    int bars = replay.update(header, sample);
+    r.samples++;
+    if (pending && bars == pendingTarget) {
+      uint64_t latencyMs = end - pendingSinceMs;
+      latencySumMs += latencyMs;
+      if (latencyMs > r.latencyMaxMs) {
+        r.latencyMaxMs = (uint32_t)latencyMs;
+      }
+      r.settled++;
+      pending = false;
+    }
+    // Measured UVI, as the sketch's updateUvAutoRange() gets it
+    if (ranging.update(barMeasuredUvi(sample.rawUVS, getUvDivisorForRange(mode)), (uint32_t)end)) {
+      if (r.switches > 0 && end - lastSwitchMs < r.minSwitchGapMs) {
+        r.minSwitchGapMs = (uint32_t)(end - lastSwitchMs);
+      }
+      lastSwitchMs = end;
+      r.switches++;
+      discard = true;
+    }
+  }
+  r.latencyAvgMs = r.settled ? (uint32_t)(latencySumMs / r.settled) : 0;
+  return r;
+}
+
+// Totals over several seeds
+static TraceResult simulateSeeds(TraceConfig trace, const UvAutoRangeConfig& rangeConfig, int game,
+                                 uint32_t seeds) {
+  TraceResult total = {};
+  total.minSwitchGapMs = UINT32_MAX;
+  uint64_t latencySumMs = 0;
+  for (uint32_t s = 0; s < seeds; s++) {
+    trace.seed = 1000 + s;
+    TraceResult r = simulate(trace, rangeConfig, game);
+    total.transitions += r.transitions;
+    total.settled += r.settled;
+    total.samples += r.samples;
+    total.switches += r.switches;
+    latencySumMs += (uint64_t)r.latencyAvgMs * r.settled;
+    if (r.latencyMaxMs > total.latencyMaxMs) {
+      total.latencyMaxMs = r.latencyMaxMs;
+    }
+    if (r.minSwitchGapMs < total.minSwitchGapMs) {
+      total.minSwitchGapMs = r.minSwitchGapMs;
+    }
+  }
+  total.latencyAvgMs = total.settled ? (uint32_t)(latencySumMs / total.settled) : 0;
+  return total;
+}
+
+static const UvAutoRangeConfig TEST_CONFIG = { true, 3.0f, 2.0f, 2000 };
+
+static void checkStateMachine() {
+  UvAutoRange ranging;
+  ranging.configure(TEST_CONFIG);
+  ranging.setMode(UV_RANGE_SLOW, 0);
+  CHECK(!ranging.update(5.0f, 1999));                // Dwell from the boot range too
+  CHECK(!ranging.update(2.99f, 2000));
+  CHECK(ranging.update(3.0f, 2000));
+  CHECK_EQ(ranging.mode(), UV_RANGE_FAST);
+  CHECK(!ranging.update(0.5f, 3999));                // Dwell
+  CHECK(!ranging.update(2.0f, 4000));                // Inside the band: stays fast
+  CHECK(!ranging.update(2.9f, 5000));
+  CHECK(!ranging.update(1.99f, 6000));               // Once could be mid-step
+  CHECK(!ranging.update(2.0f, 6100));
+  CHECK(!ranging.update(1.99f, 6200));
+  CHECK(ranging.update(1.0f, 6300));
+  CHECK_EQ(ranging.mode(), UV_RANGE_SLOW);
+  CHECK(!ranging.update(2.9f, 9000));                // Inside the band: stays slow
+  CHECK_EQ(ranging.switchCount(), 2);
+
+  // A range set from outside (warm resume) restarts the dwell
+  ranging.setMode(UV_RANGE_FAST, 10000);
+  CHECK(!ranging.update(0.0f, 11000));
+  CHECK(ranging.update(0.0f, 12000));                // Samples in the dwell count
+  // Millisecond wrap
+  ranging.setMode(UV_RANGE_SLOW, 0xFFFFFF00u);
+  CHECK(!ranging.update(5.0f, 0x00000100u));
+  CHECK(ranging.update(5.0f, 0x00000800u));
+
+  UvAutoRangeConfig off = TEST_CONFIG;
+  off.enabled = false;
+  ranging.configure(off);
+  ranging.setMode(UV_RANGE_SLOW, 0);
+  CHECK(!ranging.update(10.0f, 100000));
+  CHECK_EQ(ranging.mode(), UV_RANGE_SLOW);
+}
+
+struct RangeScene {
+  const char* name;
+  float sunUvi;
+  float shadeUvi;
+};
+
+// "bright" steps between two levels in the fast range, "walk" crosses the
+// band both ways, "shade" stays in the slow range
+static const RangeScene SCENES[] = {
+  { "bright", 9.0f, 4.5f },
+  { "walk", 8.5f, 1.2f },
+  { "shade", 2.4f, 0.8f },
+};
+
+static void checkLatency(const UvAutoRangeConfig& config) {
+  const uint32_t SEEDS = 3;
+  UvAutoRangeConfig off = config;
+  off.enabled = false;
+  for (int game = 0; game < NUM_GAMES; game++) {
+    for (const RangeScene& scene : SCENES) {
+      TraceConfig trace = { scene.sunUvi, scene.shadeUvi, 3000, 15000, 150, 20, 1800000UL, 0 };
+      TraceResult slow = simulateSeeds(trace, off, game, SEEDS);
+      TraceResult ranged = simulateSeeds(trace, config, game, SEEDS);
+      CHECK(slow.transitions > 0);
+      CHECK_EQ(ranged.transitions, slow.transitions);   // Same seeds, same light
+      CHECK_EQ(slow.switches, 0);
+      CHECK(ranged.settled >= slow.settled);
+      CHECK(ranged.latencyAvgMs <= slow.latencyAvgMs);
+      CHECK(ranged.latencyMaxMs <= slow.latencyMaxMs);
+      // At most one switch per transition, plus the first into the fast range
+      CHECK(ranged.switches <= ranged.transitions + SEEDS);
+      if (scene.shadeUvi >= config.fastAboveUvi) {
+        CHECK(2 * ranged.latencyAvgMs < slow.latencyAvgMs);
+        CHECK_EQ(ranged.switches, SEEDS);   // Into the fast range once, then never out
+      }
+      if (scene.sunUvi < config.fastAboveUvi) {
+        CHECK_EQ(ranged.switches, 0);
+      }
+      printf("  %-6s %-6s: %4lu/%4lu settled, avg %3lu -> %3lu ms, worst %4lu -> %4lu ms, %3lu switches\n",
+             GAME_NAMES[game], scene.name, (unsigned long)ranged.settled, (unsigned long)ranged.transitions,
+             (unsigned long)slow.latencyAvgMs, (unsigned long)ranged.latencyAvgMs,
+             (unsigned long)slow.latencyMaxMs, (unsigned long)ranged.latencyMaxMs,
+             (unsigned long)ranged.switches);
+    }
+  }
+}
+
+static void checkHysteresis(const UvAutoRangeConfig& config) {
+  // Steady light at the upper threshold: one switch up, then it stays
+  TraceConfig atFast = { config.fastAboveUvi, config.fastAboveUvi, 3000, 15000, 0, 100, 1800000UL, 7 };
+  TraceResult hover = simulate(atFast, config, 0);
+  CHECK_EQ(hover.switches, 1);
+
+  // Bright light for 15 minutes, then steady at the lower threshold: one
+  // switch up, one down, then it stays
+  TraceConfig drop = { 6.0f, config.slowBelowUvi, 900000UL, 900000UL, 0, 100, 1800000UL, 7 };
+  TraceResult r = simulate(drop, config, 0);
+  CHECK_EQ(r.switches, 2);
+
+  // Light jumping across the whole band every few samples: switches are a
+  // dwell apart at least
+  TraceConfig jumpy = { 6.0f, 0.5f, 200, 1200, 0, 20, 1800000UL, 7 };
+  r = simulate(jumpy, config, 0);
+  CHECK(r.switches > 10);
+  CHECK(r.minSwitchGapMs >= config.minDwellMs);
+  CHECK(r.switches <= jumpy.durationMs / config.minDwellMs + 1);
+  printf("  light jumping across the band: %lu switches, %lu ms apart at least\n", (unsigned long)r.switches,
+         (unsigned long)r.minSwitchGapMs);
+
+  // The same hovering light with no band and no dwell flaps
+  UvAutoRangeConfig noBand = { true, config.fastAboveUvi, config.fastAboveUvi, 0 };
+  TraceResult flaps = simulate(atFast, noBand, 0);
+  CHECK(flaps.switches > 100);
+  printf("  light at UVI %.1f: %lu switch with the band and dwell, %lu without\n", config.fastAboveUvi,
+         (unsigned long)hover.switches, (unsigned long)flaps.switches);
+}
+
+int main() {
+  printf("test_uv_auto_range\n");
+  checkStateMachine();
+  UvAutoRangeConfig config = getUvAutoRangeConfig();
+  config.enabled = true;   // Checked even in builds that turn it off
+  checkLatency(config);
+  checkHysteresis(config);
+  return hostTestResult("test_uv_auto_range");
+}
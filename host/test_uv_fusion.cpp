@@ -0,0 +1,228 @@
+// test_uv_fusion.cpp - Staggered sensor fusion on mocked sensors (UvFusion.h)
+//
+// Scripted samples check the calibration mapping, newest and average
+// fusion, the fresh window, offline sensors, and outlier rejection. A
+// sensor that keeps disagreeing is left out only after outlierStrikes
+// samples in a row, and only with three sensors online. It rejoins as soon
+// as it agrees again. A sun/shade step that reaches every sensor within
+// one cycle never leaves one out. The simulator then runs the 'm'
+// scenarios with the same light for every sensor count: N sensors must
+// deliver a sample every cycle/N and settle steps sooner, a dirty window
+// must be left out, and a sensor dropping off the bus must never stall the
+// stream for more than two sensors' share of a cycle.
+#include <stdio.h>
+#include <math.h>
+
+#include "FirmwareConfig.h"
+#include "HostTest.h"
+
+static const UvFusionConfig NEWEST = { false, 0.25f, 200.0f, 3, 500 };
+static const UvFusionConfig AVERAGE = { true, 0.25f, 200.0f, 3, 500 };
+
+static bool near(float a, float b) {
+  return fabsf(a - b) <= 0.01f;
+}
+
+static void setUp(UvFusion& fusion, const UvFusionConfig& config, int count) {
+  fusion.configure(config, count);
+  for (int i = 0; i < count; i++) {
+    fusion.setOnline(i, true);
+  }
+}
+
+static void checkCalibration() {
+  float scale = 0.0f;
+  float offset = 0.0f;
+  uvFusionCalibration(1.0f, 0.0f, true, 0.6f, 0.4f, 2300.0f, &scale, &offset);
+  CHECK(near(scale, 1.0f) && near(offset, 0.0f));   // No own window: same as the reference
+  uvFusionCalibration(1.25f, 0.0f, false, 0.6f, 0.4f, 2300.0f, &scale, &offset);
+  CHECK(near(scale, 0.8f) && near(offset, 0.0f));
+  uvFusionCalibration(0.0f, 0.0f, false, 0.6f, 0.4f, 2300.0f, &scale, &offset);
+  CHECK(near(scale, 1.0f));                          // Unset sensitivity
+  // A window twice as clear as the enclosure's: half the counts, plus half
+  // the enclosure offset the reference sees
+  uvFusionCalibration(1.0f, 1.2f, true, 0.6f, 0.4f, 2300.0f, &scale, &offset);
+  CHECK(near(scale, 0.5f) && near(offset, 0.4f * 2300.0f * 0.5f));
+  uvFusionCalibration(1.0f, 1.2f, false, 0.6f, 0.4f, 2300.0f, &scale, &offset);
+  CHECK(near(scale, 1.0f) && near(offset, 0.0f));   // Compensation off
+  uvFusionCalibration(2.0f, 0.3f, true, 0.6f, 0.0f, 2300.0f, &scale, &offset);
+  CHECK(near(scale, 1.0f) && near(offset, 0.0f));   // Dimmer window, less sensitive sensor
+
+  UvFusion fusion;
+  setUp(fusion, NEWEST, 2);
+  fusion.setCalibration(1, 0.5f, 100.0f);
+  float fused = 0.0f;
+  CHECK(fusion.add(1, 1000, 0, &fused));
+  CHECK(near(fused, 600.0f));
+  fusion.setCalibration(1, 1.0f, -500.0f);
+  CHECK(fusion.add(1, 100, 10, &fused));
+  CHECK(near(fused, 0.0f));                          // Never below zero
+}
+
+static void checkFusion() {
+  UvFusion fusion;
+  fusion.configure(NEWEST, 0);
+  CHECK_EQ(fusion.count(), 1);
+  fusion.configure(NEWEST, 9);
+  CHECK_EQ(fusion.count(), UV_FUSION_MAX_SENSORS);
+
+  // Newest: every accepted sample passes straight through
+  setUp(fusion, NEWEST, 3);
+  float fused = 0.0f;
+  CHECK(fusion.add(0, 1000, 0, &fused) && near(fused, 1000.0f));
+  CHECK(fusion.add(1, 1100, 166, &fused) && near(fused, 1100.0f));
+  CHECK(fusion.add(2, 900, 333, &fused) && near(fused, 900.0f));
+  CHECK_EQ(fusion.onlineCount(), 3);
+
+  // Average: the mean of the fresh samples
+  setUp(fusion, AVERAGE, 3);
+  CHECK(fusion.add(0, 1000, 0, &fused) && near(fused, 1000.0f));
+  CHECK(fusion.add(1, 1100, 166, &fused) && near(fused, 1050.0f));
+  CHECK(fusion.add(2, 900, 333, &fused) && near(fused, 1000.0f));
+  CHECK(fusion.add(0, 1300, 500, &fused) && near(fused, 1100.0f));   // Replaces sensor 0's sample
+  // Sensor 1's sample (166) is older than 500 ms at 700, sensor 2's is not
+  CHECK(fusion.add(0, 1300, 700, &fused) && near(fused, 1100.0f));
+  CHECK(fusion.add(0, 1300, 900, &fused) && near(fused, 1300.0f));   // Both stale
+
+  // Offline: forgotten at once, and rejoins with nothing held
+  setUp(fusion, AVERAGE, 3);
+  fusion.add(0, 1000, 0, &fused);
+  fusion.add(1, 2000, 100, &fused);
+  fusion.setOnline(1, false);
+  CHECK_EQ(fusion.onlineCount(), 2);
+  CHECK(near(fusion.lastCounts(1), 0.0f));
+  CHECK(fusion.add(2, 1000, 200, &fused) && near(fused, 1000.0f));
+  fusion.setOnline(1, true);
+  CHECK(fusion.add(0, 1000, 300, &fused) && near(fused, 1000.0f));
+}
+
+static void checkOutliers() {
+  UvFusion fusion;
+  float fused = 0.0f;
+  // Sensor 2 reads double: struck three times in a row, then left out
+  setUp(fusion, NEWEST, 3);
+  uint32_t t = 0;
+  int accepted = 0;
+  for (int cycle = 0; cycle < 5; cycle++) {
+    fusion.add(0, 1000, t, &fused);
+    fusion.add(1, 1010, t + 166, &fused);
+    accepted += fusion.add(2, 2000, t + 333, &fused) ? 1 : 0;
+    t += 500;
+  }
+  CHECK_EQ(accepted, 2);
+  CHECK(fusion.isExcluded(2));
+  CHECK_EQ(fusion.samples(2), 5);
+  CHECK_EQ(fusion.rejected(2), 3);
+  // A left-out sensor is not part of the others' median or the average
+  CHECK(fusion.add(0, 1000, t, &fused) && near(fused, 1000.0f));
+  // Agreeing once brings it back
+  CHECK(fusion.add(2, 1005, t + 333, &fused));
+  CHECK(!fusion.isExcluded(2));
+
+  // Within outlierMinCounts of the median (25% of 400 is less): not struck
+  setUp(fusion, NEWEST, 3);
+  t = 0;
+  for (int cycle = 0; cycle < 6; cycle++) {
+    fusion.add(0, 400, t, &fused);
+    fusion.add(1, 400, t + 166, &fused);
+    CHECK(fusion.add(2, 590, t + 333, &fused));
+    t += 500;
+  }
+
+  // Two sensors: no majority, nothing is left out
+  setUp(fusion, NEWEST, 2);
+  t = 0;
+  for (int cycle = 0; cycle < 6; cycle++) {
+    CHECK(fusion.add(0, 1000, t, &fused));
+    CHECK(fusion.add(1, 3000, t + 250, &fused));
+    t += 500;
+  }
+
+  // Three sensors, one offline: two left, so again nothing is left out
+  setUp(fusion, NEWEST, 3);
+  fusion.setOnline(1, false);
+  t = 0;
+  for (int cycle = 0; cycle < 6; cycle++) {
+    fusion.add(0, 1000, t, &fused);
+    CHECK(fusion.add(2, 3000, t + 333, &fused));
+    t += 500;
+  }
+
+  // Strikes disabled
+  UvFusionConfig never = NEWEST;
+  never.outlierStrikes = 0;
+  setUp(fusion, never, 3);
+  t = 0;
+  for (int cycle = 0; cycle < 6; cycle++) {
+    fusion.add(0, 1000, t, &fused);
+    fusion.add(1, 1000, t + 166, &fused);
+    CHECK(fusion.add(2, 5000, t + 333, &fused));
+    t += 500;
+  }
+
+  // Sun/shade steps reach the four staggered sensors within one cycle:
+  // whoever sees the step first is struck once at most, never left out
+  setUp(fusion, NEWEST, 4);
+  t = 0;
+  int rejectedSamples = 0;
+  for (int cycle = 0; cycle < 40; cycle++) {
+    for (int i = 0; i < 4; i++) {
+      uint32_t now = t + 125 * (uint32_t)i;
+      uint32_t raw = ((now / 2000) & 1) ? 20000 : 4000;
+      rejectedSamples += fusion.add(i, raw, now, &fused) ? 0 : 1;
+    }
+    t += 500;
+  }
+  CHECK_EQ(rejectedSamples, 0);
+}
+
+static void checkSimulator() {
+  const float divisor = getUvDivisorForRange(UV_RANGE_SLOW);
+  UvFusionConfig config = getUvFusionConfig(divisor, 500);
+  for (int average = 0; average < 2; average++) {
+    config.average = (average != 0);
+    UvFusionSimResult results[6];
+    for (int s = 0; s < 6; s++) {
+      const UvFusionSimScenario& scenario = UV_FUSION_SIM_SCENARIOS[s];
+      uvFusionSimulate(uvFusionSimScenarioConfig(scenario, divisor, config, 1800000UL, 777), &results[s]);
+      // Same light for every sensor count
+      CHECK_EQ(results[s].steps, results[0].steps);
+      CHECK(results[s].stepsSettled + 1 >= results[s].steps);
+      if (scenario.dirty < 0 && scenario.dropped < 0) {
+        uint32_t cycleShare = 500 / (uint32_t)scenario.sensors;
+        CHECK(results[s].intervalAvgMs <= cycleShare + 1);
+        CHECK(results[s].intervalMaxMs <= cycleShare + 1);
+        CHECK_EQ(results[s].rejected, 0);
+      }
+      printf("  %-8s %-7s %4lu ms apart (max %3lu), %2lu permille off, steps in %3lu ms, %4lu rejected\n",
+             scenario.name, average ? "average" : "newest", (unsigned long)results[s].intervalAvgMs,
+             (unsigned long)results[s].intervalMaxMs, (unsigned long)results[s].errorPermille,
+             (unsigned long)results[s].stepLatencyAvgMs, (unsigned long)results[s].rejected);
+    }
+    const UvFusionSimResult& x1 = results[0];
+    const UvFusionSimResult& x4 = results[3];
+    const UvFusionSimResult& dirty = results[4];
+    const UvFusionSimResult& drop = results[5];
+    if (!config.average) {
+      CHECK(x4.stepLatencyAvgMs < x1.stepLatencyAvgMs);   // Newest: faster
+    } else {
+      CHECK(x4.errorPermille < x1.errorPermille);         // Average: steadier
+    }
+    // The dirty sensor is left out, so the stream stays close to the truth
+    CHECK(dirty.rejected > 0);
+    CHECK(dirty.errorPermille <= x4.errorPermille + 5);
+    // A dropped sensor costs its share of the samples, never a stall
+    CHECK(drop.outputs < x4.outputs && drop.outputs > x4.outputs * 3 / 4);
+    CHECK(drop.intervalMaxMs <= 2 * 500 / 4);
+    CHECK_EQ(drop.rejected, 0);
+  }
+}
+
+int main() {
+  printf("test_uv_fusion\n");
+  checkCalibration();
+  checkFusion();
+  checkOutliers();
+  checkSimulator();
+  return hostTestResult("test_uv_fusion");
+}
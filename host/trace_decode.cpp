@@ -0,0 +1,72 @@
+// trace_decode.cpp - Decode a raw event trace dump ('T') on a PC
+//
+//   trace_decode [capture.txt] [--no-gba]
+//
+// Reads a Serial Monitor capture (or stdin), finds the raw dump in it and
+// prints the same timeline and sensor->HID / sensor->GBA latencies the 't'
+// dump prints on the device. --no-gba skips the GBA pairing for a trace
+// recorded with GBA_LINK_ENABLED = false.
+#include <stdio.h>
+#include <string.h>
+
+#include "TraceFormat.h"
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  bool gba = true;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--no-gba") == 0) {
+      gba = false;
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      fprintf(stderr, "usage: %s [capture.txt] [--no-gba]\n", argv[0]);
+      return 2;
+    } else {
+      path = argv[i];
+    }
+  }
+
+  FILE* in = (path == nullptr || strcmp(path, "-") == 0) ? stdin : fopen(path, "r");
+  if (in == nullptr) {
+    fprintf(stderr, "%s: cannot open %s\n", argv[0], path);
+    return 2;
+  }
+  static TraceRawParser parser;
+  char line[256];
+  while (!parser.done() && !parser.failed() && fgets(line, sizeof(line), in) != nullptr) {
+    line[strcspn(line, "\r\n")] = '\0';
+    parser.line(line);
+  }
+  if (in != stdin) {
+    fclose(in);
+  }
+  if (!parser.done()) {
+    fprintf(stderr, "%s: no complete raw trace dump (\"%s %u\" ... \"%s\") found\n", argv[0], TRACE_RAW_BEGIN,
+            (unsigned)TRACE_BUFFER_EVENTS, TRACE_RAW_END);
+    return 1;
+  }
+
+  TraceReader reader;
+  reader.begin(parser.store);
+  traceFormatSummary(line, sizeof(line), reader);
+  puts(line);
+  puts(TRACE_TIMELINE_HEADER);
+
+  TraceLatencyPairing latency(gba);
+  int64_t firstUs = 0;
+  bool first = true;
+  TraceEntry entry;
+  while (reader.read(&entry)) {
+    if (first) {
+      firstUs = entry.timeUs;
+      first = false;
+    }
+    traceFormatEntry(line, sizeof(line), entry, firstUs);
+    puts(line);
+    latency.add(entry);
+  }
+  traceFormatLatency(line, sizeof(line), "sensor->HID", latency.hid);
+  puts(line);
+  traceFormatLatency(line, sizeof(line), "sensor->GBA", latency.gba);
+  puts(line);
+  return 0;
+}
@@ -0,0 +1,50 @@
+// uv_fusion_sim.cpp - Staggered UV sensors fused on a PC (UvFusion.h)
+//
+//   uv_fusion_sim [--minutes M] [--seed S] [--average | --newest]
+//
+// Runs the same mocked-sensor scenarios as the device's 'm' command with
+// the fusion settings of the config.h this tool was built with, by default
+// for 60 minutes with the device's seed, so the table matches the device's.
+// --average and --newest override UV_SENSOR_FUSE_AVERAGE to compare the two.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "FirmwareConfig.h"
+
+int main(int argc, char** argv) {
+  uint32_t minutes = 60;
+  uint32_t seed = 12345;
+  const float divisor = getUvDivisorForRange(UV_RANGE_SLOW);
+  UvFusionConfig fusion = getUvFusionConfig(divisor, 500);
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--minutes") == 0 && i + 1 < argc) {
+      minutes = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+      seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--average") == 0) {
+      fusion.average = true;
+    } else if (strcmp(argv[i], "--newest") == 0) {
+      fusion.average = false;
+    } else {
+      fprintf(stderr, "usage: %s [--minutes M] [--seed S] [--average | --newest]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (minutes == 0) {
+    fprintf(stderr, "%s: --minutes must be at least 1\n", argv[0]);
+    return 2;
+  }
+
+  printf("# UV fusion simulation: 500ms cycle, 400ms integration, %lu min per run, %s\n", (unsigned long)minutes,
+         fusion.average ? "average" : "newest");
+  puts(UV_FUSION_SIM_TABLE_HEADER);
+  char line[96];
+  for (const UvFusionSimScenario& scenario : UV_FUSION_SIM_SCENARIOS) {
+    UvFusionSimResult result;
+    uvFusionSimulate(uvFusionSimScenarioConfig(scenario, divisor, fusion, minutes * 60000UL, seed), &result);
+    uvFusionSimFormatRow(line, sizeof(line), scenario.name, result);
+    puts(line);
+  }
+  return 0;
+}